@@ -101,6 +101,8 @@ Args::Ctor()
 
   doNormalizeTy = true;
 
+  prof_jobs = 1;
+
   prof_metrics = Analysis::Args::MetricFlg_NULL;
 
   profflat_computeFinalMetricValues = true;
@@ -115,6 +117,7 @@ Args::Ctor()
   db_copySrcFiles   = true;
   out_db_config     = "";
   db_makeMetricDB   = false;
+  db_metricDBSparse = false;
   db_addStructId    = false;
 
   out_txt           = Analysis_OUT_TXT;
@@ -142,6 +142,9 @@ public:
 
   bool doNormalizeTy;
 
+  // Number of threads for reading and merging profile files
+  uint prof_jobs;
+
   // -------------------------------------------------------
   // Attribution/Correlation arguments: special
   // -------------------------------------------------------
@@ -205,6 +208,7 @@ public:
   std::string out_db_config;     // disable: "", stdout: "-"
 
   bool db_makeMetricDB;
+  bool db_metricDBSparse;        // write a sparse (CSR) metric-db
   bool db_addStructId;
 
   // -------------------------------------------------------
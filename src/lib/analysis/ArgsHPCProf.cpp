@@ -118,6 +118,10 @@ Options: General:\n\
   -V, --version        Print version information.\n\
   -h, --help           Print this help.\n\
   --debug [<n>]        Debug: use debug level <n>. {1}\n\
+  -j <num>, --jobs <num>\n\
+                       Use <num> threads to read and merge profile files\n\
+                       and to read load modules. The result does not\n\
+                       depend on <num>. {1}\n\
 \n\
 Options: Source Code and Static Structure:\n\
   --name <name>, --title <name>\n\
@@ -155,9 +159,11 @@ Options: Output:\n\
                        {./" Analysis_DB_DIR "}";
 
 static const char* usage_details_2 = "\n\
-  --metric-db <yes|no>\n\
+  --metric-db <yes|no|sparse>\n\
                        Control whether to generate a thread-level metric\n\
-                       value database for hpcviewer scatter plots. {no}";
+                       value database for hpcviewer scatter plots. {no}\n\
+                       'sparse' writes the database storing only non-zero\n\
+                       values (metric-db format 00.20).";
 
 static const char* usage_details_3 = "\n\
   --remove-redundancy \n\
@@ -219,6 +225,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   { 'h', "help",            CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  { 'j', "jobs",            CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
   { 0, "remove-redundancy", CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
   {  0 , "debug",           CLP::ARG_OPT,  CLP::DUPOPT_CLOB, NULL,  // hidden
@@ -243,6 +251,7 @@ ArgsHPCProf::ArgsHPCProf()
   prof_metrics = Analysis::Args::MetricFlg_StatsSum;
 
   db_makeMetricDB = false;
+  db_metricDBSparse = false;
   remove_redundancy = false;
 }
 
@@ -377,6 +386,14 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       }
       Diagnostics_SetDiagnosticFilterLevel(verb);
     }
+    if (parser.isOpt("jobs")) {
+      const string& arg = parser.getOptArg("jobs");
+      long jobs = CmdLineParser::toLong(arg);
+      if (jobs < 1) {
+	ARG_ERROR("--jobs/-j option must be a positive integer");
+      }
+      prof_jobs = (uint)jobs;
+    }
 
     // Check for agent options
     if (parser.isOpt("agent-cilk")) {
@@ -465,7 +482,14 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
     }
     if (parser.isOpt("metric-db")) {
       const string& arg = parser.getOptArg("metric-db");
-      db_makeMetricDB = CmdLineParser::parseArg_bool(arg, "--metric-db option");
+      if (arg == "sparse") {
+	db_makeMetricDB = true;
+	db_metricDBSparse = true;
+      }
+      else {
+	db_makeMetricDB = CmdLineParser::parseArg_bool(arg, "--metric-db option");
+	db_metricDBSparse = false;
+      }
     }
     if (parser.isOpt("struct-id")) {
       db_addStructId = true;
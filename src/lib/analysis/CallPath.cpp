@@ -68,11 +68,19 @@ using std::dec;
 #include <string>
 using std::string;
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
 #include <map>
 #include <vector>
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <typeinfo>
 
 #include <sys/stat.h>
@@ -132,37 +140,251 @@ namespace Analysis {
 namespace CallPath {
 
 
+//***************************************************************************
+// Reading and merging profiles
+//***************************************************************************
+
+// ProfileReducer: reads a vector of profile files and merges them
+//   using a fixed pairwise reduction tree whose shape depends only on
+//   the number of files.  Worker threads claim files in order; after
+//   reading a file, a thread climbs the tree and merges each subtree
+//   whose other child is already complete (always merging the right
+//   child's profile into the left's).  Thus, the result (CCT,
+//   metric ordering, cpIds) is independent of the number of threads.
+//
+// Trace files: When trace files must be normalized
+//   (CCT::MrgFlg_NormalizeTraceFileY), a cpId conflict at some level of
+//   the tree affects every trace file of the right subtree.  Rather
+//   than rewriting those files at each level, we record, per trace
+//   file, the sequence of cpId maps it is subject to and rewrite each
+//   file at most once after the reduction.
+class ProfileReducer
+{
+public:
+  ProfileReducer(const Util::StringVec& profileFiles,
+		 const Util::UIntVec* groupMap,
+		 int mergeTy, uint rFlags, uint mrgFlags)
+    : m_profileFiles(profileFiles), m_groupMap(groupMap),
+      m_mergeTy(mergeTy), m_rFlags(rFlags), m_mrgFlags(mrgFlags),
+      m_doFixTrace(mrgFlags & Prof::CCT::MrgFlg_NormalizeTraceFileY),
+      m_nodes(profileFiles.size()),
+      m_nextFile(0), m_nextTrace(0), m_isError(false)
+  {
+    // m_arrived[lvl][p]: whether one of the two children (at level
+    // lvl) of node p (at level lvl + 1) is complete.  Level 0 holds
+    // the leaves.
+    uint width = 1;
+    while (width < profileFiles.size()) {
+      width *= 2;
+      uint numNodes = (profileFiles.size() + width - 1) / width;
+      m_arrived.push_back(std::vector<char>(numNodes, 0));
+    }
+  }
+
+  ~ProfileReducer()
+  {
+    for (uint i = 0; i < m_nodes.size(); ++i) {
+      delete m_nodes[i].prof;
+    }
+  }
+
+  Prof::CallPath::Profile*
+  reduce(uint numThreads)
+  {
+    run(numThreads, &ProfileReducer::readAndMerge);
+
+    Prof::CallPath::Profile* prof = m_nodes[0].prof;
+    prof->metricMgr()->mergePerfEventStatistics_finalize(m_profileFiles.size());
+
+    // Rewrite trace files that are subject to cpId translations
+    for (uint i = 0; i < m_nodes[0].traces.size(); ++i) {
+      if (!m_nodes[0].traces[i].cpIdMaps.empty()) {
+	m_tracesToFix.push_back(&m_nodes[0].traces[i]);
+      }
+    }
+    run(numThreads, &ProfileReducer::fixTraces);
+
+    m_nodes[0].prof = NULL;
+    return prof;
+  }
+
+private:
+  typedef Prof::CallPath::Profile::CPIdMap CPIdMap;
+
+  struct TraceFix
+  {
+    std::string fnm;
+    std::vector<std::shared_ptr<const CPIdMap> > cpIdMaps;
+  };
+
+  // the result of a subtree; held in the slot of its leftmost leaf
+  struct MergeNode
+  {
+    MergeNode() : prof(NULL) { }
+
+    Prof::CallPath::Profile* prof;
+    std::vector<TraceFix> traces;
+  };
+
+  typedef void (ProfileReducer::*WorkFn)();
+
+  void
+  run(uint numThreads, WorkFn fn)
+  {
+    std::vector<std::thread> threads;
+    for (uint i = 1; i < numThreads; ++i) {
+      threads.push_back(std::thread(&ProfileReducer::work, this, fn));
+    }
+    work(fn);
+    for (uint i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+
+  void
+  work(WorkFn fn)
+  {
+    try {
+      (this->*fn)();
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> guard(m_lock);
+      if (!m_error) {
+	m_error = std::current_exception();
+      }
+      m_isError = true;
+    }
+  }
+
+  void
+  readAndMerge()
+  {
+    const uint numFiles = m_profileFiles.size();
+
+    for (uint i = m_nextFile++; i < numFiles && !m_isError; i = m_nextFile++) {
+      // -------------------------------------------------------
+      // read leaf i
+      // -------------------------------------------------------
+      uint groupId = (m_groupMap) ? (*m_groupMap)[i] : 0;
+      MergeNode& leaf = m_nodes[i];
+      leaf.prof = read(m_profileFiles[i], groupId, m_rFlags);
+
+      // add the directory into the set of directories
+      leaf.prof->addDirectory(m_profileFiles[i]);
+
+      if (m_doFixTrace) {
+	const StringSet& traces = leaf.prof->traceFileNameSet();
+	for (StringSet::const_iterator it = traces.begin();
+	     it != traces.end(); ++it) {
+	  leaf.traces.push_back(TraceFix());
+	  leaf.traces.back().fnm = *it;
+	}
+      }
+
+      // -------------------------------------------------------
+      // climb the tree while this thread completes the second child
+      // -------------------------------------------------------
+      uint j = i;
+      for (uint lvl = 0, width = 1; width < numFiles; ++lvl, width *= 2) {
+	uint sibling = j ^ 1;
+	bool hasSibling = (sibling * width < numFiles);
+	if (hasSibling) {
+	  std::lock_guard<std::mutex> guard(m_lock);
+	  char& arrived = m_arrived[lvl][j / 2];
+	  if (!arrived) {
+	    arrived = 1;
+	    break; // the sibling's thread will merge
+	  }
+	}
+
+	j = j / 2;
+	if (hasSibling) {
+	  merge(m_nodes[(2 * j) * width], m_nodes[(2 * j + 1) * width]);
+	}
+      }
+    }
+  }
+
+  void
+  merge(MergeNode& x, MergeNode& y)
+  {
+    Prof::CCT::MergeEffectList mrgEffects;
+    x.prof->merge(*y.prof, m_mergeTy, m_mrgFlags,
+		  (m_doFixTrace) ? &mrgEffects : NULL);
+    x.prof->metricMgr()->mergePerfEventStatistics(y.prof->metricMgr());
+    x.prof->copyDirectory(y.prof->directorySet());
+
+    delete y.prof;
+    y.prof = NULL;
+
+    if (!mrgEffects.empty()) {
+      CPIdMap* cpIdMap = new CPIdMap;
+      for (Prof::CCT::MergeEffectList::const_iterator it = mrgEffects.begin();
+	   it != mrgEffects.end(); ++it) {
+	cpIdMap->insert(std::make_pair(it->old_cpId, it->new_cpId));
+      }
+      std::shared_ptr<const CPIdMap> cpIdMapPtr(cpIdMap);
+      for (uint i = 0; i < y.traces.size(); ++i) {
+	y.traces[i].cpIdMaps.push_back(cpIdMapPtr);
+      }
+    }
+    x.traces.insert(x.traces.end(), y.traces.begin(), y.traces.end());
+    y.traces.clear();
+  }
+
+  void
+  fixTraces()
+  {
+    for (uint i = m_nextTrace++; i < m_tracesToFix.size() && !m_isError;
+	 i = m_nextTrace++) {
+      const TraceFix* trace = m_tracesToFix[i];
+      std::vector<const CPIdMap*> cpIdMaps;
+      for (uint k = 0; k < trace->cpIdMaps.size(); ++k) {
+	cpIdMaps.push_back(trace->cpIdMaps[k].get());
+      }
+      Prof::CallPath::Profile::rewriteTrace(trace->fnm, cpIdMaps);
+    }
+  }
+
+private:
+  const Util::StringVec& m_profileFiles;
+  const Util::UIntVec* m_groupMap;
+  int  m_mergeTy;
+  uint m_rFlags;
+  uint m_mrgFlags;
+  bool m_doFixTrace;
+
+  std::vector<MergeNode> m_nodes;
+  std::vector<std::vector<char> > m_arrived;
+  std::vector<const TraceFix*> m_tracesToFix;
+
+  std::mutex m_lock;
+  std::atomic<uint> m_nextFile;
+  std::atomic<uint> m_nextTrace;
+  std::atomic<bool> m_isError;
+  std::exception_ptr m_error;
+};
+
+
 Prof::CallPath::Profile*
 read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
-     int mergeTy, uint rFlags, uint mrgFlags)
+     int mergeTy, uint rFlags, uint mrgFlags, uint numThreads)
 {
   // Special case
   if (profileFiles.empty()) {
     Prof::CallPath::Profile* prof = Prof::CallPath::Profile::make(rFlags);
     return prof;
   }
-  
-  // General case
-  uint groupId = (groupMap) ? (*groupMap)[0] : 0;
-  Prof::CallPath::Profile* prof = read(profileFiles[0], groupId, rFlags);
 
-  // add the directory into the set of directories
-  prof->addDirectory(profileFiles[0]);
-
-  for (uint i = 1; i < profileFiles.size(); ++i) {
-    groupId = (groupMap) ? (*groupMap)[i] : 0;
-    Prof::CallPath::Profile* p = read(profileFiles[i], groupId, rFlags);
-    prof->merge(*p, mergeTy, mrgFlags);
-
-    prof->metricMgr()->mergePerfEventStatistics(p->metricMgr());
-    delete p;
+  // General case
+  numThreads = std::max(1u, std::min(numThreads, (uint)profileFiles.size()));
 
-    // add the directory into the set of directories
-    prof->addDirectory(profileFiles[i]);
-  }
-  prof->metricMgr()->mergePerfEventStatistics_finalize(profileFiles.size());
-  
-  return prof;
+  ProfileReducer reducer(profileFiles, groupMap, mergeTy, rFlags, mrgFlags);
+  return reducer.reduce(numThreads);
 }
 
 
@@ -366,14 +588,17 @@ makeVMAmap(VmaVecMap & vmaMap, Prof::CCT::ANode * node)
 
 //
 // Precompute struct simple for one struct tree (lmStruct) from the
-// binutils load module (lm) and vma vector (vmaVec).
+// vma vector (vmaVec) and what the binary says about each vma
+// (infoMap).
 //
+typedef std::map <VMA, BAnal::Struct::SimpleInfo> SimpleInfoMap;
+
 static void
 precomputeStructSimple(Prof::Struct::LM * lmStruct,
-		       BinUtil::LM * lm,
-		       VmaVec * vmaVec)
+		       VmaVec * vmaVec,
+		       const SimpleInfoMap & infoMap)
 {
-  if (lm == NULL || vmaVec == NULL) {
+  if (vmaVec == NULL) {
     return;
   }
 
@@ -381,7 +606,9 @@ precomputeStructSimple(Prof::Struct::LM * lmStruct,
     VMA vma = (*vmaVec)[i];
 
     if (lmStruct->findStmt(vma) == NULL) {
-      BAnal::Struct::makeStructureSimple(lmStruct, lm, vma);
+      auto it = infoMap.find(vma);
+      DIAG_Assert(it != infoMap.end(), "precomputeStructSimple: no info for vma");
+      BAnal::Struct::makeStructureSimple(lmStruct, it->second, vma);
     }
   }
 
@@ -395,17 +622,33 @@ precomputeStructSimple(Prof::Struct::LM * lmStruct,
 
 typedef std::map<Prof::Struct::ANode*, Prof::CCT::ANode*> StructToCCTMap;
 
-static void
-overlayStaticStructureMain(Prof::CallPath::Profile& prof,
-			   Prof::LoadMap::LM* loadmap_lm,
-			   Prof::Struct::LM* lmStrct,
-			   VmaVec * vmaVec,
-                           bool printProgress);
+// OverlayLM: the overlay's view of one load module.  A vector of
+// them is indexed by LoadMap::LMId_t; unused load modules have no
+// 'lmStrct'.
+struct OverlayLM
+{
+  OverlayLM()
+    : loadmap_lm(NULL), lmStrct(NULL), lm(NULL), vmaVec(NULL),
+      useStruct(false), isRead(false)
+  { }
+
+  Prof::LoadMap::LM* loadmap_lm;
+  Prof::Struct::LM* lmStrct;
+  BinUtil::LM* lm; // optional: demand struct simple during the walk
+
+  // reading the binary (cf. LMReader)
+  VmaVec* vmaVec;
+  bool useStruct;
+  bool isRead;
+  std::string binaryName;
+  SimpleInfoMap simpleInfo;
+  std::string error;
+};
+
+typedef std::vector<OverlayLM> OverlayLMVec;
 
 static void
-overlayStaticStructure(Prof::CCT::ANode* node,
-		       Prof::LoadMap::LM* loadmap_lm,
-		       Prof::Struct::LM* lmStrct, BinUtil::LM* lm);
+overlayStaticStructure(Prof::CCT::ANode* node, const OverlayLMVec& lms);
 
 static Prof::CCT::ANode*
 demandScopeInFrame(Prof::CCT::ADynNode* node, Prof::Struct::ANode* strct,
@@ -424,17 +667,189 @@ static void
 coalesceStmts(Prof::CallPath::Profile& prof);
 
 
+//****************************************************************************
+
+// LMReader: reads the binaries of the load modules without a
+//   structure file and adds struct simple for their sampled VMAs.
+//   Worker threads claim load modules in order, open and read each
+//   binary, and look up what struct simple needs for each VMA.  Only
+//   the calling thread adds to the Struct tree, in load map order as
+//   the workers finish, so that the structure (and its ids) does not
+//   depend on the number of threads.
+class LMReader
+{
+public:
+  LMReader(Prof::CallPath::Profile& prof, OverlayLMVec& lms,
+	   bool printProgress)
+    : m_prof(prof), m_lms(lms), m_printProgress(printProgress),
+      m_isDone(lms.size(), 0), m_nextLM(0), m_isError(false)
+  { }
+
+  void
+  run(uint numThreads)
+  {
+    if (numThreads <= 1) {
+      for (uint i = 0; i < m_lms.size(); ++i) {
+	readLM(m_lms[i]);
+	addStructure(m_lms[i]);
+      }
+      return;
+    }
+
+    std::vector<std::thread> threads;
+    for (uint i = 0; i < numThreads; ++i) {
+      threads.push_back(std::thread(&LMReader::work, this));
+    }
+
+    try {
+      for (uint i = 0; i < m_lms.size(); ++i) {
+	{
+	  std::unique_lock<std::mutex> guard(m_lock);
+	  while (!m_isDone[i] && !m_isError) {
+	    m_doneCond.wait(guard);
+	  }
+	}
+	if (m_isError) {
+	  break;
+	}
+	addStructure(m_lms[i]);
+      }
+    }
+    catch (...) {
+      noteError();
+    }
+
+    for (uint i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+
+private:
+  void
+  work()
+  {
+    try {
+      for (uint i = m_nextLM++; i < m_lms.size() && !m_isError;
+	   i = m_nextLM++) {
+	readLM(m_lms[i]);
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_isDone[i] = 1;
+	m_doneCond.notify_one();
+      }
+    }
+    catch (...) {
+      noteError();
+    }
+  }
+
+  void
+  noteError()
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (!m_error) {
+      m_error = std::current_exception();
+    }
+    m_isError = true;
+    m_doneCond.notify_one();
+  }
+
+  // Read the binary for 'x'.  N.B.: may run in a worker thread, so it
+  // must not touch the Struct tree.
+  void
+  readLM(OverlayLM& x)
+  {
+    if (!x.lmStrct || x.useStruct
+	|| x.loadmap_lm->id() == Prof::LoadMap::LMId_NULL) {
+      return;
+    }
+
+    BinUtil::LM* lm = NULL;
+    try {
+      lm = new BinUtil::LM();
+      lm->open(x.loadmap_lm->name().c_str());
+      lm->read(m_prof.directorySet(), BinUtil::LM::ReadFlg_Proc);
+      if (x.vmaVec) {
+	for (uint i = 0; i < x.vmaVec->size(); i++) {
+	  VMA vma = (*x.vmaVec)[i];
+	  if (x.simpleInfo.find(vma) == x.simpleInfo.end()) {
+	    BAnal::Struct::findStructureSimple(lm, vma, x.simpleInfo[vma]);
+	  }
+	}
+      }
+      x.binaryName = lm->name();
+      x.isRead = true;
+    }
+    catch (const Diagnostics::Exception& e) {
+      x.simpleInfo.clear();
+      x.error = e.what();
+    }
+    delete lm;
+  }
+
+  // Add struct simple for 'x' to its Struct::LM.
+  void
+  addStructure(OverlayLM& x)
+  {
+    if (!x.lmStrct) {
+      return;
+    }
+
+    const string& lm_nm = x.loadmap_lm->name();
+    const string& lm_pretty_name = Prof::LoadMap::LM::pretty_name(lm_nm);
+
+    if (x.useStruct) {
+      DIAG_MsgIf(m_printProgress, "STRUCTURE: " << lm_pretty_name);
+    } else if (x.loadmap_lm->id() == Prof::LoadMap::LMId_NULL) {
+      // no-op for this case
+    } else if (!x.isRead) {
+      DIAG_WMsgIf(m_printProgress, "Cannot fully process samples for load module " << 
+		  lm_pretty_name << ": " << x.error);
+    } else {
+      if (x.vmaVec == NULL) {
+	DIAG_WMsgIf(m_printProgress, "Unable to compute struct simple for " << lm_nm);
+      }
+      else {
+	precomputeStructSimple(x.lmStrct, x.vmaVec, x.simpleInfo);
+      }
+      DIAG_MsgIf(m_printProgress, "Line map : " << lm_pretty_name);
+      x.lmStrct->pretty_name(x.binaryName);
+    }
+
+    SimpleInfoMap().swap(x.simpleInfo);
+  }
+
+private:
+  Prof::CallPath::Profile& m_prof;
+  OverlayLMVec& m_lms;
+  bool m_printProgress;
+
+  std::vector<char> m_isDone;
+
+  std::mutex m_lock;
+  std::condition_variable m_doneCond;
+  std::atomic<uint> m_nextLM;
+  std::atomic<bool> m_isError;
+  std::exception_ptr m_error;
+};
+
+
 //****************************************************************************
 
 //
-// The main entry point for hpcprof and prof-mpi.  Iterate over load
-// modules and overlay structure one LM at a time.
+// The main entry point for hpcprof and prof-mpi.  Read the load
+// modules (concurrently, with 'numThreads' threads) and then overlay
+// structure for all of them in one walk over the CCT.
 //
 void
 Analysis::CallPath::
 overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 			   string agent, bool doNormalizeTy,
-                           bool printProgress)
+                           bool printProgress, uint numThreads)
 {
   const Prof::LoadMap* loadmap = prof.loadmap();
   Prof::Struct::Root* rootStrct = prof.structure()->root();
@@ -445,9 +860,11 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
   std::string errors;
 
   // -------------------------------------------------------
-  // Overlay static structure. N.B. To process spurious samples,
-  // iteration includes LoadMap::LMId_NULL
+  // Demand structure for each used load module. N.B. To process
+  // spurious samples, iteration includes LoadMap::LMId_NULL
   // -------------------------------------------------------
+  OverlayLMVec lms(loadmap->size() + 1);
+
   for (Prof::LoadMap::LMId_t i = Prof::LoadMap::LMId_NULL;
       i <= loadmap->size(); ++i) {
     Prof::LoadMap::LM* lm = loadmap->lm(i);
@@ -457,16 +874,18 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
         const string& lm_nm = lm->name();
         Prof::Struct::LM* lmStrct = Prof::Struct::LM::demand(rootStrct, lm_nm);
 
-	VmaVec * vmaVec = NULL;
+	lms[i].loadmap_lm = lm;
+	lms[i].lmStrct = lmStrct;
+	lms[i].useStruct = (lmStrct->childCount() > 0);
+
 	auto it = vmaMap.find(i);
 	if (it != vmaMap.end()) {
-	  vmaVec = it->second;
+	  lms[i].vmaVec = it->second;
 	}
-
-	overlayStaticStructureMain(prof, lm, lmStrct, vmaVec, printProgress);
       }
       catch (const Diagnostics::Exception& x) {
         errors += "  " + x.what() + "\n";
+	lms[i].lmStrct = NULL;
       }
     }
   }
@@ -475,6 +894,23 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
     DIAG_WMsgIf(1, "Cannot fully process samples because of errors reading load modules:\n" << errors);
   }
 
+  // -------------------------------------------------------
+  // Read binaries and overlay static structure
+  // -------------------------------------------------------
+  numThreads = std::max(1u, std::min(numThreads, (uint)lms.size()));
+
+  LMReader reader(prof, lms, printProgress);
+  reader.run(numThreads);
+
+  overlayStaticStructure(prof.cct()->root(), lms);
+
+  // account for new structure inserted by Analysis::Util::demandStructure()
+  for (uint i = 0; i < lms.size(); ++i) {
+    if (lms[i].lmStrct) {
+      lms[i].lmStrct->computeVMAMaps();
+    }
+  }
+
   // delete VMA vectors
   for (auto it = vmaMap.begin(); it != vmaMap.end(); ++it) {
     delete it->second;
@@ -493,61 +929,6 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 }
 
 
-//
-// Overlay for one load module.
-//
-static void
-overlayStaticStructureMain(Prof::CallPath::Profile& prof,
-			   Prof::LoadMap::LM* loadmap_lm,
-			   Prof::Struct::LM* lmStrct,
-			   VmaVec * vmaVec,
-                           bool printProgress)
-{
-  const string& lm_nm = loadmap_lm->name();
-  const string& lm_pretty_name = Prof::LoadMap::LM::pretty_name(lm_nm);
-
-  BinUtil::LM* lm = NULL;
-
-  bool useStruct = (lmStrct->childCount() > 0);
-
-  if (useStruct) {
-    DIAG_MsgIf(printProgress, "STRUCTURE: " << lm_pretty_name);
-  } else if (loadmap_lm->id() == Prof::LoadMap::LMId_NULL) {
-    // no-op for this case
-  } else {
-    try {
-      lm = new BinUtil::LM();
-      lm->open(lm_nm.c_str());
-      lm->read(prof.directorySet(), BinUtil::LM::ReadFlg_Proc);
-      if (vmaVec == NULL) {
-	DIAG_WMsgIf(printProgress, "Unable to compute struct simple for " << lm_nm);
-      }
-      else {
-	precomputeStructSimple(lmStrct, lm, vmaVec);
-      }
-    }
-    catch (const Diagnostics::Exception& x) {
-      delete lm;
-      lm = NULL;
-      DIAG_WMsgIf(printProgress, "Cannot fully process samples for load module " << 
-                  lm_pretty_name << ": " << x.what());
-    }
-    if (lm) DIAG_MsgIf(printProgress, "Line map : " << lm_pretty_name);
-  }
-
-  if (lm) {
-    lmStrct->pretty_name(lm->name());
-  }
-
-  overlayStaticStructure(prof.cct()->root(), loadmap_lm, lmStrct, NULL);
-  
-  // account for new structure inserted by BAnal::Struct::makeStructureSimple()
-  lmStrct->computeVMAMaps();
-
-  delete lm;
-}
-
-
 void
 Analysis::CallPath::
 noteStaticStructureOnLeaves(Prof::CallPath::Profile& prof)
@@ -596,28 +977,29 @@ overlayStaticStructure(Prof::CallPath::Profile& prof,
 		       Prof::LoadMap::LM* loadmap_lm,
 		       Prof::Struct::LM* lmStrct, BinUtil::LM* lm)
 {
-  overlayStaticStructure(prof.cct()->root(), loadmap_lm, lmStrct, lm);
+  OverlayLMVec lms(loadmap_lm->id() + 1);
+  lms[loadmap_lm->id()].loadmap_lm = loadmap_lm;
+  lms[loadmap_lm->id()].lmStrct = lmStrct;
+  lms[loadmap_lm->id()].lm = lm;
+
+  overlayStaticStructure(prof.cct()->root(), lms);
 }
 
 
 //****************************************************************************
 
 //
-// Where the overlay actually happens.  This is per load module.
+// Where the overlay actually happens.  Each ADynNode is overlaid with
+// the structure of its own load module, so one walk serves them all.
 //
 static void
-overlayStaticStructure(Prof::CCT::ANode* node,
-		       Prof::LoadMap::LM* loadmap_lm,
-		       Prof::Struct::LM* lmStrct, BinUtil::LM* lm)
+overlayStaticStructure(Prof::CCT::ANode* node, const OverlayLMVec& lms)
 {
   // INVARIANT: The parent of 'node' has been fully processed
-  // w.r.t. the given load module and lives within a correctly located
-  // procedure frame.
+  // and lives within a correctly located procedure frame.
   
   if (!node) { return; }
 
-  bool useStruct = (!lm);
-
   // N.B.: dynamically allocate to better handle the deep recursion
   // required for very deep CCTs.
   StructToCCTMap* strctToCCTMap = new StructToCCTMap;
@@ -643,15 +1025,16 @@ overlayStaticStructure(Prof::CCT::ANode* node,
     it++; // advance iterator -- it is pointing at 'n'
     
     // ---------------------------------------------------
-    // process Prof::CCT::ADynNode nodes
-    // 
-    // N.B.: Since we process w.r.t. one load module at a time, we may
-    //   see non-ADynNode nodes!
+    // process Prof::CCT::ADynNode nodes of load modules with structure
     // ---------------------------------------------------
     Prof::CCT::ADynNode* n_dyn = dynamic_cast<Prof::CCT::ADynNode*>(n);
-    if (n_dyn && (n_dyn->lmId() == loadmap_lm->id())) {
+    if (n_dyn && n_dyn->lmId() < lms.size() && lms[n_dyn->lmId()].lmStrct) {
       using namespace Prof;
 
+      Struct::LM* lmStrct = lms[n_dyn->lmId()].lmStrct;
+      BinUtil::LM* lm = lms[n_dyn->lmId()].lm;
+      bool useStruct = (!lm);
+
       const string* unkProcNm = NULL;
       if (n_dyn->isSecondarySynthRoot()) {
 	unkProcNm = &Struct::Tree::PartialUnwindProcNm;
@@ -690,7 +1073,7 @@ overlayStaticStructure(Prof::CCT::ANode* node,
     // recur
     // ---------------------------------------------------
     if (!n->isLeaf()) {
-      overlayStaticStructure(n, loadmap_lm, lmStrct, lm);
+      overlayStaticStructure(n, lms);
     }
   }
 
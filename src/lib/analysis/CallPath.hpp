@@ -94,9 +94,12 @@ extern std::ostream* dbgOs; // for parallel debugging
 //
 // ---------------------------------------------------------
 
+// read: Read and merge 'profileFiles' using 'numThreads' threads.
+//   Profiles are merged with a pairwise reduction tree, so the result
+//   does not depend on 'numThreads'.
 Prof::CallPath::Profile*
 read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
-     int mergeTy, uint rFlags = 0, uint mrgFlags = 0);
+     int mergeTy, uint rFlags = 0, uint mrgFlags = 0, uint numThreads = 1);
 
 Prof::CallPath::Profile*
 read(const char* prof_fnm, uint groupId, uint rFlags = 0);
@@ -134,10 +137,13 @@ readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args);
 // - Every CCT::Call and CCT::Stmt is a descendant of a CCT::ProcFrm
 // - A CCT::Stmt node is always a leaf.
 
+// overlayStaticStructureMain: Overlay static structure for every load
+// module, reading binaries with 'numThreads' threads.  The result
+// does not depend on 'numThreads'.
 void
 overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 			   string agent, bool doNormalizeTy,
-                           bool printProgress);
+                           bool printProgress, uint numThreads = 1);
 
 // lm is optional and may be NULL
 void 
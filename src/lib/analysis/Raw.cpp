@@ -63,6 +63,9 @@
 #include <string>
 using std::string;
 
+#include <vector>
+#include <cstdlib>
+
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
@@ -144,17 +147,31 @@ Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
 
     hpcmetricDB_fmt_hdr_fprint(&hdr, stdout);
 
-    for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
-      fprintf(stdout, "(%6u: ", nodeId);
-      for (uint mId = 0; mId < hdr.numMetrics; ++mId) {
-	double mval = 0;
-	ret = hpcfmt_real8_fread(&mval, fs);
-	if (ret != HPCFMT_OK) {
-	  DIAG_Throw("error reading trace file '" << filenm << "'");
+    if (hpcmetricDB_fmt_hdr_isSparse(&hdr)) {
+      hpcmetricDB_fmt_sparse_t sparse;
+      ret = hpcmetricDB_fmt_sparse_fread(&sparse, fs, malloc);
+      if (ret != HPCFMT_OK) {
+	hpcmetricDB_fmt_sparse_free(&sparse, free);
+	DIAG_Throw("error reading metric-db file '" << filenm << "'");
+      }
+      hpcmetricDB_fmt_sparse_fprint(&sparse, stdout);
+      hpcmetricDB_fmt_sparse_free(&sparse, free);
+    }
+    else {
+      std::vector<double> row(hdr.numMetrics);
+      for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
+	fprintf(stdout, "(%6u: ", nodeId);
+	if (hdr.numMetrics > 0) {
+	  ret = hpcfmt_int8v_fread((uint64_t*)row.data(), hdr.numMetrics, fs);
+	  if (ret != HPCFMT_OK) {
+	    DIAG_Throw("error reading metric-db file '" << filenm << "'");
+	  }
+	}
+	for (uint mId = 0; mId < hdr.numMetrics; ++mId) {
+	  fprintf(stdout, "%12g ", row[mId]);
 	}
-	fprintf(stdout, "%12g ", mval);
+	fprintf(stdout, ")\n");
       }
-      fprintf(stdout, ")\n");
     }
 
     hpcio_fclose(fs);
@@ -186,20 +203,29 @@ Analysis::Raw::writeAsText_callpathTrace(const char* filenm)
 
     hpctrace_fmt_hdr_fprint(&hdr, stdout);
 
+    hpctrace_fmt_reader_t* reader = new hpctrace_fmt_reader_t;
+    ret = hpctrace_fmt_reader_init(reader, &hdr, fs);
+    if (ret != HPCFMT_OK) {
+      delete reader;
+      DIAG_Throw("error reading trace file '" << filenm << "'");
+    }
+
     // Read trace records and exit on EOF
-    while ( !feof(fs) ) {
+    while (true) {
       hpctrace_fmt_datum_t datum;
-      ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, fs);
+      ret = hpctrace_fmt_reader_next(reader, &datum);
       if (ret == HPCFMT_EOF) {
 	break;
       }
       else if (ret == HPCFMT_ERR) {
+	delete reader;
 	DIAG_Throw("error reading trace file '" << filenm << "'");
       }
 
       hpctrace_fmt_datum_fprint(&datum, hdr.flags, stdout);
     }
 
+    delete reader;
     hpcio_fclose(fs);
   }
   catch (...) {
@@ -76,85 +76,97 @@ using namespace std;
 //****************************************************************************
 
 //
-// makeStructureSimple -- make a Prof::Struct::Stmt node and path up
-// to lmStruct for vma.
+// findStructureSimple -- look up in lm what makeStructureSimple()
+// needs to know about vma.
 //
-Prof::Struct::Stmt *
-BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
-				   BinUtil::LM * lm, VMA vma)
+void
+BAnal::Struct::findStructureSimple(BinUtil::LM * lm, VMA vma,
+				   SimpleInfo & info)
 {
   //
   // begin address for proc containing vma, and proc and file name
   //
-  string prettynm, linknm, proc_filenm;
-  SrcFile::ln proc_line = 0;
+  info = SimpleInfo();
   VMA proc_vma = vma;
 
   BinUtil::Proc * bproc = lm->findProc(vma);
 
   if (bproc != NULL) {
     proc_vma = bproc->begVMA();
-    lm->findSrcCodeInfo(proc_vma, 0, linknm, proc_filenm, proc_line);
+    lm->findSrcCodeInfo(proc_vma, 0, info.linknm, info.proc_filenm, info.proc_line);
   } else {
-    lm->findSimpleFunction(proc_vma, linknm);
+    lm->findSimpleFunction(proc_vma, info.linknm);
   }
 
-  if (proc_filenm.empty()) {
-    proc_filenm = string(UNKNOWN_FILE)
+  if (info.proc_filenm.empty()) {
+    info.proc_filenm = string(UNKNOWN_FILE)
         + " [" + FileUtil::basename(lm->name().c_str()) + "]";
   }
 
-  if (! linknm.empty()) {
-    prettynm = BinUtil::demangleProcName(linknm);
+  if (! info.linknm.empty()) {
+    info.prettynm = BinUtil::demangleProcName(info.linknm);
   }
   else {
     stringstream buf;
 
     buf << UNKNOWN_PROC << " 0x" << hex << proc_vma << dec
 	<< " [" << FileUtil::basename(lm->name().c_str()) << "]";
-    prettynm = buf.str();
+    info.prettynm = buf.str();
   }
 
-  Prof::Struct::File * fileStruct =
-    Prof::Struct::File::demand(lmStruct, proc_filenm);
-
-  Prof::Struct::Proc * procStruct =
-    Prof::Struct::Proc::demand(fileStruct, prettynm, linknm, proc_line, proc_line);
-
   //
   // file and line for vma (stmt), and end vma
   //
-  string stmt_procnm, stmt_filenm;
-  SrcFile::ln stmt_line = 0;
-  VMA end_vma = vma + 1;
+  string stmt_procnm;
+  info.end_vma = vma + 1;
 
-  lm->findSrcCodeInfo(vma, 0, stmt_procnm, stmt_filenm, stmt_line);
+  lm->findSrcCodeInfo(vma, 0, stmt_procnm, info.stmt_filenm, info.stmt_line);
 
   BinUtil::Insn * insn = lm->findInsn(vma, 0);
   if (insn) {
-    end_vma = insn->endVMA();
+    info.end_vma = insn->endVMA();
   }
+}
+
+
+//
+// makeStructureSimple -- make a Prof::Struct::Stmt node and path up
+// to lmStruct for vma, as described by info.
+//
+Prof::Struct::Stmt *
+BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
+				   const SimpleInfo & info, VMA vma)
+{
+  Prof::Struct::File * fileStruct =
+    Prof::Struct::File::demand(lmStruct, info.proc_filenm);
+
+  Prof::Struct::Proc * procStruct =
+    Prof::Struct::Proc::demand(fileStruct, info.prettynm, info.linknm,
+			       info.proc_line, info.proc_line);
 
   Prof::Struct::Stmt * stmt = NULL;
 
   // stmts with known file and line that differs from proc need a
   // guard alien
-  if ((! stmt_filenm.empty()) && stmt_line != 0
-      && (stmt_filenm != proc_filenm || stmt_line < proc_line))
+  if ((! info.stmt_filenm.empty()) && info.stmt_line != 0
+      && (info.stmt_filenm != info.proc_filenm
+	  || info.stmt_line < info.proc_line))
   {
-    Prof::Struct::Alien * alien = procStruct->demandGuardAlien(stmt_filenm, stmt_line);
-    stmt = alien->demandStmt(stmt_line, vma, end_vma);
+    string stmt_filenm = info.stmt_filenm;
+    Prof::Struct::Alien * alien =
+      procStruct->demandGuardAlien(stmt_filenm, info.stmt_line);
+    stmt = alien->demandStmt(info.stmt_line, vma, info.end_vma);
   }
   else {
-    stmt = procStruct->demandStmtSimple(stmt_line, vma, end_vma);
+    stmt = procStruct->demandStmtSimple(info.stmt_line, vma, info.end_vma);
   }
 
 #if DEBUG_STRUCT_SIMPLE
   cout << "------------------------------------------------------------\n"
-       << "0x" << hex << vma << "--0x" << end_vma << dec << "  (struct simple)\n"
-       << "line:  " << stmt_line << "\n"
-       << "file:  " << stmt_filenm << "\n"
-       << "name:  " << linknm << "\n\n";
+       << "0x" << hex << vma << "--0x" << info.end_vma << dec << "  (struct simple)\n"
+       << "line:  " << info.stmt_line << "\n"
+       << "file:  " << info.stmt_filenm << "\n"
+       << "name:  " << info.linknm << "\n\n";
 
   stmt->dumpmePath(cout, 0, "");
   cout << "\n";
@@ -162,3 +174,19 @@ BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
 
   return stmt;
 }
+
+
+//
+// makeStructureSimple -- make a Prof::Struct::Stmt node and path up
+// to lmStruct for vma.
+//
+Prof::Struct::Stmt *
+BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
+				   BinUtil::LM * lm, VMA vma)
+{
+  SimpleInfo info;
+
+  findStructureSimple(lm, vma, info);
+
+  return makeStructureSimple(lmStruct, info, vma);
+}
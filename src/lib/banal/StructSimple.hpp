@@ -62,6 +62,8 @@
 
 //************************* System Include Files ****************************
 
+#include <string>
+
 //*************************** User Include Files ****************************
 
 #include <include/uint.h> 
@@ -86,6 +88,26 @@ namespace Struct {
   Prof::Struct::Stmt*
   makeStructureSimple(Prof::Struct::LM* lmStrct, BinUtil::LM* lm, VMA vma);
 
+  // makeStructureSimple() in two steps: findStructureSimple() reads
+  // only 'lm', so it may run concurrently for different load modules,
+  // while building the structure tree stays with the caller.
+  struct SimpleInfo
+  {
+    std::string prettynm, linknm, proc_filenm;
+    SrcFile::ln proc_line;
+
+    std::string stmt_filenm;
+    SrcFile::ln stmt_line;
+    VMA end_vma;
+  };
+
+  void
+  findStructureSimple(BinUtil::LM* lm, VMA vma, SimpleInfo& info);
+
+  Prof::Struct::Stmt*
+  makeStructureSimple(Prof::Struct::LM* lmStrct, const SimpleInfo& info,
+		      VMA vma);
+
 } // namespace Struct
 
 } // namespace BAnal
@@ -71,8 +71,15 @@ using std::string;
 using std::cerr;
 using std::endl;
 
+#include <cerrno>
 #include <cstring>
 
+#include <mutex>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 //*************************** User Include Files ****************************
 
 #include <include/hpctoolkit-config.h>
@@ -115,6 +122,14 @@ using std::endl;
 // private data 
 //***************************************************************************
 
+// BFD keeps a global cache of the files it opens by name.  Each LM
+// reads its own file through bfd_openr_iovec, which stays out of that
+// cache, and holds its own m_bfdLock while it uses its bfd, so LMs on
+// different threads don't wait for each other.  s_bfdLock serializes
+// opening and closing bfds and every use of a bfd whose line lookups
+// may make BFD open a separate debug file (cf. LM::bfdMutex).
+static std::mutex s_bfdLock;
+
 static const char *noreturn_table[] = {
   // include machine-generated file containing names of functions 
   // that don't return
@@ -122,6 +137,64 @@ static const char *noreturn_table[] = {
 };
 
 
+//***************************************************************************
+// private operations
+//***************************************************************************
+
+// bfd_openr_iovec callbacks: the stream is a heap-allocated fd.
+
+static void*
+bfdOpenFile(bfd* abfd, void* filenm)
+{
+  int fd = ::open((const char*)filenm, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    bfd_set_error(bfd_error_system_call);
+    return NULL;
+  }
+  return new int(fd);
+}
+
+
+static file_ptr
+bfdReadFile(bfd* abfd, void* stream, void* buf, file_ptr nbytes,
+	    file_ptr offset)
+{
+  file_ptr done = 0;
+  while (done < nbytes) {
+    ssize_t ret = ::pread(*(int*)stream, (char*)buf + done, nbytes - done,
+			  offset + done);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      bfd_set_error(bfd_error_system_call);
+      return -1;
+    }
+    if (ret == 0) {
+      break;
+    }
+    done += ret;
+  }
+  return done;
+}
+
+
+static int
+bfdCloseFile(bfd* abfd, void* stream)
+{
+  int ret = ::close(*(int*)stream);
+  delete (int*)stream;
+  return ret;
+}
+
+
+static int
+bfdStatFile(bfd* abfd, void* stream, struct stat* sb)
+{
+  return ::fstat(*(int*)stream, sb);
+}
+
+
 //***************************************************************************
 // type declarations
 //***************************************************************************
@@ -345,7 +418,7 @@ BinUtil::LM::LM(bool useBinutils)
   : m_type(TypeNULL), m_readFlags(ReadFlg_NULL),
     m_txtBeg(0), m_txtEnd(0), m_begVMA(0),
     m_textBegReloc(0), m_unrelocDelta(0),
-    m_bfd(NULL), m_bfdSymTab(NULL), 
+    m_bfd(NULL), m_bfdSharesFiles(false), m_bfdSymTab(NULL), 
     m_bfdDynSymTab(NULL), m_bfdSynthTab(NULL),
     m_bfdSymTabSort(NULL), m_bfdSymTabSz(0), m_bfdDynSymTabSz(0),
     m_bfdSymTabSortSz(0), m_bfdSynthTabSz(0), m_noreturns(0), 
@@ -369,6 +442,8 @@ BinUtil::LM::~LM()
 
   // BFD info
   if (m_bfd) {
+    // closing may close a separate debug file that BFD cached
+    std::lock_guard<std::mutex> guard(s_bfdLock);
     bfd_close(m_bfd);
     m_bfd = NULL;
   }
@@ -390,9 +465,9 @@ BinUtil::LM::~LM()
   m_bfdSynthTabSz = 0;
   m_bfdDynSymTabSz = 0;
   
-  // reset isa
-  delete isa;
-  isa = NULL;
+  // N.B.: 'isa' is shared by all LMs, and other threads may still be
+  // using theirs, so it is deliberately never deleted: the one ISA
+  // object is leaked at exit.
 
   delete m_noreturns;
   m_noreturns = NULL;
@@ -442,9 +517,12 @@ BinUtil::LM::open(const char* filenm)
   // 1. Initialize bfd and open the object file.
   // -------------------------------------------------------
 
+  std::lock_guard<std::mutex> guard(s_bfdLock);
+
   // Determine file existence.
   bfd_init();
-  m_bfd = bfd_openr(filenm, "default");
+  m_bfd = bfd_openr_iovec(filenm, "default", bfdOpenFile, (void*)filenm,
+			  bfdReadFile, bfdCloseFile, bfdStatFile);
   if (!m_bfd) {
     BINUTIL_Throw("'" << filenm << "': " << bfd_errmsg(bfd_get_error()));
   }
@@ -479,6 +557,12 @@ BinUtil::LM::open(const char* filenm)
   m_txtBeg = bfd_get_start_address(m_bfd); // entry point
   m_begVMA = m_txtBeg;
 
+  // Without its own DWARF, or with a dwz file, line lookups make BFD
+  // open another file by name, through its global cache.
+  m_bfdSharesFiles =
+    !bfd_get_section_by_name(m_bfd, ".debug_info")
+    || bfd_get_section_by_name(m_bfd, ".gnu_debugaltlink");
+
   // -------------------------------------------------------
   // 3. Configure ISA.  
   // -------------------------------------------------------
@@ -510,12 +594,21 @@ BinUtil::LM::read(const std::set<std::string> &directorySet, LM::ReadFlg readflg
     return;
   }
 
+  std::lock_guard<std::mutex> guard(bfdMutex());
+
   readSymbolTables();
   readSegs();
   computeNoReturns();
 }
 
 
+std::mutex&
+BinUtil::LM::bfdMutex()
+{
+  return m_bfdSharesFiles ? s_bfdLock : m_bfdLock;
+}
+
+
 // relocate: Internally, all operations are performed on non-relocated
 // VMAs.  All routines operating on VMAs should call unrelocate(),
 // which will do the right thing.
@@ -574,6 +667,8 @@ BinUtil::LM::findSrcCodeInfo(VMA vma, ushort opIndex,
   asection* bfdSeg = NULL;
   VMA base = 0;
 
+  std::unique_lock<std::mutex> guard(bfdMutex());
+
   Seg* seg = findSeg(opVMA);
   if (seg) {
     bfdSeg = bfd_get_section_by_name(m_bfd, seg->name().c_str());
@@ -604,10 +699,14 @@ BinUtil::LM::findSrcCodeInfo(VMA vma, ushort opIndex,
     }
     if (bfd_file) { 
       file = bfd_file;
-      m_realpathMgr.realpath(file);
     }
     line = (SrcFile::ln)bfd_line;
   }
+  guard.unlock();
+
+  if (!file.empty()) {
+    m_realpathMgr.realpath(file);
+  }
 
   return STATUS;
 }
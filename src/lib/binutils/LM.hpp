@@ -66,6 +66,7 @@
 #include <deque>
 #include <map>
 #include <iostream>
+#include <mutex>
 
 #include <string.h>
 
@@ -519,6 +520,10 @@ private:
 
   void
   computeNoReturns();
+
+  // The lock to hold around calls into BFD on m_bfd
+  std::mutex&
+  bfdMutex();
   
   // unrelocate: Given a relocated VMA, returns a non-relocated version.
   VMA
@@ -573,6 +578,8 @@ private:
   // of asymbol structs, not pointers.
 
   bfd*      m_bfd;             // BFD of this module.
+  std::mutex m_bfdLock;        // Held around calls into BFD on m_bfd
+  bool      m_bfdSharesFiles;  // BFD may open other files for m_bfd
   asymbol** m_bfdSymTab;       // Unmodified BFD symbol table
   asymbol** m_bfdDynSymTab;    // Unmodified BFD dynamic symbol table
   asymbol*  m_bfdSynthTab;     // Synthetic BFD symbol table.
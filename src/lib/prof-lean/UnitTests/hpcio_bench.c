@@ -0,0 +1,292 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Microbenchmark and check for the CCT node reader; check for the
+//   compact trace reader.
+//
+// Description:
+//   Writes a synthetic profile CCT (nodes with a metric vector each) to a
+//   temporary file with hpcrun_fmt_cct_node_fwrite, then decodes it twice:
+//   once with the former one-fgetc-per-byte big-endian decoding and once
+//   with hpcrun_fmt_cct_node_fread.  Both decodings must agree; the time
+//   of each is printed.  A node record cut at any byte must then be
+//   reported as an error, and a compact trace cut inside its last block
+//   must read as its whole blocks followed by EOF.
+//
+//   Built and run (with a small CCT) by 'make check' in this directory:
+//     ./UnitTests/hpcio_bench [num-nodes] [num-metrics]
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+#include <lib/prof-lean/usec_time.h>
+
+//***************************************************************************
+
+
+// The decoding hpcio used before block reads: one fgetc per byte.
+static int
+fgetc_be(uint64_t* val, int size, FILE* fs)
+{
+  uint64_t v = 0;
+  for (int shift = 8 * (size - 1); shift >= 0; shift -= 8) {
+    int c = fgetc(fs);
+    if (c == EOF) {
+      return 0;
+    }
+    v |= ((uint64_t)(uint8_t)c) << shift;
+  }
+  *val = v;
+  return 1;
+}
+
+
+static int
+fgetc_cct_node_fread(hpcrun_fmt_cct_node_t* x, FILE* fs)
+{
+  uint64_t v;
+  if (!fgetc_be(&v, 4, fs)) return 0;
+  x->id = (uint32_t)v;
+  if (!fgetc_be(&v, 4, fs)) return 0;
+  x->id_parent = (uint32_t)v;
+  if (!fgetc_be(&v, 2, fs)) return 0;
+  x->lm_id = (uint16_t)v;
+  if (!fgetc_be(&v, 8, fs)) return 0;
+  x->lm_ip = v;
+  for (uint i = 0; i < x->num_metrics; ++i) {
+    if (!fgetc_be(&x->metrics[i].bits, 8, fs)) return 0;
+  }
+  return 1;
+}
+
+
+static void
+make_node(hpcrun_fmt_cct_node_t* x, uint32_t i)
+{
+  x->id = i + 1;
+  x->id_parent = (i / 4);
+  x->lm_id = (uint16_t)(i % 7);
+  x->lm_ip = 0x400000 + 16 * (uint64_t)i;
+  for (uint m = 0; m < x->num_metrics; ++m) {
+    if (m % 2) {
+      x->metrics[m].r = (double)i / (m + 1);
+    }
+    else {
+      x->metrics[m].i = (uint64_t)i * 1000003 + m;
+    }
+  }
+}
+
+
+static void
+check_node(const hpcrun_fmt_cct_node_t* x, const hpcrun_fmt_cct_node_t* y)
+{
+  assert(x->id == y->id);
+  assert(x->id_parent == y->id_parent);
+  assert(x->lm_id == y->lm_id);
+  assert(x->lm_ip == y->lm_ip);
+  assert(memcmp(x->metrics, y->metrics,
+		x->num_metrics * sizeof(hpcrun_metricVal_t)) == 0);
+}
+
+
+// A compact trace of one full block and a short one, cut at every byte
+// of the second block, reads as the first block's records and then EOF.
+static void
+check_trace_truncation(void)
+{
+  const uint32_t nfull = HPCTRACE_FMT_BlockMaxRecords;
+  const uint32_t num_records = nfull + 5;
+
+  hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
+  HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS, true);
+
+  char* trace = NULL;
+  size_t trace_sz = 0;
+  FILE* fs = open_memstream(&trace, &trace_sz);
+  assert(fs);
+  int ret = hpctrace_fmt_hdr_fwrite(flags, fs);
+  assert(ret == HPCFMT_OK);
+
+  hpctrace_fmt_block_t* b = malloc(sizeof(*b));
+  assert(b);
+  hpctrace_fmt_block_init(b);
+  long block2 = 0;
+  for (uint32_t i = 0; i < num_records; ++i) {
+    hpctrace_fmt_datum_t x = { .comp = 1000 + 10 * i, .cpId = i + 1,
+			       .metricId = HPCTRACE_FMT_MetricId_NULL };
+    ret = hpctrace_fmt_datum_block_fwrite(&x, flags, b, fs, NULL);
+    assert(ret == HPCFMT_OK);
+    if (i == nfull - 1) {
+      block2 = ftell(fs);
+    }
+  }
+  ret = hpctrace_fmt_block_fwrite(b, fs, NULL);
+  assert(ret == HPCFMT_OK);
+  fclose(fs);
+  free(b);
+
+  for (size_t cut = block2; cut <= trace_sz; ++cut) {
+    fs = fmemopen(trace, cut, "r");
+    assert(fs);
+    hpctrace_fmt_hdr_t hdr;
+    hpctrace_fmt_reader_t* r = malloc(sizeof(*r));
+    assert(r);
+    ret = hpctrace_fmt_hdr_fread(&hdr, fs);
+    assert(ret == HPCFMT_OK);
+    ret = hpctrace_fmt_reader_init(r, &hdr, fs);
+    assert(ret == HPCFMT_OK);
+
+    uint32_t n = 0;
+    hpctrace_fmt_datum_t y;
+    while ((ret = hpctrace_fmt_reader_next(r, &y)) == HPCFMT_OK) {
+      assert(y.comp == 1000 + 10 * n && y.cpId == n + 1);
+      n++;
+    }
+    assert(ret == HPCFMT_EOF);
+    assert(n == ((cut == trace_sz) ? num_records : nfull));
+
+    free(r);
+    fclose(fs);
+  }
+  free(trace);
+}
+
+
+int
+main(int argc, char** argv)
+{
+  uint32_t num_nodes = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000;
+  uint     num_metrics = (argc > 2) ? strtoul(argv[2], NULL, 10) : 8;
+
+  epoch_flags_t flags;
+  flags.bits = 0;
+
+  hpcrun_metricVal_t* mx = calloc(num_metrics + 1, sizeof(*mx));
+  hpcrun_metricVal_t* my = calloc(num_metrics + 1, sizeof(*my));
+  hpcrun_fmt_cct_node_t x, y;
+  hpcrun_fmt_cct_node_init(&x);
+  hpcrun_fmt_cct_node_init(&y);
+  x.num_metrics = y.num_metrics = num_metrics;
+  x.metrics = mx;
+  y.metrics = my;
+
+  FILE* fs = tmpfile();
+  assert(fs);
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    make_node(&x, i);
+    int ret = hpcrun_fmt_cct_node_fwrite(&x, flags, fs);
+    assert(ret == HPCFMT_OK);
+  }
+  fflush(fs);
+
+  // per-byte decoding
+  rewind(fs);
+  unsigned long t0 = usec_time();
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    int ok = fgetc_cct_node_fread(&y, fs);
+    assert(ok);
+    make_node(&x, i);
+    check_node(&x, &y);
+  }
+  double t_fgetc = (usec_time() - t0) * 1e-6;
+
+  // hpcrun_fmt reader
+  rewind(fs);
+  t0 = usec_time();
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    int ret = hpcrun_fmt_cct_node_fread(&y, flags, fs);
+    assert(ret == HPCFMT_OK);
+    make_node(&x, i);
+    check_node(&x, &y);
+  }
+  double t_fread = (usec_time() - t0) * 1e-6;
+  fclose(fs);
+
+  // a record cut at any byte is an error, not a silently short node
+  char* rec = NULL;
+  size_t rec_sz = 0;
+  fs = open_memstream(&rec, &rec_sz);
+  assert(fs);
+  make_node(&x, 1);
+  int ret = hpcrun_fmt_cct_node_fwrite(&x, flags, fs);
+  assert(ret == HPCFMT_OK);
+  fclose(fs);
+
+  for (size_t cut = 1; cut < rec_sz; ++cut) {
+    fs = fmemopen(rec, cut, "r");
+    assert(fs);
+    ret = hpcrun_fmt_cct_node_fread(&y, flags, fs);
+    assert(ret == HPCFMT_ERR);
+    fclose(fs);
+  }
+  free(rec);
+
+  check_trace_truncation();
+
+  free(mx);
+  free(my);
+
+  printf("%u nodes x %u metrics: fgetc %.3f s, hpcrun_fmt %.3f s"
+	 " (%.1fx)\n", num_nodes, num_metrics, t_fgetc, t_fread,
+	 t_fgetc / t_fread);
+  return 0;
+}
@@ -63,6 +63,10 @@
 
 #define HASH_LENGTH MD5_HASH_NBYTES
 
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
 //*****************************************************************************
 // interface operations
 //*****************************************************************************
@@ -152,4 +156,8 @@ crypto_hash_self_test
   int verbose
 );
 
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
 #endif
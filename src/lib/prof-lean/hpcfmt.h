@@ -179,6 +179,29 @@ hpcfmt_int8_fread(uint64_t* val, FILE* infs)
 }
 
 
+// hpcfmt_intXv_fread: reads a vector of 'n' X-byte values at once
+static inline int
+hpcfmt_int4v_fread(uint32_t* val, size_t n, FILE* infs)
+{
+  size_t sz = hpcio_be4v_fread(val, n, infs);
+  if ( sz != n * sizeof(uint32_t) ) {
+    return (sz == 0 && feof(infs)) ? HPCFMT_EOF : HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+static inline int
+hpcfmt_int8v_fread(uint64_t* val, size_t n, FILE* infs)
+{
+  size_t sz = hpcio_be8v_fread(val, n, infs);
+  if ( sz != n * sizeof(uint64_t) ) {
+    return (sz == 0 && feof(infs)) ? HPCFMT_EOF : HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
 static inline int
 hpcfmt_intX_fread(uint8_t* val, size_t size, FILE* infs)
 {
@@ -243,6 +266,27 @@ hpcfmt_intX_fwrite(uint8_t* val, size_t size, FILE* outfs)
 }
 
 
+// hpcfmt_intXv_fwrite: writes a vector of 'n' X-byte values at once
+static inline int
+hpcfmt_int4v_fwrite(const uint32_t* val, size_t n, FILE* outfs)
+{
+  if ( n * sizeof(uint32_t) != hpcio_be4v_fwrite(val, n, outfs) ) {
+    return HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+static inline int
+hpcfmt_int8v_fwrite(const uint64_t* val, size_t n, FILE* outfs)
+{
+  if ( n * sizeof(uint64_t) != hpcio_be8v_fwrite(val, n, outfs) ) {
+    return HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
 static inline int
 hpcfmt_real8_fwrite(double val, FILE* outfs)
 {
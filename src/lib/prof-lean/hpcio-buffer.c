@@ -71,6 +71,14 @@
 //
 // Deserves further study: the best way to handle errors from write().
 //
+// In asynchronous mode (HPCIO_OUTBUF_ASYNC), the buffer is a ring of
+// segments.  The client fills one segment at a time; a full segment
+// is marked ready and written by whoever calls hpcio_outbuf_drain(),
+// normally a writer thread outside the signal handler.  The segment
+// states are the only data shared between the client and the drainer.
+// Each write() is kept whole within a segment, so when the ring is
+// full a dropped write loses whole records, not part of one.
+//
 //***************************************************************************
 
 //************************* System Include Files ****************************
@@ -88,10 +96,15 @@
 #include "hpcfmt.h"
 #include "hpcio-buffer.h"
 #include "spinlock.h"
+#include "stdatomic.h"
 #include <include/min-max.h>
 
 #define HPCIO_OUTBUF_MAGIC  0x494F4246
 
+// async segment states
+#define SEG_FREE   0   // owned by the client
+#define SEG_READY  1   // full, waiting to be written
+
 
 
 //***************************************************************************
@@ -108,6 +121,18 @@ typedef struct hpcio_outbuf_s {
   int  flags;
   char use_lock;
   spinlock_t lock;
+
+  // async mode only
+  int nsegs;
+  size_t seg_size;
+  int fill_seg;            // segment being filled by the client
+  int drain_seg;           // next segment to write
+  atomic_int seg_state[HPCIO_OUTBUF_NUM_SEGS];
+  size_t seg_len[HPCIO_OUTBUF_NUM_SEGS];
+  size_t seg_done[HPCIO_OUTBUF_NUM_SEGS];
+  spinlock_t drain_lock;
+  hpcio_outbuf_notify_fn_t *notify;
+  long num_dropped;        // records, see hpcio_outbuf_write_records()
 } hpcio_outbuf_t;
 
 
@@ -149,6 +174,10 @@ outbuf_alloc
   hpcio_outbuf_t *ob = freelist_dequeue();
   if (ob == 0) {
     ob = (hpcio_outbuf_t *) alloc(sizeof(hpcio_outbuf_t));
+    // recycled outbufs keep their drain lock, which a writer thread
+    // may briefly hold even after close
+    spinlock_init(&ob->drain_lock);
+    ob->nsegs = 0;
   }
   return ob;
 }
@@ -167,6 +196,142 @@ outbuf_free
 }
 
 
+// Try to write() len bytes from buf, starting at offset *done and
+// advancing *done as bytes are written.
+//
+// Returns: HPCFMT_OK if everything was written, else HPCFMT_ERR.
+//
+static int
+outbuf_write_all(int fd, const char *buf, size_t len, size_t *done)
+{
+  ssize_t ret;
+
+  while (*done < len) {
+    errno = 0;
+    ret = write(fd, buf + *done, len - *done);
+
+    // Check for short writes.  Note: EINTR is not failure.
+    if (ret > 0 || (ret == 0 && errno == EINTR)) {
+      *done += ret;
+    }
+    else {
+      return HPCFMT_ERR;
+    }
+  }
+  return HPCFMT_OK;
+}
+
+
+// Write the ready segments in ring order.  The caller holds the
+// drain lock.  A segment that fails to write stays ready and is
+// retried from where it stopped on the next drain.
+//
+// Returns: HPCFMT_OK if all ready segments were written, else
+// HPCFMT_ERR.
+//
+static int
+outbuf_drain_segments(hpcio_outbuf_t *outbuf)
+{
+  for (;;) {
+    int k = outbuf->drain_seg;
+    if (atomic_load_explicit(&outbuf->seg_state[k], memory_order_acquire)
+	!= SEG_READY) {
+      return HPCFMT_OK;
+    }
+
+    char *seg = (char *) outbuf->buf_start + k * outbuf->seg_size;
+    if (outbuf_write_all(outbuf->fd, seg, outbuf->seg_len[k],
+			 &outbuf->seg_done[k]) != HPCFMT_OK) {
+      return HPCFMT_ERR;
+    }
+
+    outbuf->seg_done[k] = 0;
+    outbuf->drain_seg = (k + 1) % outbuf->nsegs;
+    atomic_store_explicit(&outbuf->seg_state[k], SEG_FREE, memory_order_release);
+  }
+}
+
+
+// Hand the client's current segment to the drainer and move on to the
+// next one.  Never blocks.
+//
+// Returns: 1 if the client has a fresh segment, or 0 if the next one
+// has not been written yet.
+//
+static int
+outbuf_seal_segment(hpcio_outbuf_t *outbuf)
+{
+  int k = outbuf->fill_seg;
+  int next = (k + 1) % outbuf->nsegs;
+
+  if (atomic_load_explicit(&outbuf->seg_state[next], memory_order_acquire)
+      != SEG_FREE) {
+    return 0;
+  }
+
+  outbuf->seg_len[k] = outbuf->in_use;
+  atomic_store_explicit(&outbuf->seg_state[k], SEG_READY, memory_order_release);
+
+  outbuf->fill_seg = next;
+  outbuf->in_use = 0;
+
+  if (outbuf->notify) {
+    outbuf->notify();
+  }
+  return 1;
+}
+
+
+// Write the ready segments and then the client's partial segment.
+// Only the client may call this, and it may wait for a drain in
+// progress on another thread.
+//
+static int
+outbuf_flush_async(hpcio_outbuf_t *outbuf)
+{
+  spinlock_lock(&outbuf->drain_lock);
+
+  int ret = outbuf_drain_segments(outbuf);
+  if (ret == HPCFMT_OK) {
+    char *seg = (char *) outbuf->buf_start + outbuf->fill_seg * outbuf->seg_size;
+    size_t done = 0;
+    ret = outbuf_write_all(outbuf->fd, seg, outbuf->in_use, &done);
+    if (done > 0) {
+      memmove(seg, seg + done, outbuf->in_use - done);
+      outbuf->in_use -= done;
+    }
+  }
+
+  spinlock_unlock(&outbuf->drain_lock);
+  return ret;
+}
+
+
+// Copy data into the client's segment, moving to the next segment if
+// it does not fit.  A write larger than a segment, or one that finds
+// the ring full, is dropped whole and its 'nrecords' records counted.
+//
+// Returns: size, since dropped data is accounted for separately.
+//
+static ssize_t
+outbuf_write_async(hpcio_outbuf_t *outbuf, const void *data, size_t size,
+		   long nrecords)
+{
+  if (size > outbuf->seg_size - outbuf->in_use) {
+    if (size > outbuf->seg_size || ! outbuf_seal_segment(outbuf)) {
+      outbuf->num_dropped += nrecords;
+      return size;
+    }
+  }
+
+  char *seg = (char *) outbuf->buf_start + outbuf->fill_seg * outbuf->seg_size;
+  memcpy(seg + outbuf->in_use, data, size);
+  outbuf->in_use += size;
+
+  return size;
+}
+
+
 // Try to write() the entire outbuf.
 //
 // Returns: HPCFMT_OK if the entire buffer was successfully written,
@@ -177,6 +342,10 @@ outbuf_flush_buffer(hpcio_outbuf_t *outbuf)
 {
   ssize_t amt_done, ret;
 
+  if (outbuf->nsegs > 0) {
+    return outbuf_flush_async(outbuf);
+  }
+
   amt_done = 0;
   while (amt_done < outbuf->in_use) {
     errno = 0;
@@ -245,6 +414,25 @@ hpcio_outbuf_attach
   outbuf->use_lock = (flags & HPCIO_OUTBUF_LOCKED);
   spinlock_unlock(&outbuf->lock);
 
+  spinlock_lock(&outbuf->drain_lock);
+  outbuf->nsegs = 0;
+  outbuf->seg_size = 0;
+  outbuf->fill_seg = 0;
+  outbuf->drain_seg = 0;
+  for (int k = 0; k < HPCIO_OUTBUF_NUM_SEGS; k++) {
+    atomic_init(&outbuf->seg_state[k], SEG_FREE);
+    outbuf->seg_len[k] = 0;
+    outbuf->seg_done[k] = 0;
+  }
+  outbuf->notify = NULL;
+  outbuf->num_dropped = 0;
+
+  if ((flags & HPCIO_OUTBUF_ASYNC) && buf_size >= HPCIO_OUTBUF_NUM_SEGS) {
+    outbuf->nsegs = HPCIO_OUTBUF_NUM_SEGS;
+    outbuf->seg_size = buf_size / HPCIO_OUTBUF_NUM_SEGS;
+  }
+  spinlock_unlock(&outbuf->drain_lock);
+
   *outbuf_ptr = outbuf;
 
   return HPCFMT_OK;
@@ -257,6 +445,18 @@ hpcio_outbuf_attach
 //
 ssize_t
 hpcio_outbuf_write(hpcio_outbuf_t *outbuf, const void *data, size_t size)
+{
+  return hpcio_outbuf_write_records(outbuf, data, size, 1);
+}
+
+
+// As hpcio_outbuf_write(), for data that holds 'nrecords' records
+// (e.g., a compact trace block), so that a write dropped in
+// asynchronous mode is counted as that many records.
+//
+ssize_t
+hpcio_outbuf_write_records(hpcio_outbuf_t *outbuf, const void *data,
+			   size_t size, long nrecords)
 {
   size_t amt, amt_done;
 
@@ -267,6 +467,14 @@ hpcio_outbuf_write(hpcio_outbuf_t *outbuf, const void *data, size_t size)
     spinlock_lock(&outbuf->lock);
   }
 
+  if (outbuf->nsegs > 0) {
+    amt_done = outbuf_write_async(outbuf, data, size, nrecords);
+    if (outbuf->use_lock) {
+      spinlock_unlock(&outbuf->lock);
+    }
+    return amt_done;
+  }
+
   amt_done = 0;
   while (amt_done < size) {
     // flush if needed
@@ -345,6 +553,12 @@ hpcio_outbuf_close(hpcio_outbuf_t **outbuf_ptr)
     ret = HPCFMT_ERR;
   }
 
+  // a writer thread may still hold a pointer to this outbuf, so detach
+  // it from the ring under the drain lock before recycling it
+  spinlock_lock(&outbuf->drain_lock);
+  outbuf->nsegs = 0;
+  spinlock_unlock(&outbuf->drain_lock);
+
   if (outbuf->use_lock) {
     spinlock_unlock(&outbuf->lock);
   }
@@ -355,3 +569,57 @@ hpcio_outbuf_close(hpcio_outbuf_t **outbuf_ptr)
 
   return ret;
 }
+
+
+// Set a function to call when a segment becomes ready to write, for
+// example to wake a writer thread.  It is called from the context of
+// hpcio_outbuf_write(), so it must be safe inside signal handlers.
+//
+void
+hpcio_outbuf_set_notify(hpcio_outbuf_t *outbuf, hpcio_outbuf_notify_fn_t *notify)
+{
+  if (outbuf != NULL && outbuf->magic == HPCIO_OUTBUF_MAGIC) {
+    outbuf->notify = notify;
+  }
+}
+
+
+// Write the segments that the client has filled, in asynchronous mode.
+// Does nothing if another thread is draining the buffer.  Safe to call
+// from any thread on an outbuf that is open or has been closed.
+//
+// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
+//
+int
+hpcio_outbuf_drain(hpcio_outbuf_t *outbuf)
+{
+  int ret = HPCFMT_OK;
+
+  if (outbuf == NULL) {
+    return HPCFMT_ERR;
+  }
+  if (! limit_spinlock_lock(&outbuf->drain_lock, 1, 0)) {
+    return HPCFMT_OK;
+  }
+
+  // closed (or not async) buffers are checked under the drain lock
+  if (outbuf->magic == HPCIO_OUTBUF_MAGIC && outbuf->nsegs > 0) {
+    ret = outbuf_drain_segments(outbuf);
+  }
+
+  spinlock_unlock(&outbuf->drain_lock);
+  return ret;
+}
+
+
+// Returns: the number of records dropped because the asynchronous ring
+// was full.
+//
+long
+hpcio_outbuf_num_dropped(hpcio_outbuf_t *outbuf)
+{
+  if (outbuf == NULL || outbuf->magic != HPCIO_OUTBUF_MAGIC) {
+    return 0;
+  }
+  return outbuf->num_dropped;
+}
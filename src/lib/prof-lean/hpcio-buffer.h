@@ -64,6 +64,17 @@ typedef struct hpcio_outbuf_s hpcio_outbuf_t;
 #define HPCIO_OUTBUF_LOCKED    0x1
 #define HPCIO_OUTBUF_UNLOCKED  0x2
 
+// Asynchronous mode: the buffer is split into HPCIO_OUTBUF_NUM_SEGS
+// segments.  A full segment is handed off to hpcio_outbuf_drain()
+// (normally run by a writer thread) and the client continues in the
+// next one, so hpcio_outbuf_write() never calls write().  If every
+// segment is waiting to be written, the data is dropped and counted.
+#define HPCIO_OUTBUF_ASYNC     0x4
+
+#define HPCIO_OUTBUF_NUM_SEGS  4
+
+typedef void (hpcio_outbuf_notify_fn_t)(void);
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -89,6 +100,16 @@ hpcio_outbuf_write
 );
 
 
+ssize_t
+hpcio_outbuf_write_records
+(
+  hpcio_outbuf_t *outbuf,
+  const void *data,
+  size_t size,
+  long nrecords
+);
+
+
 int
 hpcio_outbuf_flush
 (
@@ -103,6 +124,28 @@ hpcio_outbuf_close
 );
 
 
+void
+hpcio_outbuf_set_notify
+(
+  hpcio_outbuf_t *outbuf,
+  hpcio_outbuf_notify_fn_t *notify
+);
+
+
+int
+hpcio_outbuf_drain
+(
+  hpcio_outbuf_t *outbuf
+);
+
+
+long
+hpcio_outbuf_num_dropped
+(
+  hpcio_outbuf_t *outbuf
+);
+
+
 #if defined(__cplusplus)
 }
 #endif
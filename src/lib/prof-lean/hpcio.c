@@ -90,6 +90,8 @@
 
 //*************************** User Include Files ****************************
 
+#include <include/big-endian.h>
+
 #include "hpcio.h"
 
 
@@ -278,21 +280,20 @@ hpcio_le8_fwrite(uint64_t* val, FILE* fs)
 
 //***************************************************************************
 // Big endian
+//
+// Each value is moved with a single fread()/fwrite() and converted
+// with the byte-swap macros from <include/big-endian.h>, rather than
+// one stdio call per byte.  On a short read, the missing (low-order)
+// bytes are zero, exactly as with the byte-at-a-time loop.
 //***************************************************************************
 
 size_t
 hpcio_be2_fread(uint16_t* val, FILE* fs)
 {
   uint16_t v = 0; // local copy of val
-  int shift = 0, num_read = 0, c;
-  
-  for (shift = 8; shift >= 0; shift -= 8) {
-    if ( (c = fgetc(fs)) == EOF ) { break; }
-    num_read++;
-    v = (uint16_t)(v | ((c & 0xff) << shift)); // 8, 0
-  }
+  size_t num_read = fread(&v, 1, sizeof(v), fs);
 
-  *val = v;
+  *val = be_to_host_16(v);
   return num_read;
 }
 
@@ -301,15 +302,9 @@ size_t
 hpcio_be4_fread(uint32_t* val, FILE* fs)
 {
   uint32_t v = 0; // local copy of val
-  int shift = 0, num_read = 0, c;
-  
-  for (shift = 24; shift >= 0; shift -= 8) {
-    if ( (c = fgetc(fs)) == EOF ) { break; }
-    num_read++;
-    v |= ((uint32_t)(c & 0xff) << shift); // 24, 16, 8, 0
-  }
+  size_t num_read = fread(&v, 1, sizeof(v), fs);
 
-  *val = v;
+  *val = be_to_host_32(v);
   return num_read;
 }
 
@@ -318,101 +313,141 @@ size_t
 hpcio_be8_fread(uint64_t* val, FILE* fs)
 {
   uint64_t v = 0; // local copy of val
-  int shift = 0, num_read = 0, c;
-  
-  for (shift = 56; shift >= 0; shift -= 8) {
-    if ( (c = fgetc(fs)) == EOF ) { break; }
-    num_read++;
-    v |= ((uint64_t)(c & 0xff) << shift); // 56, 48, 40, ... 0
+  size_t num_read = fread(&v, 1, sizeof(v), fs);
+
+  *val = be_to_host_64(v);
+  return num_read;
+}
+
+
+size_t
+hpcio_be8v_fread(uint64_t* val, size_t n, FILE* fs)
+{
+  size_t num_read = fread(val, 1, n * sizeof(uint64_t), fs);
+
+  // swap whole values in place; a simple loop the compiler vectorizes
+  size_t n_full = num_read / sizeof(uint64_t);
+  for (size_t i = 0; i < n_full; ++i) {
+    val[i] = be_to_host_64(val[i]);
+  }
+
+  // a trailing partial value is decoded as hpcio_be8_fread() would
+  size_t n_part = num_read % sizeof(uint64_t);
+  if (n_part > 0) {
+    uint64_t v = 0;
+    memcpy(&v, &val[n_full], n_part);
+    val[n_full] = be_to_host_64(v);
   }
 
-  *val = v;
   return num_read;
 }
 
 
 size_t
-hpcio_beX_fread(uint8_t* val, size_t size, FILE* fs)
+hpcio_be4v_fread(uint32_t* val, size_t n, FILE* fs)
 {
-  size_t num_read = 0;
+  size_t num_read = fread(val, 1, n * sizeof(uint32_t), fs);
 
-  for (uint i = 0; i < size; ++i) {
-    int c = fgetc(fs);
-    if (c == EOF) {
-      break;
-    }
-    val[i] = (uint8_t) c;
-    num_read++;
+  size_t n_full = num_read / sizeof(uint32_t);
+  for (size_t i = 0; i < n_full; ++i) {
+    val[i] = be_to_host_32(val[i]);
+  }
+
+  size_t n_part = num_read % sizeof(uint32_t);
+  if (n_part > 0) {
+    uint32_t v = 0;
+    memcpy(&v, &val[n_full], n_part);
+    val[n_full] = be_to_host_32(v);
   }
 
   return num_read;
 }
 
 
+size_t
+hpcio_beX_fread(uint8_t* val, size_t size, FILE* fs)
+{
+  return fread(val, 1, size, fs);
+}
+
+
 //***************************************************************************
 
 size_t
 hpcio_be2_fwrite(uint16_t* val, FILE* fs)
 {
-  uint16_t v = *val; // local copy of val
-  int shift = 0, num_write = 0, c;
-  
-  for (shift = 8; shift >= 0; shift -= 8) {
-    c = fputc( ((v >> shift) & 0xff) , fs);
-    if (c == EOF) { break; }
-    num_write++;
-  }
-  return num_write;
+  uint16_t v = host_to_be_16(*val);
+  return fwrite(&v, 1, sizeof(v), fs);
 }
 
 
 size_t
 hpcio_be4_fwrite(uint32_t* val, FILE* fs)
 {
-  uint32_t v = *val; // local copy of val
-  int shift = 0, num_write = 0, c;
-  
-  for (shift = 24; shift >= 0; shift -= 8) {
-    c = fputc( ((v >> shift) & 0xff) , fs);
-    if (c == EOF) { break; }
-    num_write++;
-  }
-  return num_write;
+  uint32_t v = host_to_be_32(*val);
+  return fwrite(&v, 1, sizeof(v), fs);
 }
 
 
 size_t
 hpcio_be8_fwrite(uint64_t* val, FILE* fs)
 {
-  uint64_t v = *val; // local copy of val
-  int shift = 0, num_write = 0, c;
-  
-  for (shift = 56; shift >= 0; shift -= 8) {
-    c = fputc( ((v >> shift) & 0xff) , fs);
-    if (c == EOF) { break; }
-    num_write++;
+  uint64_t v = host_to_be_64(*val);
+  return fwrite(&v, 1, sizeof(v), fs);
+}
+
+
+// Vectors are converted through a bounded staging buffer so that the
+// caller's data is left untouched and each fwrite() moves a large block.
+#define HPCIO_VEC_CHUNK_BYTES (16 * 1024)
+
+size_t
+hpcio_be4v_fwrite(const uint32_t* val, size_t n, FILE* fs)
+{
+  uint32_t buf[HPCIO_VEC_CHUNK_BYTES / sizeof(uint32_t)];
+  const size_t chunk = sizeof(buf) / sizeof(buf[0]);
+  size_t num_write = 0;
+
+  for (size_t i = 0; i < n; i += chunk) {
+    size_t len = (n - i < chunk) ? (n - i) : chunk;
+    for (size_t j = 0; j < len; ++j) {
+      buf[j] = host_to_be_32(val[i + j]);
+    }
+    size_t nw = fwrite(buf, 1, len * sizeof(uint32_t), fs);
+    num_write += nw;
+    if (nw != len * sizeof(uint32_t)) { break; }
   }
   return num_write;
 }
 
 
 size_t
-hpcio_beX_fwrite(uint8_t* val, size_t size, FILE* fs)
+hpcio_be8v_fwrite(const uint64_t* val, size_t n, FILE* fs)
 {
+  uint64_t buf[HPCIO_VEC_CHUNK_BYTES / sizeof(uint64_t)];
+  const size_t chunk = sizeof(buf) / sizeof(buf[0]);
   size_t num_write = 0;
-  
-  for (uint i = 0; i < size; ++i) {
-    int c = fputc(val[i], fs);
-    if (c == EOF) {
-      break;
+
+  for (size_t i = 0; i < n; i += chunk) {
+    size_t len = (n - i < chunk) ? (n - i) : chunk;
+    for (size_t j = 0; j < len; ++j) {
+      buf[j] = host_to_be_64(val[i + j]);
     }
-    num_write++;
+    size_t nw = fwrite(buf, 1, len * sizeof(uint64_t), fs);
+    num_write += nw;
+    if (nw != len * sizeof(uint64_t)) { break; }
   }
-
   return num_write;
 }
 
 
+size_t
+hpcio_beX_fwrite(uint8_t* val, size_t size, FILE* fs)
+{
+  return fwrite(val, 1, size, fs);
+}
+
+
 //***************************************************************************
 //
 //***************************************************************************
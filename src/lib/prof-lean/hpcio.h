@@ -154,6 +154,15 @@ hpcio_be4_fread(uint32_t* val, FILE* fs);
 size_t
 hpcio_be8_fread(uint64_t* val, FILE* fs);
 
+// hpcio_beXv_fread: Reads 'n' consecutive X-byte big-endian values
+// from 'fs' into 'val' with one read, converting them in place.
+// Returns the number of bytes read.
+size_t
+hpcio_be4v_fread(uint32_t* val, size_t n, FILE* fs);
+
+size_t
+hpcio_be8v_fread(uint64_t* val, size_t n, FILE* fs);
+
 size_t
 hpcio_beX_fread(uint8_t* val, size_t size, FILE* fs);
 
@@ -170,6 +179,14 @@ hpcio_be8_fwrite(uint64_t* val, FILE* fs);
 size_t
 hpcio_beX_fwrite(uint8_t* val, size_t size, FILE* fs);
 
+// hpcio_beXv_fwrite: Writes 'n' X-byte values from 'val' in big-endian
+// order using large block writes.  Returns the number of bytes written.
+size_t
+hpcio_be4v_fwrite(const uint32_t* val, size_t n, FILE* fs);
+
+size_t
+hpcio_be8v_fwrite(const uint64_t* val, size_t n, FILE* fs);
+
 
 //***************************************************************************
 
@@ -76,6 +76,7 @@
 
 //*************************** User Include Files ****************************
 
+#include <include/big-endian.h>
 #include <include/gcc-attr.h>
 
 #include "hpcio.h"
@@ -616,28 +617,80 @@ hpcrun_fmt_loadmapEntry_free(loadmap_entry_t* x, hpcfmt_free_fn dealloc)
 // cct
 //***************************************************************************
 
- int
+// largest fixed-size prefix of a cct node record: id, id_parent,
+// as_info, lm_id, lm_ip and lip
+#define HPCRUN_FMT_CCT_NODE_HDR_MAX_SZ \
+  (4 + 4 + 4 + 2 + 8 + (8 * LUSH_LIP_DATA8_SZ))
+
+// decode a big-endian value from '*p' and advance '*p' past it
+static inline uint16_t
+hpcrun_fmt_be2_decode(const uint8_t** p)
+{
+  uint16_t v;
+  memcpy(&v, *p, sizeof(v));
+  *p += sizeof(v);
+  return be_to_host_16(v);
+}
+
+static inline uint32_t
+hpcrun_fmt_be4_decode(const uint8_t** p)
+{
+  uint32_t v;
+  memcpy(&v, *p, sizeof(v));
+  *p += sizeof(v);
+  return be_to_host_32(v);
+}
+
+static inline uint64_t
+hpcrun_fmt_be8_decode(const uint8_t** p)
+{
+  uint64_t v;
+  memcpy(&v, *p, sizeof(v));
+  *p += sizeof(v);
+  return be_to_host_64(v);
+}
+
+
+int
 hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
 			  epoch_flags_t flags, FILE* fs)
 {
-  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->id, fs));
-  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->id_parent, fs));
+  // The fixed-size part of a node record (id, id_parent, [as_info],
+  // lm_id, lm_ip, [lip]) is read with one call and decoded from the
+  // buffer; the metric vector is read and swapped as one block.
+  uint8_t buf[HPCRUN_FMT_CCT_NODE_HDR_MAX_SZ];
+  int isLogicalUnwind = flags.fields.isLogicalUnwind;
+
+  size_t hdr_sz = (sizeof(x->id) + sizeof(x->id_parent)
+		   + sizeof(x->lm_id) + sizeof(x->lm_ip));
+  if (isLogicalUnwind) {
+    hdr_sz += sizeof(x->as_info.bits) + sizeof(x->lip.data8);
+  }
+
+  HPCFMT_ThrowIfError(hpcfmt_intX_fread(buf, hdr_sz, fs));
+
+  const uint8_t* p = buf;
+  x->id        = hpcrun_fmt_be4_decode(&p);
+  x->id_parent = hpcrun_fmt_be4_decode(&p);
 
   x->as_info = lush_assoc_info_NULL;
-  if (flags.fields.isLogicalUnwind) {
-    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->as_info.bits, fs));
+  if (isLogicalUnwind) {
+    x->as_info.bits = hpcrun_fmt_be4_decode(&p);
   }
 
-  HPCFMT_ThrowIfError(hpcfmt_int2_fread(&x->lm_id, fs));
-  HPCFMT_ThrowIfError(hpcfmt_int8_fread(&x->lm_ip, fs));
+  x->lm_id = hpcrun_fmt_be2_decode(&p);
+  x->lm_ip = hpcrun_fmt_be8_decode(&p);
 
   lush_lip_init(&x->lip);
-  if (flags.fields.isLogicalUnwind) {
-    hpcrun_fmt_lip_fread(&x->lip, fs);
+  if (isLogicalUnwind) {
+    for (int i = 0; i < LUSH_LIP_DATA8_SZ; ++i) {
+      x->lip.data8[i] = hpcrun_fmt_be8_decode(&p);
+    }
   }
 
-  for (int i = 0; i < x->num_metrics; ++i) {
-    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&x->metrics[i].bits, fs));
+  if (x->num_metrics > 0) {
+    HPCFMT_ThrowIfError(hpcfmt_int8v_fread((uint64_t*)x->metrics,
+					   x->num_metrics, fs));
   }
   
   return HPCFMT_OK;
@@ -825,8 +878,12 @@ hpctrace_fmt_hdr_outbuf(hpctrace_hdr_flags_t flags, hpcio_outbuf_t* outbuf)
     k++;
   }
 
+  const char* version =
+    (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS))
+    ? HPCTRACE_FMT_VersionCompact : HPCTRACE_FMT_Version;
+
   hpcio_outbuf_write(outbuf, HPCTRACE_FMT_Magic, HPCTRACE_FMT_MagicLen);
-  hpcio_outbuf_write(outbuf, HPCTRACE_FMT_Version, HPCTRACE_FMT_VersionLen);
+  hpcio_outbuf_write(outbuf, version, HPCTRACE_FMT_VersionLen);
   hpcio_outbuf_write(outbuf, HPCTRACE_FMT_Endian, HPCTRACE_FMT_EndianLen);
   ret = hpcio_outbuf_write(outbuf, buf, bufSZ);
 
@@ -847,7 +904,11 @@ hpctrace_fmt_hdr_fwrite(hpctrace_hdr_flags_t flags, FILE* fs)
   nw = fwrite(HPCTRACE_FMT_Magic,   1, HPCTRACE_FMT_MagicLen, fs);
   if (nw != HPCTRACE_FMT_MagicLen) return HPCFMT_ERR;
 
-  nw = fwrite(HPCTRACE_FMT_Version, 1, HPCTRACE_FMT_VersionLen, fs);
+  const char* version =
+    (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS))
+    ? HPCTRACE_FMT_VersionCompact : HPCTRACE_FMT_Version;
+
+  nw = fwrite(version, 1, HPCTRACE_FMT_VersionLen, fs);
   if (nw != HPCTRACE_FMT_VersionLen) return HPCFMT_ERR;
 
   nw = fwrite(HPCTRACE_FMT_Endian,  1, HPCTRACE_FMT_EndianLen, fs);
@@ -972,6 +1033,424 @@ hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 }
 
 
+//***************************************************************************
+// [hpctrace] compact blocks
+//***************************************************************************
+
+static inline unsigned char*
+trace_varint_put(unsigned char* p, uint64_t v)
+{
+  while (v >= 0x80) {
+    *p++ = (unsigned char)((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  *p++ = (unsigned char)v;
+  return p;
+}
+
+
+static inline int
+trace_varint_get(const unsigned char* buf, uint32_t len, uint32_t* pos,
+		 uint64_t* v)
+{
+  uint64_t x = 0;
+  for (int shift = 0; *pos < len && shift < 64; shift += 7) {
+    unsigned char c = buf[(*pos)++];
+    x |= ((uint64_t)(c & 0x7f)) << shift;
+    if (!(c & 0x80)) {
+      *v = x;
+      return HPCFMT_OK;
+    }
+  }
+  return HPCFMT_ERR;
+}
+
+
+static inline uint64_t
+trace_zigzag(int64_t d)
+{
+  return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+}
+
+
+static inline int64_t
+trace_unzigzag(uint64_t v)
+{
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+
+static inline unsigned char*
+trace_be_put(unsigned char* p, uint64_t v, int nbytes)
+{
+  for (int shift = 8 * (nbytes - 1); shift >= 0; shift -= 8) {
+    *p++ = (v >> shift) & 0xff;
+  }
+  return p;
+}
+
+
+void
+hpctrace_fmt_block_init(hpctrace_fmt_block_t* b)
+{
+  b->time = 0;
+  b->prevTime = 0;
+  b->nrecords = 0;
+  b->len = 0;
+}
+
+
+static void
+trace_block_put(hpctrace_fmt_block_t* b, hpctrace_fmt_datum_t* x,
+		hpctrace_hdr_flags_t flags)
+{
+  uint64_t time = x->comp;
+  if (b->nrecords == 0) {
+    b->time = time;
+    b->prevTime = time;
+  }
+
+  unsigned char* p = b->buf + HPCTRACE_FMT_BlockHdrLen + b->len;
+  p = trace_varint_put(p, trace_zigzag((int64_t)(time - b->prevTime)));
+  p = trace_varint_put(p, x->cpId);
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
+    p = trace_varint_put(p, x->metricId);
+  }
+
+  b->len = p - (b->buf + HPCTRACE_FMT_BlockHdrLen);
+  b->prevTime = time;
+  b->nrecords++;
+}
+
+
+// Fill in the block header; returns the size of the whole block.
+static uint32_t
+trace_block_seal(hpctrace_fmt_block_t* b)
+{
+  unsigned char* p = b->buf;
+  p = trace_be_put(p, b->time, 8);
+  p = trace_be_put(p, b->nrecords, 4);
+  p = trace_be_put(p, b->len, 4);
+  return HPCTRACE_FMT_BlockHdrLen + b->len;
+}
+
+
+int
+hpctrace_fmt_block_outbuf(hpctrace_fmt_block_t* b, hpcio_outbuf_t* outbuf)
+{
+  if (b->nrecords == 0) {
+    return HPCFMT_OK;
+  }
+
+  // one write per block, so that a block is never split
+  ssize_t sz = trace_block_seal(b);
+  int ret = (hpcio_outbuf_write_records(outbuf, b->buf, sz, b->nrecords) == sz)
+    ? HPCFMT_OK : HPCFMT_ERR;
+
+  hpctrace_fmt_block_init(b);
+  return ret;
+}
+
+
+int
+hpctrace_fmt_datum_block_outbuf(hpctrace_fmt_datum_t* x,
+				hpctrace_hdr_flags_t flags,
+				hpctrace_fmt_block_t* b, hpcio_outbuf_t* outbuf)
+{
+  trace_block_put(b, x, flags);
+  if (b->nrecords == HPCTRACE_FMT_BlockMaxRecords) {
+    return hpctrace_fmt_block_outbuf(b, outbuf);
+  }
+  return HPCFMT_OK;
+}
+
+
+int
+hpctrace_fmt_block_fwrite(hpctrace_fmt_block_t* b, FILE* fs,
+			  uint64_t* nwritten)
+{
+  if (b->nrecords == 0) {
+    return HPCFMT_OK;
+  }
+
+  size_t sz = trace_block_seal(b);
+  int ret = (fwrite(b->buf, 1, sz, fs) == sz) ? HPCFMT_OK : HPCFMT_ERR;
+  if (nwritten) {
+    *nwritten += sz;
+  }
+
+  hpctrace_fmt_block_init(b);
+  return ret;
+}
+
+
+int
+hpctrace_fmt_datum_block_fwrite(hpctrace_fmt_datum_t* x,
+				hpctrace_hdr_flags_t flags,
+				hpctrace_fmt_block_t* b, FILE* fs,
+				uint64_t* nwritten)
+{
+  trace_block_put(b, x, flags);
+  if (b->nrecords == HPCTRACE_FMT_BlockMaxRecords) {
+    return hpctrace_fmt_block_fwrite(b, fs, nwritten);
+  }
+  return HPCFMT_OK;
+}
+
+
+// Read the index trailer of a compact trace of 'size' bytes, if it has
+// one.  Leaves 'fs' positioned at the start of the block entries.
+//
+// Returns: HPCFMT_OK if there is a trailer, else HPCFMT_ERR.
+static int
+trace_index_trailer(FILE* fs, uint64_t size, uint64_t* nblocks,
+		    uint64_t* nrecords)
+{
+  char magic[HPCTRACE_FMT_IndexMagicLen];
+
+  if (size < HPCTRACE_FMT_HeaderLen + HPCTRACE_FMT_IndexTrailerLen) {
+    return HPCFMT_ERR;
+  }
+  if (fseeko(fs, size - HPCTRACE_FMT_IndexTrailerLen, SEEK_SET) != 0
+      || hpcfmt_int8_fread(nblocks, fs) != HPCFMT_OK
+      || hpcfmt_int8_fread(nrecords, fs) != HPCFMT_OK
+      || fread(magic, 1, sizeof(magic), fs) != sizeof(magic)
+      || memcmp(magic, HPCTRACE_FMT_IndexMagic, sizeof(magic)) != 0) {
+    return HPCFMT_ERR;
+  }
+
+  uint64_t avail = size - HPCTRACE_FMT_HeaderLen - HPCTRACE_FMT_IndexTrailerLen;
+  if (*nblocks > avail / 16) {
+    return HPCFMT_ERR;
+  }
+  uint64_t start = size - HPCTRACE_FMT_IndexTrailerLen - (*nblocks * 16);
+  if (fseeko(fs, start, SEEK_SET) != 0) {
+    return HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+static int
+trace_file_size(FILE* fs, uint64_t* size)
+{
+  if (fseeko(fs, 0, SEEK_END) != 0) {
+    return HPCFMT_ERR;
+  }
+  off_t end = ftello(fs);
+  if (end < 0) {
+    return HPCFMT_ERR;
+  }
+  *size = end;
+  return HPCFMT_OK;
+}
+
+
+int
+hpctrace_fmt_reader_init(hpctrace_fmt_reader_t* r, hpctrace_fmt_hdr_t* hdr,
+			 FILE* fs)
+{
+  r->fs = fs;
+  r->flags = hdr->flags;
+  r->end = 0;
+  r->time = 0;
+  r->nleft = 0;
+  r->pos = 0;
+  r->len = 0;
+
+  if (!HPCTRACE_HDR_FLAGS_GET_BIT(r->flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS)) {
+    return HPCFMT_OK;
+  }
+
+  // the blocks end where the index (if any) begins
+  off_t cur = ftello(fs);
+  uint64_t size, nblocks, nrecords;
+  if (cur < 0 || trace_file_size(fs, &size) != HPCFMT_OK) {
+    return HPCFMT_ERR;
+  }
+  r->end = size;
+  if (trace_index_trailer(fs, size, &nblocks, &nrecords) == HPCFMT_OK) {
+    r->end = ftello(fs);
+  }
+  if (fseeko(fs, cur, SEEK_SET) != 0) {
+    return HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+// Load the next block into the reader.  As in trace_index_scan(), a
+// truncated last block ends the trace.
+static int
+trace_reader_block(hpctrace_fmt_reader_t* r)
+{
+  off_t off = ftello(r->fs);
+  if (off < 0) {
+    return HPCFMT_ERR;
+  }
+  if ((uint64_t)off + HPCTRACE_FMT_BlockHdrLen > r->end) {
+    return HPCFMT_EOF;
+  }
+
+  uint64_t time;
+  uint32_t n, len;
+  if (hpcfmt_int8_fread(&time, r->fs) != HPCFMT_OK
+      || hpcfmt_int4_fread(&n, r->fs) != HPCFMT_OK
+      || hpcfmt_int4_fread(&len, r->fs) != HPCFMT_OK) {
+    return HPCFMT_ERR;
+  }
+  if (len > HPCTRACE_FMT_BlockMaxLen
+      || (uint64_t)off + HPCTRACE_FMT_BlockHdrLen + len > r->end) {
+    return HPCFMT_EOF;
+  }
+  if (fread(r->buf, 1, len, r->fs) != len) {
+    return HPCFMT_ERR;
+  }
+
+  r->time = time;
+  r->nleft = n;
+  r->pos = 0;
+  r->len = len;
+  return HPCFMT_OK;
+}
+
+
+int
+hpctrace_fmt_reader_next(hpctrace_fmt_reader_t* r, hpctrace_fmt_datum_t* x)
+{
+  if (!HPCTRACE_HDR_FLAGS_GET_BIT(r->flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS)) {
+    return hpctrace_fmt_datum_fread(x, r->flags, r->fs);
+  }
+
+  while (r->nleft == 0) {
+    int ret = trace_reader_block(r);
+    if (ret != HPCFMT_OK) {
+      return ret; // can be HPCFMT_EOF
+    }
+  }
+
+  uint64_t delta, cpId, metricId = HPCTRACE_FMT_MetricId_NULL;
+  if (trace_varint_get(r->buf, r->len, &r->pos, &delta) != HPCFMT_OK
+      || trace_varint_get(r->buf, r->len, &r->pos, &cpId) != HPCFMT_OK) {
+    return HPCFMT_ERR;
+  }
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(r->flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)
+      && trace_varint_get(r->buf, r->len, &r->pos, &metricId) != HPCFMT_OK) {
+    return HPCFMT_ERR;
+  }
+
+  r->time += trace_unzigzag(delta);
+  r->nleft--;
+
+  x->comp = r->time;
+  x->cpId = (uint32_t)cpId;
+  x->metricId = (uint32_t)metricId;
+  return HPCFMT_OK;
+}
+
+
+// Walk the block headers from the end of the file header, recording
+// each block in 'idx' if its arrays are non-NULL.  A truncated last
+// block (e.g., from a process that did not exit cleanly) ends the walk.
+static int
+trace_index_scan(hpctrace_fmt_index_t* idx, FILE* fs, uint64_t size)
+{
+  uint64_t off = HPCTRACE_FMT_HeaderLen;
+  uint64_t nblocks = 0, nrecords = 0;
+
+  while (off + HPCTRACE_FMT_BlockHdrLen <= size) {
+    uint64_t time;
+    uint32_t n, len;
+    if (fseeko(fs, off, SEEK_SET) != 0
+	|| hpcfmt_int8_fread(&time, fs) != HPCFMT_OK
+	|| hpcfmt_int4_fread(&n, fs) != HPCFMT_OK
+	|| hpcfmt_int4_fread(&len, fs) != HPCFMT_OK) {
+      return HPCFMT_ERR;
+    }
+    if (len > HPCTRACE_FMT_BlockMaxLen
+	|| off + HPCTRACE_FMT_BlockHdrLen + len > size) {
+      break;
+    }
+    if (idx->time) {
+      idx->time[nblocks] = time;
+      idx->offset[nblocks] = off;
+    }
+    nblocks++;
+    nrecords += n;
+    off += HPCTRACE_FMT_BlockHdrLen + len;
+  }
+
+  idx->nblocks = nblocks;
+  idx->nrecords = nrecords;
+  return HPCFMT_OK;
+}
+
+
+int
+hpctrace_fmt_index_fread(hpctrace_fmt_index_t* idx, FILE* fs,
+			 hpcfmt_alloc_fn alloc)
+{
+  uint64_t size;
+
+  idx->nblocks = 0;
+  idx->nrecords = 0;
+  idx->time = NULL;
+  idx->offset = NULL;
+
+  if (trace_file_size(fs, &size) != HPCFMT_OK) {
+    return HPCFMT_ERR;
+  }
+
+  if (trace_index_trailer(fs, size, &idx->nblocks, &idx->nrecords) == HPCFMT_OK) {
+    idx->time = (uint64_t*) alloc(idx->nblocks * sizeof(uint64_t) + 1);
+    idx->offset = (uint64_t*) alloc(idx->nblocks * sizeof(uint64_t) + 1);
+    for (uint64_t i = 0; i < idx->nblocks; ++i) {
+      HPCFMT_ThrowIfError(hpcfmt_int8_fread(&idx->time[i], fs));
+      HPCFMT_ThrowIfError(hpcfmt_int8_fread(&idx->offset[i], fs));
+    }
+    return HPCFMT_OK;
+  }
+
+  // no trailer: count the blocks, then record them
+  HPCFMT_ThrowIfError(trace_index_scan(idx, fs, size));
+  idx->time = (uint64_t*) alloc(idx->nblocks * sizeof(uint64_t) + 1);
+  idx->offset = (uint64_t*) alloc(idx->nblocks * sizeof(uint64_t) + 1);
+  return trace_index_scan(idx, fs, size);
+}
+
+
+int
+hpctrace_fmt_index_fwrite(hpctrace_fmt_index_t* idx, FILE* fs)
+{
+  for (uint64_t i = 0; i < idx->nblocks; ++i) {
+    HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(idx->time[i], fs));
+    HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(idx->offset[i], fs));
+  }
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(idx->nblocks, fs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(idx->nrecords, fs));
+  if (fwrite(HPCTRACE_FMT_IndexMagic, 1, HPCTRACE_FMT_IndexMagicLen, fs)
+      != HPCTRACE_FMT_IndexMagicLen) {
+    return HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+void
+hpctrace_fmt_index_free(hpctrace_fmt_index_t* idx, hpcfmt_free_fn dealloc)
+{
+  if (idx->time) {
+    dealloc(idx->time);
+  }
+  if (idx->offset) {
+    dealloc(idx->offset);
+  }
+  idx->time = NULL;
+  idx->offset = NULL;
+  idx->nblocks = 0;
+}
+
+
 //***************************************************************************
 // hpcprof-metricdb (located here for now)
 //***************************************************************************
@@ -1002,6 +1481,7 @@ hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs)
   if (nr != HPCMETRICDB_FMT_VersionLen) {
     return HPCFMT_ERR;
   }
+  strcpy(hdr->versionStr, version);
   hdr->version = atof(hdr->versionStr);
 
   nr = fread(&endian, 1, HPCMETRICDB_FMT_EndianLen, infs);
@@ -1024,7 +1504,7 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
   nw = fwrite(HPCMETRICDB_FMT_Magic,   1, HPCMETRICDB_FMT_MagicLen, outfs);
   if (nw != HPCTRACE_FMT_MagicLen) return HPCFMT_ERR;
 
-  nw = fwrite(HPCMETRICDB_FMT_Version, 1, HPCMETRICDB_FMT_VersionLen, outfs);
+  nw = fwrite(hdr->versionStr, 1, HPCMETRICDB_FMT_VersionLen, outfs);
   if (nw != HPCMETRICDB_FMT_VersionLen) return HPCFMT_ERR;
 
   nw = fwrite(HPCMETRICDB_FMT_Endian,  1, HPCMETRICDB_FMT_EndianLen, outfs);
@@ -1043,9 +1523,130 @@ hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
   fprintf(outfs, "%s\n", HPCMETRICDB_FMT_Magic);
   fprintf(outfs, "[hdr:...]\n");
 
+  fprintf(outfs, "(version:     %s)\n", hdr->versionStr);
   fprintf(outfs, "(num-nodes:   %u)\n", hdr->numNodes);
   fprintf(outfs, "(num-metrics: %u)\n", hdr->numMetrics);
 
   return HPCFMT_OK;
 }
 
+
+void
+hpcmetricDB_fmt_hdr_init(hpcmetricDB_fmt_hdr_t* hdr, int isSparse,
+			 uint32_t numNodes, uint32_t numMetrics)
+{
+  strcpy(hdr->versionStr, (isSparse) ? HPCMETRICDB_FMT_VersionSparse
+	                             : HPCMETRICDB_FMT_Version);
+  hdr->version = atof(hdr->versionStr);
+  hdr->endian = HPCMETRICDB_FMT_Endian[0];
+  hdr->numNodes = numNodes;
+  hdr->numMetrics = numMetrics;
+}
+
+
+//***************************************************************************
+// [hpcprof-metricdb] sparse body
+//***************************************************************************
+
+int
+hpcmetricDB_fmt_sparse_fread(hpcmetricDB_fmt_sparse_t* x, FILE* infs,
+			     hpcfmt_alloc_fn alloc)
+{
+  uint32_t reserved;
+
+  x->rowNodeId = NULL;
+  x->rowPtr    = NULL;
+  x->value     = NULL;
+  x->metricId  = NULL;
+
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->numRows, infs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&reserved, infs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fread(&x->numNZ, infs));
+
+  if (!alloc) {
+    return HPCFMT_ERR;
+  }
+
+  // N.B.: allocate at least one element so that a NULL return always
+  // indicates failure
+  size_t numRows = x->numRows, numNZ = x->numNZ;
+  x->rowNodeId = (uint32_t*) alloc((numRows + 1) * sizeof(uint32_t));
+  x->rowPtr    = (uint64_t*) alloc((numRows + 1) * sizeof(uint64_t));
+  x->value     = (double*)   alloc((numNZ + 1) * sizeof(double));
+  x->metricId  = (uint32_t*) alloc((numNZ + 1) * sizeof(uint32_t));
+  if (!x->rowNodeId || !x->rowPtr || !x->value || !x->metricId) {
+    return HPCFMT_ERR;
+  }
+
+  HPCFMT_ThrowIfError(hpcfmt_int4v_fread(x->rowNodeId, numRows, infs));
+  if (numRows % 2 != 0) {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&reserved, infs));
+  }
+  HPCFMT_ThrowIfError(hpcfmt_int8v_fread(x->rowPtr, numRows + 1, infs));
+  HPCFMT_ThrowIfError(hpcfmt_int8v_fread((uint64_t*)x->value, numNZ, infs));
+  HPCFMT_ThrowIfError(hpcfmt_int4v_fread(x->metricId, numNZ, infs));
+
+  if (x->rowPtr[0] != 0 || x->rowPtr[numRows] != x->numNZ) {
+    return HPCFMT_ERR;
+  }
+
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_sparse_fwrite(const hpcmetricDB_fmt_sparse_t* x,
+			      FILE* outfs)
+{
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(x->numRows, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(0, outfs)); // reserved
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(x->numNZ, outfs));
+
+  HPCFMT_ThrowIfError(hpcfmt_int4v_fwrite(x->rowNodeId, x->numRows, outfs));
+  if (x->numRows % 2 != 0) {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(0, outfs)); // pad
+  }
+  HPCFMT_ThrowIfError(hpcfmt_int8v_fwrite(x->rowPtr, x->numRows + 1, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int8v_fwrite((const uint64_t*)x->value,
+					  x->numNZ, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int4v_fwrite(x->metricId, x->numNZ, outfs));
+
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_sparse_fprint(const hpcmetricDB_fmt_sparse_t* x,
+			      FILE* outfs)
+{
+  fprintf(outfs, "(num-rows:    %u)\n", x->numRows);
+  fprintf(outfs, "(num-nz:      %"PRIu64")\n", x->numNZ);
+
+  for (uint32_t i = 0; i < x->numRows; ++i) {
+    fprintf(outfs, "(%6u: ", x->rowNodeId[i]);
+    for (uint64_t k = x->rowPtr[i]; k < x->rowPtr[i + 1]; ++k) {
+      fprintf(outfs, "[%u] %g ", x->metricId[k], x->value[k]);
+    }
+    fprintf(outfs, ")\n");
+  }
+
+  return HPCFMT_OK;
+}
+
+
+void
+hpcmetricDB_fmt_sparse_free(hpcmetricDB_fmt_sparse_t* x,
+			    hpcfmt_free_fn dealloc)
+{
+  if (dealloc) {
+    if (x->rowNodeId) { dealloc(x->rowNodeId); }
+    if (x->rowPtr)    { dealloc(x->rowPtr); }
+    if (x->value)     { dealloc(x->value); }
+    if (x->metricId)  { dealloc(x->metricId); }
+  }
+  x->rowNodeId = NULL;
+  x->rowPtr    = NULL;
+  x->value     = NULL;
+  x->metricId  = NULL;
+}
+
@@ -70,6 +70,7 @@
 
 #include <stdbool.h>
 #include <limits.h>
+#include <string.h>
 
 //*************************** User Include Files ****************************
 
@@ -594,6 +595,7 @@ hpcrun_fmt_lip_fprint(lush_lip_t* x, FILE* fs, const char* pre);
 
 static const char HPCTRACE_FMT_Magic[]   = "HPCRUN-trace______"; // 18 bytes
 static const char HPCTRACE_FMT_Version[] = "01.01";              // 5 bytes
+static const char HPCTRACE_FMT_VersionCompact[] = "02.00";       // 5 bytes
 static const char HPCTRACE_FMT_Endian[]  = "b";                  // 1 byte
 
 // Use of bit fields is not recommended as the order of fields 
@@ -609,6 +611,7 @@ typedef struct hpctrace_hdr_flags_bitfield {
 // Substitute bit fields with macros
 #define HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS 0U
 #define HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS 1U
+#define HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS      2U // cf. [hpctrace] blocks
 
 #define HPCTRACE_HDR_FLAGS_GET_BIT(flag, pos) \
   ((flag >> pos) & 1U)
@@ -726,6 +729,119 @@ hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 			  FILE* fs);
 
 
+//***************************************************************************
+// [hpctrace] compact blocks (version 02.00)
+//***************************************************************************
+
+// A trace whose header has HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS set (and
+// version HPCTRACE_FMT_VersionCompact) stores its records in blocks
+// that can be decoded independently:
+//
+//   block hdr: time of first record (8), number of records (4),
+//              payload length (4)
+//   payload:   per record, as LEB128 varints: zigzag time delta from
+//              the previous record in the block (0 for the first),
+//              cpId, [metricId if data-centric]
+//
+// A trace may end with a block index, which hpcprof writes:
+//
+//   per block: time of first record (8), file offset (8)
+//   number of blocks (8), number of records (8), HPCTRACE_FMT_IndexMagic
+//
+// Files from hpcrun have no index; readers then walk the block headers.
+
+#define HPCTRACE_FMT_BlockHdrLen     16
+#define HPCTRACE_FMT_BlockMaxRecords 256
+#define HPCTRACE_FMT_RecordMaxLen    (10 + 5 + 5)
+#define HPCTRACE_FMT_BlockMaxLen \
+  (HPCTRACE_FMT_BlockMaxRecords * HPCTRACE_FMT_RecordMaxLen)
+
+static const char HPCTRACE_FMT_IndexMagic[] = "HPCTIDX1"; // 8 bytes
+#define HPCTRACE_FMT_IndexMagicLen (sizeof(HPCTRACE_FMT_IndexMagic) - 1)
+#define HPCTRACE_FMT_IndexTrailerLen (8 + 8 + HPCTRACE_FMT_IndexMagicLen)
+
+
+// a block being encoded (writers)
+typedef struct hpctrace_fmt_block_t {
+  uint64_t time;     // time of the first record
+  uint64_t prevTime; // time of the last record
+  uint32_t nrecords;
+  uint32_t len;      // payload bytes
+  unsigned char buf[HPCTRACE_FMT_BlockHdrLen + HPCTRACE_FMT_BlockMaxLen];
+} hpctrace_fmt_block_t;
+
+
+void
+hpctrace_fmt_block_init(hpctrace_fmt_block_t* b);
+
+// Append a record, writing the block to 'outbuf' once it is full.
+int
+hpctrace_fmt_datum_block_outbuf(hpctrace_fmt_datum_t* x,
+				hpctrace_hdr_flags_t flags,
+				hpctrace_fmt_block_t* b, hpcio_outbuf_t* outbuf);
+
+// Write a partially filled block, if any.
+int
+hpctrace_fmt_block_outbuf(hpctrace_fmt_block_t* b, hpcio_outbuf_t* outbuf);
+
+// N.B.: not async safe.  Same as above, for a FILE; 'nwritten' (if
+// non-NULL) is incremented by the number of bytes written.
+int
+hpctrace_fmt_datum_block_fwrite(hpctrace_fmt_datum_t* x,
+				hpctrace_hdr_flags_t flags,
+				hpctrace_fmt_block_t* b, FILE* fs,
+				uint64_t* nwritten);
+
+int
+hpctrace_fmt_block_fwrite(hpctrace_fmt_block_t* b, FILE* fs,
+			  uint64_t* nwritten);
+
+
+// sequential reader for either trace format (readers)
+typedef struct hpctrace_fmt_reader_t {
+  FILE* fs;
+  hpctrace_hdr_flags_t flags;
+  uint64_t end;      // compact: offset of the end of the last block
+  uint64_t time;     // compact: time of the previous record
+  uint32_t nleft;    // compact: records left in the current block
+  uint32_t pos;
+  uint32_t len;
+  unsigned char buf[HPCTRACE_FMT_BlockMaxLen];
+} hpctrace_fmt_reader_t;
+
+
+// Prepare to read records from 'fs', positioned just after 'hdr'.
+int
+hpctrace_fmt_reader_init(hpctrace_fmt_reader_t* r, hpctrace_fmt_hdr_t* hdr,
+			 FILE* fs);
+
+// Returns: HPCFMT_OK, HPCFMT_EOF or HPCFMT_ERR.
+int
+hpctrace_fmt_reader_next(hpctrace_fmt_reader_t* r, hpctrace_fmt_datum_t* x);
+
+
+// block index of a compact trace
+typedef struct hpctrace_fmt_index_t {
+  uint64_t nblocks;
+  uint64_t nrecords;
+  uint64_t* time;   // time of first record, per block
+  uint64_t* offset; // file offset, per block
+} hpctrace_fmt_index_t;
+
+
+// Read the index of the compact trace 'fs', from its trailer if there
+// is one, else by walking the block headers.
+int
+hpctrace_fmt_index_fread(hpctrace_fmt_index_t* idx, FILE* fs,
+			 hpcfmt_alloc_fn alloc);
+
+int
+hpctrace_fmt_index_fwrite(hpctrace_fmt_index_t* idx, FILE* fs);
+
+void
+hpctrace_fmt_index_free(hpctrace_fmt_index_t* idx, hpcfmt_free_fn dealloc);
+
+
 //***************************************************************************
 // hpcprof-metricdb (located here for now)
 //***************************************************************************
@@ -738,6 +854,9 @@ static const char HPCMETRICDB_FMT_Magic[]   = "HPCPROF-metricdb__"; // 18 bytes
 static const char HPCMETRICDB_FMT_Version[] = "00.10";              // 5 bytes
 static const char HPCMETRICDB_FMT_Endian[]  = "b";                  // 1 byte
 
+// version of a sparse metric-db (see hpcmetricDB_fmt_sparse_t)
+static const char HPCMETRICDB_FMT_VersionSparse[] = "00.20";        // 5 bytes
+
 #define HPCMETRICDB_FMT_MagicLenX   (sizeof(HPCMETRICDB_FMT_Magic) - 1)
 #define HPCMETRICDB_FMT_VersionLenX (sizeof(HPCMETRICDB_FMT_Version) - 1)
 #define HPCMETRICDB_FMT_EndianLenX  (sizeof(HPCMETRICDB_FMT_Endian) - 1)
@@ -773,6 +892,70 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
 int
 hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
 
+// hpcmetricDB_fmt_hdr_init: initialize 'hdr' for a dense ('isSparse'
+// == 0) or sparse metric-db with the given dimensions
+void
+hpcmetricDB_fmt_hdr_init(hpcmetricDB_fmt_hdr_t* hdr, int isSparse,
+			 uint32_t numNodes, uint32_t numMetrics);
+
+static inline int
+hpcmetricDB_fmt_hdr_isSparse(const hpcmetricDB_fmt_hdr_t* hdr)
+{
+  return (strcmp(hdr->versionStr, HPCMETRICDB_FMT_VersionSparse) == 0);
+}
+
+
+//***************************************************************************
+// [hpcprof-metricdb] sparse body
+//***************************************************************************
+
+// A dense metric-db (version 00.10) follows the header with a
+// numNodes x numMetrics row-major matrix of real8 values, the first row
+// corresponding to node 1.
+//
+// A sparse metric-db (version 00.20) instead stores only non-zero
+// values, in compressed-sparse-row form.  All fields are big-endian;
+// since the header is 32 bytes and 'rowNodeId' is padded, every array
+// of 8-byte values starts 8-byte aligned:
+//
+//   numRows   (uint32)           nodes with at least one non-zero value
+//   reserved  (uint32)
+//   numNZ     (uint64)           non-zero (node, metric) values
+//   rowNodeId (uint32 x numRows)      node id of each row, increasing
+//   [uint32 pad, if numRows is odd]
+//   rowPtr    (uint64 x numRows + 1)  values of row i: [rowPtr[i], rowPtr[i+1])
+//   value     (real8  x numNZ)
+//   metricId  (uint32 x numNZ)        0-based metric column of each value
+
+typedef struct hpcmetricDB_fmt_sparse_t {
+
+  uint32_t  numRows;
+  uint64_t  numNZ;
+
+  uint32_t* rowNodeId;
+  uint64_t* rowPtr;
+  double*   value;
+  uint32_t* metricId;
+
+} hpcmetricDB_fmt_sparse_t;
+
+
+int
+hpcmetricDB_fmt_sparse_fread(hpcmetricDB_fmt_sparse_t* x, FILE* infs,
+			     hpcfmt_alloc_fn alloc);
+
+int
+hpcmetricDB_fmt_sparse_fwrite(const hpcmetricDB_fmt_sparse_t* x,
+			      FILE* outfs);
+
+int
+hpcmetricDB_fmt_sparse_fprint(const hpcmetricDB_fmt_sparse_t* x,
+			      FILE* outfs);
+
+void
+hpcmetricDB_fmt_sparse_free(hpcmetricDB_fmt_sparse_t* x,
+			    hpcfmt_free_fn dealloc);
+
 // --------------------------------------------------------------------------
 // additional sampling info
 // --------------------------------------------------------------------------
@@ -74,6 +74,8 @@ using std::vector;
 #include <set>
 using std::set;
 
+#include <unordered_map>
+
 #include <typeinfo>
 
 //*************************** User Include Files ****************************
@@ -200,14 +202,8 @@ Tree::merge(const Tree* y, uint x_newMetricBegIdx, uint mrgFlag, uint oFlag)
   // 
   // -------------------------------------------------------
 
-  if (!m_mergeCtxt) {
-    bool doTrackCPIds = !x->metadata()->traceFileNameSet().empty();
-    m_mergeCtxt = new MergeContext(x, doTrackCPIds);
-  }
-  m_mergeCtxt->flags(mrgFlag);
-  
   MergeEffectList* mrgEffects =
-    x_root->mergeDeep(y_root, x_newMetricBegIdx, *m_mergeCtxt, oFlag);
+    x_root->mergeDeep(y_root, x_newMetricBegIdx, x->mergeCtxt(mrgFlag), oFlag);
 
   DIAG_If(0 /*public diag level*/) {
     verifyUniqueCPIds();
@@ -217,6 +213,18 @@ Tree::merge(const Tree* y, uint x_newMetricBegIdx, uint mrgFlag, uint oFlag)
 }
 
 
+MergeContext&
+Tree::mergeCtxt(uint mrgFlag)
+{
+  if (!m_mergeCtxt) {
+    bool doTrackCPIds = !metadata()->traceFileNameSet().empty();
+    m_mergeCtxt = new MergeContext(this, doTrackCPIds);
+  }
+  m_mergeCtxt->flags(mrgFlag);
+  return *m_mergeCtxt;
+}
+
+
 void
 Tree::pruneCCTByNodeId(const uint8_t* prunedNodes)
 {
@@ -336,7 +344,7 @@ ANode::IntToANodeType(long i)
   return (ANodeTy)i;
 }
 
-uint ANode::s_nextUniqueId = 2;
+std::atomic<uint> ANode::s_nextUniqueId(2);
 
 
 //***************************************************************************
@@ -346,6 +354,187 @@ uint ANode::s_nextUniqueId = 2;
 string AProcNode::BOGUS;
 
 
+// ---------------------------------------------------------
+// DynChildIndex: a hash index over the direct ADynNode children of a
+// node, keyed by the fields for which ADynNode::isMergable() requires
+// equality (load module, load module ip, logical ip).  Other
+// conditions (leaf-ness, association class) are checked on the
+// candidates of a bucket.  Non-ADynNode children (static structure)
+// are only counted; while any exist, the index cannot answer queries.
+// ---------------------------------------------------------
+class ANode::DynChildIndex
+{
+public:
+  // fan-out below which a linear scan of the children is cheaper
+  static const uint MinChildren = 16;
+
+  DynChildIndex(ANode* x)
+    : m_numStatic(0)
+  {
+    m_map.reserve(x->childCount());
+    for (ANodeChildIterator it(x); it.Current(); ++it) {
+      insert(it.current());
+    }
+  }
+
+  bool
+  isComplete() const
+  { return (m_numStatic == 0); }
+
+  void
+  insert(ANode* x)
+  {
+    ADynNode* x_dyn = dynamic_cast<ADynNode*>(x);
+    if (x_dyn) {
+      m_map[Key(*x_dyn)].push_back(x_dyn);
+    }
+    else {
+      m_numStatic++;
+    }
+  }
+
+  void
+  erase(ANode* x)
+  {
+    ADynNode* x_dyn = dynamic_cast<ADynNode*>(x);
+    if (x_dyn) {
+      Map::iterator it = m_map.find(Key(*x_dyn));
+      DIAG_Assert(it != m_map.end(), "ANode::DynChildIndex::erase");
+      vector<ADynNode*>& bucket = it->second;
+      for (uint i = 0; i < bucket.size(); ++i) {
+	if (bucket[i] == x_dyn) {
+	  bucket.erase(bucket.begin() + i);
+	  break;
+	}
+      }
+      if (bucket.empty()) {
+	m_map.erase(it);
+      }
+    }
+    else {
+      m_numStatic--;
+    }
+  }
+
+  ADynNode*
+  find(const ADynNode& y_dyn, bool y_isLeaf) const
+  {
+    Map::const_iterator it = m_map.find(Key(y_dyn));
+    if (it != m_map.end()) {
+      const vector<ADynNode*>& bucket = it->second;
+      for (uint i = 0; i < bucket.size(); ++i) {
+	if (ADynNode::isMergable(*bucket[i], y_dyn, y_isLeaf)) {
+	  return bucket[i];
+	}
+      }
+    }
+    return NULL;
+  }
+
+private:
+  struct Key
+  {
+    Key(const ADynNode& x)
+      : lmId(x.lmId_real()), lmIP(x.lmIP_real()), hasLip(x.lip() != NULL)
+    {
+      lip[0] = (hasLip) ? x.lip()->data8[0] : 0;
+      lip[1] = (hasLip) ? x.lip()->data8[1] : 0;
+    }
+
+    bool
+    operator==(const Key& y) const
+    {
+      return (lmId == y.lmId && lmIP == y.lmIP && hasLip == y.hasLip
+	      && lip[0] == y.lip[0] && lip[1] == y.lip[1]);
+    }
+
+    LoadMap::LMId_t lmId;
+    VMA lmIP;
+    bool hasLip;
+    uint64_t lip[LUSH_LIP_DATA8_SZ];
+  };
+
+  struct KeyHash
+  {
+    size_t
+    operator()(const Key& x) const
+    {
+      uint64_t h = x.lmIP * 0x9e3779b97f4a7c15ULL;
+      h ^= ((uint64_t)x.lmId << 32) + (h >> 29);
+      h ^= x.lip[0] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      h ^= x.lip[1] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      return (size_t)h;
+    }
+  };
+
+  typedef std::unordered_map<Key, vector<ADynNode*>, KeyHash> Map;
+
+  Map  m_map;
+  uint m_numStatic;
+};
+
+
+ANode::~ANode()
+{
+  delete m_dynChildIdx;
+}
+
+
+void
+ANode::invalidateDynChildIndex()
+{
+  delete m_dynChildIdx;
+  m_dynChildIdx = NULL;
+}
+
+
+//***************************************************************************
+// ANode, etc: Tree Modification
+//***************************************************************************
+
+void
+ANode::link(ANode* parent)
+{
+  NonUniformDegreeTreeNode::link(parent);
+  if (parent && parent->m_dynChildIdx) {
+    parent->m_dynChildIdx->insert(this);
+  }
+}
+
+
+void
+ANode::linkBefore(ANode* sibling)
+{
+  NonUniformDegreeTreeNode::linkBefore(sibling);
+  ANode* p = parent();
+  if (p && p->m_dynChildIdx) {
+    p->m_dynChildIdx->insert(this);
+  }
+}
+
+
+void
+ANode::linkAfter(ANode* sibling)
+{
+  NonUniformDegreeTreeNode::linkAfter(sibling);
+  ANode* p = parent();
+  if (p && p->m_dynChildIdx) {
+    p->m_dynChildIdx->insert(this);
+  }
+}
+
+
+void
+ANode::unlink()
+{
+  ANode* p = parent();
+  if (p && p->m_dynChildIdx) {
+    p->m_dynChildIdx->erase(this);
+  }
+  NonUniformDegreeTreeNode::unlink();
+}
+
+
 //***************************************************************************
 // ANode, etc: Tree Navigation 
 //***************************************************************************
@@ -603,10 +792,51 @@ ANode::computeMetrics(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
   
   // N.B. pre-order walk assumes point-wise metrics
   // Cf. Analysis::Flat::Driver::computeDerivedBatch().
+  //
+  // Since metrics are point-wise, each metric may be computed over all
+  // nodes before moving on to the next one.  This lets an expression be
+  // compiled once and evaluated a batch of nodes at a time; expressions
+  // that cannot be compiled use the tree-walking evaluator.
 
+  std::vector<Metric::IData*> nodes;
   for (ANodeIterator it(this); it.Current(); ++it) {
-    ANode* n = it.current();
-    n->computeMetricsMe(mMgr, mBegId, mEndId, doFinal);
+    nodes.push_back(it.current());
+  }
+
+  uint numMetrics = mMgr.size();
+  std::vector<double> scratch;
+
+  for (uint mId = mBegId; mId < mEndId; ++mId) {
+    const Metric::ADesc* m = mMgr.metric(mId);
+    const Metric::DerivedDesc* mm = dynamic_cast<const Metric::DerivedDesc*>(m);
+    if ( !(mm && mm->expr()) ) {
+      continue;
+    }
+    const Metric::AExpr* expr = mm->expr();
+
+    Metric::AExprProg progNF, prog;
+    bool isCompiled = expr->compileNF(progNF);
+    if (isCompiled && doFinal) {
+      isCompiled = expr->compile(prog);
+      prog.emit(Metric::AExprProg::OpStore, mId, numMetrics/*size*/);
+    }
+
+    if (isCompiled) {
+      const size_t batchSz = Metric::AExprProg::BatchSz;
+      for (size_t i = 0; i < nodes.size(); i += batchSz) {
+	uint n = (uint)std::min(batchSz, nodes.size() - i);
+	progNF.evalBatch(&nodes[i], n, scratch);
+	if (doFinal) {
+	  prog.evalBatch(&nodes[i], n, scratch);
+	}
+      }
+    }
+    else {
+      for (size_t i = 0; i < nodes.size(); ++i) {
+	static_cast<ANode*>(nodes[i])->computeMetricsMe(mMgr, mId, mId + 1,
+							 doFinal);
+      }
+    }
   }
 }
 
@@ -986,19 +1216,39 @@ ADynNode::mergeMe(const ANode& y, MergeContext* mrgCtxt, uint metricBegIdx, bool
 ADynNode*
 ANode::findDynChild(const ADynNode& y_dyn)
 {
+  return findDynChild(y_dyn, y_dyn.isLeaf());
+}
+
+
+ADynNode*
+ANode::findDynChild(const ADynNode& y_dyn, bool y_isLeaf)
+{
+  // Fast path: consult the child index.  The index can answer neither
+  // the structure-based merge condition of ADynNode::isMergable() nor
+  // queries that must look through static structure children; both
+  // fall back to the scan below.
+  if (!y_dyn.structure() && childCount() >= DynChildIndex::MinChildren) {
+    if (!m_dynChildIdx) {
+      m_dynChildIdx = new DynChildIndex(this);
+    }
+    if (m_dynChildIdx->isComplete()) {
+      return m_dynChildIdx->find(y_dyn, y_isLeaf);
+    }
+  }
+
   for (ANodeChildIterator it(this); it.Current(); ++it) {
     ANode* x = it.current();
 
     ADynNode* x_dyn = dynamic_cast<ADynNode*>(x);
     if (x_dyn) {
       // Base case: an ADynNode descendent
-      if (ADynNode::isMergable(*x_dyn, y_dyn)) {
+      if (ADynNode::isMergable(*x_dyn, y_dyn, y_isLeaf)) {
 	return x_dyn;
       }
     }
     else {
       // Inductive case: some other type; find the first ADynNode descendents.
-      ADynNode* x_dyn_descendent = x->findDynChild(y_dyn);
+      ADynNode* x_dyn_descendent = x->findDynChild(y_dyn, y_isLeaf);
       if (x_dyn_descendent) {
 	return x_dyn_descendent;
       }
@@ -64,6 +64,7 @@
 
 #include <iostream>
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <list>
@@ -178,6 +179,12 @@ public:
   merge(const Tree* y, uint x_newMetricBegIdx,
 	uint mrgFlag = 0, uint oFlag = 0);
 
+  // mergeCtxt: the context for merges into 'this' (created on first
+  //   use), with its flags set to 'mrgFlag'.  Used by callers that
+  //   merge nodes one at a time rather than via merge().
+  MergeContext&
+  mergeCtxt(uint mrgFlag);
+
   // -------------------------------------------------------
   // dense ids (only used when explicitly requested)
   // -------------------------------------------------------
@@ -320,31 +327,36 @@ public:
   ANode(ANodeTy type, ANode* parent, Struct::ACodeNode* strct = NULL)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
+      m_type(type), m_id(nextUniqueId()), m_strct(strct),
+      m_dynChildIdx(NULL)
   {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
+    if (parent) {
+      parent->invalidateDynChildIndex();
+    }
   }
 
   ANode(ANodeTy type,
 	ANode* parent, Struct::ACodeNode* strct, const Metric::IData& metrics)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(metrics),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
+      m_type(type), m_id(nextUniqueId()), m_strct(strct),
+      m_dynChildIdx(NULL)
   {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
+    if (parent) {
+      parent->invalidateDynChildIndex();
+    }
   }
 
-  virtual ~ANode()
-  { }
+  virtual ~ANode();
   
   // deep copy of internals (but without children)
   ANode(const ANode& x)
     : NonUniformDegreeTreeNode(NULL),
       Metric::IData(x),
-      m_type(x.m_type), m_id(s_nextUniqueId), m_strct(x.m_strct)
+      m_type(x.m_type), m_id(nextUniqueId()), m_strct(x.m_strct),
+      m_dynChildIdx(NULL)
   {
     zeroLinks();
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
   }
 
   // deep copy of internals (but without children)
@@ -355,8 +367,7 @@ public:
       //NonUniformDegreeTreeNode::operator=(x);
       Metric::IData::operator=(x);
       m_type = x.m_type;
-      m_id = s_nextUniqueId;
-      s_nextUniqueId += 2;
+      m_id = nextUniqueId();
       // m_id: skip
       m_strct = x.m_strct;
     }
@@ -454,6 +465,24 @@ public:
   }
 
 
+  // --------------------------------------------------------
+  // Tree modification
+  //   N.B.: These shadow the NonUniformDegreeTreeNode versions so
+  //   that a parent's child index (cf. findDynChild()) stays current.
+  // --------------------------------------------------------
+  void
+  link(ANode* parent);
+
+  void
+  linkBefore(ANode* sibling);
+
+  void
+  linkAfter(ANode* sibling);
+
+  void
+  unlink();
+
+
   // --------------------------------------------------------
   // ancestor: find first ANode in path from this to root with given type
   // (Note: We assume that a node *can* be an ancestor of itself.)
@@ -606,9 +635,25 @@ public:
   // If the CCT does not have structure information, we only need to
   //   inspect the children of z.  Otherwise, it is necessary to find
   //   the collection of z's direct ADynNode descendents.
+  //
+  // Once 'this' has more than a few children, the lookup is answered
+  //   by a lazily built hash index of the direct ADynNode children,
+  //   which keeps mergeDeep() linear for wide nodes.
+  //
+  // The second form takes y_dyn's leaf status explicitly, for probing
+  //   with a node that is not (yet) linked to its children.
   CCT::ADynNode*
   findDynChild(const ADynNode& y_dyn);
 
+  CCT::ADynNode*
+  findDynChild(const ADynNode& y_dyn, bool y_isLeaf);
+
+  // invalidateDynChildIndex: discard the child index used by
+  //   findDynChild(); it is rebuilt on demand.  Must be called
+  //   whenever a child's merge key (load module, ip, lip) changes.
+  void
+  invalidateDynChildIndex();
+
 
   // --------------------------------------------------------
   // 
@@ -678,13 +723,33 @@ protected:
   mergeDeep_fixInsert(int newMetrics, MergeContext& mrgCtxt);
 
 
+  void
+  invalidateParentDynChildIndex()
+  {
+    ANode* p = parent();
+    if (p) {
+      p->invalidateDynChildIndex();
+    }
+  }
+
+
 private:
-  static uint s_nextUniqueId;
+  // N.B.: profiles may be read concurrently (cf. Analysis::CallPath::read)
+  static uint
+  nextUniqueId()
+  { return s_nextUniqueId.fetch_add(2); } // cf. HPCRUN_FMT_RetainIdFlag
+
+  static std::atomic<uint> s_nextUniqueId;
+
+  class DynChildIndex;
   
 protected:
   ANodeTy m_type; // obsolete with typeid(), but hard to replace
   uint m_id;
   Struct::ACodeNode* m_strct;
+
+private:
+  DynChildIndex* m_dynChildIdx; // lazily built; cf. findDynChild()
 };
 
 
@@ -822,13 +887,17 @@ public:
   void
   lmId(LoadMap::LMId_t x)
   {
+    invalidateParentDynChildIndex();
     if (isValid_lip()) { lush_lip_setLMId(m_lip, (uint16_t)x); return; }
     m_lmId = x;
   }
 
   void
   lmId_real(LoadMap::LMId_t x)
-  { m_lmId = x; }
+  {
+    invalidateParentDynChildIndex();
+    m_lmId = x;
+  }
 
   virtual VMA
   lmIP() const
@@ -846,6 +915,7 @@ public:
   void
   lmIP(VMA lmIP, ushort opIdx)
   {
+    invalidateParentDynChildIndex();
     if (isValid_lip()) {
       lush_lip_setLMIP(m_lip, lmIP);
       m_opIdx = 0;
@@ -870,7 +940,10 @@ public:
   
   void
   lip(const lush_lip_t* lip)
-  { m_lip = const_cast<lush_lip_t*>(lip); }
+  {
+    invalidateParentDynChildIndex();
+    m_lip = const_cast<lush_lip_t*>(lip);
+  }
 
   static lush_lip_t*
   clone_lip(const lush_lip_t* x)
@@ -919,8 +992,13 @@ public:
 
   static bool
   isMergable(const ADynNode& x, const ADynNode& y)
+  { return isMergable(x, y, y.isLeaf()); }
+
+  // isMergable: as above, but with y's leaf status given by 'y_isLeaf'
+  static bool
+  isMergable(const ADynNode& x, const ADynNode& y, bool y_isLeaf)
   {
-    if (x.isLeaf() == y.isLeaf()
+    if (x.isLeaf() == y_isLeaf
 	&& x.lmId_real() == y.lmId_real()) {
 
       // 1. additional tests for standard merge condition (N.B.: order
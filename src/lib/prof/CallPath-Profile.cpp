@@ -71,10 +71,13 @@ using std::dec;
 using std::string;
 
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <algorithm>
 #include <sstream>
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring> // strcmp
 #include <cmath> // abs
 
@@ -190,7 +193,53 @@ Profile::~Profile()
 
 
 uint
-Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
+Profile::merge(Profile& y, int mergeTy, uint mrgFlag,
+	       CCT::MergeEffectList* mrgEffects)
+{
+  Profile& x = (*this);
+
+  // -------------------------------------------------------
+  // merge name, flags, metrics and LoadMaps
+  //
+  // Post-INVARIANT: y's cct refers to x's LoadMap
+  // -------------------------------------------------------
+  uint x_newMetricBegIdx = 0;
+  std::vector<LoadMap::MergeEffect>* mrgEffects1 = NULL;
+  uint firstMergedMetric = merge_meta(y, mergeTy, x_newMetricBegIdx,
+				      mrgEffects1);
+  y.merge_fixCCT(mrgEffects1);
+  delete mrgEffects1;
+
+  // -------------------------------------------------------
+  // merge CCTs
+  // -------------------------------------------------------
+
+  if (mrgFlag & CCT::MrgFlg_NormalizeTraceFileY) {
+    mrgFlag |= CCT::MrgFlg_PropagateEffects;
+  }
+
+  CCT::MergeEffectList* mrgEffects2 =
+    x.cct()->merge(y.cct(), x_newMetricBegIdx, mrgFlag);
+
+  DIAG_Assert(Logic::implies(mrgEffects2 && !mrgEffects2->empty(),
+			     mrgFlag & CCT::MrgFlg_NormalizeTraceFileY),
+	      "CallPath::Profile::merge: there should only be CCT::MergeEffects when MrgFlg_NormalizeTraceFileY is passed");
+
+  if (mrgEffects && mrgEffects2) {
+    mrgEffects->splice(mrgEffects->end(), *mrgEffects2);
+  }
+  else {
+    y.merge_fixTrace(mrgEffects2);
+  }
+  delete mrgEffects2;
+
+  return firstMergedMetric;
+}
+
+
+uint
+Profile::merge_meta(Profile& y, int mergeTy, uint& x_newMetricBegIdx,
+		    std::vector<LoadMap::MergeEffect>*& lmEffects)
 {
   Profile& x = (*this);
 
@@ -244,36 +293,13 @@ Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
   // -------------------------------------------------------
   // merge metrics
   // -------------------------------------------------------
-  uint x_newMetricBegIdx = 0;
+  x_newMetricBegIdx = 0;
   uint firstMergedMetric = mergeMetrics(y, mergeTy, x_newMetricBegIdx);
   
   // -------------------------------------------------------
   // merge LoadMaps
-  //
-  // Post-INVARIANT: y's cct refers to x's LoadMap
-  // -------------------------------------------------------
-  std::vector<LoadMap::MergeEffect>* mrgEffects1 =
-    x.m_loadmap->merge(*y.loadmap());
-  y.merge_fixCCT(mrgEffects1);
-  delete mrgEffects1;
-
-  // -------------------------------------------------------
-  // merge CCTs
   // -------------------------------------------------------
-
-  if (mrgFlag & CCT::MrgFlg_NormalizeTraceFileY) {
-    mrgFlag |= CCT::MrgFlg_PropagateEffects;
-  }
-
-  CCT::MergeEffectList* mrgEffects2 =
-    x.cct()->merge(y.cct(), x_newMetricBegIdx, mrgFlag);
-
-  DIAG_Assert(Logic::implies(mrgEffects2 && !mrgEffects2->empty(),
-			     mrgFlag & CCT::MrgFlg_NormalizeTraceFileY),
-	      "CallPath::Profile::merge: there should only be CCT::MergeEffects when MrgFlg_NormalizeTraceFileY is passed");
-
-  y.merge_fixTrace(mrgEffects2);
-  delete mrgEffects2;
+  lmEffects = x.m_loadmap->merge(*y.loadmap());
 
   return firstMergedMetric;
 }
@@ -383,8 +409,6 @@ Profile::merge_fixCCT(const std::vector<LoadMap::MergeEffect>* mrgEffects)
 void
 Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
 {
-  typedef std::map<uint, uint> UIntToUIntMap;
-
   // early exit for trivial case
   if (m_traceFileName.empty()) {
     return;
@@ -397,26 +421,35 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
   // Profile::merge(), but the list of effects is more general and
   // extensible.  There are no asymptotic problems with building the
   // following map for local use.
-  UIntToUIntMap cpIdMap;
+  CPIdMap cpIdMap;
   for (CCT::MergeEffectList::const_iterator it = mrgEffects->begin();
        it != mrgEffects->end(); ++it) {
     const CCT::MergeEffect& effct = *it;
     cpIdMap.insert(std::make_pair(effct.old_cpId, effct.new_cpId));
   }
 
+  std::vector<const CPIdMap*> cpIdMaps(1, &cpIdMap);
+  rewriteTrace(m_traceFileName, cpIdMaps);
+}
+
+
+void
+Profile::rewriteTrace(const std::string& traceFnm,
+		      const std::vector<const CPIdMap*>& cpIdMaps)
+{
   // ------------------------------------------------------------
   // Rewrite trace file
   // ------------------------------------------------------------
   int ret;
 
-  DIAG_MsgIf(0, "Profile::merge_fixTrace: " << m_traceFileName);
+  DIAG_MsgIf(0, "Profile::rewriteTrace: " << traceFnm);
 
-  string traceFileNameTmp = m_traceFileName + "." + HPCPROF_TmpFnmSfx;
+  string traceFileNameTmp = traceFnm + "." + HPCPROF_TmpFnmSfx;
 
   char* infsBuf = new char[HPCIO_RWBufferSz];
   char* outfsBuf = new char[HPCIO_RWBufferSz];
 
-  const string& inFnm = m_traceFileName;
+  const string& inFnm = traceFnm;
   FILE* infs = hpcio_fopen_r(inFnm.c_str());
   if (!infs) {
     std::string errorString;
@@ -426,7 +459,7 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
   }
 
   ret = setvbuf(infs, infsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, inFnm << ": Profile::merge_fixTrace: setvbuf!");
+  DIAG_AssertWarn(ret == 0, inFnm << ": Profile::rewriteTrace: setvbuf!");
 
   hpctrace_fmt_hdr_t hdr;
   ret = hpctrace_fmt_hdr_fread(&hdr, infs);
@@ -457,15 +490,35 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
   }
 
   ret = setvbuf(outfs, outfsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, outFnm << ": Profile::merge_fixTrace: setvbuf!");
+  DIAG_AssertWarn(ret == 0, outFnm << ": Profile::rewriteTrace: setvbuf!");
+
+  // compact traces stay compact and gain a block index
+  bool isCompact =
+    HPCTRACE_HDR_FLAGS_GET_BIT(hdr.flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS);
+  hpctrace_fmt_reader_t* reader = new hpctrace_fmt_reader_t;
+  hpctrace_fmt_block_t* block = new hpctrace_fmt_block_t;
+  std::vector<uint64_t> blockTime, blockOffset;
+  uint64_t outOffset = HPCTRACE_FMT_HeaderLen, numRecords = 0;
+  hpctrace_fmt_block_init(block);
+
+  ret = hpctrace_fmt_reader_init(reader, &hdr, infs);
+  if (ret == HPCFMT_ERR) {
+    DIAG_EMsg("failed reading trace measurement file " << inFnm << "; skip this one.");
+    hpcio_fclose(infs);
+    hpcio_fclose(outfs);
+    unlink(outFnm.c_str());
+    delete reader;
+    delete block;
+    return;
+  }
 
   ret = hpctrace_fmt_hdr_fwrite(hdr.flags, outfs);
   if (ret == HPCFMT_ERR) goto badwrite;
 
-  while ( !feof(infs) ) {
+  while ( !feof(infs) || reader->nleft > 0 ) {
     // 1. Read trace record (exit on EOF)
     hpctrace_fmt_datum_t datum;
-    ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, infs);
+    ret = hpctrace_fmt_reader_next(reader, &datum);
     if (ret == HPCFMT_EOF) {
       break;
     } else if (ret == HPCFMT_ERR) {
@@ -473,21 +526,49 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
       hpcio_fclose(infs);
       hpcio_fclose(outfs);
       unlink(outFnm.c_str()); // delete incomplete output file
+      delete reader;
+      delete block;
       return;
     }
     
     // 2. Translate cct id
     uint cctId_old = datum.cpId;
     uint cctId_new = datum.cpId;
-    UIntToUIntMap::iterator it = cpIdMap.find(cctId_old);
-    if (it != cpIdMap.end()) {
-      cctId_new = it->second;
-      DIAG_MsgIf(0, "  " << cctId_old << " -> " << cctId_new);
+    for (uint i = 0; i < cpIdMaps.size(); ++i) {
+      CPIdMap::const_iterator it = cpIdMaps[i]->find(cctId_new);
+      if (it != cpIdMaps[i]->end()) {
+	cctId_new = it->second;
+      }
     }
+    DIAG_MsgIf(0, "  " << cctId_old << " -> " << cctId_new);
     datum.cpId = cctId_new;
 
     // 3. Write new trace record
-    ret = hpctrace_fmt_datum_fwrite(&datum, hdr.flags, outfs);
+    if (isCompact) {
+      if (block->nrecords == 0) {
+	blockTime.push_back(datum.comp);
+	blockOffset.push_back(outOffset);
+      }
+      numRecords++;
+      ret = hpctrace_fmt_datum_block_fwrite(&datum, hdr.flags, block, outfs,
+					    &outOffset);
+    }
+    else {
+      ret = hpctrace_fmt_datum_fwrite(&datum, hdr.flags, outfs);
+    }
+    if (ret == HPCFMT_ERR) goto badwrite;
+  }
+
+  if (isCompact) {
+    ret = hpctrace_fmt_block_fwrite(block, outfs, &outOffset);
+    if (ret == HPCFMT_ERR) goto badwrite;
+
+    hpctrace_fmt_index_t idx;
+    idx.nblocks = blockTime.size();
+    idx.nrecords = numRecords;
+    idx.time = blockTime.data();
+    idx.offset = blockOffset.data();
+    ret = hpctrace_fmt_index_fwrite(&idx, outfs);
     if (ret == HPCFMT_ERR) goto badwrite;
   }
 
@@ -496,6 +577,8 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
 
   delete[] infsBuf;
   delete[] outfsBuf;
+  delete reader;
+  delete block;
   return;
 
 badwrite:
@@ -1762,6 +1845,10 @@ Profile::fmt_cct_fwrite(const Profile& prof, FILE* fs, uint wFlags)
   // N.B.: This may not generate preorder ids because it is necessary
   // to retain certain trace ids.
   uint64_t numNodes = 0;
+  if (wFlags & WFlg_NoCCT) {
+    return hpcfmt_int8_fwrite(numNodes, fs);
+  }
+
   uint nodeId_next = 2; // cf. s_nextUniqueId
   for (CCT::ANodeIterator it(prof.cct()->root()); it.Current(); ++it) {
     CCT::ANode* n = it.current();
@@ -1810,6 +1897,491 @@ Profile::fmt_cct_fwrite(const Profile& prof, FILE* fs, uint wFlags)
 }
 
 
+//***************************************************************************
+// Binary exchange form (cf. bin_pack())
+//***************************************************************************
+
+namespace {
+
+// Layout of a bin_pack() buffer.  Every section starts 8-byte aligned.
+//
+//   BinHdr
+//   meta data: hpcrun-fmt hdr and epoch with an empty CCT  [padded]
+//   BinNode[numNodes]: the CCT in preorder; node 0 is the CCT::Root
+//   double[numMetrics][numNodes]: one column of values per metric
+
+const uint64_t BinMagic = 0x31304e4942435048ULL; // "HPCBIN01"
+
+struct BinHdr {
+  uint64_t magic;
+  uint64_t metaSz;     // unpadded size of meta data
+  uint64_t numNodes;
+  uint64_t numMetrics; // number of metric columns
+};
+
+enum {
+  BinNode_Leaf = (1 << 0) // node had no children
+};
+
+struct BinNode {
+  uint64_t lmIP;
+  uint64_t lip[LUSH_LIP_DATA8_SZ];
+  uint32_t parent; // index of parent node (ignored for node 0)
+  uint32_t cpId;
+  uint32_t asInfo;
+  uint16_t lmId;
+  uint16_t flags;
+};
+
+
+inline size_t
+bin_align(size_t sz)
+{
+  return (sz + 7) & ~((size_t)7);
+}
+
+
+// BinView: typed views of the sections of a bin_pack() buffer
+struct BinView {
+  BinView(const uint8_t* buffer, size_t bufferSz)
+  {
+    DIAG_Assert(bufferSz >= sizeof(BinHdr)
+		&& ((uintptr_t)buffer % sizeof(uint64_t)) == 0,
+		"Profile::bin_unpack: bad buffer");
+    hdr = (const BinHdr*)buffer;
+    DIAG_Assert(hdr->magic == BinMagic, "Profile::bin_unpack: bad magic");
+
+    meta = buffer + sizeof(BinHdr);
+    nodes = (const BinNode*)(meta + bin_align(hdr->metaSz));
+    metrics = (const double*)(nodes + hdr->numNodes);
+
+    size_t sz = (sizeof(BinHdr) + bin_align(hdr->metaSz)
+		 + hdr->numNodes * sizeof(BinNode)
+		 + hdr->numNodes * hdr->numMetrics * sizeof(double));
+    DIAG_Assert(sz == bufferSz && hdr->numNodes > 0,
+		"Profile::bin_unpack: truncated buffer");
+  }
+
+  double
+  metric(uint64_t nodeIdx, uint64_t mId) const
+  { return metrics[mId * hdr->numNodes + nodeIdx]; }
+
+  const BinHdr*  hdr;
+  const uint8_t* meta;
+  const BinNode* nodes;
+  const double*  metrics;
+};
+
+
+// bin_noteLMs: mark the load modules used by 'bin' within 'prof' (cf.
+//   cct_makeNode()) and return a map from bin's load module ids to
+//   'prof' ids after applying 'lmEffects'.  Invalid ids map to NULL.
+std::vector<Prof::LoadMap::LMId_t>
+bin_noteLMs(Prof::CallPath::Profile& prof, const BinView& bin)
+{
+  using namespace Prof;
+
+  LoadMap& loadmap = *(prof.loadmap());
+
+  std::vector<LoadMap::LMId_t> lmMap(loadmap.size() + 1);
+  for (LoadMap::LMId_t i = 0; i < lmMap.size(); ++i) {
+    lmMap[i] = i;
+  }
+
+  for (uint64_t i = 1; i < bin.hdr->numNodes; ++i) {
+    const BinNode& n = bin.nodes[i];
+    if (n.lmId < lmMap.size()) {
+      loadmap.lm(n.lmId)->isUsed(true);
+    }
+    lush_lip_t lip;
+    memcpy(lip.data8, n.lip, sizeof(lip.data8));
+    LoadMap::LMId_t lip_lmId = lush_lip_getLMId(&lip);
+    if (lip_lmId < lmMap.size()) {
+      loadmap.lm(lip_lmId)->isUsed(true);
+    }
+  }
+
+  return lmMap;
+}
+
+
+void
+bin_fixLMs(std::vector<Prof::LoadMap::LMId_t>& lmMap,
+	   const std::vector<Prof::LoadMap::MergeEffect>* lmEffects)
+{
+  if (lmEffects) {
+    for (uint i = 0; i < lmEffects->size(); ++i) {
+      const Prof::LoadMap::MergeEffect& chg = (*lmEffects)[i];
+      lmMap[chg.old_id] = chg.new_id;
+    }
+  }
+}
+
+
+// bin_makeNode: the binary analogue of cct_makeNode(); load module
+//   ids are translated through 'lmMap'.
+std::pair<Prof::CCT::ADynNode*, Prof::CCT::ADynNode*>
+bin_makeNode(const BinView& bin, uint64_t nodeIdx,
+	     const std::vector<Prof::LoadMap::LMId_t>& lmMap)
+{
+  using namespace Prof;
+
+  const BinNode& n_bin = bin.nodes[nodeIdx];
+
+  bool isLeaf = (n_bin.flags & BinNode_Leaf);
+  uint cpId = n_bin.cpId;
+
+  lush_assoc_info_t as_info;
+  as_info.bits = n_bin.asInfo;
+
+  LoadMap::LMId_t lmId = LoadMap::LMId_NULL;
+  if (n_bin.lmId < lmMap.size()) {
+    lmId = lmMap[n_bin.lmId];
+  }
+  else {
+    DIAG_WMsg(1, "Profile::bin_unpack: CCT node " << nodeIdx
+	      << " has invalid load module: " << n_bin.lmId);
+  }
+
+  VMA lmIP = (VMA)n_bin.lmIP;
+  ushort opIdx = 0;
+
+  lush_lip_t* lip = NULL;
+  lush_lip_t lip_bin;
+  memcpy(lip_bin.data8, n_bin.lip, sizeof(lip_bin.data8));
+  if (!lush_lip_eq(&lip_bin, &lush_lip_NULL)) {
+    lip = CCT::ADynNode::clone_lip(&lip_bin);
+
+    LoadMap::LMId_t lip_lmId = lush_lip_getLMId(lip);
+    lip_lmId = (lip_lmId < lmMap.size()) ? lmMap[lip_lmId] : LoadMap::LMId_NULL;
+    lush_lip_setLMId(lip, (uint16_t) lip_lmId);
+  }
+
+  uint numMetrics = bin.hdr->numMetrics;
+  bool hasMetrics = false;
+
+  Metric::IData metricData(numMetrics);
+  for (uint mId = 0; mId < numMetrics; ++mId) {
+    double mval = bin.metric(nodeIdx, mId);
+    metricData.metric(mId) = mval;
+    if (mval != 0.0) {
+      hasMetrics = true;
+    }
+  }
+
+  // Split an interior node with metrics into an interior node and a
+  // leaf sibling, exactly as cct_makeNode() does.
+  CCT::ADynNode* n = NULL;
+  CCT::ADynNode* n_leaf = NULL;
+
+  if (hasMetrics || isLeaf) {
+    n = new CCT::Stmt(NULL, cpId, as_info, lmId, lmIP, opIdx, lip,
+		      metricData);
+  }
+
+  if (!isLeaf) {
+    if (hasMetrics) {
+      n_leaf = n;
+
+      Metric::IData metricData0(numMetrics);
+      lush_lip_t* lipCopy = CCT::ADynNode::clone_lip(lip);
+
+      n = new CCT::Call(NULL, HPCRUN_FMT_CCTNodeId_NULL, as_info, lmId, lmIP,
+			opIdx, lipCopy, metricData0);
+    }
+    else {
+      n = new CCT::Call(NULL, cpId, as_info, lmId, lmIP, opIdx, lip,
+			metricData);
+    }
+  }
+
+  return std::make_pair(n, n_leaf);
+}
+
+
+// bin_mergeNode: merge 'y' (unlinked; with leaf status 'y_isLeaf')
+//   into the children of 'x_parent', following ANode::mergeDeep().
+//   Returns the node of x that now represents 'y' (possibly 'y'
+//   itself) or NULL if 'y' was dropped.  'y' is consumed.  If
+//   'x_parentIsNew', 'x_parent' was itself inserted from y and no
+//   lookup is needed.  A NULL 'mrgCtxt' means 'x' is being built from
+//   scratch.
+Prof::CCT::ANode*
+bin_mergeNode(Prof::CCT::ADynNode* y, bool y_isLeaf,
+	      Prof::CCT::ANode* x_parent, bool x_parentIsNew,
+	      uint x_newMetricBegIdx, Prof::CCT::MergeContext* mrgCtxt,
+	      Prof::CCT::MergeEffectList& effctLst)
+{
+  using namespace Prof;
+
+  CCT::ADynNode* x = NULL;
+  if (!x_parentIsNew) {
+    x = x_parent->findDynChild(*y, y_isLeaf);
+  }
+
+  if (!x) {
+    // case 1: insert node (cf. ANode::mergeDeep_fixInsert())
+    if (mrgCtxt) {
+      if (mrgCtxt->flags() & (CCT::MrgFlg_CCTMergeOnly
+			      | CCT::MrgFlg_AssertCCTMergeOnly)) {
+	delete y;
+	return NULL;
+      }
+
+      CCT::MergeContext::pair ret = mrgCtxt->ensureUniqueCPId(y->cpId());
+      y->cpId(ret.cpId);
+      if (!ret.effect.isNoop()) {
+	effctLst.push_back(ret.effect);
+      }
+      y->insertMetricsBefore(x_newMetricBegIdx);
+    }
+    y->link(x_parent);
+    return y;
+  }
+  else {
+    // case 2: merge nodes
+    CCT::MergeEffect effct = x->mergeMe(*y, mrgCtxt, x_newMetricBegIdx);
+    if (mrgCtxt->doPropagateEffects() && !effct.isNoop()) {
+      effctLst.push_back(effct);
+    }
+    delete y;
+    return x;
+  }
+}
+
+
+// bin_mergeCCT: merge the CCT in 'bin' into 'x_cct' node by node
+//   (cf. CCT::Tree::merge()).  Returns the merge effects.
+Prof::CCT::MergeEffectList*
+bin_mergeCCT(Prof::CCT::Tree& x_cct, const BinView& bin,
+	     const std::vector<Prof::LoadMap::LMId_t>& lmMap,
+	     uint x_newMetricBegIdx, Prof::CCT::MergeContext* mrgCtxt)
+{
+  using namespace Prof;
+
+  CCT::MergeEffectList* effctLst = new CCT::MergeEffectList;
+
+  uint64_t numNodes = bin.hdr->numNodes;
+
+  // x node corresponding to each node of 'bin' (NULL if dropped) and
+  // whether it was inserted from 'bin'
+  std::vector<CCT::ANode*> x_nodes(numNodes, NULL);
+  std::vector<bool> x_isNew(numNodes, false);
+
+  x_nodes[0] = x_cct.root();
+  x_isNew[0] = (!mrgCtxt);
+
+  for (uint64_t i = 1; i < numNodes; ++i) {
+    const BinNode& n_bin = bin.nodes[i];
+    DIAG_Assert(n_bin.parent < i, "Profile::bin_unpack: CCT node " << i
+		<< " has invalid parent (" << n_bin.parent << ")");
+
+    CCT::ANode* x_parent = x_nodes[n_bin.parent];
+    if (!x_parent) {
+      continue; // subtree was dropped
+    }
+    bool x_parentIsNew = x_isNew[n_bin.parent];
+
+    std::pair<CCT::ADynNode*, CCT::ADynNode*> y2 =
+      bin_makeNode(bin, i, lmMap);
+
+    // Merge the leaf sibling first: an interior node inserted from y
+    // has no children yet, so it would look like a leaf to the probe.
+    if (y2.second) {
+      bin_mergeNode(y2.second, true, x_parent, x_parentIsNew,
+		    x_newMetricBegIdx, mrgCtxt, *effctLst);
+    }
+
+    CCT::ANode* x = bin_mergeNode(y2.first, (n_bin.flags & BinNode_Leaf),
+				  x_parent, x_parentIsNew,
+				  x_newMetricBegIdx, mrgCtxt, *effctLst);
+    x_nodes[i] = x;
+    x_isNew[i] = (x == y2.first);
+  }
+
+  return effctLst;
+}
+
+} // namespace (anonymous)
+
+
+void
+Profile::bin_pack(const Profile& prof, uint wFlags,
+		  uint8_t** buffer, size_t* bufferSz)
+{
+  const CCT::ANode* root = prof.cct()->root();
+  DIAG_Assert(root && typeid(*root) == typeid(CCT::Root),
+	      "Profile::bin_pack: profile must be canonical!");
+
+  // ------------------------------------------------------------
+  // meta data
+  // ------------------------------------------------------------
+  char* metaBuf = NULL;
+  size_t metaSz = 0;
+
+  // open_memstream: mallocs buffer and sets metaSz
+  FILE* fs = open_memstream(&metaBuf, &metaSz);
+  int ret = fmt_fwrite(prof, fs, wFlags | WFlg_NoCCT);
+  fclose(fs);
+  DIAG_Assert(ret == HPCFMT_OK, "Profile::bin_pack: error writing meta data");
+
+  // ------------------------------------------------------------
+  // size buffer
+  // ------------------------------------------------------------
+  std::vector<const CCT::ANode*> nodes;
+  for (CCT::ANodeIterator it(root); it.Current(); ++it) {
+    nodes.push_back(it.current());
+  }
+
+  uint64_t numNodes = nodes.size();
+  uint64_t numMetrics = prof.metricMgr()->size();
+  if (prof.isMetricMgrVirtual() || (wFlags & WFlg_VirtualMetrics) ) {
+    numMetrics = 0;
+  }
+
+  size_t sz = (sizeof(BinHdr) + bin_align(metaSz)
+	       + numNodes * sizeof(BinNode)
+	       + numNodes * numMetrics * sizeof(double));
+  uint8_t* buf = (uint8_t*)malloc(sz);
+  memset(buf, 0, sizeof(BinHdr) + bin_align(metaSz));
+
+  BinHdr* hdr = (BinHdr*)buf;
+  hdr->magic      = BinMagic;
+  hdr->metaSz     = metaSz;
+  hdr->numNodes   = numNodes;
+  hdr->numMetrics = numMetrics;
+
+  memcpy(buf + sizeof(BinHdr), metaBuf, metaSz);
+  free(metaBuf);
+
+  BinNode* nodesBin = (BinNode*)(buf + sizeof(BinHdr) + bin_align(metaSz));
+  double* metricsBin = (double*)(nodesBin + numNodes);
+
+  // ------------------------------------------------------------
+  // CCT nodes and metric columns
+  // ------------------------------------------------------------
+  std::unordered_map<const CCT::ANode*, uint32_t> nodeIdx(numNodes);
+  nodeIdx[root] = 0;
+
+  for (uint64_t i = 0; i < numNodes; ++i) {
+    const CCT::ANode* n = nodes[i];
+    BinNode& n_bin = nodesBin[i];
+    memset(&n_bin, 0, sizeof(n_bin));
+
+    n_bin.flags = (n->isLeaf()) ? BinNode_Leaf : 0;
+
+    if (i > 0) {
+      const CCT::ADynNode* n_dyn = dynamic_cast<const CCT::ADynNode*>(n);
+      DIAG_Assert(n_dyn, "Profile::bin_pack: unexpected CCT node type");
+
+      nodeIdx[n] = (uint32_t)i;
+      n_bin.parent = nodeIdx[n->parent()];
+
+      // cf. fmt_cct_fwrite(): only retained ids survive
+      uint cpId = n_dyn->cpId();
+      n_bin.cpId = (hpcrun_fmt_doRetainId(cpId)) ? cpId
+	                                         : HPCRUN_FMT_CCTNodeId_NULL;
+      if (prof.m_flags.fields.isLogicalUnwind) {
+	n_bin.asInfo = n_dyn->assocInfo().bits;
+	if (n_dyn->lip()) {
+	  memcpy(n_bin.lip, n_dyn->lip()->data8, sizeof(n_bin.lip));
+	}
+      }
+      n_bin.lmId = (uint16_t) n_dyn->lmId();
+      n_bin.lmIP = n_dyn->ADynNode::lmIP();
+    }
+
+    for (uint64_t mId = 0; mId < numMetrics; ++mId) {
+      metricsBin[mId * numNodes + i] = (i > 0) ? n->metric(mId) : 0.0;
+    }
+  }
+
+  *buffer = buf;
+  *bufferSz = sz;
+}
+
+
+Profile*
+Profile::bin_unpack(const uint8_t* buffer, size_t bufferSz, uint rFlags,
+		    bool doReadCCT)
+{
+  BinView bin(buffer, bufferSz);
+
+  // ------------------------------------------------------------
+  // meta data
+  // ------------------------------------------------------------
+  FILE* fs = fmemopen(const_cast<uint8_t*>(bin.meta), bin.hdr->metaSz, "r");
+
+  Profile* prof = NULL;
+  fmt_fread(prof, fs, rFlags, "(Profile::bin_unpack)", NULL, NULL);
+
+  fclose(fs);
+
+  std::vector<LoadMap::LMId_t> lmMap = bin_noteLMs(*prof, bin);
+
+  // ------------------------------------------------------------
+  // CCT
+  // ------------------------------------------------------------
+  if (doReadCCT) {
+    DIAG_Assert(prof->cct()->root()->isLeaf(), DIAG_UnexpectedInput);
+    CCT::MergeEffectList* effctLst =
+      bin_mergeCCT(*prof->cct(), bin, lmMap, 0, NULL);
+    delete effctLst;
+  }
+
+  return prof;
+}
+
+
+uint
+Profile::bin_merge(Profile& y, const uint8_t* buffer, size_t bufferSz,
+		   int mergeTy, uint mrgFlag,
+		   CCT::MergeEffectList* mrgEffects)
+{
+  Profile& x = (*this);
+
+  BinView bin(buffer, bufferSz);
+
+  DIAG_Assert(y.cct()->root()->isLeaf(),
+	      "Profile::bin_merge: y must be made by bin_unpack(..., false)");
+  DIAG_Assert(typeid(*x.cct()->root()) == typeid(CCT::Root),
+	      "Profile::bin_merge: Merge precondition fails!");
+
+  // ------------------------------------------------------------
+  // merge name, flags, metrics and LoadMaps
+  // ------------------------------------------------------------
+  std::vector<LoadMap::LMId_t> lmMap = bin_noteLMs(y, bin);
+
+  uint x_newMetricBegIdx = 0;
+  std::vector<LoadMap::MergeEffect>* lmEffects = NULL;
+  uint firstMergedMetric = merge_meta(y, mergeTy, x_newMetricBegIdx,
+				      lmEffects);
+  bin_fixLMs(lmMap, lmEffects);
+  delete lmEffects;
+
+  // ------------------------------------------------------------
+  // merge CCTs (cf. merge())
+  // ------------------------------------------------------------
+  if (mrgFlag & CCT::MrgFlg_NormalizeTraceFileY) {
+    mrgFlag |= CCT::MrgFlg_PropagateEffects;
+  }
+
+  CCT::MergeEffectList* mrgEffects2 =
+    bin_mergeCCT(*x.cct(), bin, lmMap, x_newMetricBegIdx,
+		 &x.cct()->mergeCtxt(mrgFlag));
+
+  if (mrgEffects) {
+    mrgEffects->splice(mrgEffects->end(), *mrgEffects2);
+  }
+  else {
+    y.merge_fixTrace(mrgEffects2);
+  }
+  delete mrgEffects2;
+
+  return firstMergedMetric;
+}
+
+
 //***************************************************************************
 
 // 1. Create a CCT::Root node for the CCT
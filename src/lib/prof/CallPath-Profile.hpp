@@ -66,6 +66,7 @@
 #include <cstdio>
 
 #include <vector>
+#include <map>
 #include <set>
 #include <string>
 
@@ -244,8 +245,24 @@ public:
   //   the index of the first merged metric in x.
   // ASSUMES: both x and y are in canonical form (canonicalize())
   // WARNING: the merge may change/destroy y
+  //
+  // If 'mrgEffects' is non-NULL, y's trace file is not rewritten under
+  //   CCT::MrgFlg_NormalizeTraceFileY; instead, the CCT merge effects
+  //   are appended to 'mrgEffects' so the caller can apply them later
+  //   (cf. rewriteTrace()).
   uint
-  merge(Profile& y, int mergeTy, uint mrgFlag = 0);
+  merge(Profile& y, int mergeTy, uint mrgFlag = 0,
+	CCT::MergeEffectList* mrgEffects = NULL);
+
+
+  // rewriteTrace: Rewrite trace file 'traceFnm' into a temporary file
+  //   (cf. HPCPROF_TmpFnmSfx), translating each record's cpId through
+  //   each map in 'cpIdMaps' in order.  A cpId not in a map is kept.
+  typedef std::map<uint, uint> CPIdMap;
+
+  static void
+  rewriteTrace(const std::string& traceFnm,
+	       const std::vector<const CPIdMap*>& cpIdMaps);
 
   // -------------------------------------------------------
   //
@@ -271,6 +288,9 @@ public:
     // affects the normalizations applied to obtain a canonical CCT.
     RFlg_HpcrunData = (1 << 4),
 
+    // *private*: write an empty CCT (cf. bin_pack())
+    WFlg_NoCCT          = (1 << 14),
+
     // only write metric descriptors, even if CCT nodes have metrics
     WFlg_VirtualMetrics = (1 << 15)
   };
@@ -324,6 +344,38 @@ public:
   static int
   fmt_cct_fwrite(const Profile& prof, FILE* fs, uint wFlags);
 
+
+  // bin_*(): A compact binary form for exchanging profiles between
+  // processes of one job (e.g., hpcprof-mpi's reduction), in native
+  // byte order.  The meta data (metric table, load map) is encoded
+  // as hpcrun-fmt with an empty CCT.  The CCT is a flat, pointer-free
+  // array of nodes in preorder, each naming its parent by index,
+  // followed by a column block of metric values (one column per
+  // metric; empty with WFlg_VirtualMetrics).
+  //
+  // N.B.: As with fmt_cct_fwrite(), only CCT::ADynNodes are written;
+  // 'prof' must be canonical and have no static structure.
+
+  // bin_pack: malloc()s '*buffer' and fills it with 'prof'
+  static void
+  bin_pack(const Profile& prof, uint wFlags,
+	   uint8_t** buffer, size_t* bufferSz);
+
+  // bin_unpack: make a Profile from a bin_pack() buffer.  If
+  //   'doReadCCT' is false, only the meta data is read and the CCT is
+  //   left empty (cf. bin_merge()).
+  static Profile*
+  bin_unpack(const uint8_t* buffer, size_t bufferSz, uint rFlags,
+	     bool doReadCCT = true);
+
+  // bin_merge: as merge(), except that y's CCT is merged directly
+  //   from the bin_pack() 'buffer' from which 'y' was made with
+  //   bin_unpack(..., false), without building the CCT.
+  uint
+  bin_merge(Profile& y, const uint8_t* buffer, size_t bufferSz,
+	    int mergeTy, uint mrgFlag = 0,
+	    CCT::MergeEffectList* mrgEffects = NULL);
+
   // -------------------------------------------------------
   // Output
   // -------------------------------------------------------
@@ -355,6 +407,13 @@ private:
   uint
   mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx);
 
+  // merge everything but the CCTs: returns the index of the first
+  // merged metric and the LoadMap merge effects (to be applied to y's
+  // CCT)
+  uint
+  merge_meta(Profile& y, int mergeTy, uint& x_newMetricBegIdx,
+	     std::vector<LoadMap::MergeEffect>*& lmEffects);
+
   // apply MergeEffects after merging two profiles
   void
   merge_fixCCT(const std::vector<LoadMap::MergeEffect>* mrgEffects);
@@ -88,6 +88,272 @@ namespace Prof {
 namespace Metric {
 
 
+// ----------------------------------------------------------------------
+// class AExprProg
+// ----------------------------------------------------------------------
+
+void
+AExprProg::emit(OpTy op, uint arg, uint arg2, double c)
+{
+  Insn insn = { op, arg, arg2, c };
+  m_insns.push_back(insn);
+
+  uint pops = 0, pushes = 1;
+  switch (op) {
+    case OpConst:
+    case OpVar:
+      break;
+    case OpNeg:
+      pops = 1; break;
+    case OpPower:
+    case OpDivide:
+    case OpMinus:
+      pops = 2; break;
+    case OpSumSquares:
+      pops = arg; pushes = 2; break;
+    case OpStore:
+      pops = 1; pushes = 0; break;
+    default: // n-ary
+      pops = arg; break;
+  }
+  DIAG_Assert(pops <= m_depth, "AExprProg::emit: stack underflow");
+  m_depth = m_depth - pops + pushes;
+  m_maxDepth = std::max(m_maxDepth, m_depth);
+}
+
+
+// N.B.: Each operation is a loop over the batch that combines operands
+// in the same order as the corresponding AExpr::eval(), so results are
+// identical to the tree-walking evaluator.
+void
+AExprProg::evalBatch(Metric::IData* const* data, uint n,
+		     std::vector<double>& scratch) const
+{
+  DIAG_Assert(n <= BatchSz, "AExprProg::evalBatch: batch too large");
+
+  // the column stack plus two temporaries for mean/variance
+  scratch.resize((m_maxDepth + 2) * BatchSz);
+  double* stk = &scratch[0];
+  double* t1 = stk + m_maxDepth * BatchSz;
+  double* t2 = t1 + BatchSz;
+  uint top = 0;
+
+#define AEXPR_COL(k) (stk + (k) * BatchSz)
+
+  for (uint p = 0; p < m_insns.size(); ++p) {
+    const Insn& insn = m_insns[p];
+    switch (insn.op) {
+      case OpConst: {
+	double* z = AEXPR_COL(top++);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = insn.c;
+	}
+	break;
+      }
+      case OpVar: {
+	double* z = AEXPR_COL(top++);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = data[j]->demandMetric(insn.arg);
+	}
+	break;
+      }
+      case OpNeg: {
+	double* z = AEXPR_COL(top - 1);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = -z[j];
+	}
+	break;
+      }
+      case OpPower: {
+	top--;
+	double* z = AEXPR_COL(top - 1);
+	const double* e = AEXPR_COL(top);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = pow(z[j], e[j]);
+	}
+	break;
+      }
+      case OpDivide: {
+	top--;
+	double* z = AEXPR_COL(top - 1);
+	const double* d = AEXPR_COL(top);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = (AExpr::isok(d[j]) && d[j] != 0.0) ? (z[j] / d[j]) : c_FP_NAN_d;
+	}
+	break;
+      }
+      case OpMinus: {
+	top--;
+	double* z = AEXPR_COL(top - 1);
+	const double* s = AEXPR_COL(top);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = z[j] - s[j];
+	}
+	break;
+      }
+      case OpPlus:
+      case OpMean:
+      case OpTimes:
+      case OpMax: {
+	uint sz = insn.arg;
+	top -= sz;
+	double* z = AEXPR_COL(top);
+	if (sz == 0) {
+	  double z0 = (insn.op == OpTimes) ? 1.0 : 0.0;
+	  for (uint j = 0; j < n; ++j) {
+	    z[j] = z0;
+	  }
+	}
+	else if (insn.op == OpTimes) {
+	  for (uint j = 0; j < n; ++j) {
+	    z[j] = 1.0 * z[j];
+	  }
+	  for (uint i = 1; i < sz; ++i) {
+	    const double* x = AEXPR_COL(top + i);
+	    for (uint j = 0; j < n; ++j) {
+	      z[j] *= x[j];
+	    }
+	  }
+	}
+	else if (insn.op == OpMax) {
+	  for (uint i = 1; i < sz; ++i) {
+	    const double* x = AEXPR_COL(top + i);
+	    for (uint j = 0; j < n; ++j) {
+	      z[j] = std::max(z[j], x[j]);
+	    }
+	  }
+	}
+	else {
+	  for (uint j = 0; j < n; ++j) {
+	    z[j] = 0.0 + z[j];
+	  }
+	  for (uint i = 1; i < sz; ++i) {
+	    const double* x = AEXPR_COL(top + i);
+	    for (uint j = 0; j < n; ++j) {
+	      z[j] += x[j];
+	    }
+	  }
+	  if (insn.op == OpMean) {
+	    for (uint j = 0; j < n; ++j) {
+	      z[j] = z[j] / (double) sz;
+	    }
+	  }
+	}
+	top++;
+	break;
+      }
+      case OpMin: {
+	uint sz = insn.arg;
+	top -= sz;
+	for (uint j = 0; j < n; ++j) {
+	  t1[j] = DBL_MAX;
+	}
+	for (uint i = 0; i < sz; ++i) {
+	  const double* x = AEXPR_COL(top + i);
+	  for (uint j = 0; j < n; ++j) {
+	    if (x[j] != 0.0) {
+	      t1[j] = std::min(t1[j], x[j]);
+	    }
+	  }
+	}
+	double* z = AEXPR_COL(top++);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = (t1[j] == DBL_MAX) ? DBL_MIN : t1[j];
+	}
+	break;
+      }
+      case OpStdDev:
+      case OpCoefVar:
+      case OpRStdDev: {
+	// running mean (t1) and variance (t2), cf. AExpr::evalVariance()
+	uint sz = insn.arg;
+	top -= sz;
+	for (uint j = 0; j < n; ++j) {
+	  t1[j] = 0.0;
+	  t2[j] = 0.0;
+	}
+	for (uint i = 0; i < sz; ++i) {
+	  const double* x = AEXPR_COL(top + i);
+	  for (uint j = 0; j < n; ++j) {
+	    double delta = x[j] - t1[j];
+	    t1[j] += delta / (i + 1);
+	    t2[j] += delta * (x[j] - t1[j]);
+	  }
+	}
+	double* z = AEXPR_COL(top++);
+	for (uint j = 0; j < n; ++j) {
+	  double sdev = sqrt(t2[j] / sz);
+	  double mean = t1[j];
+	  if (insn.op == OpStdDev) {
+	    z[j] = sdev;
+	  }
+	  else {
+	    z[j] = 0.0;
+	    if (mean > epsilon) {
+	      z[j] = (insn.op == OpCoefVar) ? (sdev / mean) : (sdev / mean) * 100;
+	    }
+	  }
+	}
+	break;
+      }
+      case OpSumSquares: {
+	uint sz = insn.arg;
+	top -= sz;
+	for (uint j = 0; j < n; ++j) {
+	  t1[j] = 0.0;
+	  t2[j] = 0.0;
+	}
+	for (uint i = 0; i < sz; ++i) {
+	  const double* x = AEXPR_COL(top + i);
+	  for (uint j = 0; j < n; ++j) {
+	    t1[j] += x[j];
+	    t2[j] += (x[j] * x[j]);
+	  }
+	}
+	std::copy(t1, t1 + n, AEXPR_COL(top++));
+	std::copy(t2, t2 + n, AEXPR_COL(top++));
+	break;
+      }
+      case OpStore: {
+	const double* z = AEXPR_COL(--top);
+	for (uint j = 0; j < n; ++j) {
+	  data[j]->demandMetric(insn.arg, insn.arg2) = z[j];
+	}
+	break;
+      }
+      default:
+	DIAG_Die(DIAG_UnexpectedInput);
+    }
+  }
+
+#undef AEXPR_COL
+}
+
+
+std::ostream&
+AExprProg::dump(std::ostream& os) const
+{
+  static const char* opStr[] = {
+    "const", "var", "neg", "power", "divide", "minus", "plus", "times",
+    "min", "max", "mean", "stddev", "coefvar", "r-stddev", "sum-squares",
+    "store"
+  };
+  for (uint p = 0; p < m_insns.size(); ++p) {
+    const Insn& insn = m_insns[p];
+    os << opStr[insn.op];
+    if (insn.op == OpConst) {
+      os << " " << insn.c;
+    }
+    else if (insn.op != OpNeg && insn.op != OpPower && insn.op != OpDivide
+	     && insn.op != OpMinus) {
+      os << " " << insn.arg;
+    }
+    os << endl;
+  }
+  return os;
+}
+
+
 // ----------------------------------------------------------------------
 // class AExpr
 // ----------------------------------------------------------------------
@@ -139,6 +405,17 @@ Neg::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Neg::compile(AExprProg& prog) const
+{
+  if (!m_expr->compile(prog)) {
+    return false;
+  }
+  prog.emit(AExprProg::OpNeg);
+  return true;
+}
+
+
 std::ostream&
 Neg::dumpMe(std::ostream& os) const
 {
@@ -177,6 +454,17 @@ Power::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Power::compile(AExprProg& prog) const
+{
+  if (!m_base->compile(prog) || !m_exponent->compile(prog)) {
+    return false;
+  }
+  prog.emit(AExprProg::OpPower);
+  return true;
+}
+
+
 std::ostream&
 Power::dumpMe(std::ostream& os) const
 {
@@ -209,6 +497,17 @@ Divide::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Divide::compile(AExprProg& prog) const
+{
+  if (!m_numerator->compile(prog) || !m_denominator->compile(prog)) {
+    return false;
+  }
+  prog.emit(AExprProg::OpDivide);
+  return true;
+}
+
+
 std::ostream&
 Divide::dumpMe(std::ostream& os) const
 {
@@ -237,6 +536,17 @@ Minus::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Minus::compile(AExprProg& prog) const
+{
+  if (!m_minuend->compile(prog) || !m_subtrahend->compile(prog)) {
+    return false;
+  }
+  prog.emit(AExprProg::OpMinus);
+  return true;
+}
+
+
 std::ostream&
 Minus::dumpMe(std::ostream& os) const
 {
@@ -271,6 +581,13 @@ Plus::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Plus::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpPlus, m_opands, m_sz);
+}
+
+
 std::ostream&
 Plus::dumpMe(std::ostream& os) const
 {
@@ -308,6 +625,13 @@ Times::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Times::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpTimes, m_opands, m_sz);
+}
+
+
 std::ostream&
 Times::dumpMe(std::ostream& os) const
 {
@@ -345,6 +669,13 @@ Max::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Max::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpMax, m_opands, m_sz);
+}
+
+
 std::ostream&
 Max::dumpMe(std::ostream& os) const
 {
@@ -386,6 +717,13 @@ Min::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Min::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpMin, m_opands, m_sz);
+}
+
+
 std::ostream&
 Min::dumpMe(std::ostream& os) const
 {
@@ -419,6 +757,13 @@ Mean::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+Mean::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpMean, m_opands, m_sz);
+}
+
+
 std::ostream&
 Mean::dumpMe(std::ostream& os) const
 {
@@ -453,6 +798,13 @@ StdDev::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+StdDev::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpStdDev, m_opands, m_sz);
+}
+
+
 std::ostream&
 StdDev::dumpMe(std::ostream& os) const
 {
@@ -492,6 +844,13 @@ CoefVar::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+CoefVar::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpCoefVar, m_opands, m_sz);
+}
+
+
 std::ostream&
 CoefVar::dumpMe(std::ostream& os) const
 {
@@ -531,6 +890,13 @@ RStdDev::eval(const Metric::IData& mdata) const
 }
 
 
+bool
+RStdDev::compile(AExprProg& prog) const
+{
+  return compileOpands(prog, AExprProg::OpRStdDev, m_opands, m_sz);
+}
+
+
 std::ostream&
 RStdDev::dumpMe(std::ostream& os) const
 {
@@ -70,6 +70,11 @@
 //   CoefVar: coefficient of variance              : n-ary
 //   RStdDev: relative standard deviation          : n-ary
 //
+// An expression tree may also be compiled into an AExprProg, a flat
+// postfix program that evaluates the expression for a batch of nodes at
+// a time (one loop over the batch per operation instead of one virtual
+// call per node and operation).
+//
 //***************************************************************************
 
 #ifndef prof_Prof_Metric_AExpr_hpp
@@ -79,6 +84,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <algorithm>
 
 //************************* User Include Files *******************************
@@ -103,6 +109,75 @@ namespace Prof {
 
 namespace Metric {
 
+// ----------------------------------------------------------------------
+// class AExprProg
+//   A compiled AExpr: a postfix program over a stack of columns, where
+//   each column holds one value per node of a batch.  Operands of an
+//   n-ary operation are the top n columns; results are pushed in their
+//   place.  OpStore pops a column into the metric 'arg' (demanding a
+//   metric vector of at least 'arg2' entries) of every node.
+// ----------------------------------------------------------------------
+
+class AExprProg
+{
+public:
+  enum OpTy {
+    OpConst,      // push c
+    OpVar,        // push metric 'arg'
+    OpNeg,
+    OpPower,
+    OpDivide,
+    OpMinus,
+    OpPlus,       // n-ary: 'arg' operands
+    OpTimes,
+    OpMin,
+    OpMax,
+    OpMean,
+    OpStdDev,
+    OpCoefVar,
+    OpRStdDev,
+    OpSumSquares, // n-ary: pushes sum and sum of squares
+    OpStore       // pop into metric 'arg'
+  };
+
+  struct Insn {
+    OpTy op;
+    uint arg;
+    uint arg2;
+    double c;
+  };
+
+  // number of nodes evaluated by one pass over the program
+  static const uint BatchSz = 128;
+
+public:
+  AExprProg()
+    : m_depth(0), m_maxDepth(0)
+  { }
+
+  bool
+  empty() const
+  { return m_insns.empty(); }
+
+  void
+  emit(OpTy op, uint arg = 0, uint arg2 = 0, double c = 0.0);
+
+  // evalBatch: run the program for data[0..n), n <= BatchSz.  'scratch'
+  // holds the column stack and may be reused across calls.
+  void
+  evalBatch(Metric::IData* const* data, uint n,
+	    std::vector<double>& scratch) const;
+
+  std::ostream&
+  dump(std::ostream& os = std::cout) const;
+
+private:
+  std::vector<Insn> m_insns;
+  uint m_depth;
+  uint m_maxDepth;
+};
+
+
 // ----------------------------------------------------------------------
 // class AExpr
 //   The base class for all concrete evaluation classes
@@ -153,6 +228,24 @@ public:
   { return !(c_isnan_d(x) || c_isinf_d(x)); }
 
 
+  // compile: append a program computing eval() to 'prog'; returns false
+  // if the expression cannot be compiled
+  virtual bool
+  compile(AExprProg& GCC_ATTR_UNUSED prog) const
+  { return false; }
+
+  // compileNF: append a program performing evalNF() to 'prog'
+  virtual bool
+  compileNF(AExprProg& prog) const
+  {
+    if (!compile(prog)) {
+      return false;
+    }
+    prog.emit(AExprProg::OpStore, m_accumId[0]);
+    return true;
+  }
+
+
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
   // ------------------------------------------------------------
@@ -319,6 +412,31 @@ protected:
   }
 
 
+  static bool
+  compileOpands(AExprProg& prog, AExprProg::OpTy op, AExpr** opands, uint sz)
+  {
+    for (uint i = 0; i < sz; ++i) {
+      if (!opands[i]->compile(prog)) {
+	return false;
+      }
+    }
+    prog.emit(op, sz);
+    return true;
+  }
+
+
+  bool
+  compileStdDevNF(AExprProg& prog, AExpr** opands, uint sz) const
+  {
+    if (!compileOpands(prog, AExprProg::OpSumSquares, opands, sz)) {
+      return false;
+    }
+    prog.emit(AExprProg::OpStore, m_accumId[1]);
+    prog.emit(AExprProg::OpStore, m_accumId[0]);
+    return true;
+  }
+
+
   static void
   dump_opands(std::ostream& os, AExpr** opands, uint sz,
 	      const char* sep = ", ");
@@ -349,6 +467,13 @@ public:
   eval(const Metric::IData& GCC_ATTR_UNUSED mdata) const
   { return m_c; }
 
+  virtual bool
+  compile(AExprProg& prog) const
+  {
+    prog.emit(AExprProg::OpConst, 0, 0, m_c);
+    return true;
+  }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -390,6 +515,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -435,6 +563,13 @@ public:
   eval(const Metric::IData& mdata) const
   { return mdata.demandMetric(m_metricId); }
 
+  virtual bool
+  compile(AExprProg& prog) const
+  {
+    prog.emit(AExprProg::OpVar, m_metricId);
+    return true;
+  }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -490,6 +625,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr:
@@ -540,6 +678,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -587,6 +728,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -631,6 +775,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -681,6 +828,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -727,6 +877,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -776,6 +929,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -825,6 +981,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   {
@@ -833,6 +992,16 @@ public:
     return z;
   }
 
+  virtual bool
+  compileNF(AExprProg& prog) const
+  {
+    if (!compileOpands(prog, AExprProg::OpPlus, m_opands, m_sz)) {
+      return false;
+    }
+    prog.emit(AExprProg::OpStore, m_accumId[0]);
+    return true;
+  }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr:
@@ -886,10 +1055,17 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual bool
+  compileNF(AExprProg& prog) const
+  { return compileStdDevNF(prog, m_opands, m_sz); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -952,10 +1128,17 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual bool
+  compileNF(AExprProg& prog) const
+  { return compileStdDevNF(prog, m_opands, m_sz); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1018,10 +1201,17 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual bool
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual bool
+  compileNF(AExprProg& prog) const
+  { return compileStdDevNF(prog, m_opands, m_sz); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1086,6 +1276,13 @@ public:
   eval(const Metric::IData& GCC_ATTR_UNUSED mdata) const
   { return (double)m_numSrc; }
 
+  virtual bool
+  compile(AExprProg& prog) const
+  {
+    prog.emit(AExprProg::OpConst, 0, 0, (double)m_numSrc);
+    return true;
+  }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
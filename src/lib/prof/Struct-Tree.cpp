@@ -546,6 +546,7 @@ Alien::Ctor(ACodeNode* parent, const char* filenm, const char* nm,
   freezeLine();
 
   m_stmtMap = NULL;
+  m_proc = NULL;
 }
 
 
@@ -558,6 +559,7 @@ Alien::operator=(const Alien& x)
     m_name   = x.m_name;
     m_displaynm = x.m_displaynm;
     m_stmtMap = NULL;
+    m_proc = x.m_proc;
   }
   return *this;
 }
@@ -1634,6 +1634,10 @@ public:
   name(const std::string& n)
   { m_name = n; }
 
+  Prof::Struct::Proc*
+  proc() const
+  { return m_proc; }
+
   void
   proc(Prof::Struct::Proc *proc)
   { m_proc = proc; }
@@ -1767,7 +1771,7 @@ public:
        VMA begVMA = 0, VMA endVMA = 0,
        StmtType stmt_type = STMT_STMT)
     : ACodeNode(TyStmt, parent, begLn, endLn, begVMA, endVMA),
-      m_stmt_type(stmt_type), m_sortId((int)begLn)
+      m_stmt_type(stmt_type), m_target(0), m_sortId((int)begLn)
   {
     ANodeTy t = (parent) ? parent->type() : TyANY;
     DIAG_Assert((parent == NULL) || (t == TyGroup) || (t == TyFile)
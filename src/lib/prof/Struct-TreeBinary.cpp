@@ -0,0 +1,732 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Binary, mmap-able representation of a Struct::Tree.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+using std::string;
+
+#include <map>
+#include <vector>
+
+#include <cstring>
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "Struct-TreeBinary.hpp"
+#include "Struct-Tree.hpp"
+
+#include <lib/support/diagnostics.h>
+
+//*************************** Forward Declarations **************************
+
+//***************************************************************************
+
+namespace Prof {
+
+namespace Struct {
+
+//***************************************************************************
+// File layout
+//***************************************************************************
+
+static const char binMagic[8] = { 'H', 'P', 'C', 'S', 'T', 'R', 'B', '\0' };
+
+static const uint32_t binVersion   = 1;
+static const uint32_t binByteOrder = 0x01020304;
+static const uint32_t binNone      = 0xffffffff;
+
+enum BinScopeTy {
+  BinTyLM = 1,
+  BinTyFile,
+  BinTyProc,
+  BinTyAlien,
+  BinTyLoop,
+  BinTyStmt,
+  BinTyCall
+};
+
+struct BinHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+
+  uint64_t nStrings;
+  uint64_t strOffsetsOff; // uint32_t[nStrings], offsets into string data
+  uint64_t strDataOff;
+  uint64_t strDataSz;
+
+  uint64_t nScopes;
+  uint64_t scopesOff;     // BinScope[nScopes]
+
+  uint64_t nRanges;
+  uint64_t rangesOff;     // BinRange[nRanges]
+};
+
+struct BinScope {
+  uint8_t  type;          // BinScopeTy
+  uint8_t  pad[3];
+  uint32_t parent;        // scope index or binNone (for a LM)
+  uint32_t name;          // string id
+  uint32_t name2;         // string id: Proc: link name; Alien, Loop: file
+                          //   name; Call: device; otherwise binNone
+  uint32_t begLine;
+  uint32_t endLine;
+  uint32_t origId;
+  uint32_t ref;           // Alien: scope index of its Proc or binNone
+  uint64_t target;        // Call: call target
+  uint32_t rangeBeg;      // first range index
+  uint32_t rangeCnt;
+};
+
+struct BinRange {
+  uint64_t beg;
+  uint64_t end;
+};
+
+
+static inline uint64_t
+binAlign(uint64_t x)
+{
+  return (x + 7) & ~(uint64_t)7;
+}
+
+
+//***************************************************************************
+// isBinaryFile
+//***************************************************************************
+
+bool
+isBinaryFile(const char* filenm)
+{
+  char magic[sizeof(binMagic)];
+
+  int fd = open(filenm, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t n = read(fd, magic, sizeof(magic));
+  close(fd);
+
+  return (n == (ssize_t)sizeof(magic)
+	  && memcmp(magic, binMagic, sizeof(magic)) == 0);
+}
+
+
+//***************************************************************************
+// writeBinary
+//***************************************************************************
+
+namespace {
+
+// binIndex: 'val' as a 32-bit count, index or offset; throws if it
+// would reach binNone (which marks an absent value) or not fit at all
+static uint32_t
+binIndex(uint64_t val, const char* what)
+{
+  if (val >= binNone) {
+    DIAG_Throw("binary structure file overflow: too many " << what);
+  }
+  return (uint32_t)val;
+}
+
+
+class BinaryWriter {
+public:
+  BinaryWriter()
+  { }
+
+  void
+  write(std::ostream& os, const Tree& structure);
+
+private:
+  uint32_t
+  stringId(const string& str);
+
+  void
+  addScope(ANode* node, uint32_t parent);
+
+  void
+  addRanges(BinScope& scope, ACodeNode* node);
+
+  void
+  writePadding(std::ostream& os, uint64_t pos);
+
+  std::map<string, uint32_t> m_strMap;
+  std::vector<uint32_t>      m_strOffsets;
+  string                     m_strData;
+
+  std::vector<BinScope>      m_scopes;
+  std::vector<BinRange>      m_ranges;
+
+  std::map<Proc*, uint32_t>  m_procIdx;
+  std::vector<std::pair<uint32_t, Proc*> > m_alienRefs;
+};
+
+
+void
+BinaryWriter::write(std::ostream& os, const Tree& structure)
+{
+  Root* root = structure.root();
+  if (root) {
+    for (ANode* x = root->firstChild(); x; x = x->nextSibling()) {
+      addScope(x, binNone);
+    }
+  }
+
+  // resolve Alien -> Proc references now that every Proc has an index
+  for (uint i = 0; i < m_alienRefs.size(); ++i) {
+    std::map<Proc*, uint32_t>::iterator it =
+      m_procIdx.find(m_alienRefs[i].second);
+    if (it != m_procIdx.end()) {
+      m_scopes[m_alienRefs[i].first].ref = it->second;
+    }
+  }
+
+  BinHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, binMagic, sizeof(binMagic));
+  hdr.version   = binVersion;
+  hdr.byteOrder = binByteOrder;
+
+  hdr.nStrings      = m_strOffsets.size();
+  hdr.strOffsetsOff = binAlign(sizeof(hdr));
+  hdr.strDataOff    = binAlign(hdr.strOffsetsOff
+			       + hdr.nStrings * sizeof(uint32_t));
+  hdr.strDataSz     = m_strData.size();
+
+  hdr.nScopes   = m_scopes.size();
+  hdr.scopesOff = binAlign(hdr.strDataOff + hdr.strDataSz);
+
+  hdr.nRanges   = m_ranges.size();
+  hdr.rangesOff = binAlign(hdr.scopesOff + hdr.nScopes * sizeof(BinScope));
+
+  uint64_t pos = 0;
+  os.write((const char*)&hdr, sizeof(hdr));
+  pos += sizeof(hdr);
+
+  writePadding(os, pos);
+  pos = hdr.strOffsetsOff;
+  os.write((const char*)m_strOffsets.data(), hdr.nStrings * sizeof(uint32_t));
+  pos += hdr.nStrings * sizeof(uint32_t);
+
+  writePadding(os, pos);
+  pos = hdr.strDataOff;
+  os.write(m_strData.data(), hdr.strDataSz);
+  pos += hdr.strDataSz;
+
+  writePadding(os, pos);
+  pos = hdr.scopesOff;
+  os.write((const char*)m_scopes.data(), hdr.nScopes * sizeof(BinScope));
+  pos += hdr.nScopes * sizeof(BinScope);
+
+  writePadding(os, pos);
+  os.write((const char*)m_ranges.data(), hdr.nRanges * sizeof(BinRange));
+
+  if (!os) {
+    DIAG_Throw("error writing binary structure file");
+  }
+}
+
+
+uint32_t
+BinaryWriter::stringId(const string& str)
+{
+  std::map<string, uint32_t>::iterator it = m_strMap.find(str);
+  if (it != m_strMap.end()) {
+    return it->second;
+  }
+
+  uint32_t id = binIndex(m_strOffsets.size(), "strings");
+  m_strOffsets.push_back(binIndex(m_strData.size(), "bytes of string data"));
+  m_strData.append(str);
+  m_strData.push_back('\0');
+  m_strMap.insert(std::make_pair(str, id));
+  return id;
+}
+
+
+void
+BinaryWriter::addScope(ANode* node, uint32_t parent)
+{
+  BinScope scope;
+  memset(&scope, 0, sizeof(scope));
+  scope.parent = parent;
+  scope.name2  = binNone;
+  scope.ref    = binNone;
+
+  ACodeNode* code = dynamic_cast<ACodeNode*>(node);
+  if (!code) {
+    DIAG_Throw("binary structure files do not support scope type "
+	       << ANode::ANodeTyToName(node->type()));
+  }
+
+  scope.begLine = code->begLine();
+  scope.endLine = code->endLine();
+  scope.origId  = node->m_origId;
+
+  uint32_t idx = binIndex(m_scopes.size(), "scopes");
+
+  switch (node->type()) {
+  case ANode::TyLM:
+    scope.type = BinTyLM;
+    scope.name = stringId(node->name());
+    break;
+  case ANode::TyFile:
+    scope.type = BinTyFile;
+    scope.name = stringId(node->name());
+    break;
+  case ANode::TyProc: {
+    Proc* proc = dynamic_cast<Proc*>(node);
+    scope.type  = BinTyProc;
+    scope.name  = stringId(proc->name());
+    scope.name2 = stringId(proc->linkName());
+    addRanges(scope, proc);
+    m_procIdx[proc] = idx;
+    break;
+  }
+  case ANode::TyAlien: {
+    Alien* alien = dynamic_cast<Alien*>(node);
+    scope.type  = BinTyAlien;
+    scope.name  = stringId(alien->name());
+    scope.name2 = stringId(alien->fileName());
+    if (alien->proc()) {
+      m_alienRefs.push_back(std::make_pair(idx, alien->proc()));
+    }
+    break;
+  }
+  case ANode::TyLoop: {
+    Loop* loop = dynamic_cast<Loop*>(node);
+    scope.type  = BinTyLoop;
+    scope.name  = binNone;
+    scope.name2 = stringId(loop->fileName());
+    addRanges(scope, loop);
+    break;
+  }
+  case ANode::TyStmt: {
+    Stmt* stmt = dynamic_cast<Stmt*>(node);
+    scope.name = binNone;
+    if (stmt->stmtType() == Stmt::STMT_CALL) {
+      scope.type   = BinTyCall;
+      scope.target = stmt->target();
+      if (!stmt->device().empty()) {
+	scope.name2 = stringId(stmt->device());
+      }
+    }
+    else {
+      scope.type = BinTyStmt;
+    }
+    addRanges(scope, stmt);
+    break;
+  }
+  default:
+    DIAG_Throw("binary structure files do not support scope type "
+	       << ANode::ANodeTyToName(node->type()));
+  }
+
+  m_scopes.push_back(scope);
+
+  for (ANode* x = node->firstChild(); x; x = x->nextSibling()) {
+    addScope(x, idx);
+  }
+}
+
+
+void
+BinaryWriter::addRanges(BinScope& scope, ACodeNode* node)
+{
+  const VMAIntervalSet& vmaset = node->vmaSet();
+
+  scope.rangeBeg = binIndex(m_ranges.size(), "vma ranges");
+  scope.rangeCnt = binIndex(vmaset.size(), "vma ranges");
+  binIndex((uint64_t)scope.rangeBeg + scope.rangeCnt, "vma ranges");
+  for (VMAIntervalSet::const_iterator it = vmaset.begin();
+       it != vmaset.end(); ++it) {
+    BinRange rng = { it->beg(), it->end() };
+    m_ranges.push_back(rng);
+  }
+}
+
+
+void
+BinaryWriter::writePadding(std::ostream& os, uint64_t pos)
+{
+  static const char zeros[8] = { 0 };
+  os.write(zeros, binAlign(pos) - pos);
+}
+
+} // namespace anonymous
+
+
+void
+writeBinary(std::ostream& os, const Tree& structure)
+{
+  BinaryWriter writer;
+  writer.write(os, structure);
+}
+
+
+//***************************************************************************
+// readBinary
+//***************************************************************************
+
+namespace {
+
+class BinaryReader {
+public:
+  BinaryReader(Tree& structure, const char* filenm,
+	       const char* base, uint64_t size,
+	       const BinaryRealPathFn& realpath)
+    : m_structure(structure), m_filenm(filenm),
+      m_base(base), m_size(size), m_realpath(realpath)
+  { }
+
+  void
+  read();
+
+private:
+  void
+  checkHeader();
+
+  void
+  checkSection(uint64_t off, uint64_t num, uint64_t elemSz);
+
+  const char*
+  str(uint32_t id);
+
+  const string&
+  realStr(uint32_t id);
+
+  ANode*
+  makeScope(const BinScope& scope, ANode* parent);
+
+  void
+  addRanges(ACodeNode* node, const BinScope& scope);
+
+  Tree&                    m_structure;
+  const char*              m_filenm;
+  const char*              m_base;
+  uint64_t                 m_size;
+  const BinaryRealPathFn&  m_realpath;
+
+  BinHeader                m_hdr;
+  const uint32_t*          m_strOffsets;
+  const char*              m_strData;
+  const BinScope*          m_scopes;
+  const BinRange*          m_ranges;
+
+  std::vector<string>      m_realStrs;
+  std::vector<bool>        m_haveRealStr;
+};
+
+
+#define BIN_CHECK(expr)							\
+  if (!(expr)) {							\
+    DIAG_Throw("malformed binary structure file '" << m_filenm << "'"); \
+  }
+
+
+void
+BinaryReader::read()
+{
+  checkHeader();
+
+  Root* root = m_structure.root();
+  std::vector<ANode*> nodes(m_hdr.nScopes, (ANode*)NULL);
+
+  for (uint64_t i = 0; i < m_hdr.nScopes; ++i) {
+    const BinScope& scope = m_scopes[i];
+    BIN_CHECK(scope.parent == binNone || scope.parent < i);
+    BIN_CHECK(scope.name == binNone || scope.name < m_hdr.nStrings);
+    BIN_CHECK(scope.name2 == binNone || scope.name2 < m_hdr.nStrings);
+    BIN_CHECK(scope.rangeBeg <= m_hdr.nRanges
+	      && scope.rangeCnt <= m_hdr.nRanges - scope.rangeBeg);
+
+    ANode* parent = (scope.parent == binNone) ? root : nodes[scope.parent];
+    nodes[i] = makeScope(scope, parent);
+  }
+
+  // resolve Alien -> Proc references
+  for (uint64_t i = 0; i < m_hdr.nScopes; ++i) {
+    const BinScope& scope = m_scopes[i];
+    if (scope.type == BinTyAlien && scope.ref != binNone) {
+      BIN_CHECK(scope.ref < m_hdr.nScopes);
+      Alien* alien = dynamic_cast<Alien*>(nodes[i]);
+      alien->proc(dynamic_cast<Proc*>(nodes[scope.ref]));
+    }
+  }
+}
+
+
+void
+BinaryReader::checkHeader()
+{
+  BIN_CHECK(m_size >= sizeof(BinHeader));
+  memcpy(&m_hdr, m_base, sizeof(m_hdr));
+
+  BIN_CHECK(memcmp(m_hdr.magic, binMagic, sizeof(binMagic)) == 0);
+  if (m_hdr.byteOrder != binByteOrder) {
+    DIAG_Throw("binary structure file '" << m_filenm
+	       << "' was written on a host with a different byte order");
+  }
+  if (m_hdr.version != binVersion) {
+    DIAG_Throw("binary structure file '" << m_filenm
+	       << "' has unsupported version " << m_hdr.version);
+  }
+
+  checkSection(m_hdr.strOffsetsOff, m_hdr.nStrings, sizeof(uint32_t));
+  checkSection(m_hdr.strDataOff, m_hdr.strDataSz, 1);
+  checkSection(m_hdr.scopesOff, m_hdr.nScopes, sizeof(BinScope));
+  checkSection(m_hdr.rangesOff, m_hdr.nRanges, sizeof(BinRange));
+
+  m_strOffsets = (const uint32_t*)(m_base + m_hdr.strOffsetsOff);
+  m_strData    = m_base + m_hdr.strDataOff;
+  m_scopes     = (const BinScope*)(m_base + m_hdr.scopesOff);
+  m_ranges     = (const BinRange*)(m_base + m_hdr.rangesOff);
+
+  // every string must be NUL-terminated within the string data
+  BIN_CHECK(m_hdr.nStrings == 0
+	    || (m_hdr.strDataSz > 0 && m_strData[m_hdr.strDataSz - 1] == '\0'));
+  for (uint64_t i = 0; i < m_hdr.nStrings; ++i) {
+    BIN_CHECK(m_strOffsets[i] < m_hdr.strDataSz);
+  }
+
+  m_realStrs.resize(m_hdr.nStrings);
+  m_haveRealStr.resize(m_hdr.nStrings, false);
+}
+
+
+void
+BinaryReader::checkSection(uint64_t off, uint64_t num, uint64_t elemSz)
+{
+  BIN_CHECK(off % 8 == 0 && off <= m_size);
+  BIN_CHECK(num <= (m_size - off) / elemSz);
+}
+
+
+const char*
+BinaryReader::str(uint32_t id)
+{
+  BIN_CHECK(id != binNone);
+  return m_strData + m_strOffsets[id];
+}
+
+
+// Many scopes share a file name; apply 'realpath' once per string.
+const string&
+BinaryReader::realStr(uint32_t id)
+{
+  BIN_CHECK(id != binNone);
+  if (!m_haveRealStr[id]) {
+    m_realStrs[id] = m_realpath(str(id));
+    m_haveRealStr[id] = true;
+  }
+  return m_realStrs[id];
+}
+
+
+// Mirrors PGMDocHandler::startElement().
+ANode*
+BinaryReader::makeScope(const BinScope& scope, ANode* parent)
+{
+  ANode::ANodeTy parentTy = parent->type();
+  bool inProc = (parentTy == ANode::TyProc || parentTy == ANode::TyAlien
+		 || parentTy == ANode::TyLoop);
+
+  switch (scope.type) {
+  case BinTyLM: {
+    BIN_CHECK(parentTy == ANode::TyRoot);
+    return LM::demand(m_structure.root(), realStr(scope.name));
+  }
+
+  case BinTyFile: {
+    BIN_CHECK(parentTy == ANode::TyLM);
+    return File::demand(static_cast<LM*>(parent), realStr(scope.name));
+  }
+
+  case BinTyProc: {
+    BIN_CHECK(parentTy == ANode::TyFile);
+    File* file = static_cast<File*>(parent);
+    const char* nm = str(scope.name);
+
+    // Assume that VMA information fully qualifies procedures.
+    Proc* proc = file->findProc(nm);
+    if (proc && !proc->vmaSet().empty() && scope.rangeCnt > 0) {
+      proc = NULL;
+    }
+
+    if (!proc) {
+      const char* lnm = (scope.name2 == binNone) ? "" : str(scope.name2);
+      proc = new Proc(nm, file, lnm, false, scope.begLine, scope.endLine);
+      addRanges(proc, scope);
+      proc->m_origId = scope.origId;
+    }
+    else {
+      DIAG_Msg(0, "Warning: Found procedure '" << nm << "' multiple times within file '" << file->name() << "'; information for this procedure will be aggregated. If you do not want this, edit the STRUCTURE file and adjust the names by hand.");
+    }
+    return proc;
+  }
+
+  case BinTyAlien: {
+    BIN_CHECK(inProc);
+    const char* nm = str(scope.name);
+    Alien* alien = new Alien(static_cast<ACodeNode*>(parent),
+			     realStr(scope.name2), nm, nm,
+			     scope.begLine, scope.endLine);
+    alien->m_origId = scope.origId;
+    return alien;
+  }
+
+  case BinTyLoop: {
+    BIN_CHECK(inProc);
+    string fnm = realStr(scope.name2);
+    Loop* loop = new Loop(static_cast<ACodeNode*>(parent), fnm,
+			  scope.begLine, scope.endLine);
+    loop->m_origId = scope.origId;
+    addRanges(loop, scope);
+    return loop;
+  }
+
+  case BinTyStmt:
+  case BinTyCall: {
+    BIN_CHECK(inProc);
+    Stmt::StmtType ty =
+      (scope.type == BinTyCall) ? Stmt::STMT_CALL : Stmt::STMT_STMT;
+    Stmt* stmt = new Stmt(static_cast<ACodeNode*>(parent),
+			  scope.begLine, scope.endLine, 0, 0, ty);
+    addRanges(stmt, scope);
+    if (scope.type == BinTyCall) {
+      stmt->target(scope.target);
+      if (scope.name2 != binNone) {
+	stmt->device(str(scope.name2));
+      }
+    }
+    stmt->m_origId = scope.origId;
+    return stmt;
+  }
+
+  default:
+    BIN_CHECK(false);
+  }
+  return NULL;
+}
+
+
+void
+BinaryReader::addRanges(ACodeNode* node, const BinScope& scope)
+{
+  for (uint32_t i = 0; i < scope.rangeCnt; ++i) {
+    const BinRange& rng = m_ranges[scope.rangeBeg + i];
+    node->vmaSet().insert(rng.beg, rng.end);
+  }
+}
+
+#undef BIN_CHECK
+
+} // namespace anonymous
+
+
+void
+readBinary(Tree& structure, const char* filenm,
+	   const BinaryRealPathFn& realpath)
+{
+  int fd = open(filenm, O_RDONLY);
+  if (fd < 0) {
+    DIAG_Throw("unable to open structure file '" << filenm << "'");
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || sb.st_size == 0) {
+    close(fd);
+    DIAG_Throw("unable to read structure file '" << filenm << "'");
+  }
+
+  void* base = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    DIAG_Throw("unable to map structure file '" << filenm << "'");
+  }
+
+  try {
+    BinaryReader reader(structure, filenm, (const char*)base, sb.st_size,
+			realpath);
+    reader.read();
+  }
+  catch (...) {
+    munmap(base, sb.st_size);
+    throw;
+  }
+
+  munmap(base, sb.st_size);
+}
+
+
+} // namespace Struct
+
+} // namespace Prof
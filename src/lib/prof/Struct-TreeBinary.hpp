@@ -0,0 +1,125 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Binary, mmap-able representation of a Struct::Tree.
+//
+// Description:
+//   A binary structure file holds the same information as an
+//   hpcstruct XML file, laid out so that a reader can map it and
+//   build a Struct::Tree without parsing:
+//
+//     header | string offsets | string data | scopes | vma ranges
+//
+//   Each section begins on an 8-byte boundary.  Strings are
+//   NUL-terminated and shared between scopes.  Scopes are fixed-size
+//   records in document (preorder) order, so that a scope's parent
+//   always precedes it; a scope's vma ranges are a contiguous slice
+//   of the range array.  Integers are stored in host byte order; the
+//   header's byte-order word rejects files from a foreign host.
+//
+//***************************************************************************
+
+#ifndef prof_Prof_Struct_TreeBinary_hpp
+#define prof_Prof_Struct_TreeBinary_hpp
+
+//************************* System Include Files ****************************
+
+#include <iostream>
+#include <string>
+#include <functional>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "Struct-Tree.hpp"
+
+//*************************** Forward Declarations **************************
+
+//***************************************************************************
+
+namespace Prof {
+
+namespace Struct {
+
+// maps a file name found in the structure file to the name to use
+// in the tree (cf. DocHandlerArgs::realpath)
+typedef std::function<std::string (const std::string&)> BinaryRealPathFn;
+
+
+// isBinaryFile: true if 'filenm' begins with the binary structure
+// file magic.
+bool
+isBinaryFile(const char* filenm);
+
+
+// writeBinary: Write 'structure' to 'os' in binary form.  Group and
+// Ref scopes (which hpcstruct does not generate) are not supported.
+void
+writeBinary(std::ostream& os, const Tree& structure);
+
+
+// readBinary: Map the binary structure file 'filenm' and merge its
+// contents into 'structure', exactly as reading the corresponding
+// XML file would.  Throws on a malformed file.
+void
+readBinary(Tree& structure, const char* filenm,
+	   const BinaryRealPathFn& realpath);
+
+
+} // namespace Struct
+
+} // namespace Prof
+
+//***************************************************************************
+
+#endif /* prof_Prof_Struct_TreeBinary_hpp */
@@ -0,0 +1,242 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Check Profile::bin_merge() against Profile::merge().
+//
+// Description:
+//   x has a call site A with a leaf under it.  y has, under A, two
+//   interior call sites with metrics of their own: B, which is new to
+//   x, and C, at the address of an existing leaf of x.  Merging y as
+//   read from an hpcrun-fmt file (where cct_makeNode() splits each of
+//   B and C into an interior node and a leaf sibling) must give the
+//   same CCT as merging y's bin_pack() buffer with bin_merge().
+//
+//   Built and run by 'make check' in src/tool/hpcprof.
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <lib/prof/CallPath-Profile.hpp>
+#include <lib/prof/CCT-Tree.hpp>
+#include <lib/prof/Metric-ADesc.hpp>
+
+using namespace Prof;
+using std::string;
+
+//***************************************************************************
+
+// lib/prof leaves prof_abort to the tool (see hpcprof's main.cpp)
+void
+prof_abort
+(
+  int error_code
+)
+{
+  exit(error_code);
+}
+
+
+//***************************************************************************
+
+static const VMA ipA = 0x100, ipA_leaf = 0x108;
+static const VMA ipB = 0x200, ipB_leaf = 0x208;
+static const VMA ipC = 0x300, ipC_leaf = 0x308;
+
+
+static CCT::ADynNode*
+addNode(CCT::ANode* parent, bool isLeaf, VMA ip, double val)
+{
+  Metric::IData metrics(1);
+  metrics.metric(0) = val;
+  if (isLeaf) {
+    return new CCT::Stmt(parent, HPCRUN_FMT_CCTNodeId_NULL,
+			 lush_assoc_info_NULL, 1, ip, 0, NULL, metrics);
+  }
+  return new CCT::Call(parent, HPCRUN_FMT_CCTNodeId_NULL,
+		       lush_assoc_info_NULL, 1, ip, 0, NULL, metrics);
+}
+
+
+static CallPath::Profile*
+makeProfile(bool isY)
+{
+  CallPath::Profile* prof = CallPath::Profile::make(0);
+  prof->metricMgr()->insert(new Metric::SampledDesc("cycles", "", 1, false,
+						    "", "", ""));
+  prof->loadmap()->lm_insert(new LoadMap::LM("/test/a.out"));
+
+  CCT::ANode* a = addNode(prof->cct()->root(), false, ipA, 0);
+  if (!isY) {
+    addNode(a, true, ipA_leaf, 1);
+    addNode(a, true, ipC, 2);
+  }
+  else {
+    CCT::ANode* b = addNode(a, false, ipB, 3); // interior with metrics
+    addNode(b, true, ipB_leaf, 5);
+    CCT::ANode* c = addNode(a, false, ipC, 7); // interior with metrics
+    addNode(c, true, ipC_leaf, 11);
+  }
+  return prof;
+}
+
+
+// write 'prof' as an hpcrun-fmt file and read it back, as hpcprof
+// reads measurement files
+static CallPath::Profile*
+roundTrip(const CallPath::Profile& prof)
+{
+  char fnm[] = "/tmp/hpcprof-mergeXXXXXX";
+  int fd = mkstemp(fnm);
+  assert(fd >= 0);
+  FILE* fs = fdopen(fd, "w");
+  assert(fs);
+  int ret = CallPath::Profile::fmt_fwrite(prof, fs, 0);
+  assert(ret == HPCFMT_OK);
+  fclose(fs);
+
+  CallPath::Profile* x = CallPath::Profile::make(fnm, 0, NULL);
+  unlink(fnm);
+  return x;
+}
+
+
+// A description of the subtree at 'n' that is independent of sibling
+// order and of cpIds.
+static string
+canonical(const CallPath::Profile& prof, const CCT::ANode* n)
+{
+  std::ostringstream os;
+  os << CCT::ANode::ANodeTyToName(n->type());
+
+  const CCT::ADynNode* n_dyn = dynamic_cast<const CCT::ADynNode*>(n);
+  if (n_dyn) {
+    os << " " << prof.loadmap()->lm(n_dyn->lmId())->name()
+       << ":0x" << std::hex << n_dyn->lmIP() << std::dec;
+  }
+  for (uint i = 0; i < n->numMetrics(); ++i) {
+    if (n->hasMetric(i)) {
+      os << " m" << i << "=" << n->metric(i);
+    }
+  }
+
+  std::vector<string> kids;
+  for (CCT::ANodeChildIterator it(n); it.Current(); ++it) {
+    kids.push_back(canonical(prof, it.current()));
+  }
+  std::sort(kids.begin(), kids.end());
+
+  os << " {";
+  for (uint i = 0; i < kids.size(); ++i) {
+    os << " " << kids[i];
+  }
+  os << " }";
+  return os.str();
+}
+
+
+int
+main(int argc, char** argv)
+{
+  CallPath::Profile* x_mem = makeProfile(false);
+  CallPath::Profile* y_mem = makeProfile(true);
+
+  const int mergeTy = CallPath::Profile::Merge_MergeMetricByName;
+
+  // reference: merge the CCT read from an hpcrun-fmt file
+  CallPath::Profile* x_ref = roundTrip(*x_mem);
+  CallPath::Profile* y_ref = roundTrip(*y_mem);
+  x_ref->merge(*y_ref, mergeTy);
+
+  // bin_merge: merge straight from y's unsplit bin_pack() buffer
+  uint8_t* buf = NULL;
+  size_t bufSz = 0;
+  CallPath::Profile::bin_pack(*y_mem, 0, &buf, &bufSz);
+
+  CallPath::Profile* x_bin = roundTrip(*x_mem);
+  CallPath::Profile* y_bin =
+    CallPath::Profile::bin_unpack(buf, bufSz, 0, false/*doReadCCT*/);
+  x_bin->bin_merge(*y_bin, buf, bufSz, mergeTy);
+  free(buf);
+
+  string ref = canonical(*x_ref, x_ref->cct()->root());
+  string bin = canonical(*x_bin, x_bin->cct()->root());
+  if (ref != bin) {
+    std::cerr << "merge:     " << ref << "\n"
+	      << "bin_merge: " << bin << std::endl;
+  }
+  assert(ref == bin);
+
+  // B's metrics stay on a leaf beside the new interior node B
+  assert(ref.find("S /test/a.out:0x200 m0=3 { }") != string::npos);
+
+  std::cout << "bin_merge == merge: ok" << std::endl;
+
+  delete x_mem;
+  delete y_mem;
+  delete x_ref;
+  delete y_ref;
+  delete x_bin;
+  delete y_bin;
+  return 0;
+}
@@ -0,0 +1,265 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Round-trip check for binary structure files.
+//
+// Description:
+//   Reads an hpcstruct XML file into a Struct::Tree, writes that tree
+//   with writeBinary, reads the binary file back with readStructure
+//   (which maps it with readBinary) and checks that both trees agree
+//   scope by scope: type, names, line range, vma ranges, call target
+//   and device, and each Alien's Proc.  Without arguments a small
+//   built-in structure file with every scope type is used; otherwise
+//   each argument is an hpcstruct XML file to check.
+//
+//   Built and run (on the built-in file) by 'make check' in
+//   src/tool/hpcprof:
+//     ./Struct-TreeBinary_test [file.hpcstruct ...]
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <lib/prof/Struct-Tree.hpp>
+#include <lib/prof/Struct-TreeBinary.hpp>
+#include <lib/profxml/PGMReader.hpp>
+
+using namespace Prof::Struct;
+using std::string;
+
+static const char* structureDTD =
+#include <lib/xml/hpc-structure.dtd.h>
+;
+
+// every scope type hpcstruct writes, including an Alien that refers
+// to its Proc, a call with a target and device, and a Proc whose
+// link name differs from its name
+static const char* sampleBody =
+  "<HPCToolkitStructure i=\"0\" version=\"4.7\" n=\"\">\n"
+  "<LM i=\"1\" n=\"/tmp/a.out\" v=\"{}\">\n"
+  "<F i=\"2\" n=\"/src/util.h\">\n"
+  "<P i=\"3\" n=\"helper\" l=\"1\" v=\"{[0x400300-0x400340)}\">\n"
+  "<S i=\"4\" l=\"3\" v=\"{[0x400300-0x400340)}\"/>\n"
+  "</P>\n"
+  "</F>\n"
+  "<F i=\"5\" n=\"/src/main.c\">\n"
+  "<P i=\"6\" n=\"main\" ln=\"_main\" l=\"10\" v=\"{[0x400100-0x400200)}\">\n"
+  "<S i=\"7\" l=\"11\" v=\"{[0x400100-0x400108)}\"/>\n"
+  "<L i=\"8\" l=\"12\" f=\"/src/main.c\" v=\"{[0x400108-0x400110)}\">\n"
+  "<S i=\"9\" l=\"13\" v=\"{[0x400110-0x400118) [0x400140-0x400148)}\"/>\n"
+  "<A i=\"10\" l=\"14\" f=\"/src/util.h\" n=\"helper\" ln=\"3\" v=\"{}\">\n"
+  "<S i=\"11\" l=\"3\" v=\"{[0x400118-0x400120)}\"/>\n"
+  "</A>\n"
+  "</L>\n"
+  "<C i=\"12\" l=\"15\" v=\"{[0x400120-0x400128)}\" t=\"0x400300\" d=\"gpu0\"/>\n"
+  "</P>\n"
+  "</F>\n"
+  "</LM>\n"
+  "</HPCToolkitStructure>\n";
+
+
+static void
+readTree(Tree& tree, const string& filenm)
+{
+  std::vector<string> files(1, filenm);
+  DocHandlerArgs docargs;
+  readStructure(tree, files, PGMDocHandler::Doc_STRUCT, docargs);
+}
+
+
+// preorder list of the scopes below the root
+static void
+flatten(ANode* node, std::vector<ANode*>& nodes)
+{
+  for (ANode* x = node->firstChild(); x; x = x->nextSibling()) {
+    nodes.push_back(x);
+    flatten(x, nodes);
+  }
+}
+
+
+static int
+parentIndex(ANode* node, std::map<ANode*, int>& index)
+{
+  return (node->parent()->type() == ANode::TyRoot)
+    ? -1 : index[node->parent()];
+}
+
+
+static void
+compareTrees(const Tree& xmlTree, const Tree& binTree)
+{
+  std::vector<ANode*> xs, bs;
+  flatten(xmlTree.root(), xs);
+  flatten(binTree.root(), bs);
+  assert(xs.size() == bs.size());
+
+  std::map<ANode*, int> xIndex, bIndex;
+  for (uint i = 0; i < xs.size(); ++i) {
+    xIndex[xs[i]] = i;
+    bIndex[bs[i]] = i;
+  }
+
+  for (uint i = 0; i < xs.size(); ++i) {
+    ANode* x = xs[i];
+    ANode* b = bs[i];
+
+    assert(x->type() == b->type());
+    assert(parentIndex(x, xIndex) == parentIndex(b, bIndex));
+    assert(x->name() == b->name());
+    assert(x->m_origId == b->m_origId);
+
+    ACodeNode* xc = dynamic_cast<ACodeNode*>(x);
+    ACodeNode* bc = dynamic_cast<ACodeNode*>(b);
+    assert(xc && bc);
+    assert(xc->begLine() == bc->begLine());
+    assert(xc->endLine() == bc->endLine());
+    assert(xc->vmaSet().toString() == bc->vmaSet().toString());
+
+    switch (x->type()) {
+    case ANode::TyProc:
+      assert(dynamic_cast<Proc*>(x)->linkName()
+	     == dynamic_cast<Proc*>(b)->linkName());
+      break;
+    case ANode::TyAlien: {
+      Alien* xa = dynamic_cast<Alien*>(x);
+      Alien* ba = dynamic_cast<Alien*>(b);
+      assert(xa->fileName() == ba->fileName());
+      assert(xa->displayName() == ba->displayName());
+      assert((xa->proc() == NULL) == (ba->proc() == NULL));
+      if (xa->proc()) {
+	assert(xIndex[xa->proc()] == bIndex[ba->proc()]);
+      }
+      break;
+    }
+    case ANode::TyLoop:
+      assert(dynamic_cast<Loop*>(x)->fileName()
+	     == dynamic_cast<Loop*>(b)->fileName());
+      break;
+    case ANode::TyStmt: {
+      Stmt* xst = dynamic_cast<Stmt*>(x);
+      Stmt* bst = dynamic_cast<Stmt*>(b);
+      assert(xst->stmtType() == bst->stmtType());
+      assert(xst->target() == bst->target());
+      assert(xst->device() == bst->device());
+      break;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+
+static void
+roundTrip(const string& xmlFile)
+{
+  Tree xmlTree("");
+  readTree(xmlTree, xmlFile);
+
+  char binFile[] = "/tmp/hpcstruct-binXXXXXX";
+  int fd = mkstemp(binFile);
+  assert(fd >= 0);
+  close(fd);
+
+  {
+    std::ofstream os(binFile, std::ios::binary);
+    writeBinary(os, xmlTree);
+    assert(os);
+  }
+  assert(isBinaryFile(binFile));
+
+  Tree binTree("");
+  readTree(binTree, binFile);
+  unlink(binFile);
+
+  compareTrees(xmlTree, binTree);
+  std::cout << xmlFile << ": ok" << std::endl;
+}
+
+
+int
+main(int argc, char** argv)
+{
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      roundTrip(argv[i]);
+    }
+    return 0;
+  }
+
+  char xmlFile[] = "/tmp/hpcstruct-xmlXXXXXX";
+  int fd = mkstemp(xmlFile);
+  assert(fd >= 0);
+  close(fd);
+  {
+    std::ofstream os(xmlFile);
+    os << "<?xml version=\"1.0\"?>\n"
+       << "<!DOCTYPE HPCToolkitStructure [\n" << structureDTD << "]>\n"
+       << sampleBody;
+  }
+
+  roundTrip(xmlFile);
+  unlink(xmlFile);
+  return 0;
+}
@@ -78,6 +78,8 @@ using std::string;
 #include "PGMReader.hpp"
 #include "XercesUtil.hpp"
 
+#include <lib/prof/Struct-TreeBinary.hpp>
+
 //*********************** Xerces Include Files *******************************
 
 #include <xercesc/util/XMLString.hpp>
@@ -166,6 +168,15 @@ read_PGM(Struct::Tree& structure,
   string docType = PGMDocHandler::ToString(docty);
 
 
+  // Binary structure files (hpcstruct --convert) are mapped directly
+  // and do not need Xerces.
+  if (docty == PGMDocHandler::Doc_STRUCT && isBinaryFile(filenm)) {
+    using namespace std::placeholders;
+    readBinary(structure, filenm,
+	       std::bind(&DocHandlerArgs::realpath, &docHandlerArgs, _1));
+    return;
+  }
+
   if (!fpath.empty()) {
     if (xmlSanityCheck(filenm, docType)) {
       return;
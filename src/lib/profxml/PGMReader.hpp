@@ -62,6 +62,7 @@
 
 //************************ System Include Files ******************************
 
+#include <string>
 #include <vector>
 
 //************************* User Include Files *******************************
@@ -79,7 +80,7 @@ namespace Struct {
 
 void
 readStructure(Tree& structure, 
-	      const std::vector<string>& structureFiles,
+	      const std::vector<std::string>& structureFiles,
 	      PGMDocHandler::Doc_t docty, 
 	      DocHandlerArgs& docargs);
 
@@ -62,6 +62,8 @@
 #include <string>
 using std::string;
 
+#include <mutex>
+
 
 //*************************** User Include Files ****************************
 
@@ -86,6 +88,9 @@ using std::string;
 
 static RealPathMgr s_singleton;
 
+// realpath() may be called concurrently (cf. Analysis::CallPath::read)
+static std::mutex s_cacheLock;
+
 
 // Constructor with static singleton objects for PathFindMgr and
 // PathReplacementMgr.
@@ -132,6 +137,8 @@ RealPathMgr::realpath(string& pathNm) const
   
   // INVARIANT: 'pathNm' is not empty
 
+  std::lock_guard<std::mutex> guard(s_cacheLock);
+
   // INVARIANT: all entries in the map are non-empty
   MyMap::iterator it = m_cache.find(pathNm);
 
@@ -237,7 +237,9 @@ toDbl(const char* str, unsigned* endidx)
 //
 // --------------------------------------------------------------------------
 
-static char buf[32];
+// Each conversion formats into its own buffer on the stack: these are
+// called concurrently, e.g. by hpcprof's profile reader threads.
+#define TOSTR_BUF_SZ 32
 
 string
 toStr(const int x, int base)
@@ -253,6 +255,7 @@ toStr(const int x, int base)
     DIAG_Die(DIAG_Unimplemented);
   }
   
+  char buf[TOSTR_BUF_SZ];
   sprintf(buf, format, x);
   return string(buf);
 }
@@ -280,6 +283,7 @@ toStr(const unsigned x, int base)
     DIAG_Die(DIAG_Unimplemented);
   }
   
+  char buf[TOSTR_BUF_SZ];
   sprintf(buf, format, x);
   return string(buf);
 }
@@ -303,6 +307,7 @@ toStr(const int64_t x, int base)
     DIAG_Die(DIAG_Unimplemented);
   }
   
+  char buf[TOSTR_BUF_SZ];
   sprintf(buf, format, x);
   return string(buf);
 }
@@ -326,6 +331,7 @@ toStr(const uint64_t x, int base)
     DIAG_Die(DIAG_Unimplemented);
   }
   
+  char buf[TOSTR_BUF_SZ];
   sprintf(buf, format, x);
   return string(buf);
 }
@@ -334,6 +340,7 @@ toStr(const uint64_t x, int base)
 string
 toStr(const void* x, int GCC_ATTR_UNUSED base)
 {
+  char buf[TOSTR_BUF_SZ];
   sprintf(buf, "%p", x);
   return string(buf);
 }
@@ -342,8 +349,8 @@ toStr(const void* x, int GCC_ATTR_UNUSED base)
 string
 toStr(const double x, const char* format)
 {
-  //static char buf[19]; // 0xhhhhhhhhhhhhhhhh format
-  sprintf(buf, format, x);
+  char buf[TOSTR_BUF_SZ];
+  snprintf(buf, TOSTR_BUF_SZ, format, x);
   return string(buf);
 }
 
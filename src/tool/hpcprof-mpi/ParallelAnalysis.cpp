@@ -214,9 +214,12 @@ recvMerge(Prof::CallPath::Profile* profile,
   // receive profile from src
   uint8_t *profileBuf = new uint8_t[profileBufSz];
   MPI_Recv(profileBuf, profileBufSz, MPI_BYTE, src, src, comm, &mpistat);
+
+  // unpack only the meta data; the CCT is merged directly from the buffer
+  uint rFlags = Prof::CallPath::Profile::RFlg_VirtualMetrics;
   Prof::CallPath::Profile* new_profile =
-    unpackProfile(profileBuf, (size_t)profileBufSz);
-  delete[] profileBuf;
+    Prof::CallPath::Profile::bin_unpack(profileBuf, (size_t)profileBufSz,
+					rFlags, false/*doReadCCT*/);
 
   if (DBG_CCT_MERGE) {
     string pfx0 = "[" + StrUtil::toStr(myRank) + "]";
@@ -226,7 +229,9 @@ recvMerge(Prof::CallPath::Profile* profile,
   }
     
   int mergeTy = Prof::CallPath::Profile::Merge_MergeMetricByName;
-  profile->merge(*new_profile, mergeTy);
+  profile->bin_merge(*new_profile, profileBuf, (size_t)profileBufSz,
+		     mergeTy);
+  delete[] profileBuf;
 
   // merging the perf event statistics
   profile->metricMgr()->mergePerfEventStatistics(new_profile->metricMgr());
@@ -308,29 +313,17 @@ void
 packProfile(const Prof::CallPath::Profile& profile,
 	    uint8_t** buffer, size_t* bufferSz)
 {
-  // open_memstream: mallocs buffer and sets bufferSz
-  FILE* fs = open_memstream((char**)buffer, bufferSz);
-
+  // bin_pack: mallocs buffer and sets bufferSz
   uint wFlags = Prof::CallPath::Profile::WFlg_VirtualMetrics;
-  Prof::CallPath::Profile::fmt_fwrite(profile, fs, wFlags);
-
-  fclose(fs);
+  Prof::CallPath::Profile::bin_pack(profile, wFlags, buffer, bufferSz);
 }
 
 
 Prof::CallPath::Profile*
 unpackProfile(uint8_t* buffer, size_t bufferSz)
 {
-  FILE* fs = fmemopen(buffer, bufferSz, "r");
-
-  Prof::CallPath::Profile* prof = NULL;
   uint rFlags = Prof::CallPath::Profile::RFlg_VirtualMetrics;
-  Prof::CallPath::Profile::fmt_fread(prof, fs, rFlags,
-				     "(ParallelAnalysis::unpackProfile)",
-				     NULL, NULL);
-
-  fclose(fs);
-  return prof;
+  return Prof::CallPath::Profile::bin_unpack(buffer, bufferSz, rFlags);
 }
 
 
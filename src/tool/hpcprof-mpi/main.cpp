@@ -155,7 +155,7 @@ makeDBFileName(const string& dbDir, uint groupId, const string& profileFile);
 
 static void
 writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
-	       const string& metricDBFnm);
+	       const string& metricDBFnm, bool isSparse);
 
 
 static void
@@ -308,7 +308,8 @@ realmain(int argc, char* const* argv)
   Analysis::Util::UIntVec* groupMap =
     (nArgs.groupMax > 1) ? nArgs.groupMap : NULL;
 
-  profLcl = Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags);
+  profLcl = Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags,
+				     0 /*mrgFlags*/, args.prof_jobs);
 
   // -------------------------------------------------------
   // 1b. Create canonical CCT (metrics merged by <group>.<name>.*)
@@ -356,7 +357,7 @@ realmain(int argc, char* const* argv)
   bool printProgress =  (myRank == 0);
   Analysis::CallPath::overlayStaticStructureMain(*profGbl, args.agent,
 						 args.doNormalizeTy,
-                                                 printProgress);
+                                                 printProgress, args.prof_jobs);
 
   // N.B.: Dense ids are assigned w.r.t. Prof::CCT::...::cmpByStructureInfo()
   profGbl->cct()->makeDensePreorderIds();
@@ -946,7 +947,7 @@ makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
     // -------------------------------------------------------
 
     string dbFnm = makeDBFileName(args.db_dir, groupId, profileFile);
-    writeMetricsDB(profGbl, mBeg, mEnd, dbFnm);
+    writeMetricsDB(profGbl, mBeg, mEnd, dbFnm, args.db_metricDBSparse);
 
     // -------------------------------------------------------
     // reinitialize metric values for next time
@@ -974,10 +975,10 @@ makeDBFileName(const string& dbDir, uint groupId, const string& profileFile)
 }
 
 
-// [mBegId, mEndId)
-static void
-writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
-	       const string& metricDBFnm)
+// [mBegId, mEndId): write metric values as a dense row-major matrix
+static int
+writeMetricsDB_dense(Prof::CallPath::Profile& profGbl, uint mBegId,
+		     uint mEndId, FILE* fs)
 {
   const Prof::CCT::Tree& cct = *(profGbl.cct());
 
@@ -993,7 +994,82 @@ writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
 
   // -------------------------------------------------------
   // write data
+  //   - first row corresponds to node 1.
+  //   - first column corresponds to first sampled metric.
+  //   - rows [1, maxCCTId] are contiguous; write them as one block
+  // cf. ParallelAnalysis::unpackMetrics: 
   // -------------------------------------------------------
+  size_t numVals = (size_t)maxCCTId * packedMetrics.numMetrics();
+  if (numVals == 0) {
+    return HPCFMT_OK;
+  }
+
+  const double* vals = &packedMetrics.idx(1, 0);
+  return hpcfmt_int8v_fwrite((const uint64_t*)vals, numVals, fs);
+}
+
+
+// [mBegId, mEndId): write the non-zero metric values in
+// compressed-sparse-row form (cf. hpcmetricDB_fmt_sparse_t)
+static int
+writeMetricsDB_sparse(Prof::CallPath::Profile& profGbl, uint mBegId,
+		      uint mEndId, FILE* fs)
+{
+  const Prof::CCT::Tree& cct = *(profGbl.cct());
+
+  uint maxCCTId = cct.maxDenseId();
+
+  // rows must be written in node-id order
+  vector<Prof::CCT::ANode*> nodes(maxCCTId + 1, NULL);
+  for (Prof::CCT::ANodeIterator it(cct.root()); it.Current(); ++it) {
+    Prof::CCT::ANode* n = it.current();
+    nodes[n->id()] = n;
+  }
+
+  vector<uint32_t> rowNodeId;
+  vector<uint64_t> rowPtr(1, 0);
+  vector<double>   value;
+  vector<uint32_t> metricId;
+
+  for (uint nodeId = 1; nodeId <= maxCCTId; ++nodeId) {
+    Prof::CCT::ANode* n = nodes[nodeId];
+    if (!n) {
+      continue;
+    }
+
+    size_t rowBeg = value.size();
+    for (uint mId1 = 0, mId2 = mBegId; mId2 < mEndId; ++mId1, ++mId2) {
+      double mval = n->metric(mId2);
+      if (mval != 0.0) {
+	value.push_back(mval);
+	metricId.push_back(mId1);
+      }
+    }
+
+    if (value.size() > rowBeg) {
+      rowNodeId.push_back(nodeId);
+      rowPtr.push_back(value.size());
+    }
+  }
+
+  hpcmetricDB_fmt_sparse_t sparse;
+  sparse.numRows   = rowNodeId.size();
+  sparse.numNZ     = value.size();
+  sparse.rowNodeId = rowNodeId.data();
+  sparse.rowPtr    = rowPtr.data();
+  sparse.value     = value.data();
+  sparse.metricId  = metricId.data();
+
+  return hpcmetricDB_fmt_sparse_fwrite(&sparse, fs);
+}
+
+
+// [mBegId, mEndId)
+static void
+writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
+	       const string& metricDBFnm, bool isSparse)
+{
+  const Prof::CCT::Tree& cct = *(profGbl.cct());
 
   FILE* fs = hpcio_fopen_w(metricDBFnm.c_str(), 1);
   if (!fs) {
@@ -1007,30 +1083,23 @@ writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
   }
   DIAG_MsgIf(0, "writeMetricsDB: " << metricDBFnm);
 
-  uint numNodes = packedMetrics.numNodes() - 1;
-
   // 1. header
   hpcmetricDB_fmt_hdr_t hdr;
-  hdr.numNodes = numNodes;
-  hdr.numMetrics = mEndId - mBegId; // [mBegId mEndId)
+  hpcmetricDB_fmt_hdr_init(&hdr, isSparse, cct.maxDenseId(),
+			   mEndId - mBegId); // [mBegId mEndId)
 
   int ret;
   ret = hpcmetricDB_fmt_hdr_fwrite(&hdr, fs);
   if (ret == HPCFMT_ERR) goto badwrite;
 
   // 2. metric values
-  //    - first row corresponds to node 1.
-  //    - first column corresponds to first sampled metric.
-  // cf. ParallelAnalysis::unpackMetrics: 
-
-  for (uint nodeId = 1; nodeId < numNodes + 1; ++nodeId) {
-    for (uint mId1 = 0, mId2 = mBegId; mId2 < mEndId; ++mId1, ++mId2) {
-      double mval = packedMetrics.idx(nodeId, mId1);
-      DIAG_MsgIf(0,  "  " << nodeId << " -> " << mval);
-      ret = hpcfmt_real8_fwrite(mval, fs);
-      if (ret == HPCFMT_ERR) goto badwrite;
-    }
+  if (isSparse) {
+    ret = writeMetricsDB_sparse(profGbl, mBegId, mEndId, fs);
   }
+  else {
+    ret = writeMetricsDB_dense(profGbl, mBegId, mEndId, fs);
+  }
+  if (ret == HPCFMT_ERR) goto badwrite;
 
   hpcio_fclose(fs);
   return;
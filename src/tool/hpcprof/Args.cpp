@@ -113,6 +113,7 @@ Args::parse(int argc, const char* const argv[])
 
   // Currently, hpcprof does not generate thread-level metric db
   db_makeMetricDB = false;
+  db_metricDBSparse = false;
 }
 
 
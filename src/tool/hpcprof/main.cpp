@@ -179,7 +179,8 @@ realmain(int argc, char* const* argv)
   uint mrgFlags = (Prof::CCT::MrgFlg_NormalizeTraceFileY);
 
   Prof::CallPath::Profile* prof =
-    Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags, mrgFlags);
+    Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags, mrgFlags,
+			     args.prof_jobs);
 
   prof->disable_redundancy(args.remove_redundancy);
 
@@ -203,7 +204,8 @@ realmain(int argc, char* const* argv)
   bool printProgress = true;
 
   Analysis::CallPath::overlayStaticStructureMain(*prof, args.agent,
-						 args.doNormalizeTy, printProgress);
+						 args.doNormalizeTy, printProgress,
+						 args.prof_jobs);
 
   Analysis::CallPath::transformCudaCFGMain(*prof);
   
@@ -0,0 +1,255 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Multithreaded stress test and benchmark for the memleak footer table.
+//
+// Description:
+//   Each thread mallocs and frees blocks in a random pattern, inserting
+//   every live block into the table (or, on a full probe sequence, into
+//   its own overflow list, as memleak does with the splay tree) and
+//   deleting it again on free.  Deletes must return exactly the value
+//   inserted for that block.  After the threads join, the table must
+//   hold exactly the blocks the threads still own, and must be free of
+//   live keys once those are deleted.
+//
+//   The same workload is then timed with every table operation under
+//   one global mutex, the way footer blocks were serialized before.
+//
+//   Built and run (with a small workload) by 'make check':
+//     ./memleak_table_test [num-threads] [ops-per-thread]
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <lib/prof-lean/usec_time.h>
+
+#include <sample-sources/memleak-table.h>
+
+//***************************************************************************
+
+#define LIVE_MAX  1024
+
+typedef struct thread_arg_s {
+  long tid;
+  long ops;
+  int use_lock;
+  void *live[LIVE_MAX];    // blocks this thread still owns
+  int num_live;
+  long num_overflow;       // live blocks kept outside the table
+  char overflow[LIVE_MAX];
+} thread_arg_t;
+
+static memleak_table_t table = { .key = NULL, .val = NULL };
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// the value stored for a block: unique per block and thread
+static void *
+block_val(thread_arg_t *arg, void *block)
+{
+  return (void *) ((uintptr_t) block ^ ((uintptr_t) arg->tid << 48));
+}
+
+
+static int
+table_insert(thread_arg_t *arg, void *block)
+{
+  int ret;
+  if (arg->use_lock) pthread_mutex_lock(&table_lock);
+  ret = memleak_table_insert(&table, block, block_val(arg, block));
+  if (arg->use_lock) pthread_mutex_unlock(&table_lock);
+  return ret;
+}
+
+
+static void *
+table_delete(thread_arg_t *arg, void *block)
+{
+  void *val;
+  if (arg->use_lock) pthread_mutex_lock(&table_lock);
+  val = memleak_table_delete(&table, block);
+  if (arg->use_lock) pthread_mutex_unlock(&table_lock);
+  return val;
+}
+
+
+static void *
+worker(void *p)
+{
+  thread_arg_t *arg = (thread_arg_t *) p;
+  unsigned int seed = (unsigned int) arg->tid + 1;
+
+  for (long n = 0; n < arg->ops; n++) {
+    int i = rand_r(&seed) % LIVE_MAX;
+    if (i < arg->num_live) {
+      // free a live block
+      void *block = arg->live[i];
+      void *val = table_delete(arg, block);
+      if (arg->overflow[i]) {
+	assert(val == NULL);
+	arg->num_overflow--;
+      }
+      else {
+	assert(val == block_val(arg, block));
+      }
+      free(block);
+      arg->num_live--;
+      arg->live[i] = arg->live[arg->num_live];
+      arg->overflow[i] = arg->overflow[arg->num_live];
+    }
+    else {
+      // allocate a new block
+      void *block = malloc(16 + rand_r(&seed) % 256);
+      assert(block != NULL);
+      int k = arg->num_live++;
+      arg->live[k] = block;
+      arg->overflow[k] = ! table_insert(arg, block);
+      arg->num_overflow += arg->overflow[k];
+    }
+  }
+  return NULL;
+}
+
+
+static double
+run(thread_arg_t *args, int num_threads, long ops, int use_lock)
+{
+  pthread_t thr[num_threads];
+
+  for (int t = 0; t < num_threads; t++) {
+    args[t].tid = t;
+    args[t].ops = ops;
+    args[t].use_lock = use_lock;
+    args[t].num_live = 0;
+    args[t].num_overflow = 0;
+  }
+
+  unsigned long t0 = usec_time();
+  for (int t = 0; t < num_threads; t++) {
+    pthread_create(&thr[t], NULL, worker, &args[t]);
+  }
+  for (int t = 0; t < num_threads; t++) {
+    pthread_join(thr[t], NULL);
+  }
+  return (usec_time() - t0) * 1e-6;
+}
+
+
+// The table must hold exactly the blocks the threads still own
+// (outside their overflow lists), with their values.  Deleting those
+// must leave no live key behind.
+static void
+check_and_drain(thread_arg_t *args, int num_threads)
+{
+  long expected = 0, found = 0;
+
+  for (int t = 0; t < num_threads; t++) {
+    expected += args[t].num_live - args[t].num_overflow;
+  }
+  for (size_t i = 0; i < MEMLEAK_TABLE_SIZE; i++) {
+    uintptr_t key = atomic_load(&table.key[i]);
+    if (key != MEMLEAK_KEY_EMPTY && key != MEMLEAK_KEY_TOMB) {
+      assert(atomic_load(&table.val[i]) != 0);
+      found++;
+    }
+  }
+  assert(found == expected);
+
+  for (int t = 0; t < num_threads; t++) {
+    thread_arg_t *arg = &args[t];
+    for (int k = 0; k < arg->num_live; k++) {
+      void *val = memleak_table_delete(&table, arg->live[k]);
+      assert(val == (arg->overflow[k] ? NULL : block_val(arg, arg->live[k])));
+      free(arg->live[k]);
+    }
+    arg->num_live = 0;
+  }
+
+  for (size_t i = 0; i < MEMLEAK_TABLE_SIZE; i++) {
+    uintptr_t key = atomic_load(&table.key[i]);
+    assert(key == MEMLEAK_KEY_EMPTY || key == MEMLEAK_KEY_TOMB);
+  }
+}
+
+
+int
+main(int argc, char** argv)
+{
+  int  num_threads = (argc > 1) ? atoi(argv[1]) : 64;
+  long ops = (argc > 2) ? atol(argv[2]) : 200000;
+
+  thread_arg_t *args = calloc(num_threads, sizeof(*args));
+  assert(args != NULL);
+  assert(memleak_table_init(&table));
+
+  double t_table = run(args, num_threads, ops, 0);
+  check_and_drain(args, num_threads);
+
+  double t_lock = run(args, num_threads, ops, 1);
+  check_and_drain(args, num_threads);
+
+  double mops = num_threads * ops / 1e6;
+  printf("%d threads x %ld malloc/free ops: table %.3f s (%.1f Mops/s),"
+	 " global lock %.3f s (%.1f Mops/s)\n", num_threads, ops,
+	 t_table, mops / t_table, t_lock, mops / t_lock);
+
+  free(args);
+  return 0;
+}
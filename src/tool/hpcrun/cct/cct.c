@@ -137,6 +137,52 @@ static struct {
 } splay_cache;
 #endif
 
+//
+// per-thread cache of recent (parent, addr) -> child lookups.
+//
+// consecutive samples mostly re-walk the same call path, so most
+// insertions ask for a child that was returned a moment ago.  a hit
+// avoids splaying the sibling tree, which rewrites several pointers
+// even when the wanted child is already at the root.
+//
+// an entry is trusted only if its generation is current and the cached
+// child still names the same parent and addr.  the generation is bumped
+// whenever this thread unlinks or recycles nodes.
+//
+#define CCT_CHILD_CACHE_SIZE 1024
+
+typedef struct {
+  cct_node_t* child;
+  uint32_t gen;
+} cct_child_cache_entry_t;
+
+static __thread cct_child_cache_entry_t cct_child_cache[CCT_CHILD_CACHE_SIZE];
+static __thread uint32_t cct_child_cache_gen = 1;
+
+static inline void
+cct_child_cache_invalidate(void)
+{
+  cct_child_cache_gen++;
+}
+
+static inline cct_child_cache_entry_t*
+cct_child_cache_slot(cct_node_t* parent, cct_addr_t* addr)
+{
+  uint64_t h = ((uintptr_t) parent >> 4)
+    ^ (addr->ip_norm.lm_ip * 0x9e3779b97f4a7c15ULL)
+    ^ ((uint64_t) addr->ip_norm.lm_id << 40);
+  h ^= h >> 29;
+  return &cct_child_cache[h & (CCT_CHILD_CACHE_SIZE - 1)];
+}
+
+static inline cct_node_t*
+cct_child_cache_fill(cct_child_cache_entry_t* e, cct_node_t* child)
+{
+  e->child = child;
+  e->gen = cct_child_cache_gen;
+  return child;
+}
+
 //
 // ******************* Local Routines ********************
 //
@@ -525,6 +571,22 @@ hpcrun_cct_insert_addr(cct_node_t* node, cct_addr_t* frm)
   if ( ! node)
     return NULL;
 
+  // freeable memory may be reclaimed underneath the cache
+  bool use_cache = ! ENABLED(FREEABLE);
+  cct_child_cache_entry_t* e = cct_child_cache_slot(node, frm);
+  if (use_cache) {
+    cct_node_t* c = e->child;
+    if (e->gen == cct_child_cache_gen && c &&
+        c->parent == node && cct_addr_eq(frm, &(c->addr))) {
+      return c;
+    }
+    // a root hit needs no restructuring, so skip the splay
+    c = node->children;
+    if (c && cct_addr_eq(frm, &(c->addr))) {
+      return cct_child_cache_fill(e, c);
+    }
+  }
+
   cct_node_t* found    = splay(node->children, frm);
     //
     // !! SPECIAL CASE for cct splay !!
@@ -537,10 +599,13 @@ hpcrun_cct_insert_addr(cct_node_t* node, cct_addr_t* frm)
   node->children = found;
  
   if (found && cct_addr_eq(frm, &(found->addr))){
-    return found;
+    return use_cache ? cct_child_cache_fill(e, found) : found;
   }
   //  cct_node_t* new = cct_node_create(frm->as_info, frm->ip_norm, frm->lip, node);
   cct_node_t* new = cct_node_create(frm, node);
+  if (use_cache) {
+    cct_child_cache_fill(e, new);
+  }
 
   node->children = new;
   if (! found){
@@ -580,6 +645,8 @@ hpcrun_cct_delete_addr(cct_node_t* node, cct_addr_t* frm)
   if(!found || !cct_addr_eq(frm, &(found->addr))) 
     return NULL;
 
+  cct_child_cache_invalidate();
+
   if(node->children->left == NULL) {
     node->children = node->children->right;
     return found;
@@ -1035,6 +1102,7 @@ cct_disjoint_union_cached(cct_node_t* target, cct_node_t* src)
 // FIXME: only temporary function, until hpcrun_merge is repaired
 void
 cct_remove_my_subtree(cct_node_t* cct){
+  cct_child_cache_invalidate();
   cct->children = NULL;
 //  printf("CHILDREN: %p\tLEFT: %p\tRIGHT: %p\n", cct->children, cct->left, cct->right);
 }
@@ -1050,6 +1118,7 @@ void
 add_node_to_freelist(cct_node_t* cct){
   // parent is used as a next pointer
   if(cct){
+    cct_child_cache_invalidate();
     cct->parent = cct_node_freelist_head;
     cct_node_freelist_head = cct;
   }
@@ -11,6 +11,7 @@
 #include <cct/cct.h>
 #include <hpcrun/cct2metrics.h>
 #include <hpcrun/thread_data.h>
+#include <hpcrun/hpcrun_stats.h>
 #include <lib/prof-lean/splay-macros.h>
 
 
@@ -37,6 +38,10 @@ struct cct2metrics_t {
 // 
 
 #define THREAD_LOCAL_MAP() TD_GET(core_profile_trace_data.cct2metrics_map)
+#define THREAD_LOCAL_CACHE() TD_GET(core_profile_trace_data.cct2metrics_cache)
+
+// cache statistics are added to hpcrun_stats in chunks
+#define CCT2METRICS_CACHE_STATS_CHUNK 1024
 
 //
 // ******** initialization
@@ -54,6 +59,52 @@ hpcrun_cct2metrics_init(cct2metrics_t** map)
   TMSG(CCT2METRICS, "Init, map = %p", *map);
   *map = NULL;
 }
+
+void
+hpcrun_cct2metrics_cache_init(cct2metrics_cache_t* cache)
+{
+  memset(cache, 0, sizeof(*cache));
+}
+
+//
+// ******* Internal operations: **********
+// cache in front of the thread local map
+//
+// Entries point at map nodes, which are never freed or moved while
+// the map lives, so the cached metric list always reflects the node's
+// current association.  Only the thread local map is cached.
+//
+
+static inline int
+cache_index(cct_node_id_t node)
+{
+  uintptr_t h = ((uintptr_t) node) * 0x9e3779b97f4a7c15ULL;
+  return (int) (h >> 32) & (CCT2METRICS_CACHE_SIZE - 1);
+}
+
+static inline cct2metrics_t*
+cache_lookup(cct2metrics_cache_t* cache, cct_node_id_t node)
+{
+  int i = cache_index(node);
+  cct2metrics_t* entry = (cache->node[i] == node) ? cache->entry[i] : NULL;
+
+  cache->lookups++;
+  if (entry) cache->hits++;
+
+  if (cache->lookups == CCT2METRICS_CACHE_STATS_CHUNK) {
+    hpcrun_stats_cct2metrics_cache_add(cache->lookups, cache->hits);
+    cache->lookups = cache->hits = 0;
+  }
+  return entry;
+}
+
+static inline void
+cache_insert(cct2metrics_cache_t* cache, cct2metrics_t* entry)
+{
+  int i = cache_index(entry->node);
+  cache->node[i] = entry->node;
+  cache->entry[i] = entry;
+}
 //
 // ******* Internal operations: **********
 // mapping implemented as a splay tree 
@@ -135,6 +186,14 @@ hpcrun_get_metric_data_list_specific(cct2metrics_t **map, cct_node_id_t cct_id)
   TMSG(CCT2METRICS, "GET_METRIC_SET for %p, using map %p", cct_id, current_map);
   if (! current_map) return NULL;
 
+  if (! map) {
+    cct2metrics_t* entry = cache_lookup(&THREAD_LOCAL_CACHE(), cct_id);
+    if (entry) {
+      TMSG(CCT2METRICS, " -- cache hit %p, returning metrics", cct_id);
+      return entry->kind_metrics;
+    }
+  }
+
   current_map = splay(current_map, cct_id);
 
   if (map)
@@ -146,6 +205,7 @@ hpcrun_get_metric_data_list_specific(cct2metrics_t **map, cct_node_id_t cct_id)
 
   if (current_map->node == cct_id) {
     TMSG(CCT2METRICS, " -- found %p, returning metrics", current_map->node);
+    if (! map) cache_insert(&THREAD_LOCAL_CACHE(), current_map);
     return current_map->kind_metrics;
   }
   TMSG(CCT2METRICS, " -- cct_id NOT, found. Return NULL");
@@ -202,6 +262,7 @@ cct2metrics_assoc(cct_node_id_t node, metric_data_list_t* kind_metrics)
   TMSG(CCT2METRICS, "CCT2METRICS_ASSOC for %p, using map %p", node, map);
   if (! map) {
     map = cct2metrics_new(node, kind_metrics);
+    cache_insert(&THREAD_LOCAL_CACHE(), map);
     TMSG(CCT2METRICS, " -- new map created: %p", map);
   }
   else {
@@ -226,6 +287,7 @@ cct2metrics_assoc(cct_node_id_t node, metric_data_list_t* kind_metrics)
         map->left = NULL;
       }
       map = new;
+      cache_insert(&THREAD_LOCAL_CACHE(), map);
       TMSG(CCT2METRICS, " -- new map after insertion %p.(%p, %p)", map->node, map->left, map->right);
     }
   }
@@ -15,6 +15,21 @@
 //
 //
 typedef struct cct2metrics_t cct2metrics_t;
+
+//
+// a small direct-mapped cache in front of the thread's map, so that
+// repeated updates of the same cct node do not splay the map
+//
+#define CCT2METRICS_CACHE_SIZE 64 // must be a power of 2
+
+typedef struct cct2metrics_cache_t {
+  cct_node_id_t node[CCT2METRICS_CACHE_SIZE];
+  cct2metrics_t* entry[CCT2METRICS_CACHE_SIZE];
+
+  // lookups and hits not yet added to hpcrun_stats
+  long lookups;
+  long hits;
+} cct2metrics_cache_t;
 //
 // ******** initialization
 //
@@ -27,6 +42,8 @@ typedef struct cct2metrics_t cct2metrics_t;
 
 extern void hpcrun_cct2metrics_init(cct2metrics_t** map);
 
+extern void hpcrun_cct2metrics_cache_init(cct2metrics_cache_t* cache);
+
 // ******** Interface operations **********
 // 
 
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <lib/prof-lean/hpcio-buffer.h>
 #include <lib/prof-lean/hpcfmt.h> // for metric_aux_info_t
+#include <lib/prof-lean/hpcrun-fmt.h> // for hpctrace_fmt_block_t
 
 #include "epoch.h"
 #include "cct2metrics.h"
@@ -22,6 +23,7 @@ typedef struct core_profile_trace_data_t {
   //metrics: this is needed otherwise 
   //hpcprof does not pick them up
   cct2metrics_t* cct2metrics_map;
+  cct2metrics_cache_t cct2metrics_cache; // caches cct2metrics_map
 
   // for metric scale (openmp uses)
   void (*scale_fn)(void*);
@@ -37,6 +39,7 @@ typedef struct core_profile_trace_data_t {
   FILE* hpcrun_file;
   void* trace_buffer;
   hpcio_outbuf_t *trace_outbuf;
+  hpctrace_fmt_block_t *trace_block; // compact traces only
 
   // ----------------------------------------
   // Perf support
@@ -52,6 +52,8 @@ const char* HPCRUN_OPT_LUSH_AGENTS = "HPCRUN_OPT_LUSH_AGENTS";
 
 const char* HPCRUN_OUT_PATH        = "HPCRUN_OUT_PATH";
 const char* HPCRUN_TRACE           = "HPCRUN_TRACE";
+const char* HPCRUN_TRACE_ASYNC     = "HPCRUN_TRACE_ASYNC";
+const char* HPCRUN_TRACE_COMPACT   = "HPCRUN_TRACE_COMPACT";
 
 const char* PAPI_EVENT_LIST        = "PAPI_EVENT_LIST";
 
@@ -59,6 +61,8 @@ const char* HPCRUN_EVENT_LIST      = "HPCRUN_EVENT_LIST";
 const char* HPCRUN_MEMSIZE         = "HPCRUN_MEMSIZE";
 const char* HPCRUN_LOW_MEMSIZE     = "HPCRUN_LOW_MEMSIZE";
 
+const char* HPCRUN_EAGER_UNWIND    = "HPCRUN_EAGER_UNWIND";
+
 //
 // Returns: true if 'name' is in the environment and set to a true
 // (non-zero) value.
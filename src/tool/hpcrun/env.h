@@ -55,11 +55,15 @@ extern const char* HPCRUN_OPT_LUSH_AGENTS;
 extern const char* HPCRUN_OUT_PATH;
 
 extern const char* HPCRUN_TRACE;
+extern const char* HPCRUN_TRACE_ASYNC;
+extern const char* HPCRUN_TRACE_COMPACT;
 
 extern const char* HPCRUN_EVENT_LIST;
 extern const char* HPCRUN_MEMSIZE;
 extern const char* HPCRUN_LOW_MEMSIZE;
 
+extern const char* HPCRUN_EAGER_UNWIND;
+
 bool hpcrun_get_env_bool(const char *);
 
 #endif /* hpcrun_env_h */
@@ -0,0 +1,256 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+// An on-disk cache of the function bounds tables computed by the
+// hpcfnbounds server.  In a large parallel job, every process would
+// otherwise ask its own server to analyze the same application binary
+// and the same shared libraries.
+//
+// A table is cached under the key of its load module in the module
+// cache (see utilities/module-cache.c): the ELF build-id, or, for files
+// without one, a hash of the file contents.  Each cache file holds a
+// small header followed by the array of addresses, exactly as the
+// server returns it, and a lookup just mmaps the file.
+//
+// Notes:
+// 1. Processes that miss on the same load module serialize on a lock
+// file (flock) and check the cache again once they hold it, so only
+// one of them queries the server.  Where the file system doesn't
+// support flock, they all query the server and the last one wins.
+//
+// 2. A table is written to a temporary file and renamed into place, so
+// a reader sees either no cache file or a complete one.
+//
+// 3. The header records the hpctoolkit version and the word size, and
+// a cache file that doesn't match is recomputed and replaced.
+//
+// 4. Any failure in the cache falls back to querying the server.
+
+//***************************************************************************
+
+#include <sys/types.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "client.h"
+#include "fnbounds_cache.h"
+#include "fnbounds_file_header.h"
+#include "messages.h"
+
+#include <include/hpctoolkit-config.h>
+#include <utilities/module-cache.h>
+
+#define CACHE_MAGIC  "HPCFNBC1"
+#define CACHE_VERSION_LEN  32
+
+// Header of a cache file.  The table of num_entries addresses follows.
+struct fnbounds_cache_header {
+  char      magic[8];
+  char      version[CACHE_VERSION_LEN];
+  uint32_t  word_size;
+  int32_t   is_relocatable;
+  uint64_t  num_entries;
+  uint64_t  reference_offset;
+};
+
+
+//*****************************************************************
+// Cache files
+//*****************************************************************
+
+// Returns: pointer to the table in the mmapped cache file, or else NULL
+// if there is no usable cache file.
+//
+static void *
+cache_map(const char *path, struct fnbounds_file_header *fh)
+{
+  struct fnbounds_cache_header hdr;
+  struct stat st;
+  void *addr = NULL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  if (fstat(fd, &st) == 0
+      && pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr)
+      && memcmp(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic)) == 0
+      && strncmp(hdr.version, HPCTOOLKIT_VERSION_STRING, CACHE_VERSION_LEN) == 0
+      && hdr.word_size == sizeof(void *)
+      && st.st_size == sizeof(hdr) + hdr.num_entries * sizeof(void *)) {
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base != MAP_FAILED) {
+      fh->num_entries = hdr.num_entries;
+      fh->reference_offset = hdr.reference_offset;
+      fh->is_relocatable = hdr.is_relocatable;
+      fh->mmap_size = st.st_size;
+      addr = (char *) base + sizeof(hdr);
+    }
+  }
+
+  close(fd);
+  return addr;
+}
+
+
+static int
+write_fully(int fd, const void *buf, size_t count)
+{
+  size_t len = 0;
+
+  while (len < count) {
+    ssize_t ret = write(fd, (const char *) buf + len, count - len);
+    if (ret < 0 && errno != EINTR) {
+      return -1;
+    }
+    if (ret > 0) {
+      len += ret;
+    }
+  }
+  return 0;
+}
+
+
+// Write the table to a temporary file and rename it into place.
+//
+static void
+cache_publish(const char *path, const char *key, void *table,
+	      struct fnbounds_file_header *fh)
+{
+  struct fnbounds_cache_header hdr;
+  char tmp_path[PATH_MAX];
+  char suffix[32];
+
+  snprintf(suffix, sizeof(suffix), ".fnb.%d.tmp", (int) getpid());
+  if (hpcrun_module_cache_path(tmp_path, key, suffix) != 0) {
+    return;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic));
+  strncpy(hdr.version, HPCTOOLKIT_VERSION_STRING, CACHE_VERSION_LEN);
+  hdr.word_size = sizeof(void *);
+  hdr.is_relocatable = fh->is_relocatable;
+  hdr.num_entries = fh->num_entries;
+  hdr.reference_offset = fh->reference_offset;
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    TMSG(FNBOUNDS_CLIENT, "cache: unable to create %s: %s", tmp_path, strerror(errno));
+    return;
+  }
+  int ok = write_fully(fd, &hdr, sizeof(hdr)) == 0
+    && write_fully(fd, table, fh->num_entries * sizeof(void *)) == 0;
+  if (close(fd) != 0) {
+    ok = 0;
+  }
+
+  if (ok && rename(tmp_path, path) == 0) {
+    TMSG(FNBOUNDS_CLIENT, "cache: saved %s", path);
+  }
+  else {
+    unlink(tmp_path);
+  }
+}
+
+
+//*****************************************************************
+// Interface operations
+//*****************************************************************
+
+void *
+fnbounds_cache_query(const char *fname, struct fnbounds_file_header *fh)
+{
+  char key[MODULE_CACHE_KEY_LEN];
+  char path[PATH_MAX];
+  char lock_path[PATH_MAX];
+  void *table;
+
+  if (fh == NULL
+      || hpcrun_module_cache_key(fname, key, true) != 0
+      || hpcrun_module_cache_path(path, key, ".fnb") != 0
+      || hpcrun_module_cache_path(lock_path, key, ".fnb.lock") != 0) {
+    return hpcrun_syserv_query(fname, fh);
+  }
+
+  table = cache_map(path, fh);
+  if (table != NULL) {
+    TMSG(FNBOUNDS_CLIENT, "cache hit: %s -> %s", fname, path);
+    return table;
+  }
+
+  // Whoever holds the lock is computing a table; wait for it and look
+  // again before asking our own server.
+  int lock_fd = open(lock_path, O_RDWR | O_CREAT, 0644);
+  if (lock_fd >= 0 && flock(lock_fd, LOCK_EX) == 0) {
+    table = cache_map(path, fh);
+  }
+
+  if (table != NULL) {
+    TMSG(FNBOUNDS_CLIENT, "cache hit after wait: %s -> %s", fname, path);
+  }
+  else {
+    table = hpcrun_syserv_query(fname, fh);
+    if (table != NULL) {
+      cache_publish(path, key, table, fh);
+    }
+  }
+
+  if (lock_fd >= 0) {
+    close(lock_fd);
+  }
+  return table;
+}
@@ -90,6 +90,7 @@
 //*********************************************************************
 
 #include "fnbounds_interface.h"
+#include "fnbounds_cache.h"
 #include "fnbounds_file_header.h"
 #include "client.h"
 #include "dylib.h"
@@ -291,7 +292,7 @@ fnbounds_dso_exec(void)
 
   TMSG(MAP_EXEC, "Entry");
   realpath("/proc/self/exe", filename);
-  void** nm_table = (void**) hpcrun_syserv_query(filename, &fh);
+  void** nm_table = (void**) fnbounds_cache_query(filename, &fh);
   if (! nm_table) {
     EMSG("No nm_table for executable %s", filename);
     dylib_find_executable_bounds(&start, &end);
@@ -465,7 +466,7 @@ fnbounds_compute(const char* incoming_filename, void* start, void* end)
     pathname_for_query = filename;
   }
 
-  nm_table = (void**) hpcrun_syserv_query(pathname_for_query, &fh);
+  nm_table = (void**) fnbounds_cache_query(pathname_for_query, &fh);
   if (nm_table == NULL) {
     return hpcrun_dso_make(filename, NULL, NULL, start, end, 0);
   }
@@ -85,6 +85,11 @@ static atomic_long acc_trace_records_dropped = ATOMIC_VAR_INIT(0);
 static atomic_long acc_samples = ATOMIC_VAR_INIT(0);
 static atomic_long acc_samples_dropped = ATOMIC_VAR_INIT(0);
 
+static atomic_long trace_records_dropped = ATOMIC_VAR_INIT(0);
+
+static atomic_long cct2metrics_cache_lookups = ATOMIC_VAR_INIT(0);
+static atomic_long cct2metrics_cache_hits = ATOMIC_VAR_INIT(0);
+
 //***************************************************************************
 // interface operations
 //***************************************************************************
@@ -111,6 +116,11 @@ hpcrun_stats_reinit(void)
 
   atomic_store_explicit(&acc_samples, 0, memory_order_relaxed);
   atomic_store_explicit(&acc_samples_dropped, 0, memory_order_relaxed);
+
+  atomic_store_explicit(&trace_records_dropped, 0, memory_order_relaxed);
+
+  atomic_store_explicit(&cct2metrics_cache_lookups, 0, memory_order_relaxed);
+  atomic_store_explicit(&cct2metrics_cache_hits, 0, memory_order_relaxed);
 }
 
 
@@ -418,6 +428,46 @@ hpcrun_stats_trolled_frames(void)
   return atomic_load_explicit(&trolled_frames, memory_order_relaxed);
 }
 
+//-----------------------------
+// trace records dropped
+//-----------------------------
+
+void
+hpcrun_stats_trace_records_dropped_add(long value)
+{
+  atomic_fetch_add_explicit(&trace_records_dropped, value, memory_order_relaxed);
+}
+
+long
+hpcrun_stats_trace_records_dropped(void)
+{
+  return atomic_load_explicit(&trace_records_dropped, memory_order_relaxed);
+}
+
+//-----------------------------
+// cct2metrics cache lookups
+// (threads add their counts in chunks)
+//-----------------------------
+
+void
+hpcrun_stats_cct2metrics_cache_add(long lookups, long hits)
+{
+  atomic_fetch_add_explicit(&cct2metrics_cache_lookups, lookups, memory_order_relaxed);
+  atomic_fetch_add_explicit(&cct2metrics_cache_hits, hits, memory_order_relaxed);
+}
+
+long
+hpcrun_stats_cct2metrics_cache_lookups(void)
+{
+  return atomic_load_explicit(&cct2metrics_cache_lookups, memory_order_relaxed);
+}
+
+long
+hpcrun_stats_cct2metrics_cache_hits(void)
+{
+  return atomic_load_explicit(&cct2metrics_cache_hits, memory_order_relaxed);
+}
+
 //----------------------------
 // samples yielded due to deadlock prevention
 //----------------------------
@@ -466,6 +516,11 @@ hpcrun_stats_print_summary(void)
   long acc_trace = atomic_load_explicit(&acc_trace_records, memory_order_relaxed);
   long acc_trace_dropped = atomic_load_explicit(&acc_trace_records_dropped, memory_order_relaxed);
 
+  long trace_dropped = atomic_load_explicit(&trace_records_dropped, memory_order_relaxed);
+
+  long c2m_lookups = atomic_load_explicit(&cct2metrics_cache_lookups, memory_order_relaxed);
+  long c2m_hits = atomic_load_explicit(&cct2metrics_cache_hits, memory_order_relaxed);
+
   hpcrun_memory_summary();
 
   AMSG("UNWIND ANOMALIES: total: %ld errant: %ld, total-frames: %ld, total-libunwind-fails: %ld",
@@ -491,6 +546,14 @@ hpcrun_stats_print_summary(void)
        cpu_intervals_total, cpu_intervals_susp
        );
 
+  if (trace_dropped > 0) {
+    AMSG("TRACE: records dropped (trace buffer full): %ld", trace_dropped);
+  }
+
+  AMSG("CCT2METRICS CACHE: lookups: %ld (hits: %ld, %.1f%%)",
+       c2m_lookups, c2m_hits,
+       (c2m_lookups > 0) ? (100.0 * c2m_hits) / c2m_lookups : 0.0);
+
   if (hpcrun_get_disabled()) {
     AMSG("SAMPLING HAS BEEN DISABLED");
   }
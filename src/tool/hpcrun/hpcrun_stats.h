@@ -121,6 +121,24 @@ void hpcrun_stats_acc_trace_records_dropped_add(long value);
 long hpcrun_stats_acc_trace_records_dropped(void);
 
 
+//-----------------------------
+// trace records dropped
+// (async trace buffer full)
+//-----------------------------
+
+void hpcrun_stats_trace_records_dropped_add(long value);
+long hpcrun_stats_trace_records_dropped(void);
+
+
+//-----------------------------
+// cct2metrics cache lookups
+//-----------------------------
+
+void hpcrun_stats_cct2metrics_cache_add(long lookups, long hits);
+long hpcrun_stats_cct2metrics_cache_lookups(void);
+long hpcrun_stats_cct2metrics_cache_hits(void);
+
+
 //-----------------------------
 // partial unwind samples
 //-----------------------------
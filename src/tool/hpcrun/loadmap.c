@@ -57,6 +57,7 @@
 
 #include <lib/prof-lean/hpcfmt.h>
 #include <lib/prof-lean/spinlock.h>
+#include <lib/prof-lean/stdatomic.h>
 
 #define LOADMAP_DEBUG 0
 
@@ -68,6 +69,47 @@ static hpcrun_loadmap_t* s_loadmap_ptr = NULL;
 static dso_info_t* s_dso_free_list = NULL;
 
 
+// Lookup tables for the hot paths, next to the list of load modules.
+//
+// Mapped load modules are also kept sorted by start address in one of
+// two arrays. The writer (under FNBOUNDS_LOCK) rebuilds the spare
+// array on every map and unmap, swaps it in and bumps a version
+// number. Readers (possibly in a signal handler) never block: they
+// search the published array and check the version afterwards; if it
+// changed, the array may have been rewritten under them, so they try
+// again and after a few attempts walk the list instead.
+//
+// Load modules are never freed and their ids are never reused, so
+// findById is an index into an array that only grows.
+
+typedef struct lm_interval_t {
+  void* start;
+  void* end;
+  load_module_t* lm;
+} lm_interval_t;
+
+typedef struct lm_interval_array_t {
+  int count;
+  int capacity;
+  int overlapping; // if set, searches walk the list
+  lm_interval_t entries[];
+} lm_interval_array_t;
+
+#define LM_LOOKUP_ATTEMPTS 4
+
+static lm_interval_array_t* s_intervals[2];
+static atomic_uintptr_t s_intervals_published = ATOMIC_VAR_INIT(0);
+static atomic_uint s_intervals_version = ATOMIC_VAR_INIT(0);
+static int s_intervals_spare = 0;
+
+static atomic_uintptr_t s_lm_by_id = ATOMIC_VAR_INIT(0);
+static atomic_uint s_lm_by_id_count = ATOMIC_VAR_INIT(0);
+static unsigned int s_lm_by_id_capacity = 0;
+
+static void
+hpcrun_loadmap_publishId(load_module_t* lm);
+
+
 /* locking functions to ensure that loadmaps are consistent */
 static spinlock_t loadmap_lock = SPINLOCK_UNLOCKED;
 
@@ -217,6 +259,8 @@ hpcrun_loadModule_new(const char* name)
   x->prev = NULL;
   x->phdr_info.dlpi_phdr = NULL;
 
+  hpcrun_loadmap_publishId(x);
+
   return x;
 }
 
@@ -289,10 +333,138 @@ hpcrun_loadmap_print(hpcrun_loadmap_t* loadmap)
 
 //***************************************************************************
 
+static void
+hpcrun_loadmap_publishId(load_module_t* lm)
+{
+  load_module_t** by_id = (load_module_t**) atomic_load(&s_lm_by_id);
+
+  if (lm->id >= s_lm_by_id_capacity) {
+    unsigned int capacity = (s_lm_by_id_capacity) ? 2 * s_lm_by_id_capacity : 64;
+    while (capacity <= lm->id) capacity *= 2;
+
+    // the old array stays valid for readers that already have it
+    load_module_t** bigger = 
+      (load_module_t**) hpcrun_malloc(capacity * sizeof(load_module_t*));
+    memset(bigger, 0, capacity * sizeof(load_module_t*));
+    if (by_id) {
+      memcpy(bigger, by_id, s_lm_by_id_capacity * sizeof(load_module_t*));
+    }
+    by_id = bigger;
+    s_lm_by_id_capacity = capacity;
+    atomic_store(&s_lm_by_id, (uintptr_t) by_id);
+  }
+
+  by_id[lm->id] = lm;
+  atomic_store(&s_lm_by_id_count, lm->id);
+}
+
+
+static int
+lm_interval_compare(const void* a, const void* b)
+{
+  const lm_interval_t* x = (const lm_interval_t*) a;
+  const lm_interval_t* y = (const lm_interval_t*) b;
+  if (x->start < y->start) return -1;
+  if (x->start > y->start) return 1;
+  return 0;
+}
+
+
+// Rebuild the sorted array of mapped load modules and publish it.
+// Called with the list locked against other writers.
+static void
+hpcrun_loadmap_publishIntervals()
+{
+  int count = 0;
+  for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
+    if (x->dso_info) count++;
+  }
+
+  lm_interval_array_t* a = s_intervals[s_intervals_spare];
+  if (a == NULL || a->capacity < count) {
+    int capacity = (a) ? 2 * a->capacity : 64;
+    while (capacity < count) capacity *= 2;
+    a = (lm_interval_array_t*)
+      hpcrun_malloc(sizeof(lm_interval_array_t) + capacity * sizeof(lm_interval_t));
+    a->capacity = capacity;
+    s_intervals[s_intervals_spare] = a;
+  }
+
+  int i = 0;
+  for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
+    if (x->dso_info) {
+      a->entries[i].start = x->dso_info->start_addr;
+      a->entries[i].end = x->dso_info->end_addr;
+      a->entries[i].lm = x;
+      i++;
+    }
+  }
+  a->count = count;
+  qsort(a->entries, count, sizeof(lm_interval_t), lm_interval_compare);
+
+  // the list order decides between overlapping modules; leave that to it
+  a->overlapping = 0;
+  for (i = 1; i < count; i++) {
+    if (a->entries[i].start < a->entries[i - 1].end) {
+      a->overlapping = 1;
+    }
+  }
+
+  atomic_store(&s_intervals_published, (uintptr_t) a);
+  atomic_fetch_add(&s_intervals_version, 1);
+  s_intervals_spare = 1 - s_intervals_spare;
+}
+
+
+// Returns: 1 if the search of the published array is valid (and sets
+// *result), else 0.
+static int
+hpcrun_loadmap_searchIntervals(void* begin, void* end, load_module_t** result)
+{
+  unsigned int version = atomic_load(&s_intervals_version);
+  lm_interval_array_t* a = (lm_interval_array_t*) atomic_load(&s_intervals_published);
+  if (a == NULL) return 0;
+
+  int overlapping = a->overlapping;
+  int count = a->count;
+  if (count > a->capacity) count = a->capacity;
+
+  // find the last module that starts at or below 'begin'
+  int lo = 0, hi = count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (a->entries[mid].start <= begin) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  load_module_t* lm = NULL;
+  if (lo > 0 && end <= a->entries[lo - 1].end) {
+    lm = a->entries[lo - 1].lm;
+  }
+
+  atomic_thread_fence(memory_order_acquire);
+  if (overlapping || atomic_load(&s_intervals_version) != version) {
+    return 0;
+  }
+  *result = lm;
+  return 1;
+}
+
+
 load_module_t*
 hpcrun_loadmap_findByAddr(void* begin, void* end)
 {
   TMSG(LOADMAP, "find by address %p -- %p", begin, end);
+  for (int attempt = 0; attempt < LM_LOOKUP_ATTEMPTS; attempt++) {
+    load_module_t* lm;
+    if (hpcrun_loadmap_searchIntervals(begin, end, &lm)) {
+      TMSG(LOADMAP, "       --->%s", (lm) ? lm->name : "(NOT FOUND)");
+      return lm;
+    }
+  }
   for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
     TMSG(LOADMAP, "\tload module %s", x->name);
     if (x->dso_info) {
@@ -333,14 +505,14 @@ load_module_t*
 hpcrun_loadmap_findById(uint16_t id)
 {
   TMSG(LOADMAP, "find by id %d", id);
-  for (load_module_t* x = s_loadmap_ptr->lm_head; (x); x = x->next) {
-    if (x->id == id) {
-      TMSG(LOADMAP, "       --->%s", x->name);
-      return x;
-    }
+  unsigned int count = atomic_load(&s_lm_by_id_count);
+  load_module_t** by_id = (load_module_t**) atomic_load(&s_lm_by_id);
+  if (id == 0 || id > count || by_id == NULL) {
+    TMSG(LOADMAP, "       --->(NOT FOUND)");
+    return NULL;
   }
-  TMSG(LOADMAP, "       --->(NOT FOUND)");
-  return NULL;
+  TMSG(LOADMAP, "       --->%s", by_id[id]->name);
+  return by_id[id];
 }
 
 const char*
@@ -452,6 +624,7 @@ hpcrun_loadmap_map(dso_info_t* dso)
 
   }
 
+  hpcrun_loadmap_publishIntervals();
   hpcrun_loadmap_notify_map(lm);
 
   TMSG(LOADMAP, "hpcrun_loadmap_map: '%s' size=%d %s",
@@ -471,6 +644,7 @@ hpcrun_loadmap_unmap(load_module_t* lm)
   if (old_dso == NULL) return; // nothing to do!  
 
   lm->dso_info = NULL;
+  hpcrun_loadmap_publishIntervals();
 
   // Set dl_phdr_info structure to uninitialized state
   lm->phdr_info.dlpi_phdr = NULL;
@@ -526,6 +700,13 @@ hpcrun_initLoadmap()
   hpcrun_loadmap_init(s_loadmap_ptr);
 
   s_dso_free_list = NULL;
+
+  s_intervals[0] = s_intervals[1] = NULL;
+  s_intervals_spare = 0;
+  atomic_store(&s_intervals_published, 0);
+  atomic_store(&s_lm_by_id, 0);
+  atomic_store(&s_lm_by_id_count, 0);
+  s_lm_by_id_capacity = 0;
 }
 
 
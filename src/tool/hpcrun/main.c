@@ -122,6 +122,7 @@
 #include "trace.h"
 #include "write_data.h"
 #include "sample-sources/itimer.h"
+#include <utilities/module-cache.h>
 #include <utilities/token-iter.h>
 
 #include <memory/hpcrun-malloc.h>
@@ -133,6 +134,7 @@
 
 #include <unwind/common/backtrace.h>
 #include <unwind/common/unwind.h>
+#include <unwind/common/uw_recipe_map.h>
 
 #include <utilities/arch/context-pc.h>
 
@@ -460,6 +462,10 @@ hpcrun_init_internal(bool is_child)
   hpcrun_mmap_init();
   hpcrun_thread_data_init(0, NULL, is_child, hpcrun_get_num_sample_sources());
 
+  // the on-disk caches of fnbounds tables and unwind recipes are
+  // consulted as soon as load modules are mapped.
+  hpcrun_module_cache_init();
+
   // must initialize unwind recipe map before initializing fnbounds
   // because mapping of load modules affects the recipe map.
   hpcrun_unw_init();
@@ -595,6 +601,9 @@ hpcrun_init_internal(bool is_child)
       SAMPLE_SOURCES(start);
   }
 
+  // build unwind intervals ahead of samples, if HPCRUN_EAGER_UNWIND is set
+  uw_recipe_map_eager_start();
+
   hpcrun_is_initialized_private = true;
 
   // FIXME: this isn't in master-gpu-trace. how is it managed?
@@ -741,9 +750,8 @@ extern __thread monitor_tid;
 void
 hpcrun_init_thread_support()
 {
-  hpcrun_init_pthread_key();
-  hpcrun_set_thread0_data();
-  hpcrun_threaded_data();
+  // the eager unwind builder may have switched already
+  hpcrun_threaded_data_init();
   SAMPLE_SOURCES(thread_init);
 }
 
@@ -778,7 +786,6 @@ hpcrun_thread_init(int id, local_thread_data_t* local_thread_data) // cct_ctxt_t
 
   td->inside_hpcrun = 1;  // safe enter, disable signals
 
-  
   if (ENABLED(THREAD_CTXT)) {
     if (thr_ctxt) {
       hpcrun_walk_path(thr_ctxt->context, logit, (cct_op_arg_t) (intptr_t) id);
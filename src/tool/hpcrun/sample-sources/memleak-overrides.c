@@ -89,12 +89,14 @@
  *****************************************************************************/
 
 #include <sample-sources/memleak.h>
+#include <sample-sources/memleak-table.h>
 #include <messages/messages.h>
 #include <safe-sampling.h>
 #include <sample_event.h>
 #include <monitor-exts/monitor_ext.h>
 #include <lib/prof-lean/spinlock.h>
 #include <lib/prof-lean/splay-macros.h>
+#include <lib/prof-lean/stdatomic.h>
 
 // FIXME: the inline getcontext macro is broken on 32-bit x86, so
 // revert to the getcontext syscall for now.
@@ -176,6 +178,10 @@ static float memleak_prob = 0.0;
 
 static struct leakinfo_s *memleak_tree_root = NULL;
 static spinlock_t memtree_lock = SPINLOCK_UNLOCKED;
+static atomic_long memleak_tree_count = ATOMIC_VAR_INIT(0);
+
+// footer table: application pointer -> leakinfo footer
+static memleak_table_t memleak_table = { .key = NULL, .val = NULL };
 
 static int leakinfo_size = sizeof(struct leakinfo_s);
 static long memleak_pagesize = MEMLEAK_DEFAULT_PAGESIZE;
@@ -231,6 +237,7 @@ splay_insert(struct leakinfo_s *node)
     }
   }
   memleak_tree_root = node;
+  atomic_fetch_add_explicit(&memleak_tree_count, 1, memory_order_relaxed);
   spinlock_unlock(&memtree_lock);  
 }
 
@@ -256,6 +263,7 @@ splay_delete(void *memblock)
   }
 
   result = memleak_tree_root;
+  atomic_fetch_sub_explicit(&memleak_tree_count, 1, memory_order_relaxed);
 
   if (memleak_tree_root->left == NULL) {
     memleak_tree_root = memleak_tree_root->right;
@@ -272,6 +280,39 @@ splay_delete(void *memblock)
 
 
 
+
+/******************************************************************************
+ * footer table operations
+ *****************************************************************************/
+
+// Add a footer leakinfo to the table, or to the splay tree if its
+// probe sequence is full.
+//
+static void
+memleak_footer_insert(leakinfo_t *node)
+{
+  if (! memleak_table_insert(&memleak_table, node->memblock, node)) {
+    splay_insert(node);
+  }
+}
+
+
+// Find and remove the footer leakinfo for 'memblock'.  The splay
+// tree (and its lock) is only consulted while it holds entries.
+//
+static leakinfo_t *
+memleak_footer_delete(void *memblock)
+{
+  leakinfo_t *node = memleak_table_delete(&memleak_table, memblock);
+
+  if (node == NULL
+      && atomic_load_explicit(&memleak_tree_count, memory_order_relaxed) > 0) {
+    node = splay_delete(memblock);
+  }
+  return node;
+}
+
+
 /******************************************************************************
  * private operations
  *****************************************************************************/
@@ -316,6 +357,10 @@ memleak_initialize(void)
   memleak_pagesize = MEMLEAK_DEFAULT_PAGESIZE;
 #endif
 
+  if (! memleak_table_init(&memleak_table)) {
+    TMSG(MEMLEAK, "unable to map footer table, using splay tree only");
+  }
+
   // If we are sampling the mallocs, then read the probability and
   // seed the random number generator.
   prob_str = getenv(HPCRUN_MEMLEAK_PROB);
@@ -412,7 +457,7 @@ memleak_get_free_loc(void *appl_ptr, void **sys_ptr, leakinfo_t **info_ptr)
 
   // always try footer
   *sys_ptr = appl_ptr;
-  *info_ptr = splay_delete(appl_ptr);
+  *info_ptr = memleak_footer_delete(appl_ptr);
   if (*info_ptr == NULL) {
     return MEMLEAK_LOC_NONE;
   }
@@ -435,7 +480,7 @@ memleak_get_free_loc(void *appl_ptr, void **sys_ptr, leakinfo_t **info_ptr)
 }
 
 
-// Fill in the leakinfo struct, add metric to CCT, add to splay tree
+// Fill in the leakinfo struct, add metric to CCT, add to footer table
 // (if footer) and print TMSG.
 //
 static void
@@ -469,7 +514,7 @@ memleak_add_leakinfo(const char *name, void *sys_ptr, void *appl_ptr,
     loc_str = "inactive";
   }
   if (loc == MEMLEAK_LOC_FOOT) {
-    splay_insert(info_ptr);
+    memleak_footer_insert(info_ptr);
   }
 
   TMSG(MEMLEAK, "%s: bytes: %ld sys: %p appl: %p info: %p cct: %p (%s)",
@@ -0,0 +1,211 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+//***************************************************************************
+//
+// File: memleak-table.h
+//
+// Purpose:
+//   The memleak footer table: a lock-free, open-addressing hash table
+//   mapping application pointers to their leakinfo footers.
+//
+// Description:
+//   The table has 2^6 shards of 2^16 slots, probed linearly within a
+//   shard.  A slot is claimed by a CAS on its key and then published
+//   by storing its value.  Deletion clears the value and leaves a
+//   tombstone key, which later inserts may reclaim.  Since a block is
+//   inserted by its malloc and deleted only by its free, at most one
+//   thread ever looks for a given key, and a probe never dereferences
+//   another thread's value.
+//
+//   An insert that finds no free slot within MEMLEAK_TABLE_MAX_PROBE
+//   slots fails; the caller keeps the entry elsewhere.
+//
+//   The table has no dependencies on the rest of hpcrun, so it can be
+//   exercised on its own (see UnitTests/memleak_table_test.c).
+//
+//***************************************************************************
+
+#ifndef __MEMLEAK_TABLE_H__
+#define __MEMLEAK_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include <lib/prof-lean/stdatomic.h>
+
+#define MEMLEAK_TABLE_SHARDS_LG  6
+#define MEMLEAK_TABLE_SLOTS_LG   16
+#define MEMLEAK_TABLE_MAX_PROBE  64
+
+#define MEMLEAK_TABLE_SHARDS  (1UL << MEMLEAK_TABLE_SHARDS_LG)
+#define MEMLEAK_TABLE_SLOTS   (1UL << MEMLEAK_TABLE_SLOTS_LG)
+#define MEMLEAK_TABLE_SIZE    (MEMLEAK_TABLE_SHARDS * MEMLEAK_TABLE_SLOTS)
+
+// slot keys: 0 is never used, 1 was used (tombstone)
+#define MEMLEAK_KEY_EMPTY  ((uintptr_t) 0)
+#define MEMLEAK_KEY_TOMB   ((uintptr_t) 1)
+
+// key (application pointer) and value arrays, mmap-ed at init
+typedef struct memleak_table_s {
+  atomic_uintptr_t *key;
+  atomic_uintptr_t *val;
+} memleak_table_t;
+
+
+static inline size_t
+memleak_table_hash(void *memblock)
+{
+  uint64_t h = ((uintptr_t) memblock >> 4) * 0x9e3779b97f4a7c15ULL;
+  return (size_t) (h >> (64 - MEMLEAK_TABLE_SHARDS_LG - MEMLEAK_TABLE_SLOTS_LG));
+}
+
+
+// Returns: 1 if the table is mapped, 0 if it could not be (and all
+// inserts will fail).
+//
+static inline int
+memleak_table_init(memleak_table_t *table)
+{
+  size_t sz = MEMLEAK_TABLE_SIZE * sizeof(atomic_uintptr_t);
+  void *keys, *vals;
+
+  if (table->key != NULL) {
+    return 1;
+  }
+
+  // anonymous pages are zero (MEMLEAK_KEY_EMPTY) and only touched
+  // slots become resident
+  keys = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  vals = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (keys == MAP_FAILED || vals == MAP_FAILED) {
+    if (keys != MAP_FAILED) munmap(keys, sz);
+    if (vals != MAP_FAILED) munmap(vals, sz);
+    return 0;
+  }
+
+  table->val = vals;
+  table->key = keys;
+  return 1;
+}
+
+
+// Returns: 1 if 'memblock' -> 'val' was added to the table, 0 if the
+// caller must keep it elsewhere.
+//
+static inline int
+memleak_table_insert(memleak_table_t *table, void *memblock, void *val)
+{
+  uintptr_t key = (uintptr_t) memblock;
+  size_t h, shard, i, k;
+
+  if (table->key == NULL) {
+    return 0;
+  }
+
+  h = memleak_table_hash(memblock);
+  shard = h & ~(MEMLEAK_TABLE_SLOTS - 1);
+
+  for (k = 0; k < MEMLEAK_TABLE_MAX_PROBE; k++) {
+    i = shard | ((h + k) & (MEMLEAK_TABLE_SLOTS - 1));
+    uintptr_t old = atomic_load_explicit(&table->key[i],
+					 memory_order_relaxed);
+    if ((old == MEMLEAK_KEY_EMPTY || old == MEMLEAK_KEY_TOMB)
+	&& atomic_compare_exchange_strong_explicit(&table->key[i],
+						   &old, key,
+						   memory_order_acquire,
+						   memory_order_relaxed)) {
+      atomic_store_explicit(&table->val[i], (uintptr_t) val,
+			    memory_order_release);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+// Returns: the value for 'memblock' (now removed from the table), or
+// NULL if not present.
+//
+static inline void *
+memleak_table_delete(memleak_table_t *table, void *memblock)
+{
+  uintptr_t key = (uintptr_t) memblock;
+  size_t h, shard, i, k;
+
+  if (table->key == NULL) {
+    return NULL;
+  }
+
+  h = memleak_table_hash(memblock);
+  shard = h & ~(MEMLEAK_TABLE_SLOTS - 1);
+
+  for (k = 0; k < MEMLEAK_TABLE_MAX_PROBE; k++) {
+    i = shard | ((h + k) & (MEMLEAK_TABLE_SLOTS - 1));
+    uintptr_t cur = atomic_load_explicit(&table->key[i],
+					 memory_order_acquire);
+    if (cur == key) {
+      void *val = (void *)
+	atomic_load_explicit(&table->val[i], memory_order_acquire);
+      atomic_store_explicit(&table->val[i], 0, memory_order_relaxed);
+      atomic_store_explicit(&table->key[i], MEMLEAK_KEY_TOMB,
+			    memory_order_release);
+      return val;
+    }
+    if (cur == MEMLEAK_KEY_EMPTY) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+#endif
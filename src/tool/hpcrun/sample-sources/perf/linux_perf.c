@@ -272,6 +272,26 @@ perf_stop_all(int nevents, event_thread_t *event_thread)
   }
 }
 
+/*
+ * Stop/restart the counters around the signal handler.  In batch mode
+ * the counters keep running, so samples may land in the handler.
+ */
+static void
+perf_handler_stop(int nevents, event_thread_t *event_thread)
+{
+  if (perf_util_get_batch_size() <= 1) {
+    perf_stop_all(nevents, event_thread);
+  }
+}
+
+static void
+perf_handler_restart(int nevents, event_thread_t *event_thread)
+{
+  if (perf_util_get_batch_size() <= 1) {
+    perf_start_all(nevents, event_thread);
+  }
+}
+
 static int
 perf_get_pmu_support(const char *name, struct perf_event_attr *event_attr)
 {
@@ -551,11 +571,22 @@ record_sample(event_thread_t *current, perf_mmap_data_t *mmap_data,
   // ----------------------------------------------------------------------------
   // update the cct and add callchain if necessary
   // ----------------------------------------------------------------------------
-  sampling_info_t info = {.sample_clock = 0, .sample_data = mmap_data};
+  // in batch mode, the signal context belongs to the last sample only;
+  // use the callchain the kernel recorded with each sample instead.
+  // samples without user frames fall back to unwinding the context.
+  if (perf_util_get_batch_size() > 1
+      && perf_util_callchain_ip(mmap_data, 0) != NULL) {
+    *sv = hpcrun_sample_callchain(current->event->hpcrun_metric_id,
+          (hpcrun_metricVal_t) {.r=counter},
+          perf_util_callchain_ip, mmap_data);
+  }
+  else {
+    sampling_info_t info = {.sample_clock = 0, .sample_data = mmap_data};
 
-  *sv = hpcrun_sample_callpath(context, current->event->hpcrun_metric_id,
-        (hpcrun_metricVal_t) {.r=counter},
-        0/*skipInner*/, 0/*isSync*/, &info);
+    *sv = hpcrun_sample_callpath(context, current->event->hpcrun_metric_id,
+          (hpcrun_metricVal_t) {.r=counter},
+          0/*skipInner*/, 0/*isSync*/, &info);
+  }
 
   blame_shift_apply(current->event->hpcrun_metric_id, sv->sample_node, 
                     counter /*metricIncr*/);
@@ -866,6 +897,7 @@ METHOD_FN(process_event_list, int lush_metrics)
     // all threads and file descriptor will reuse the same attributes.
     // ------------------------------------------------------------
     perf_util_attr_init(event, event_attr, is_period, threshold, 0);
+    perf_util_attr_set_batch(event_attr, perf_util_get_batch_size());
 
     // ------------------------------------------------------------
     // initialize the property of the metric
@@ -1043,7 +1075,8 @@ perf_event_handler(
   }
 
   // ----------------------------------------------------------------------------
-  // disable all counters
+  // disable all counters, unless in batch mode: there the handler drains
+  // many samples per signal and the stop/start ioctls would dominate
   // ----------------------------------------------------------------------------
 
   sample_source_t *self = &obj_name();
@@ -1062,7 +1095,7 @@ perf_event_handler(
     return 0; // tell monitor that the signal has been handled
   }
 
-  perf_stop_all(nevents, event_thread);
+  perf_handler_stop(nevents, event_thread);
 
   // ----------------------------------------------------------------------------
   // check #1: check if signal generated by kernel for profiling
@@ -1071,7 +1104,7 @@ perf_event_handler(
   if (siginfo->si_code < 0  ||  siginfo->si_fd < 0) {
     TMSG(LINUX_PERF, "signal si_code %d < 0 indicates not from kernel", 
          siginfo->si_code);
-    perf_start_all(nevents, event_thread);
+    perf_handler_restart(nevents, event_thread);
     hpcrun_safe_exit();
 
     HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
@@ -1084,7 +1117,7 @@ perf_event_handler(
   // if sampling disabled explicitly for this thread, skip all processing
   // ----------------------------------------------------------------------------
   if (hpcrun_suppress_sample()) {
-    perf_start_all(nevents, event_thread);
+    perf_handler_restart(nevents, event_thread);
     hpcrun_safe_exit();
     HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
 
@@ -1104,7 +1137,7 @@ perf_event_handler(
         siginfo->si_code, siginfo->si_fd, PERF_SIGNAL);
 
     restart_perf_event(fd);
-    perf_start_all(nevents, event_thread);
+    perf_handler_restart(nevents, event_thread);
 
     HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
 
@@ -1126,7 +1159,7 @@ perf_event_handler(
     TMSG(LINUX_PERF, "signal si_code %d with fd %d: unknown perf event",
        siginfo->si_code, fd);
 
-    perf_start_all(nevents, event_thread);
+    perf_handler_restart(nevents, event_thread);
     hpcrun_safe_exit();
 
     HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
@@ -1137,7 +1170,7 @@ perf_event_handler(
 
   if (current == NULL || current->mmap == NULL || current->fd < 0) {
     TMSG(LINUX_PERF, "Corrupt data for fd: %d, current->fd: %d", fd, current->fd);
-    perf_start_all(nevents, event_thread);
+    perf_handler_restart(nevents, event_thread);
     hpcrun_safe_exit();
 
     HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
@@ -1169,7 +1202,7 @@ perf_event_handler(
 
   } while (more_data);
 
-  perf_start_all(nevents, event_thread);
+  perf_handler_restart(nevents, event_thread);
 
   hpcrun_safe_exit();
 
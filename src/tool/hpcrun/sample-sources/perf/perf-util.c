@@ -48,6 +48,8 @@
 
 #include <linux/version.h>
 #include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 /******************************************************************************
@@ -55,6 +57,8 @@
  *****************************************************************************/
 
 #include <hpcrun/cct_insert_backtrace.h>
+#include <hpcrun/trace.h>
+#include <hpcrun/utilities/ip-normalized.h>
 #include <lib/prof-lean/spinlock.h>     // hostid
 #include <lib/support-lean/OSUtil.h>     // hostid
 
@@ -65,6 +69,8 @@
 
 #define MAX_BUFFER_LINUX_KERNEL 128
 
+#define HPCRUN_PERF_BATCH "HPCRUN_PERF_BATCH"
+
 
 //******************************************************************************
 // constants
@@ -208,6 +214,25 @@ perf_get_kernel_lm_id()
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
 
+//----------------------------------------------------------
+// number of leading entries of a callchain that belong to the kernel.
+// a callchain that includes user frames continues with a
+// PERF_CONTEXT_USER marker followed by the user IPs.
+//----------------------------------------------------------
+static int
+perf_kernel_callchain_len(
+  perf_mmap_data_t *data
+)
+{
+  for (int i = 0; i < data->nr; i++) {
+    if (data->ips[i] == PERF_CONTEXT_USER) {
+      return i;
+    }
+  }
+  return data->nr;
+}
+
+
 //----------------------------------------------------------
 // extend a user-mode callchain with kernel frames (if any)
 //----------------------------------------------------------
@@ -224,7 +249,8 @@ perf_add_kernel_callchain(
   }
 
   perf_mmap_data_t *data = (perf_mmap_data_t*) data_aux;
-  if (data->nr > 0) {
+  int nr_kernel = perf_kernel_callchain_len(data);
+  if (nr_kernel > 0) {
     uint16_t kernel_lm_id = perf_get_kernel_lm_id();
 
     // bug #44 https://github.com/HPCToolkit/hpctoolkit/issues/44 
@@ -236,7 +262,7 @@ perf_add_kernel_callchain(
 
     // add kernel IPs to the call chain top down, which is the 
     // reverse of the order in which they appear in ips[]
-    for (int i = data->nr - 1; i > 0; i--) {
+    for (int i = nr_kernel - 1; i > 0; i--) {
       parent = perf_insert_cct(kernel_lm_id, parent, data->ips[i]);
     }
 
@@ -353,6 +379,107 @@ perf_util_init()
 }
 
 
+//----------------------------------------------------------
+// number of samples the kernel should buffer before raising a signal
+// (HPCRUN_PERF_BATCH).  a value of 1, the default, processes each
+// sample in its own signal; larger values take call paths from the
+// callchains recorded by the kernel instead of unwinding.
+//----------------------------------------------------------
+int
+perf_util_get_batch_size()
+{
+  static int batch_size = 0;
+
+  if (batch_size == 0) {
+    batch_size = 1;
+
+    const char *val_str = getenv(HPCRUN_PERF_BATCH);
+    if (val_str != NULL) {
+      int val = atoi(val_str);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
+      if (val > PERF_MAX_BATCH_SIZE) {
+        EMSG("WARNING: Lowered %s from %d to %d.", HPCRUN_PERF_BATCH, val,
+             PERF_MAX_BATCH_SIZE);
+        val = PERF_MAX_BATCH_SIZE;
+      }
+      if (val > 1 && hpcrun_trace_isactive()) {
+        EMSG("WARNING: %s is ignored when tracing.", HPCRUN_PERF_BATCH);
+        val = 1;
+      }
+      if (val > 1) {
+        batch_size = val;
+      }
+#else
+      if (val > 1) {
+        EMSG("WARNING: %s requires user callchains (Linux 3.7).",
+             HPCRUN_PERF_BATCH);
+      }
+#endif
+    }
+    TMSG(LINUX_PERF, "batch size = %d", batch_size);
+  }
+  return batch_size;
+}
+
+
+//----------------------------------------------------------
+// ask the kernel to signal once per 'batch_size' samples and to
+// record the user callchain of each sample
+//----------------------------------------------------------
+void
+perf_util_attr_set_batch(
+  struct perf_event_attr *attr,
+  int batch_size
+)
+{
+  if (batch_size <= 1) {
+    return;
+  }
+  attr->wakeup_events = batch_size;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
+  attr->sample_type            |= PERF_SAMPLE_CALLCHAIN;
+  attr->exclude_callchain_user  = INCLUDE_CALLCHAIN;
+#endif
+}
+
+
+//----------------------------------------------------------
+// the i-th user-mode IP of the callchain recorded by the kernel for
+// a sample, innermost first, or NULL past its end.  user frames are
+// found by the kernel's frame pointer walk, so code built without
+// frame pointers yields truncated paths.
+//----------------------------------------------------------
+void *
+perf_util_callchain_ip(
+  void *data_aux,
+  int i
+)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
+  perf_mmap_data_t *data = (perf_mmap_data_t*) data_aux;
+  if (data == NULL) {
+    return NULL;
+  }
+
+  // first user IP follows the PERF_CONTEXT_USER marker
+  int k = perf_kernel_callchain_len(data) + 1 + i;
+  if (k >= data->nr) {
+    return NULL;
+  }
+
+  // a zero or a marker ends a truncated walk
+  u64 ip = data->ips[k];
+  if (ip == 0 || ip >= PERF_CONTEXT_MAX) {
+    return NULL;
+  }
+  return (void *) ip;
+#else
+  return NULL;
+#endif
+}
+
+
 //----------------------------------------------------------
 // Interface to see if the kernel symbol is available
 // this function caches the value so that we don't need
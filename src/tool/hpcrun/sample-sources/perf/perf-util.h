@@ -58,8 +58,12 @@
 
 // the number of maximum frames (call chains) 
 // For kernel only call chain, I think 32 is a good number.
-// If we include user call chains, it should be bigger than that.
-#define MAX_CALLCHAIN_FRAMES 32
+// If we include user call chains, it should be bigger than that,
+// which is the case in batch mode (see HPCRUN_PERF_BATCH).
+#define MAX_CALLCHAIN_FRAMES 128
+
+// the largest number of samples per wakeup in batch mode
+#define PERF_MAX_BATCH_SIZE  64
 
 
 /******************************************************************************
@@ -169,4 +173,13 @@ perf_util_get_max_sample_rate();
 int
 perf_util_check_precise_ip_suffix(char *event);
 
+int
+perf_util_get_batch_size();
+
+void
+perf_util_attr_set_batch(struct perf_event_attr *attr, int batch_size);
+
+void *
+perf_util_callchain_ip(void *data_aux, int i);
+
 #endif
@@ -84,10 +84,10 @@
 #define MMAP_OFFSET_0            0
 
 #define PERF_DATA_PAGE_EXP        1      // use 2^PERF_DATA_PAGE_EXP pages
-#define PERF_DATA_PAGES           (1 << PERF_DATA_PAGE_EXP)
+#define PERF_BATCH_DATA_PAGE_EXP  5      // ... or 2^5 pages in batch mode
 
-#define PERF_MMAP_SIZE(pagesz)    ((pagesz) * (PERF_DATA_PAGES + 1))
-#define PERF_TAIL_MASK(pagesz)    (((pagesz) * PERF_DATA_PAGES) - 1)
+#define PERF_MMAP_SIZE(pagesz)    ((pagesz) * (data_pages + 1))
+#define PERF_TAIL_MASK(pagesz)    (((pagesz) * data_pages) - 1)
 
 #define BUFFER_FRONT(current_perf_mmap)              ((char *) current_perf_mmap + pagesize)
 #define BUFFER_SIZE               (tail_mask + 1)
@@ -106,6 +106,7 @@
  *****************************************************************************/
 
 static int pagesize      = 0;
+static int data_pages    = 0;
 static size_t tail_mask  = 0;
 
 
@@ -257,11 +258,14 @@ perf_sample_callchain(u64 data_head, u64 *data_tail,
 
       // read the IPs for the frames
       if (perf_read(data_head, data_tail,
-                    current_perf_mmap, mmap_data->ips, num_records * sizeof(u64)) != 0) {
+                    current_perf_mmap, mmap_data->ips, mmap_data->nr * sizeof(u64)) != 0) {
         // the data seems invalid
         mmap_data->nr = 0;
         TMSG(LINUX_PERF, "unable to read all %d frames", num_records);
       }
+
+      // skip the frames that do not fit
+      *data_tail += (num_records - mmap_data->nr) * sizeof(u64);
     }
   } else {
     TMSG(LINUX_PERF, "unable to read the number of frames" );
@@ -537,6 +541,11 @@ void
 perf_mmap_init()
 {
   pagesize = sysconf(_SC_PAGESIZE);
+
+  // a batch of samples with user callchains needs more room
+  int exp = (perf_util_get_batch_size() > 1) ? PERF_BATCH_DATA_PAGE_EXP
+                                             : PERF_DATA_PAGE_EXP;
+  data_pages = 1 << exp;
   tail_mask = PERF_TAIL_MASK(pagesize);
 }
 
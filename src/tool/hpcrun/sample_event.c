@@ -304,6 +304,116 @@ hpcrun_sample_callpath(void* context, int metricId,
   return ret;
 }
 
+
+// Copy a recorded call path into the thread's backtrace buffer,
+// stopping at the monitor fence just as the unwinder does.  A path
+// that never reaches a fence is a partial unwind.
+static bool
+callchain_to_backtrace(backtrace_info_t* bt,
+		       hpcrun_callchain_fn callchain_fn, void* data)
+{
+  thread_data_t* td = hpcrun_get_thread_data();
+  td->btbuf_cur = td->btbuf_beg;
+  td->btbuf_sav = td->btbuf_end;
+
+  memset(bt, 0, sizeof(*bt));
+  bt->fence = FENCE_BAD;
+  bt->partial_unwind = true;
+
+  void* ip;
+  for (int i = 0; (ip = callchain_fn(data, i)) != NULL; i++) {
+    hpcrun_ensure_btbuf_avail();
+
+    frame_t* frame = td->btbuf_cur++;
+    memset(frame, 0, sizeof(*frame));
+    frame->cursor.pc_unnorm = ip;
+    frame->ip_norm = hpcrun_normalize_ip(ip, NULL);
+
+    fence_enum_t fence =
+      (monitor_unwind_process_bottom_frame(ip) ? FENCE_MAIN :
+       monitor_unwind_thread_bottom_frame(ip) ? FENCE_THREAD : FENCE_NONE);
+    if (fence != FENCE_NONE) {
+      bt->fence = fence;
+      bt->partial_unwind = false;
+      break;
+    }
+  }
+
+  bt->begin = td->btbuf_beg;
+  bt->last  = td->btbuf_cur - 1;
+  return (td->btbuf_cur != td->btbuf_beg);
+}
+
+
+sample_val_t
+hpcrun_sample_callchain(int metricId, hpcrun_metricVal_t metricIncr,
+			hpcrun_callchain_fn callchain_fn, void *data)
+{
+  sample_val_t ret;
+  hpcrun_sample_val_init(&ret);
+
+  if (monitor_block_shootdown()) {
+    monitor_unblock_shootdown();
+    return ret;
+  }
+
+  if (! hpctoolkit_sampling_is_active()) {
+    monitor_unblock_shootdown();
+    return ret;
+  }
+
+  hpcrun_stats_num_samples_total_inc();
+
+  if (hpcrun_is_sampling_disabled()) {
+    TMSG(SAMPLE,"global suspension");
+    hpcrun_all_sources_stop();
+    monitor_unblock_shootdown();
+    return ret;
+  }
+
+  hpcrun_stats_num_samples_attempted_inc();
+
+  thread_data_t* td   = hpcrun_get_thread_data();
+  sigjmp_buf_t* it    = &(td->bad_unwind);
+  sigjmp_buf_t* old   = td->current_jmp_buf;
+  td->current_jmp_buf = it;
+
+  cct_node_t* node = NULL;
+  epoch_t* epoch = td->core_profile_trace_data.epoch;
+
+  hpcrun_set_handling_sample(td);
+
+  // no unwind happens here; the jump buffer guards the cct insertion
+  if (sigsetjmp(it->jb, 1) == 0 && epoch != NULL) {
+    epoch = hpcrun_check_for_new_loadmap(epoch);
+
+    backtrace_info_t bt;
+    if (callchain_to_backtrace(&bt, callchain_fn, data)) {
+      if (bt.partial_unwind) {
+	hpcrun_stats_num_samples_partial_inc();
+      }
+      if (! (bt.partial_unwind && ENABLED(NO_PARTIAL_UNW))) {
+	node = hpcrun_cct_record_backtrace_w_metric(&(epoch->csdata),
+						    bt.partial_unwind, &bt,
+						    false, metricId,
+						    metricIncr, data);
+      }
+      hpcrun_stats_frames_total_inc((long)(bt.last - bt.begin + 1));
+    }
+  }
+  td->current_jmp_buf = old;
+
+  hpcrun_clear_handling_sample(td);
+
+  ret.sample_node = node;
+
+  TMSG(SAMPLE_CALLPATH,"done w callchain sample, return %p", ret.sample_node);
+  monitor_unblock_shootdown();
+
+  return ret;
+}
+
+
 static int const PTHREAD_CTXT_SKIP_INNER = 1;
 
 cct_node_t*
@@ -109,6 +109,22 @@ extern sample_val_t hpcrun_sample_callpath(void *context, int metricId,
 		                   hpcrun_metricVal_t metricIncr,
 				   int skipInner, int isSync, sampling_info_t *data);
 
+// hpcrun_callchain_fn: return the i-th user-mode instruction pointer
+// of a call path recorded at sample time, innermost first, or NULL
+// past its end.
+typedef void* (*hpcrun_callchain_fn)(void* data, int i);
+
+// hpcrun_sample_callchain: like hpcrun_sample_callpath(), but the
+// call path comes from 'callchain_fn' rather than from unwinding a
+// context.  For samples that are processed after the fact, e.g., in
+// batches drained from a kernel buffer.  The path is fenced and
+// inserted like an unwound one; 'data' is also handed to the kernel
+// callpath hook.
+extern sample_val_t hpcrun_sample_callchain(int metricId,
+					    hpcrun_metricVal_t metricIncr,
+					    hpcrun_callchain_fn callchain_fn,
+					    void *data);
+
 extern cct_node_t* hpcrun_gen_thread_ctxt(void *context);
 
 extern cct_node_t* hpcrun_sample_callpath_w_bt(void *context,
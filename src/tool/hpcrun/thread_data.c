@@ -200,6 +200,21 @@ hpcrun_threaded_data(void)
 }
 
 
+// Switch to per-thread data, with the calling thread's data as thread
+// 0's.  Done when the application starts its first thread, or before
+// that for a helper thread of hpcrun's own; later calls do nothing.
+void
+hpcrun_threaded_data_init(void)
+{
+  if (hpcrun_get_thread_data != &hpcrun_get_thread_data_local) {
+    return;
+  }
+  hpcrun_init_pthread_key();
+  hpcrun_set_thread0_data();
+  hpcrun_threaded_data();
+}
+
+
 //***************************************************************************
 // 
 //***************************************************************************
@@ -230,6 +245,7 @@ core_profile_trace_data_init(core_profile_trace_data_t * cptd, int id, cct_ctxt_
   // cct2metrics map: associate a metric_set with
   //                  a cct node
   hpcrun_cct2metrics_init(&(cptd->cct2metrics_map));
+  hpcrun_cct2metrics_cache_init(&(cptd->cct2metrics_cache));
 
   // ----------------------------------------
   // tracing
@@ -243,6 +259,7 @@ core_profile_trace_data_init(core_profile_trace_data_t * cptd, int id, cct_ctxt_
   cptd->hpcrun_file  = NULL;
   cptd->trace_buffer = NULL;
   cptd->trace_outbuf = NULL;
+  cptd->trace_block = NULL;
 
   // ----------------------------------------
   // perf event support
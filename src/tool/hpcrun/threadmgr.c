@@ -104,6 +104,8 @@ static atomic_int_least32_t threadmgr_num_threads = ATOMIC_VAR_INIT(1); // numbe
 static atomic_int_least32_t threadmgr_tot_threads = ATOMIC_VAR_INIT(1); // number of total threads
 #endif
 
+static atomic_int_least32_t threadmgr_internal_ids = ATOMIC_VAR_INIT(0); // ids handed to hpcrun's own threads
+
 static SLIST_HEAD(thread_list_head, thread_list_s) list_thread_head =
     SLIST_HEAD_INITIALIZER(thread_list_head);
 
@@ -234,6 +236,19 @@ hpcrun_threadmgr_thread_count()
 	return atomic_load_explicit(&threadmgr_active_threads, memory_order_relaxed);
 }
 
+/**
+ * Return an id for a thread that hpcrun starts for its own use, that
+ * libmonitor doesn't number and that writes no profile or trace, such
+ * as the eager unwind builder.  These ids are negative, so they are
+ * never those of an application thread (numbered from 0 by libmonitor)
+ * or of a GPU stream.
+ **/
+int
+hpcrun_threadMgr_internal_id()
+{
+	return -1 - atomic_fetch_add_explicit(&threadmgr_internal_ids, 1, memory_order_relaxed);
+}
+
 /**
  * Return the type of HPCRUN_OPTION_MERGE_THREAD option
  * Possible value:
@@ -75,6 +75,8 @@ void hpcrun_threadmgr_thread_delete();
 
 int hpcrun_threadmgr_thread_count();
 
+int hpcrun_threadMgr_internal_id();
+
 bool
 hpcrun_threadMgr_data_get(int id, cct_ctxt_t* thr_ctxt, thread_data_t **data);
 
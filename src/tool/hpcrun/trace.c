@@ -52,6 +52,11 @@
 #include <sys/time.h>
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
 
 
 //*********************************************************************
@@ -77,12 +82,22 @@
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcio.h>
 #include <lib/prof-lean/hpcio-buffer.h>
+#include <lib/prof-lean/stdatomic.h>
+
+#include "hpcrun_stats.h"
 
 
 //*********************************************************************
 // type declarations
 //*********************************************************************
 
+// an async trace buffer that the writer thread drains; slots are
+// cleared when the trace is closed and reused by later threads
+typedef struct trace_writer_entry_s {
+  atomic_uintptr_t outbuf;
+  struct trace_writer_entry_s *next;
+} trace_writer_entry_t;
+
 
 
 //*********************************************************************
@@ -90,6 +105,10 @@
 //*********************************************************************
 
 static void hpcrun_trace_file_validate(int valid, char *op);
+static int trace_writer_start(void);
+static void trace_writer_notify(void);
+static void trace_writer_register(hpcio_outbuf_t *outbuf);
+static void trace_writer_unregister(hpcio_outbuf_t *outbuf);
 static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t *cptd, unsigned int call_path_id, uint metric_id, uint32_t dLCA, uint64_t nanotime);
 
 
@@ -99,6 +118,23 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
 
 static int tracing = 0;
 
+// asynchronous trace writing (HPCRUN_TRACE_ASYNC): sampled threads hand
+// full trace segments to one writer thread per process instead of
+// calling write() in the signal handler.
+static int trace_async = 0;
+enum {
+  TRACE_WRITER_NONE = 0,
+  TRACE_WRITER_STARTING,
+  TRACE_WRITER_RUNNING,
+  TRACE_WRITER_FAILED
+};
+static atomic_int trace_writer_state = ATOMIC_VAR_INIT(TRACE_WRITER_NONE);
+static atomic_uintptr_t trace_writer_list = ATOMIC_VAR_INIT(0);
+static sem_t trace_writer_sem;
+
+// compact (blocked, delta-encoded) trace format (HPCRUN_TRACE_COMPACT)
+static int trace_compact = 0;
+
 //*********************************************************************
 // interface operations
 //*********************************************************************
@@ -115,6 +151,19 @@ hpcrun_trace_init()
 {
   tracing = hpcrun_get_env_bool(HPCRUN_TRACE);
   TMSG(TRACE, "Tracing is %s", (tracing ? "ON" : "OFF"));
+
+  // after fork, the child has no writer thread and no open traces
+  trace_async = tracing && hpcrun_get_env_bool(HPCRUN_TRACE_ASYNC);
+  atomic_store(&trace_writer_state, TRACE_WRITER_NONE);
+  atomic_store(&trace_writer_list, 0);
+  if (trace_async && sem_init(&trace_writer_sem, 0, 0) != 0) {
+    EMSG("unable to create trace writer semaphore, writing traces synchronously");
+    trace_async = 0;
+  }
+  TMSG(TRACE, "Asynchronous trace writing is %s", (trace_async ? "ON" : "OFF"));
+
+  trace_compact = tracing && hpcrun_get_env_bool(HPCRUN_TRACE_COMPACT);
+  TMSG(TRACE, "Compact trace format is %s", (trace_compact ? "ON" : "OFF"));
 }
 
 
@@ -140,10 +189,16 @@ hpcrun_trace_open(core_profile_trace_data_t * cptd)
     fd = hpcrun_open_trace_file(cptd->id);
     hpcrun_trace_file_validate(fd >= 0, "open");
     cptd->trace_buffer = hpcrun_malloc(HPCRUN_TraceBufferSz);
+    int async = trace_async && trace_writer_start();
     ret = hpcio_outbuf_attach(&cptd->trace_outbuf, fd, cptd->trace_buffer,
-			      HPCRUN_TraceBufferSz, HPCIO_OUTBUF_UNLOCKED,
+			      HPCRUN_TraceBufferSz,
+			      HPCIO_OUTBUF_UNLOCKED | (async ? HPCIO_OUTBUF_ASYNC : 0),
                               hpcrun_malloc);
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "open");
+    if (async) {
+      hpcio_outbuf_set_notify(cptd->trace_outbuf, trace_writer_notify);
+      trace_writer_register(cptd->trace_outbuf);
+    }
 
     hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
 #ifdef DATACENTRIC_TRACE
@@ -158,6 +213,12 @@ hpcrun_trace_open(core_profile_trace_data_t * cptd)
 #else
     HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS, false);
 #endif
+
+    if (trace_compact) {
+      HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS, true);
+      cptd->trace_block = hpcrun_malloc(sizeof(hpctrace_fmt_block_t));
+      hpctrace_fmt_block_init(cptd->trace_block);
+    }
     
     ret = hpctrace_fmt_hdr_outbuf(flags, cptd->trace_outbuf);
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "write header to");
@@ -219,6 +280,18 @@ hpcrun_trace_close(core_profile_trace_data_t * cptd)
   if (tracing && hpcrun_sample_prob_active()) {
 
     TMSG(TRACE, "Trace active close code");
+    if (cptd->trace_block) {
+      if (hpctrace_fmt_block_outbuf(cptd->trace_block, cptd->trace_outbuf) != HPCFMT_OK) {
+	EMSG("unable to write last block of trace file");
+      }
+    }
+
+    long dropped = hpcio_outbuf_num_dropped(cptd->trace_outbuf);
+    if (dropped > 0) {
+      hpcrun_stats_trace_records_dropped_add(dropped);
+    }
+    trace_writer_unregister(cptd->trace_outbuf);
+
     int ret = hpcio_outbuf_close(&cptd->trace_outbuf);
     if (ret != HPCFMT_OK) {
       EMSG("unable to flush and close trace file");
@@ -274,7 +347,14 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
     HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS, false);
 #endif
     
-    int ret = hpctrace_fmt_datum_outbuf(&trace_datum, flags, cptd->trace_outbuf);
+    int ret;
+    if (cptd->trace_block) {
+      ret = hpctrace_fmt_datum_block_outbuf(&trace_datum, flags, cptd->trace_block,
+					    cptd->trace_outbuf);
+    }
+    else {
+      ret = hpctrace_fmt_datum_outbuf(&trace_datum, flags, cptd->trace_outbuf);
+    }
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "append");
 }
 
@@ -287,3 +367,120 @@ hpcrun_trace_file_validate(int valid, char *op)
     monitor_real_abort();
   }
 }
+
+
+//*********************************************************************
+// asynchronous trace writer
+//*********************************************************************
+
+static void *
+trace_writer_loop(void *arg)
+{
+  // samples belong to application threads, not to this one
+  sigset_t mask;
+  sigfillset(&mask);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+  for (;;) {
+    while (sem_wait(&trace_writer_sem) != 0) {
+      // EINTR
+    }
+
+    trace_writer_entry_t *e =
+      (trace_writer_entry_t *) atomic_load(&trace_writer_list);
+    for (; e != NULL; e = e->next) {
+      hpcio_outbuf_t *outbuf = (hpcio_outbuf_t *) atomic_load(&e->outbuf);
+      if (outbuf != NULL) {
+	hpcio_outbuf_drain(outbuf);
+      }
+    }
+  }
+  return NULL;
+}
+
+
+// Start the writer thread on first use.  A thread that finds another
+// one creating the writer waits until pthread_create() has returned,
+// so it never attaches an async buffer that no writer will drain.
+//
+// Returns: 1 if the writer thread is running, else 0.
+//
+static int
+trace_writer_start(void)
+{
+  int state = TRACE_WRITER_NONE;
+  if (! atomic_compare_exchange_strong(&trace_writer_state, &state,
+				       TRACE_WRITER_STARTING)) {
+    while (state == TRACE_WRITER_STARTING) {
+      sched_yield();
+      state = atomic_load(&trace_writer_state);
+    }
+    return (state == TRACE_WRITER_RUNNING);
+  }
+
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  // create the writer without libmonitor watching
+  monitor_disable_new_threads();
+  int ret = pthread_create(&thread, &attr, trace_writer_loop, NULL);
+  monitor_enable_new_threads();
+
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    EMSG("unable to create trace writer thread, writing traces synchronously");
+    atomic_store(&trace_writer_state, TRACE_WRITER_FAILED);
+    return 0;
+  }
+  atomic_store(&trace_writer_state, TRACE_WRITER_RUNNING);
+  return 1;
+}
+
+
+// called from hpcio_outbuf_write() inside the signal handler
+static void
+trace_writer_notify(void)
+{
+  sem_post(&trace_writer_sem);
+}
+
+
+static void
+trace_writer_register(hpcio_outbuf_t *outbuf)
+{
+  trace_writer_entry_t *e =
+    (trace_writer_entry_t *) atomic_load(&trace_writer_list);
+
+  for (; e != NULL; e = e->next) {
+    uintptr_t empty = 0;
+    if (atomic_compare_exchange_strong(&e->outbuf, &empty, (uintptr_t) outbuf)) {
+      return;
+    }
+  }
+
+  e = (trace_writer_entry_t *) hpcrun_malloc(sizeof(trace_writer_entry_t));
+  atomic_init(&e->outbuf, (uintptr_t) outbuf);
+
+  uintptr_t head = atomic_load(&trace_writer_list);
+  do {
+    e->next = (trace_writer_entry_t *) head;
+  } while (! atomic_compare_exchange_weak(&trace_writer_list, &head, (uintptr_t) e));
+}
+
+
+static void
+trace_writer_unregister(hpcio_outbuf_t *outbuf)
+{
+  trace_writer_entry_t *e =
+    (trace_writer_entry_t *) atomic_load(&trace_writer_list);
+
+  for (; e != NULL; e = e->next) {
+    uintptr_t expected = (uintptr_t) outbuf;
+    if (atomic_compare_exchange_strong(&e->outbuf, &expected, 0)) {
+      return;
+    }
+  }
+}
@@ -80,6 +80,10 @@
 //---------------------------------------------------------------------
 #include <memory/hpcrun-malloc.h>
 #include <main.h>
+#include <env.h>
+#include <handling_sample.h>
+#include <sample_sources_all.h>
+#include <threadmgr.h>
 #include "thread_data.h"
 #include "uw_hash.h"
 #include "uw_recipe_map.h"
@@ -99,6 +103,9 @@
 // global include files
 //******************************************************************************
 
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -109,6 +116,9 @@
 
 #define SKIPLIST_HEIGHT 8
 
+// load module ids are 16 bits
+#define EAGER_MODULE_WORDS ((UINT16_MAX + 1) / 64)
+
 #define NUM_NODES 10
 
 //******************************************************************************
@@ -554,6 +564,241 @@ uw_recipe_map_repoison(uintptr_t start, uintptr_t end, unwinder_t uw)
   uw_recipe_map_poison(start, end, uw);
 }
 
+// Insert a DEFERRED pair for the function [start, end) into the map,
+// unless there is one already.
+// Returns: the pair in the map.
+static ilmstat_btuwi_pair_t*
+uw_recipe_map_insert_deferred(uintptr_t start, uintptr_t end, load_module_t *lm,
+			      unwinder_t uw)
+{
+  // bounding addresses found; set DEFERRED state and pair it with
+  // (bitree_uwi_t*)NULL and try to insert into map:
+  ilmstat_btuwi_pair_t *ilm_btui =
+    ilmstat_btuwi_pair_malloc(start, end, lm, DEFERRED, my_alloc);
+
+  csklnode_t *node = cskl_insert(unwinder_to_cskiplist[uw], ilm_btui, my_alloc);
+  if (ilm_btui !=  (ilmstat_btuwi_pair_t*)node->val) {
+    // interval_ldmod_pair ([fcn_start, fcn_end), lm) is already in the map,
+    // so free the unused copy and use the mapped one
+    ilmstat_btuwi_pair_free(ilm_btui, uw);
+    ilm_btui = (ilmstat_btuwi_pair_t*)node->val;
+  }
+  return ilm_btui;
+}
+
+
+// Build the tree of intervals for a pair that the caller has just
+// moved to FORTHCOMING, and mark it READY, or NEVER on a fault.
+// Returns: true if the intervals were built.
+static bool
+uw_recipe_map_build(thread_data_t *td, ilmstat_btuwi_pair_t *ilm_btui, unwinder_t uw)
+{
+  void *fcn_start = (void*)ilm_btui->interval.start;
+  void *fcn_end   = (void*)ilm_btui->interval.end;
+
+  // ----------------------------------------------------------
+  // potentially crash in this statement. need to save the state 
+  // ----------------------------------------------------------
+
+  sigjmp_buf_t *oldjmp = td->current_jmp_buf;       // store the outer sigjmp
+
+  td->current_jmp_buf  = &(td->bad_interval);
+
+  int ljmp = sigsetjmp(td->bad_interval.jb, 1);
+  if (ljmp == 0) {
+    btuwi_status_t btuwi_stat = build_intervals(fcn_start, fcn_end - fcn_start, uw);
+    if (btuwi_stat.error != 0) {
+      TMSG(UW_RECIPE_MAP, "build_intervals: fcn range %p to %p: error %d",
+	   fcn_start, fcn_end, btuwi_stat.error);
+    }
+    ilm_btui->btuwi = bitree_uwi_rebalance(btuwi_stat.first, btuwi_stat.count);
+    atomic_store_explicit(&ilm_btui->stat, READY, memory_order_release);
+
+    td->current_jmp_buf = oldjmp;   // restore the outer sigjmp
+    return true;
+  }
+
+  td->current_jmp_buf = oldjmp;   // restore the outer sigjmp
+  EMSG("Fail to get interval %p to %p", fcn_start, fcn_end);
+  atomic_store_explicit(&ilm_btui->stat, NEVER, memory_order_release);
+  return false;
+}
+
+
+//---------------------------------------------------------------------
+// eager interval building
+//---------------------------------------------------------------------
+
+// With HPCRUN_EAGER_UNWIND set, a helper thread builds the native
+// intervals for every function of a load module, so that a sampling
+// thread finds them READY instead of building them in its signal
+// handler on the first sample in each function.  Only modules that
+// have been sampled are built: the first interval built on demand in a
+// module queues it for the helper.  Code that is mapped but never runs
+// costs nothing.
+//
+// The helper needs thread data of its own, for hpcrun_malloc and to
+// recover from a fault in build_intervals.  It starts at process init,
+// after switching the process to per-thread data, and takes an id that
+// no application thread or GPU stream has.
+
+typedef struct eager_item_s {
+  load_module_t *lm;
+  struct eager_item_s *next;
+} eager_item_t;
+
+static bool eager_enabled = false;
+static atomic_uintptr_t eager_queue = ATOMIC_VAR_INIT(0);
+static atomic_int eager_state = ATOMIC_VAR_INIT(0);
+static sem_t eager_sem;
+static atomic_uint_least64_t eager_requested[EAGER_MODULE_WORDS];
+
+static void
+uw_recipe_map_eager_build(thread_data_t *td, load_module_t *lm)
+{
+  dso_info_t *dso = lm->dso_info;
+  if (dso == NULL || dso->table == NULL || dso->nsymbols < 2) return;
+
+  uintptr_t dist = dso->is_relocatable ? dso->start_to_ref_dist : 0;
+  long built = 0;
+  long i;
+
+  for (i = 0; i + 1 < dso->nsymbols; i++) {
+    // stop if the module has been unmapped meanwhile
+    if (lm->dso_info != dso) break;
+
+    uintptr_t start = (uintptr_t) dso->table[i] + dist;
+    uintptr_t end   = (uintptr_t) dso->table[i + 1] + dist;
+    if (start >= end) continue;
+
+    ilmstat_btuwi_pair_t *ilm_btui =
+      uw_recipe_map_insert_deferred(start, end, lm, NATIVE_UNWINDER);
+
+    // a sampling thread may have got here first
+    tree_stat_t oldstat = DEFERRED;
+    if (atomic_compare_exchange_strong_explicit(&ilm_btui->stat, &oldstat, FORTHCOMING,
+						memory_order_release, memory_order_relaxed)) {
+      // the segv handler only recovers from faults while handling a sample
+      hpcrun_set_handling_sample(td);
+      if (uw_recipe_map_build(td, ilm_btui, NATIVE_UNWINDER)) built++;
+      hpcrun_clear_handling_sample(td);
+    }
+  }
+
+  TMSG(UW_RECIPE_MAP, "eager: built %ld of %ld functions in %s", built,
+       (long) dso->nsymbols - 1, lm->name);
+}
+
+
+static void *
+uw_recipe_map_eager_loop(void *arg)
+{
+  // samples belong to application threads, not to this one, but a
+  // fault in build_intervals must still reach the segv handler
+  sigset_t mask;
+  sigfillset(&mask);
+  sigdelset(&mask, SIGSEGV);
+  sigdelset(&mask, SIGBUS);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+  int id = hpcrun_threadMgr_internal_id();
+  thread_data_t *td = hpcrun_allocate_thread_data(id);
+  hpcrun_set_thread_data(td);
+  hpcrun_thread_data_init(id, NULL, 0, hpcrun_get_num_sample_sources());
+
+  for (;;) {
+    while (sem_wait(&eager_sem) != 0) {
+      // EINTR
+    }
+
+    // take the whole queue and build the oldest module first
+    eager_item_t *list = (eager_item_t *) atomic_exchange(&eager_queue, 0);
+    eager_item_t *oldest = NULL;
+    while (list != NULL) {
+      eager_item_t *next = list->next;
+      list->next = oldest;
+      oldest = list;
+      list = next;
+    }
+    for (; oldest != NULL; oldest = oldest->next) {
+      uw_recipe_map_eager_build(td, oldest->lm);
+    }
+  }
+  return NULL;
+}
+
+
+// Called from the signal handler.
+//
+static void
+uw_recipe_map_eager_enqueue(load_module_t *lm)
+{
+  if (lm == NULL || atomic_load(&eager_state) != 1) return;
+
+  // once per mapping of the module
+  uint_least64_t bit = (uint_least64_t) 1 << (lm->id % 64);
+  if (atomic_fetch_or(&eager_requested[lm->id / 64], bit) & bit) return;
+
+  eager_item_t *item = (eager_item_t *) hpcrun_malloc(sizeof(eager_item_t));
+  if (item == NULL) return;
+  item->lm = lm;
+
+  uintptr_t head = atomic_load(&eager_queue);
+  do {
+    item->next = (eager_item_t *) head;
+  } while (! atomic_compare_exchange_weak(&eager_queue, &head, (uintptr_t) item));
+
+  sem_post(&eager_sem);
+}
+
+
+static void
+uw_recipe_map_eager_init(void)
+{
+  // after a fork, the child has no helper thread and an empty queue
+  eager_enabled = hpcrun_get_env_bool(HPCRUN_EAGER_UNWIND);
+  atomic_store(&eager_queue, 0);
+  atomic_store(&eager_state, 0);
+  int k;
+  for (k = 0; k < EAGER_MODULE_WORDS; k++) {
+    atomic_store_explicit(&eager_requested[k], 0, memory_order_relaxed);
+  }
+  if (eager_enabled) {
+    sem_init(&eager_sem, 0, 0);
+  }
+}
+
+
+void
+uw_recipe_map_eager_start(void)
+{
+  if (! eager_enabled) return;
+
+  int state = 0;
+  if (! atomic_compare_exchange_strong(&eager_state, &state, 1)) return;
+
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  // the builder must not share thread 0's data
+  hpcrun_threaded_data_init();
+
+  // create the builder without libmonitor watching
+  monitor_disable_new_threads();
+  int ret = pthread_create(&thread, &attr, uw_recipe_map_eager_loop, NULL);
+  monitor_enable_new_threads();
+
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    EMSG("unable to create eager unwind thread, building intervals on demand");
+    atomic_store(&eager_state, -1);
+  }
+}
+
+
 static void
 uw_recipe_map_notify_map(load_module_t* lm)
 {
@@ -591,6 +836,9 @@ uw_recipe_map_notify_unmap(load_module_t* lm)
   thread_data_t *td = hpcrun_get_thread_data();
   uw_hash_delete_range(td->uw_hash_table, start, end);
 
+  // build it again if it is mapped again and sampled
+  atomic_fetch_and(&eager_requested[lm->id / 64], ~((uint_least64_t) 1 << (lm->id % 64)));
+
   uw_recipe_map_report_and_dump("*** unmap: after poisoning", start, end);
 }
 
@@ -643,6 +891,7 @@ uw_recipe_map_init(void)
 	       ilmstat_btuwi_pair_cmp, ilmstat_btuwi_pair_inrange, my_alloc);
 
   uw_recipe_map_notify_init();
+  uw_recipe_map_eager_init();
 
   // initialize the map with a POISONED node ({([0, UINTPTR_MAX), NULL), NEVER}, NULL)
   for (uw = 0; uw < NUM_UNWINDERS; uw++)
@@ -770,19 +1019,7 @@ uw_recipe_map_lookup(void *addr, unwinder_t uw, unwindr_info_t *unwr_info)
       return false;
     }
 
-    // bounding addresses found; set DEFERRED state and pair it with
-    // (bitree_uwi_t*)NULL and try to insert into map:
-    ilm_btui =
-      ilmstat_btuwi_pair_malloc((uintptr_t)fcn_start, (uintptr_t)fcn_end, lm,
-        DEFERRED, my_alloc);
-    
-    csklnode_t *node = cskl_insert(unwinder_to_cskiplist[uw], ilm_btui, my_alloc);
-    if (ilm_btui !=  (ilmstat_btuwi_pair_t*)node->val) {
-      // interval_ldmod_pair ([fcn_start, fcn_end), lm) is already in the map,
-      // so free the unused copy and use the mapped one
-      ilmstat_btuwi_pair_free(ilm_btui, uw);
-      ilm_btui = (ilmstat_btuwi_pair_t*)node->val;
-    }
+    ilm_btui = uw_recipe_map_insert_deferred((uintptr_t)fcn_start, (uintptr_t)fcn_end, lm, uw);
     }
 #if UW_RECIPE_MAP_DEBUG
     assert(ilm_btui != NULL);
@@ -791,37 +1028,15 @@ uw_recipe_map_lookup(void *addr, unwinder_t uw, unwindr_info_t *unwr_info)
     if (atomic_compare_exchange_strong_explicit(&ilm_btui->stat, &oldstat, FORTHCOMING,
                   memory_order_release, memory_order_relaxed)) {
       // it is my responsibility to build the tree of intervals for the function
-      void *fcn_start = (void*)ilm_btui->interval.start;
-      void *fcn_end   = (void*)ilm_btui->interval.end;
-
-      // ----------------------------------------------------------
-      // potentially crash in this statement. need to save the state 
-      // ----------------------------------------------------------
-
-      sigjmp_buf_t *oldjmp = td->current_jmp_buf;       // store the outer sigjmp
-
-      td->current_jmp_buf  = &(td->bad_interval);
-
-      int ljmp = sigsetjmp(td->bad_interval.jb, 1);
-      if (ljmp == 0) {
-        btuwi_status_t btuwi_stat = build_intervals(fcn_start, fcn_end - fcn_start, uw);
-        if (btuwi_stat.error != 0) {
-          TMSG(UW_RECIPE_MAP, "build_intervals: fcn range %p to %p: error %d",
-         fcn_start, fcn_end, btuwi_stat.error);
-        }
-        ilm_btui->btuwi = bitree_uwi_rebalance(btuwi_stat.first, btuwi_stat.count);
-        atomic_store_explicit(&ilm_btui->stat, READY, memory_order_release);
-
-        td->current_jmp_buf = oldjmp;   // restore the outer sigjmp
-
-      } else {
-        td->current_jmp_buf = oldjmp;   // restore the outer sigjmp
-        EMSG("Fail to get interval %p to %p", fcn_start, fcn_end);
-        atomic_store_explicit(&ilm_btui->stat, NEVER, memory_order_release);
+      if (!uw_recipe_map_build(td, ilm_btui, uw)) {
         // I am going to switch an unwinder because it does not help
         //uw_hash_delete(td->uw_hash_table, addr);
         return false;
       }
+      // the module is being sampled: have the helper build the rest of it
+      if (eager_enabled && uw == NATIVE_UNWINDER) {
+        uw_recipe_map_eager_enqueue(ilm_btui->lm);
+      }
     }
     else {
       while (FORTHCOMING == oldstat)
@@ -60,6 +60,16 @@ void
 uw_recipe_map_init(void);
 
 
+/*
+ * start the thread that builds the intervals of sampled load modules
+ * ahead of the samples in their other functions, if
+ * HPCRUN_EAGER_UNWIND is set.  called at process init; later calls do
+ * nothing.
+ */
+void
+uw_recipe_map_eager_start(void);
+
+
 /*
  * if addr is found in range in the map, return true and
  *   *unwr_info is the ilmstat_btuwi_pair_t ( ([start, end), ldmod, status), btuwi ),
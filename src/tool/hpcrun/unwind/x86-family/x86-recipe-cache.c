@@ -0,0 +1,665 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+// A cache of x86 unwind recipes on disk.  Without it, every process
+// decodes each function the first time it is sampled there, in the
+// signal handler, and in a large parallel job every process decodes
+// the same hot functions and takes the same latency spike.
+//
+// Each load module with a build-id has a recipe file in the module
+// cache directory (see utilities/module-cache.c).  The file is a small
+// header followed by a sequence of records, one per function: the
+// function bounds, then its intervals, with addresses relative to the
+// module's reference point.  When a module is mapped, we mmap its file
+// and index the records by function start.  build_intervals() then
+// rebuilds the intervals of a function found in the index instead of
+// decoding it, and keeps the intervals it does decode for the file, so
+// that later runs find them.
+//
+// Notes:
+// 1. Only one process at a time rewrites a recipe file: the one that
+// holds an flock on its lock file, taken when the module is mapped and
+// kept until it is unmapped.  Other processes only read.
+//
+// 2. The signal handler does no file I/O.  It copies each new record
+// into memory from hpcrun_malloc and pushes it on a lock-free list of
+// the module.  When the module is unmapped, or at process exit, the
+// writer copies the valid part of the old file and the new records to
+// a new file and renames it over the old one.  Files are never
+// truncated or appended to in place, so a process that has the old
+// one mapped keeps reading it safely.  Records past PENDING_LIMIT bytes
+// are dropped; the next run decodes those functions again.
+//
+// 3. Records are validated when the file is indexed, and the index
+// stops at the first bad one, which the rewrite then leaves out.  A
+// file from another version of hpctoolkit is replaced.  If a function
+// appears twice, the first record wins.
+//
+// 4. Records saved in this run are not indexed until the next one.
+
+//***************************************************************************
+
+#include <sys/types.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <include/hpctoolkit-config.h>
+#include <hpcrun/device-finalizers.h>
+#include <hpcrun/loadmap.h>
+#include <memory/hpcrun-malloc.h>
+#include <memory/mmap.h>
+#include <messages/messages.h>
+#include <utilities/module-cache.h>
+
+#include <lib/prof-lean/stdatomic.h>
+
+#include "x86-recipe-cache.h"
+#include "x86-unwind-interval.h"
+
+
+#define RECIPE_CACHE_MAGIC  "HPCUWRC1"
+#define RECIPE_CACHE_VERSION_LEN  32
+
+// Most bytes of new records a process keeps for its recipe files.
+#define PENDING_LIMIT  (16 * 1024 * 1024)
+
+// Load module ids are 16 bits.
+#define MAX_MODULES  (UINT16_MAX + 1)
+
+// Header of a recipe file.  Records follow.
+struct recipe_cache_header {
+  char      magic[8];
+  char      version[RECIPE_CACHE_VERSION_LEN];
+  uint32_t  word_size;
+  uint32_t  interval_size;
+};
+
+// A function and its number of intervals, which follow.  Addresses
+// here and in the intervals are relative to the reference point of the
+// load module (start_to_ref_dist).
+struct recipe_cache_function {
+  uint64_t  start;
+  uint64_t  end;
+  uint32_t  count;
+  int32_t   error;
+};
+
+struct recipe_cache_interval {
+  uint64_t  start;
+  uint64_t  end;
+  int32_t   ra_status;
+  int32_t   sp_ra_pos;
+  int32_t   sp_bp_pos;
+  int32_t   bp_status;
+  int32_t   bp_ra_pos;
+  int32_t   bp_bp_pos;
+  int32_t   has_tail_calls;
+  int32_t   pad;
+};
+
+// A record waiting to be written, and the next one on its list.
+typedef struct pending_record_s {
+  struct pending_record_s *next;
+  size_t size;
+  struct recipe_cache_function function;  // intervals follow
+} pending_record_t;
+
+typedef struct recipe_cache_entry_s {
+  uint64_t  start;
+  const struct recipe_cache_function *function;
+} recipe_cache_entry_t;
+
+// The recipe file of one mapped load module.
+typedef struct recipe_cache_s {
+  recipe_cache_entry_t *index;  // functions sorted by start
+  size_t num_functions;
+  const char *base;             // the mapped file, if it has records
+  size_t valid;                 // length of its valid part, or 0
+  int lock_fd;                  // >= 0 if this process rewrites the file
+  atomic_uintptr_t pending;     // new records, most recent first
+  char path[PATH_MAX];
+} recipe_cache_t;
+
+static atomic_uintptr_t module_caches[MAX_MODULES];
+
+static atomic_size_t pending_bytes = ATOMIC_VAR_INIT(0);
+
+
+//*****************************************************************
+// Reading and indexing recipe files
+//*****************************************************************
+
+// Returns: offset of the record after the one at 'pos', or else 0 if
+// there is no valid record at 'pos'.
+//
+static size_t
+record_next(const char *base, size_t size, size_t pos)
+{
+  const struct recipe_cache_function *fn;
+  const struct recipe_cache_interval *iv;
+  uint32_t k;
+
+  if (size - pos < sizeof(*fn)) {
+    return 0;
+  }
+  fn = (const struct recipe_cache_function *) (base + pos);
+  iv = (const struct recipe_cache_interval *) (fn + 1);
+
+  if (fn->count == 0 || fn->start >= fn->end
+      || fn->count > (size - pos - sizeof(*fn)) / sizeof(*iv)) {
+    return 0;
+  }
+
+  // the intervals must tile the function, in order
+  uint64_t addr = fn->start;
+  for (k = 0; k < fn->count; k++) {
+    if (iv[k].start != addr || iv[k].end < iv[k].start || iv[k].end > fn->end
+	|| iv[k].ra_status < RA_SP_RELATIVE || iv[k].ra_status > POISON
+	|| iv[k].bp_status < BP_UNCHANGED || iv[k].bp_status > BP_HOSED) {
+      return 0;
+    }
+    addr = iv[k].end;
+  }
+  if (addr != fn->end) {
+    return 0;
+  }
+
+  return pos + sizeof(*fn) + fn->count * sizeof(*iv);
+}
+
+
+static bool
+entry_less(const recipe_cache_entry_t *x, const recipe_cache_entry_t *y)
+{
+  return x->start < y->start
+    || (x->start == y->start && x->function < y->function);
+}
+
+
+static void
+sift_down(recipe_cache_entry_t *a, size_t root, size_t n)
+{
+  for (;;) {
+    size_t child = 2 * root + 1;
+    if (child >= n) {
+      return;
+    }
+    if (child + 1 < n && entry_less(&a[child], &a[child + 1])) {
+      child++;
+    }
+    if (! entry_less(&a[root], &a[child])) {
+      return;
+    }
+    recipe_cache_entry_t tmp = a[root];
+    a[root] = a[child];
+    a[child] = tmp;
+    root = child;
+  }
+}
+
+
+// Heapsort, so as not to depend on qsort's allocator at map time.
+//
+static void
+sort_entries(recipe_cache_entry_t *a, size_t n)
+{
+  size_t k;
+
+  for (k = n / 2; k > 0; k--) {
+    sift_down(a, k - 1, n);
+  }
+  for (k = n; k > 1; k--) {
+    recipe_cache_entry_t tmp = a[0];
+    a[0] = a[k - 1];
+    a[k - 1] = tmp;
+    sift_down(a, 0, k - 1);
+  }
+}
+
+
+// Map the recipe file and index its records.
+// Returns: length of the valid part of the file, or 0 if the file is
+// missing or its header doesn't match.
+//
+static size_t
+cache_map(recipe_cache_t *c)
+{
+  struct recipe_cache_header hdr;
+  struct stat st;
+  size_t pos, next, n;
+
+  int fd = open(c->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+  if (fstat(fd, &st) != 0
+      || pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)
+      || memcmp(hdr.magic, RECIPE_CACHE_MAGIC, sizeof(hdr.magic)) != 0
+      || strncmp(hdr.version, HPCTOOLKIT_VERSION_STRING, RECIPE_CACHE_VERSION_LEN) != 0
+      || hdr.word_size != sizeof(void *)
+      || hdr.interval_size != sizeof(struct recipe_cache_interval)) {
+    close(fd);
+    return 0;
+  }
+
+  size_t size = st.st_size;
+  if (size == sizeof(hdr)) {
+    close(fd);
+    return size;
+  }
+  const char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return 0;
+  }
+
+  n = 0;
+  for (pos = sizeof(hdr); (next = record_next(base, size, pos)) != 0; pos = next) {
+    n++;
+  }
+  size_t valid = pos;
+  c->base = base;
+  c->valid = valid;
+
+  if (n > 0) {
+    recipe_cache_entry_t *index = hpcrun_mmap_anon(n * sizeof(*index));
+    if (index == NULL) {
+      return valid;
+    }
+    n = 0;
+    for (pos = sizeof(hdr); pos < valid; pos = record_next(base, size, pos)) {
+      index[n].function = (const struct recipe_cache_function *) (base + pos);
+      index[n].start = index[n].function->start;
+      n++;
+    }
+    sort_entries(index, n);
+
+    // keep the first record for each function
+    size_t k, m = 0;
+    for (k = 0; k < n; k++) {
+      if (m == 0 || index[k].start != index[m - 1].start) {
+	index[m++] = index[k];
+      }
+    }
+    c->index = index;
+    c->num_functions = m;
+  }
+
+  TMSG(UW_RECIPE_CACHE, "mapped %s: %ld functions", c->path, (long) c->num_functions);
+  return valid;
+}
+
+
+static bool
+write_all(int fd, const void *buf, size_t size)
+{
+  const char *p = buf;
+
+  while (size > 0) {
+    ssize_t ret = write(fd, p, size);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    p += ret;
+    size -= ret;
+  }
+  return true;
+}
+
+
+// Write the new records of 'c', after the valid records of the file we
+// mapped, to a new file and rename it over the old one.  Only the
+// holder of the lock file calls this, never from a signal handler.
+//
+static void
+cache_flush(recipe_cache_t *c)
+{
+  struct recipe_cache_header hdr;
+  char tmp_path[PATH_MAX];
+  pending_record_t *rec;
+
+  rec = (pending_record_t *) atomic_exchange(&c->pending, 0);
+  if (rec == NULL) {
+    return;
+  }
+
+  int len = snprintf(tmp_path, sizeof(tmp_path), "%s.%d", c->path, (int) getpid());
+  if (len < 0 || len >= (int) sizeof(tmp_path)) {
+    return;
+  }
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    TMSG(UW_RECIPE_CACHE, "unable to open %s: %s", tmp_path, strerror(errno));
+    return;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, RECIPE_CACHE_MAGIC, sizeof(hdr.magic));
+  strncpy(hdr.version, HPCTOOLKIT_VERSION_STRING, RECIPE_CACHE_VERSION_LEN);
+  hdr.word_size = sizeof(void *);
+  hdr.interval_size = sizeof(struct recipe_cache_interval);
+
+  bool ok = write_all(fd, &hdr, sizeof(hdr));
+  if (ok && c->base != NULL && c->valid > sizeof(hdr)) {
+    ok = write_all(fd, c->base + sizeof(hdr), c->valid - sizeof(hdr));
+  }
+  long count = 0;
+  for (; ok && rec != NULL; rec = rec->next, count++) {
+    ok = write_all(fd, &rec->function, rec->size);
+  }
+
+  ok = (close(fd) == 0) && ok;
+  if (ok && rename(tmp_path, c->path) == 0) {
+    TMSG(UW_RECIPE_CACHE, "wrote %ld new functions to %s", count, c->path);
+  }
+  else {
+    TMSG(UW_RECIPE_CACHE, "unable to write %s: %s", c->path, strerror(errno));
+    unlink(tmp_path);
+  }
+}
+
+
+// Flush and give up the cache of a module that is going away.
+//
+static void
+cache_release(recipe_cache_t *c)
+{
+  // The mapped file and the index stay: a signal handler may still be
+  // reading them.  Give up the lock so another process can write.
+  if (c != NULL && c->lock_fd >= 0) {
+    cache_flush(c);
+    int fd = c->lock_fd;
+    c->lock_fd = -1;
+    close(fd);
+  }
+}
+
+
+//*****************************************************************
+// Load module notifications
+//*****************************************************************
+
+static void
+x86_recipe_cache_notify_map(load_module_t *lm)
+{
+  char key[MODULE_CACHE_KEY_LEN];
+  char lock_path[PATH_MAX];
+
+  if (lm == NULL || lm->dso_info == NULL) return;
+
+  recipe_cache_t *c = hpcrun_malloc(sizeof(*c));
+  if (c == NULL) return;
+  memset(c, 0, sizeof(*c));
+  c->lock_fd = -1;
+
+  // recipes only make sense for the exact same code, so a module
+  // without a build-id isn't worth hashing
+  if (hpcrun_module_cache_key(lm->name, key, false) != 0
+      || hpcrun_module_cache_path(c->path, key, ".uwr") != 0
+      || hpcrun_module_cache_path(lock_path, key, ".uwr.lock") != 0) {
+    return;
+  }
+
+  // Take the writer's lock, if no other process has it, before looking
+  // at the file, so that no one rewrites it in the meantime.
+  int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) == 0) {
+    c->lock_fd = fd;
+  }
+  else if (fd >= 0) {
+    close(fd);
+  }
+
+  cache_map(c);
+
+  atomic_store(&module_caches[lm->id], (uintptr_t) c);
+}
+
+
+static void
+x86_recipe_cache_notify_unmap(load_module_t *lm)
+{
+  if (lm == NULL) return;
+
+  cache_release((recipe_cache_t *) atomic_exchange(&module_caches[lm->id], 0));
+}
+
+
+// At process exit, write out the records of the modules still mapped.
+//
+static void
+x86_recipe_cache_fini(void *arg)
+{
+  int k;
+
+  for (k = 0; k < MAX_MODULES; k++) {
+    cache_release((recipe_cache_t *) atomic_exchange(&module_caches[k], 0));
+  }
+}
+
+
+static recipe_cache_t *
+cache_for_addr(void *ins, uintptr_t *ref_dist)
+{
+  load_module_t *lm = hpcrun_loadmap_findByAddr(ins, ins);
+  if (lm == NULL) {
+    return NULL;
+  }
+  dso_info_t *dso = lm->dso_info;
+  recipe_cache_t *c = (recipe_cache_t *) atomic_load(&module_caches[lm->id]);
+  if (dso == NULL || c == NULL) {
+    return NULL;
+  }
+  *ref_dist = dso->start_to_ref_dist;
+  return c;
+}
+
+
+//*****************************************************************
+// Interface operations
+//*****************************************************************
+
+void
+x86_recipe_cache_init(void)
+{
+  static loadmap_notify_t recipe_cache_notifiers;
+  static device_finalizer_fn_entry_t recipe_cache_finalizer;
+  static bool registered = false;
+  int k;
+
+  // forget what a parent process had mapped
+  for (k = 0; k < MAX_MODULES; k++) {
+    atomic_store_explicit(&module_caches[k], 0, memory_order_relaxed);
+  }
+
+  atomic_store_explicit(&pending_bytes, 0, memory_order_relaxed);
+
+  recipe_cache_notifiers.map = x86_recipe_cache_notify_map;
+  recipe_cache_notifiers.unmap = x86_recipe_cache_notify_unmap;
+  hpcrun_loadmap_notify_register(&recipe_cache_notifiers);
+
+  // a forked child inherits the registration
+  if (! registered) {
+    registered = true;
+    recipe_cache_finalizer.fn = x86_recipe_cache_fini;
+    device_finalizer_register(device_finalizer_type_flush, &recipe_cache_finalizer);
+  }
+}
+
+
+bool
+x86_recipe_cache_lookup(void *ins, unsigned int len, btuwi_status_t *status)
+{
+  uintptr_t dist;
+  recipe_cache_t *c = cache_for_addr(ins, &dist);
+  if (c == NULL || c->num_functions == 0) {
+    return false;
+  }
+
+  uint64_t start = (uintptr_t) ins - dist;
+  size_t lo = 0, hi = c->num_functions;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (c->index[mid].start < start) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  if (lo == c->num_functions || c->index[lo].start != start) {
+    return false;
+  }
+
+  const struct recipe_cache_function *fn = c->index[lo].function;
+  if (fn->end != start + len) {
+    return false;
+  }
+
+  const struct recipe_cache_interval *iv = (const struct recipe_cache_interval *) (fn + 1);
+  unwind_interval *first = NULL;
+  unwind_interval *prev = NULL;
+  uint32_t k;
+
+  for (k = 0; k < fn->count; k++) {
+    x86registers_t reg = {
+      iv[k].sp_ra_pos, iv[k].sp_bp_pos, (bp_loc) iv[k].bp_status,
+      iv[k].bp_ra_pos, iv[k].bp_bp_pos
+    };
+    unwind_interval *u = new_ui((char *) (uintptr_t) (iv[k].start + dist),
+				(ra_loc) iv[k].ra_status, &reg);
+    UWI_END_ADDR(u) = (uintptr_t) (iv[k].end + dist);
+    UWI_RECIPE(u)->has_tail_calls = iv[k].has_tail_calls;
+    if (prev) {
+      bitree_uwi_set_rightsubtree(prev, u);
+    }
+    else {
+      first = u;
+    }
+    prev = u;
+  }
+
+  status->first_undecoded_ins = (char *) ins + len;
+  status->first = first;
+  status->count = fn->count;
+  status->error = fn->error;
+
+  TMSG(UW_RECIPE_CACHE, "hit: %p, %d intervals", ins, status->count);
+  return true;
+}
+
+
+void
+x86_recipe_cache_save(void *ins, unsigned int len, btuwi_status_t *status)
+{
+  uintptr_t dist;
+  recipe_cache_t *c = cache_for_addr(ins, &dist);
+  if (c == NULL || c->lock_fd < 0 || status->first == NULL
+      || status->count <= 0) {
+    return;
+  }
+
+  size_t size = sizeof(struct recipe_cache_function)
+    + status->count * sizeof(struct recipe_cache_interval);
+  if (atomic_fetch_add(&pending_bytes, size) + size > PENDING_LIMIT) {
+    return;
+  }
+  pending_record_t *rec =
+    hpcrun_malloc(offsetof(pending_record_t, function) + size);
+  if (rec == NULL) {
+    return;
+  }
+
+  struct recipe_cache_function *fn = &rec->function;
+  struct recipe_cache_interval *iv = (struct recipe_cache_interval *) (fn + 1);
+  unwind_interval *u;
+  uint32_t k = 0;
+
+  fn->start = (uintptr_t) ins - dist;
+  fn->end = fn->start + len;
+  fn->error = status->error;
+
+  for (u = status->first; u != NULL && k < (uint32_t) status->count; u = UWI_NEXT(u), k++) {
+    x86recipe_t *xr = UWI_RECIPE(u);
+    iv[k].start = UWI_START_ADDR(u) - dist;
+    iv[k].end = UWI_END_ADDR(u) - dist;
+    iv[k].ra_status = xr->ra_status;
+    iv[k].sp_ra_pos = xr->reg.sp_ra_pos;
+    iv[k].sp_bp_pos = xr->reg.sp_bp_pos;
+    iv[k].bp_status = xr->reg.bp_status;
+    iv[k].bp_ra_pos = xr->reg.bp_ra_pos;
+    iv[k].bp_bp_pos = xr->reg.bp_bp_pos;
+    iv[k].has_tail_calls = xr->has_tail_calls;
+    iv[k].pad = 0;
+  }
+  fn->count = k;
+  rec->size = sizeof(*fn) + k * sizeof(*iv);
+
+  // a record that wouldn't pass validation is not worth writing
+  if (k == 0 || record_next((const char *) fn, rec->size, 0) != rec->size) {
+    return;
+  }
+
+  // push it for cache_flush, which takes the whole list at once
+  uintptr_t head = atomic_load(&c->pending);
+  do {
+    rec->next = (pending_record_t *) head;
+  } while (! atomic_compare_exchange_weak(&c->pending, &head, (uintptr_t) rec));
+}
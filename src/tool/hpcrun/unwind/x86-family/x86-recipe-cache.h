@@ -0,0 +1,73 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+// A cache of x86 unwind recipes on disk, one file per load module,
+// shared by all the processes that use the module cache directory.
+// See x86-recipe-cache.c.
+
+#ifndef x86_recipe_cache_h
+#define x86_recipe_cache_h
+
+#include <stdbool.h>
+
+#include "x86-unwind-interval.h"
+
+void
+x86_recipe_cache_init(void);
+
+// If the intervals for the function [ins, ins + len) are in the
+// cache, rebuild them into 'status' and return true.
+bool
+x86_recipe_cache_lookup(void *ins, unsigned int len, btuwi_status_t *status);
+
+// Keep the intervals just built for [ins, ins + len) for the cache
+// file of their load module, which is rewritten with them when the
+// module is unmapped or the process exits.  Safe in a signal handler.
+void
+x86_recipe_cache_save(void *ins, unsigned int len, btuwi_status_t *status);
+
+#endif
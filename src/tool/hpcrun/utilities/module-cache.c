@@ -0,0 +1,275 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+// A directory of files that hpcrun caches on disk for each load module,
+// such as the function bounds tables and the x86 unwind recipes.  In a
+// large parallel job, every process would otherwise analyze the same
+// application binary and the same shared libraries.
+//
+// Files are named by the ELF build-id of their load module, or, for
+// files without one, optionally by a hash of the file contents, plus
+// a suffix for each kind of file.  Each client does its own locking
+// and validation.
+//
+// The cache directory is $HPCRUN_MODULE_CACHE, or a private directory
+// under $TMPDIR (or /tmp) on each node by default.  Setting
+// HPCRUN_MODULE_CACHE to "none" (or to an empty string) turns the
+// cache off.  A directory on a shared file system works too.
+
+//***************************************************************************
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "module-cache.h"
+
+#include <messages/messages.h>
+#include <lib/prof-lean/crypto-hash.h>
+
+#if __ELF_NATIVE_CLASS == 64
+#define ELFCLASS_NATIVE  ELFCLASS64
+#else
+#define ELFCLASS_NATIVE  ELFCLASS32
+#endif
+
+// Enough of a PT_NOTE segment to find the build-id note.
+#define NOTE_BUF_SIZE  4096
+
+static int cache_enabled = 0;
+static char cache_dir[PATH_MAX];
+
+
+//*****************************************************************
+// Cache keys
+//*****************************************************************
+
+static void
+to_hex(const unsigned char *bytes, size_t len, char *str)
+{
+  static const char digits[] = "0123456789abcdef";
+  size_t k;
+
+  for (k = 0; k < len; k++) {
+    str[2*k] = digits[bytes[k] >> 4];
+    str[2*k + 1] = digits[bytes[k] & 0xf];
+  }
+  str[2*len] = 0;
+}
+
+
+// Find the GNU build-id note in the program headers of an ELF file of
+// this process's class.
+// Returns: length of the build-id, or 0 if there is none.
+//
+static size_t
+read_build_id(int fd, unsigned char *build_id)
+{
+  ElfW(Ehdr) ehdr;
+  ElfW(Phdr) phdr;
+  unsigned char notes[NOTE_BUF_SIZE];
+  int k;
+
+  if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr)
+      || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+      || ehdr.e_ident[EI_CLASS] != ELFCLASS_NATIVE
+      || ehdr.e_phentsize != sizeof(phdr)) {
+    return 0;
+  }
+
+  for (k = 0; k < ehdr.e_phnum; k++) {
+    off_t off = ehdr.e_phoff + k * sizeof(phdr);
+    if (pread(fd, &phdr, sizeof(phdr), off) != sizeof(phdr)) {
+      return 0;
+    }
+    if (phdr.p_type != PT_NOTE) {
+      continue;
+    }
+
+    size_t len = phdr.p_filesz < NOTE_BUF_SIZE ? phdr.p_filesz : NOTE_BUF_SIZE;
+    ssize_t got = pread(fd, notes, len, phdr.p_offset);
+    if (got < (ssize_t) sizeof(ElfW(Nhdr))) {
+      continue;
+    }
+
+    // notes are 4-byte aligned in their name and description
+    size_t pos = 0;
+    while (pos + sizeof(ElfW(Nhdr)) <= (size_t) got) {
+      ElfW(Nhdr) *nhdr = (ElfW(Nhdr) *) (notes + pos);
+      size_t name_pos = pos + sizeof(ElfW(Nhdr));
+      size_t desc_pos = name_pos + ((nhdr->n_namesz + 3) & ~3);
+      size_t next = desc_pos + ((nhdr->n_descsz + 3) & ~3);
+      if (next > (size_t) got) {
+	break;
+      }
+      if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4
+	  && memcmp(notes + name_pos, "GNU", 4) == 0
+	  && nhdr->n_descsz > 0 && nhdr->n_descsz <= MODULE_CACHE_MAX_BUILD_ID) {
+	memcpy(build_id, notes + desc_pos, nhdr->n_descsz);
+	return nhdr->n_descsz;
+      }
+      pos = next;
+    }
+  }
+
+  return 0;
+}
+
+
+//*****************************************************************
+// Interface operations
+//*****************************************************************
+
+void
+hpcrun_module_cache_init(void)
+{
+  const char *dir = getenv("HPCRUN_MODULE_CACHE");
+  struct stat st;
+  int len;
+
+  cache_enabled = 0;
+
+  if (dir != NULL) {
+    if (dir[0] == 0 || strcmp(dir, "none") == 0) {
+      return;
+    }
+    len = snprintf(cache_dir, PATH_MAX, "%s", dir);
+    if (len <= 0 || len >= PATH_MAX) {
+      return;
+    }
+    mkdir(cache_dir, 0755);
+  }
+  else {
+    // a private directory per user on each node
+    const char *tmp = getenv("TMPDIR");
+    if (tmp == NULL || tmp[0] == 0) {
+      tmp = "/tmp";
+    }
+    len = snprintf(cache_dir, PATH_MAX, "%s/hpctoolkit-cache-%d",
+		   tmp, (int) getuid());
+    if (len <= 0 || len >= PATH_MAX) {
+      return;
+    }
+    mkdir(cache_dir, 0700);
+    if (stat(cache_dir, &st) != 0 || st.st_uid != getuid()) {
+      return;
+    }
+  }
+
+  if (stat(cache_dir, &st) != 0 || !S_ISDIR(st.st_mode)
+      || access(cache_dir, R_OK | W_OK | X_OK) != 0) {
+    TMSG(MODULE_CACHE, "unable to use directory %s", cache_dir);
+    return;
+  }
+
+  TMSG(MODULE_CACHE, "directory %s", cache_dir);
+  cache_enabled = 1;
+}
+
+
+int
+hpcrun_module_cache_key(const char *fname, char *key, bool hash_contents)
+{
+  unsigned char id[MODULE_CACHE_MAX_BUILD_ID];
+  struct stat st;
+  size_t len;
+  int ret = -1;
+
+  // a copy of [vdso] may still be being written by another process
+  if (! cache_enabled || fname == NULL || strstr(fname, "[vdso]") != NULL) {
+    return -1;
+  }
+
+  int fd = open(fname, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return -1;
+  }
+
+  len = read_build_id(fd, id);
+  if (len > 0) {
+    key[0] = 'b';
+    to_hex(id, len, key + 1);
+    ret = 0;
+  }
+  else if (hash_contents) {
+    void *contents = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (contents != MAP_FAILED) {
+      unsigned char hash[HASH_LENGTH];
+      crypto_hash_compute(contents, st.st_size, hash, HASH_LENGTH);
+      munmap(contents, st.st_size);
+      key[0] = 'h';
+      to_hex(hash, HASH_LENGTH, key + 1);
+      ret = 0;
+    }
+  }
+
+  close(fd);
+  return ret;
+}
+
+
+int
+hpcrun_module_cache_path(char *path, const char *key, const char *suffix)
+{
+  if (! cache_enabled) {
+    return -1;
+  }
+  int len = snprintf(path, PATH_MAX, "%s/%s%s", cache_dir, key, suffix);
+  return (len > 0 && len < PATH_MAX) ? 0 : -1;
+}
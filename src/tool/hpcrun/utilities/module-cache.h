@@ -0,0 +1,75 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+// A directory of files cached on disk for each load module, keyed by
+// the module's build-id and shared by all the processes that use the
+// directory.  See module-cache.c.
+
+#ifndef _MODULE_CACHE_H_
+#define _MODULE_CACHE_H_
+
+#include <stdbool.h>
+
+// Longest build-id we accept: sha1 is 20 bytes, some linkers use more.
+#define MODULE_CACHE_MAX_BUILD_ID  64
+
+#define MODULE_CACHE_KEY_LEN  (2 * MODULE_CACHE_MAX_BUILD_ID + 8)
+
+void hpcrun_module_cache_init(void);
+
+// Compute the cache key for the load module 'fname' into 'key', which
+// holds MODULE_CACHE_KEY_LEN chars.  If the module has no build-id and
+// 'hash_contents' is set, the key is a hash of the file contents.
+// Returns: 0 on success, else -1 if the module can't be cached.
+int hpcrun_module_cache_key(const char *fname, char *key, bool hash_contents);
+
+// Fill in 'path' (PATH_MAX chars) with the name of the cache file for
+// 'key' with file name suffix 'suffix'.
+// Returns: 0 on success, else -1 if the cache is disabled.
+int hpcrun_module_cache_path(char *path, const char *key, const char *suffix);
+
+#endif  // _MODULE_CACHE_H_
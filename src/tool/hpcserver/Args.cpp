@@ -120,6 +120,8 @@ Options: General\n\
                            indicates that the port will be auto-negotiated with\n\
                            the client. Specifying 1 indicates that the xml will\n\
                            be transferred on the main data port.\n\
+  -t, --threads        Sets the number of threads that read and compress trace\n\
+                           lines (default is the number of online CPUs).\n\
 \n\
 ";
 
@@ -149,6 +151,8 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
      CLP::isOptArg_long },
   {  'x' , "xmlport",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      CLP::isOptArg_long },
+  {  't' , "threads",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     CLP::isOptArg_long },
   CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
 };
 
@@ -178,6 +182,7 @@ Args::Ctor()
   compression = true;
   mainPort = DEFAULT_PORT;//21590
   xmlPort = 0;
+  numThreads = 0;
 }
 
 
@@ -270,6 +275,12 @@ Args::parse(int argc, const char* const argv[])
       if (xmlPort < 1024 && xmlPort > 1)
     	   ARG_ERROR("Ports must be greater than 1024.")
     }
+    if (parser.isOpt("threads")) {
+      const string& arg = parser.getOptArg("threads");
+      numThreads = (int) CmdLineParser::toLong(arg);
+      if (numThreads < 1)
+    	   ARG_ERROR("The number of threads must be at least 1.")
+    }
   }
   catch (const CmdLineParser::ParseError& x) {
     ARG_ERROR(x.what());
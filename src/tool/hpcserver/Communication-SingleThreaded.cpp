@@ -58,6 +58,11 @@
 //***************************************************************************
 
 #include <stdint.h>                     // for uint64_t
+#include <pthread.h>                    // for pthread_create, etc
+#include <unistd.h>                     // for sysconf
+#include <algorithm>                    // for min, max
+#include <deque>                        // for deque
+#include <exception>                    // for exception_ptr
 #include <iostream>                     // for operator<<, basic_ostream, etc
 #include <string>                       // for string
 #include <vector>                       // for vector, vector<>::iterator
@@ -101,46 +106,176 @@ void Communication::sendStartGetData(SpaceTimeDataController* contr, int process
 
 
 }
-void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller)
+//A trace line that a worker has read and compressed, waiting to be
+//written to the socket
+struct FilledLine
 {
-	// TODO: Make this so that the Lines get sent as soon as they are
-	// filled.
+	int line;
+	int entries;
+	Time begTime;
+	Time endTime;
+	DataCompressionLayer* compr;
+};
 
-	controller->fillTraces();
-	for (int i = 0; i < controller->tracesLength; i++)
+struct FilledLineQueue
+{
+	SpaceTimeDataController* controller;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	deque<FilledLine> lines;
+	//The first exception thrown by a worker, rethrown on the main thread;
+	//the other workers stop at their next line
+	exception_ptr error;
+};
+
+static void compressLine(ProcessTimeline* timeline, FilledLine* filled)
+{
+	vector<TimeCPID>& data = *timeline->data->listCPID;
+
+	filled->line = timeline->line();
+	filled->entries = data.size();
+	filled->begTime = data[0].timestamp;
+	filled->endTime = data[data.size() - 1].timestamp;
+
+	DEBUGCOUT(2) << "Sending process timeline with " << data.size() << " entries" << endl;
+
+	DataCompressionLayer* comprStr = new DataCompressionLayer();
+	vector<TimeCPID>::iterator it;
+	Time currentTime = data[0].timestamp;
+	for (it = data.begin(); it != data.end(); ++it)
 	{
+		comprStr->writeInt( (int)(it->timestamp - currentTime));
+		comprStr->writeInt( it->cpid);
+		currentTime = it->timestamp;
+	}
+	comprStr->flush();
+	filled->compr = comprStr;
+}
 
-		ProcessTimeline* timeline = controller->traces[i];
-		stream->writeInt( timeline->line());
-		vector<TimeCPID> data = *timeline->data->listCPID;
-		stream->writeInt( data.size());
-		// Begin time
-		stream->writeLong( data[0].timestamp);
-		//End time
-		stream->writeLong( data[data.size() - 1].timestamp);
+static bool lineFailed(FilledLineQueue* queue)
+{
+	pthread_mutex_lock(&queue->lock);
+	bool failed = (queue->error != nullptr);
+	pthread_mutex_unlock(&queue->lock);
+	return failed;
+}
+
+static void* fillLines(void* arg)
+{
+	FilledLineQueue* queue = (FilledLineQueue*) arg;
+
+	try
+	{
+		ProcessTimeline* nextTrace = queue->controller->getNextTrace();
+		while (nextTrace != NULL && !lineFailed(queue))
+		{
+			nextTrace->readInData();
+			queue->controller->addNextTrace(nextTrace);
+
+			FilledLine filled;
+			compressLine(nextTrace, &filled);
+
+			pthread_mutex_lock(&queue->lock);
+			queue->lines.push_back(filled);
+			pthread_cond_signal(&queue->ready);
+			pthread_mutex_unlock(&queue->lock);
+
+			nextTrace = queue->controller->getNextTrace();
+		}
+	}
+	catch (...)
+	{
+		pthread_mutex_lock(&queue->lock);
+		if (queue->error == nullptr)
+			queue->error = current_exception();
+		pthread_cond_signal(&queue->ready);
+		pthread_mutex_unlock(&queue->lock);
+	}
+	return NULL;
+}
+
+static int getNumFillThreads(int numLines)
+{
+	int numThreads = numWorkerThreads;
+	if (numThreads < 1)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		numThreads = (cpus > 0) ? (int) cpus : 1;
+	}
+	return max(1, min(numThreads, numLines));
+}
+
+void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller)
+{
+	// Lines are read and compressed by a pool of workers and sent as soon
+	// as each one is done, so they go out of order. Every line starts with
+	// its line number, which the client already relies on for the lines
+	// coming from the MPI slaves.
 
-		DataCompressionLayer comprStr;
+	controller->resetTraces();
 
-		vector<TimeCPID>::iterator it;
-		DEBUGCOUT(2) << "Sending process timeline with " << data.size() << " entries" << endl;
+	FilledLineQueue queue;
+	queue.controller = controller;
+	pthread_mutex_init(&queue.lock, NULL);
+	pthread_cond_init(&queue.ready, NULL);
 
+	int numThreads = getNumFillThreads(controller->tracesLength);
+	vector<pthread_t> workers;
+	for (int i = 0; i < numThreads; i++)
+	{
+		pthread_t worker;
+		if (pthread_create(&worker, NULL, fillLines, &queue) != 0)
+			break;
+		workers.push_back(worker);
+	}
+	DEBUGCOUT(1) << "Filling " << controller->tracesLength << " lines with "
+			<< workers.size() << " threads" << endl;
+	if (workers.empty())
+		fillLines(&queue);
 
-		Time currentTime = data[0].timestamp;
-		for (it = data.begin(); it != data.end(); ++it)
+	for (int i = 0; i < controller->tracesLength; i++)
+	{
+		pthread_mutex_lock(&queue.lock);
+		while (queue.lines.empty() && queue.error == nullptr)
+			pthread_cond_wait(&queue.ready, &queue.lock);
+		if (queue.error != nullptr)
 		{
-			comprStr.writeInt( (int)(it->timestamp - currentTime));
-			comprStr.writeInt( it->cpid);
-			currentTime = it->timestamp;
+			pthread_mutex_unlock(&queue.lock);
+			break;
 		}
-		comprStr.flush();
-		int outputBufferLen = comprStr.getOutputLength();
-		char* outputBuffer = (char*)comprStr.getOutputBuffer();
+		FilledLine filled = queue.lines.front();
+		queue.lines.pop_front();
+		pthread_mutex_unlock(&queue.lock);
+
+		stream->writeInt( filled.line);
+		stream->writeInt( filled.entries);
+		// Begin time
+		stream->writeLong( filled.begTime);
+		//End time
+		stream->writeLong( filled.endTime);
+
+		int outputBufferLen = filled.compr->getOutputLength();
+		char* outputBuffer = (char*)filled.compr->getOutputBuffer();
 
 		stream->writeInt(outputBufferLen);
 
 		stream->writeRawData(outputBuffer, outputBufferLen);
+		delete filled.compr;
 		prog->incrementProgress();
 	}
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		pthread_join(workers[i], NULL);
+	pthread_mutex_destroy(&queue.lock);
+	pthread_cond_destroy(&queue.ready);
+
+	if (queue.error != nullptr)
+	{
+		for (unsigned int i = 0; i < queue.lines.size(); i++)
+			delete queue.lines[i].compr;
+		rethrow_exception(queue.error);
+	}
+
 	stream->flush();
 }
 
@@ -87,6 +87,12 @@ class Range {
 			max = _max;
 			stride = _stride;
 		}
+		int getMin(){
+			return min;
+		}
+		int getMax(){
+			return max;
+		}
 };
 
 struct BinaryRepresentationOfFilter{
@@ -113,6 +119,12 @@ public:
 	bool matches (int processNum, int threadNum){
 		return (process.matches(processNum) && thread.matches(threadNum));
 	}
+	Range getProcess(){
+		return process;
+	}
+	Range getThread(){
+		return thread;
+	}
 private:
 	Range process;
 	Range thread;
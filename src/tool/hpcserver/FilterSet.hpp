@@ -78,6 +78,12 @@ public:
 	void add(Filter toAdd){
 		filters.push_back(toAdd);
 	}
+	vector<Filter>& getFilters(){
+		return filters;
+	}
+	bool isExcludeMatched(){
+		return excludeMatched;
+	}
 	bool matches(int proc, int thread) {
 		bool matchedSoFar = true;
 		vector<Filter>::iterator it;
@@ -62,6 +62,8 @@
 
 
 #include <assert.h>
+#include <algorithm>
+#include <climits>
 #include <iostream>
 
 
@@ -69,16 +71,66 @@
 #include "FilteredBaseData.hpp"
 
 namespace TraceviewerServer {
+
+//Orders ranks by (process ID, thread ID, rank), and compares them against
+//a (process ID, thread ID) key for searches
+struct IDKey {
+	int process;
+	int thread;
+};
+
+class RankIDComparator {
+	int* processIDs;
+	short* threadIDs;
+public:
+	RankIDComparator(int* _processIDs, short* _threadIDs) {
+		processIDs = _processIDs;
+		threadIDs = _threadIDs;
+	}
+	bool operator()(int a, int b) {
+		if (processIDs[a] != processIDs[b])
+			return processIDs[a] < processIDs[b];
+		if (threadIDs[a] != threadIDs[b])
+			return threadIDs[a] < threadIDs[b];
+		return a < b;
+	}
+	bool operator()(int rank, IDKey key) {
+		if (processIDs[rank] != key.process)
+			return processIDs[rank] < key.process;
+		return threadIDs[rank] < key.thread;
+	}
+};
+
+static IDKey makeKey(int process, int thread)
+{
+	IDKey key;
+	key.process = process;
+	key.thread = thread;
+	return key;
+}
+
 FilteredBaseData::FilteredBaseData(string filename, int _headerSize) {
 	baseDataFile = new BaseDataFile(filename, _headerSize);
 	headerSize = _headerSize;
+	summary = NULL;
 	baseOffsets = baseDataFile->getOffsets();
-	//Filters are default, which is allow everything, so this will initialize the vector
+
+	int numFiles = baseDataFile->getNumberOfFiles();
+	ranksByID.resize(numFiles);
+	for (int i = 0; i < numFiles; i++)
+		ranksByID[i] = i;
+	sort(ranksByID.begin(), ranksByID.end(),
+			RankIDComparator(baseDataFile->processIDs, baseDataFile->threadIDs));
+	rankMapping = new RankBitmap(numFiles);
+
+	//Filters are default, which is allow everything, so this will initialize the bitmap
 	filter();
 
 }
 
 FilteredBaseData::~FilteredBaseData() {
+	delete summary;
+	delete rankMapping;
 	delete baseDataFile;
 }
 
@@ -89,27 +141,67 @@ void FilteredBaseData::setFilters(FilterSet _filter)
 	filter();
 }
 
+//Same result as checking currentlyAppliedFilter.matches for every rank, but
+//each filter only visits the ranks in its process and thread ranges, and
+//the filters are combined a word of ranks at a time
 void FilteredBaseData::filter()
 {
 	int numFiles = baseDataFile->getNumberOfFiles();
-	rankMapping.clear();
-	for (int i = 0; i < numFiles; i++) {
-		if (currentlyAppliedFilter.matches(baseDataFile->processIDs[i], baseDataFile->threadIDs[i])){
-			rankMapping.push_back(i);
+	vector<Filter>& filters = currentlyAppliedFilter.getFilters();
+	bool excludeMatched = currentlyAppliedFilter.isExcludeMatched();
+
+	rankMapping->setAll();
+	RankBitmap matched(numFiles);
+	vector<Filter>::iterator it;
+	for (it = filters.begin(); it != filters.end(); ++it) {
+		matched.clear();
+		markMatches(*it, matched);
+		if (excludeMatched)
+			rankMapping->subtract(matched);
+		else
+			rankMapping->intersect(matched);
+	}
+	rankMapping->buildIndex();
+
+	DEBUGCOUT(1) << "Filtering matched " << rankMapping->count() << " out of "<<numFiles<<endl;
+}
+
+void FilteredBaseData::markMatches(Filter& f, RankBitmap& matched)
+{
+	Range process = f.getProcess();
+	Range thread = f.getThread();
+	RankIDComparator comp(baseDataFile->processIDs, baseDataFile->threadIDs);
+
+	vector<int>::iterator it = lower_bound(ranksByID.begin(), ranksByID.end(),
+			makeKey(process.getMin(), INT_MIN), comp);
+	while (it != ranksByID.end() && baseDataFile->processIDs[*it] <= process.getMax()) {
+		int proc = baseDataFile->processIDs[*it];
+		vector<int>::iterator groupEnd = lower_bound(it, ranksByID.end(),
+				makeKey(proc, INT_MAX), comp);
+		if (process.matches(proc)) {
+			vector<int>::iterator rank = lower_bound(it, groupEnd,
+					makeKey(proc, thread.getMin()), comp);
+			for (; rank != groupEnd && baseDataFile->threadIDs[*rank] <= thread.getMax(); ++rank) {
+				if (thread.matches(baseDataFile->threadIDs[*rank]))
+					matched.set(*rank);
+			}
 		}
+		it = groupEnd;
 	}
+}
 
-	DEBUGCOUT(1) << "Filtering matched " << rankMapping.size() << " out of "<<numFiles<<endl;
+int FilteredBaseData::getRank(int pseudoRank)
+{
+	assert(pseudoRank >= 0 && pseudoRank < rankMapping->count());
+	return rankMapping->select(pseudoRank);
 }
 
 FileOffset FilteredBaseData::getMinLoc(int pseudoRank) {
-	assert((unsigned int)pseudoRank < rankMapping.size());
-	return baseOffsets[rankMapping[pseudoRank]].start + headerSize;
+	return baseOffsets[getRank(pseudoRank)].start + headerSize;
 }
 
 FileOffset FilteredBaseData::getMaxLoc(int pseudoRank){
-	assert((unsigned int)pseudoRank < rankMapping.size());
-	return baseOffsets[rankMapping[pseudoRank]].end;
+	return baseOffsets[getRank(pseudoRank)].end;
 }
 
 int64_t FilteredBaseData::getLong(FileOffset position)
@@ -123,7 +215,7 @@ int FilteredBaseData::getInt(FileOffset position)
 
 int FilteredBaseData::getNumberOfRanks()
 {
-	return rankMapping.size();
+	return rankMapping->count();
 }
 
 int* FilteredBaseData::getProcessIDs()
@@ -134,4 +226,29 @@ short* FilteredBaseData::getThreadIDs()
 {
 	return baseDataFile->threadIDs;
 }
+
+void FilteredBaseData::loadSummary(string filename, bool mayBuild)
+{
+	delete summary;
+	summary = new TraceSummary(filename, baseDataFile, headerSize, mayBuild);
+}
+
+int FilteredBaseData::getSummaryLevel(int pseudoRank, double pixelLength)
+{
+	if (summary == NULL)
+		return -1;
+	return summary->getLevel(getRank(pseudoRank), pixelLength);
+}
+
+int FilteredBaseData::getSummaryCPID(int pseudoRank, int level, Time time)
+{
+	return summary->getEntry(getRank(pseudoRank), level, time)->cpid;
+}
+
+void FilteredBaseData::narrowInterval(int pseudoRank, Time time, FileOffset& l_bound,
+		FileOffset& r_bound)
+{
+	if (summary != NULL)
+		summary->narrowInterval(getRank(pseudoRank), time, l_bound, r_bound);
+}
 }
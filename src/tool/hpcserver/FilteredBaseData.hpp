@@ -63,6 +63,8 @@
 #include "ImageTraceAttributes.hpp"
 #include "BaseDataFile.hpp"
 #include "FilterSet.hpp"
+#include "TraceSummary.hpp"
+#include "RankBitmap.hpp"
 #include "FileUtils.hpp"//For FileOffset
 
 #include <vector>
@@ -85,17 +87,31 @@ namespace TraceviewerServer
 		int getNumberOfRanks();
 		int* getProcessIDs();
 		short* getThreadIDs();
+
+		//Maps the summary of 'filename', the file this was created with,
+		//building it first if it is missing and mayBuild is set
+		void loadSummary(string filename, bool mayBuild);
+		//Cf. TraceSummary; getSummaryLevel is -1 when there is no summary
+		int getSummaryLevel(int pseudoRank, double pixelLength);
+		int getSummaryCPID(int pseudoRank, int level, Time time);
+		void narrowInterval(int pseudoRank, Time time, FileOffset& l_bound, FileOffset& r_bound);
 	private:
 
 		void filter();
+		void markMatches(Filter& f, RankBitmap& matched);
+		int getRank(int pseudoRank);
 
 		BaseDataFile* baseDataFile;
 		OffsetPair* baseOffsets;
 		FilterSet currentlyAppliedFilter;
-		//Maps the pseudoranks the program asks for from the unfiltered
-		//pool to the real ranks from the filtered pool.
-		vector<int> rankMapping;
+		//The ranks sorted by process ID, then thread ID, so that a filter
+		//only has to look at the ranks in its ranges
+		vector<int> ranksByID;
+		//The ranks that pass the filter. Pseudorank n, the one the program
+		//asks for, is the rank of the n-th set bit.
+		RankBitmap* rankMapping;
 		int headerSize;
+		TraceSummary* summary;
 	};
 
 
@@ -69,6 +69,8 @@
 #include <sys/sysctl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
 
 #include <iostream>
 #include <algorithm> //For min of two longs
@@ -92,7 +94,7 @@ namespace TraceviewerServer
 		FileOffset osPageSize = getpagesize();
 		FileOffset pageSizeMultiple = lcm(osPageSize, lcm(headerSize, SIZE_OF_TRACE_RECORD));//The page size must be a multiple of this
 
-		FileOffset ramSizeInBytes = getRamSize();
+		FileOffset ramSizeInBytes = getAvailableRamSize();
 
 		const FileOffset _64_MEGABYTE = 1 << 26;
 		//This is a pretty arbitrary algorithm, but it works
@@ -103,15 +105,18 @@ namespace TraceviewerServer
 		//want to introduce MPI-specific code here. It's not worth it... Plus, there's
 		//a ton of paging stuff going on at the OS level that we don't really know
 		//the specifics of, so the amount of RAM may be less important than it seems.
+		//Budget from the memory that is actually free, and leave room for the
+		//page being read plus one being prefetched.
 		double MAX_PORTION_OF_RAM_AVAILABLE = 0.60;//Use up to 60%
 		int MaxPages = (int)(ramSizeInBytes * MAX_PORTION_OF_RAM_AVAILABLE/mmPageSize);
-		VersatileMemoryPage::setMaxPages(MaxPages);
+		VersatileMemoryPage::setMaxPages(max(MaxPages, 2));
 
 
 		int FullPages = fileSize / mmPageSize;
 		int PartialPageSize = fileSize % mmPageSize;
 		numPages = FullPages + (PartialPageSize == 0 ? 0 : 1);
 		pageManagementList = new LRUList<VersatileMemoryPage>(numPages);
+		pthread_mutex_init(&pageLock, NULL);
 
 		FileDescriptor fd = open(sPath.c_str(), O_RDONLY);
 
@@ -121,7 +126,7 @@ namespace TraceviewerServer
 		{
 			FileOffset mapping_len = min( mmPageSize, sizeRemaining);
 
-			masterBuffer.push_back(VersatileMemoryPage(mmPageSize*i, mapping_len, fd, pageManagementList));
+			masterBuffer.push_back(new VersatileMemoryPage(mmPageSize*i, mapping_len, fd, pageManagementList));
 
 			sizeRemaining -= mapping_len;
 
@@ -129,23 +134,76 @@ namespace TraceviewerServer
 
 	}
 
+	//Each thread moves through the file on its own (one timeline after
+	//another), so the access pattern is tracked per thread
+	static __thread LargeByteBuffer* patternOwner = NULL;
+	static __thread int patternLastPage = -1;
+	static __thread int patternStride = 0;
+
 	int LargeByteBuffer::getInt(FileOffset pos)
 	{
 		int Page = pos / mmPageSize;
 		int loc = pos % mmPageSize;
-		char* p2D = masterBuffer[Page].get() + loc;
+		char* p2D = pinPage(Page) + loc;
 		int val = ByteUtilities::readInt(p2D);
+		masterBuffer[Page]->unpin();
 		return val;
 	}
 	Long LargeByteBuffer::getLong(FileOffset pos)
 	{
 		int Page = pos / mmPageSize;
 		int loc = pos % mmPageSize;
-		char* p2D = masterBuffer[Page].get() + loc;
+		char* p2D = pinPage(Page) + loc;
 		Long val = ByteUtilities::readLong(p2D);
+		masterBuffer[Page]->unpin();
 		return val;
 
 	}
+
+	//Pins the page for reading. While a thread stays on the page it read
+	//last and the page is mapped, no lock is taken; moving to another page
+	//takes the lock to map it if needed and to update the prefetching.
+	char* LargeByteBuffer::pinPage(int page)
+	{
+		char* p = NULL;
+		if (patternOwner == this && patternLastPage == page)
+			p = masterBuffer[page]->tryPin();
+		if (p == NULL)
+		{
+			pthread_mutex_lock(&pageLock);
+			p = masterBuffer[page]->pin();
+			notePageAccess(page);
+			pthread_mutex_unlock(&pageLock);
+		}
+		return p;
+	}
+
+	//Called with pageLock held, with the page pinned: once a thread
+	//moves between pages twice in a row with the same stride, the page one
+	//more stride ahead is prefetched so that it is in memory by the time it is read
+	void LargeByteBuffer::notePageAccess(int page)
+	{
+		if (patternOwner != this)
+		{
+			patternOwner = this;
+			patternLastPage = page;
+			patternStride = 0;
+			return;
+		}
+		if (page == patternLastPage)
+			return;
+
+		int stride = page - patternLastPage;
+		if (stride == patternStride && abs(stride) <= MAX_PREFETCH_STRIDE)
+		{
+			int next = page + stride;
+			if (next >= 0 && next < numPages)
+				masterBuffer[next]->prefetch();
+		}
+		patternStride = stride;
+		patternLastPage = page;
+	}
+
 	//Could very well be a template, but we only use it for uint64_t
 	uint64_t LargeByteBuffer::lcm(uint64_t _a, uint64_t _b)
 	{
@@ -188,14 +246,46 @@ namespace TraceviewerServer
 
 	}
 
+	//MemAvailable from /proc/meminfo where there is one; else the free
+	//physical memory; else all of it
+	uint64_t LargeByteBuffer::getAvailableRamSize()
+	{
+		FILE* meminfo = fopen("/proc/meminfo", "r");
+		if (meminfo != NULL)
+		{
+			char line[256];
+			unsigned long long kb;
+			while (fgets(line, sizeof(line), meminfo) != NULL)
+			{
+				if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1)
+				{
+					fclose(meminfo);
+					DEBUGCOUT(2) << "Available memory : " << kb << " kB" << endl;
+					return kb * 1024;
+				}
+			}
+			fclose(meminfo);
+		}
+#ifdef _SC_AVPHYS_PAGES
+		long pages = sysconf(_SC_AVPHYS_PAGES);
+		long page_size = sysconf(_SC_PAGE_SIZE);
+		if (pages > 0 && page_size > 0)
+			return (uint64_t) pages * page_size;
+#endif
+		return getRamSize();
+	}
+
 	FileOffset LargeByteBuffer::size()
 	{
 		return fileSize;
 	}
 	LargeByteBuffer::~LargeByteBuffer()
 	{
+		for (int i = 0; i < numPages; i++)
+			delete masterBuffer[i];
 		masterBuffer.clear();
 		delete pageManagementList;
+		pthread_mutex_destroy(&pageLock);
 
 	}
 }
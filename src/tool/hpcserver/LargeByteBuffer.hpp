@@ -68,6 +68,7 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <pthread.h>
 
 namespace TraceviewerServer
 {
@@ -83,9 +84,20 @@ namespace TraceviewerServer
 	private:
 		static uint64_t lcm(uint64_t, uint64_t);
 		static uint64_t getRamSize();
-		vector<VersatileMemoryPage> masterBuffer;
+		static uint64_t getAvailableRamSize();
+		char* pinPage(int);
+		void notePageAccess(int);
+		//The pages are referred to by the LRU list, so they must not move
+		vector<VersatileMemoryPage*> masterBuffer;
 		int numPages;
 		LRUList<VersatileMemoryPage>* pageManagementList;
+		//Timelines are read on several threads; this guards the LRU list
+		//and the mapping and unmapping of pages. Reads from a page that is
+		//already mapped only pin the page.
+		pthread_mutex_t pageLock;
+
+		//Prefetch only for strides of at most this many pages
+		static const int MAX_PREFETCH_STRIDE = 4;
 
 	};
 
@@ -64,17 +64,133 @@
 #include "FileUtils.hpp"
 #include "DebugUtils.hpp"
 #include "ProgressBar.hpp"
+#include "Server.hpp" // for numWorkerThreads
 
 #include <string>
 #include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <lib/prof-lean/hpcio.h>
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+#if defined(__linux__) && defined(__GLIBC__) \
+	&& (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE 1
+#endif
 
 using namespace std;
 typedef int64_t Long;
 namespace TraceviewerServer
 {
+	//Shared by the threads that size and copy the trace files; each takes
+	//the next unclaimed file
+	struct MergeWork
+	{
+		vector<string>* files;
+		vector<FileOffset>* sizes;
+		vector<FileOffset>* offsets;
+		FileDescriptor output;
+		bool (*task)(MergeWork*, size_t);
+
+		pthread_mutex_t lock;
+		size_t next;
+		bool failed;
+		ProgressBar* prog;
+	};
+
+	static void* mergeWorker(void* arg)
+	{
+		MergeWork* work = (MergeWork*) arg;
+		while (true)
+		{
+			pthread_mutex_lock(&work->lock);
+			size_t i = work->next++;
+			pthread_mutex_unlock(&work->lock);
+			if (i >= work->files->size())
+				break;
+
+			bool ok = work->task(work, i);
+
+			pthread_mutex_lock(&work->lock);
+			if (!ok)
+				work->failed = true;
+			if (work->prog != NULL)
+				work->prog->incrementProgress();
+			pthread_mutex_unlock(&work->lock);
+		}
+		return NULL;
+	}
+
+	//Runs work->task on every file with a pool of threads; returns false
+	//if any of them failed
+	static bool runMergeWork(MergeWork* work)
+	{
+		pthread_mutex_init(&work->lock, NULL);
+		work->next = 0;
+		work->failed = false;
+
+		int numThreads = numWorkerThreads;
+		if (numThreads < 1)
+		{
+			long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+			numThreads = (cpus > 0) ? (int) cpus : 1;
+		}
+		numThreads = (int) min((size_t) numThreads, max((size_t) 1, work->files->size()));
+
+		vector<pthread_t> workers;
+		for (int i = 0; i < numThreads; i++)
+		{
+			pthread_t worker;
+			if (pthread_create(&worker, NULL, mergeWorker, work) != 0)
+				break;
+			workers.push_back(worker);
+		}
+		if (workers.empty())
+			mergeWorker(work);
+		for (unsigned int i = 0; i < workers.size(); i++)
+			pthread_join(workers[i], NULL);
+
+		pthread_mutex_destroy(&work->lock);
+		return !work->failed;
+	}
+
+	static bool writeFully(FileDescriptor fd, const char* buffer, size_t size, FileOffset position)
+	{
+		while (size > 0)
+		{
+			ssize_t ret = pwrite(fd, buffer, size, position);
+			if (ret <= 0)
+				return false;
+			buffer += ret;
+			size -= ret;
+			position += ret;
+		}
+		return true;
+	}
+
+	static bool sizeTask(MergeWork* work, size_t i)
+	{
+		(*work->sizes)[i] = MergeDataFiles::getTraceSize((*work->files)[i]);
+		return true;
+	}
+
+	static bool copyTask(MergeWork* work, size_t i)
+	{
+		return MergeDataFiles::copyTrace((*work->files)[i], (*work->sizes)[i],
+				work->output, (*work->offsets)[i]);
+	}
+
 	MergeDataAttribute MergeDataFiles::merge(string directory, string globInputFile,
 			string outputFile)
 	{
@@ -98,51 +214,23 @@ namespace TraceviewerServer
 		}
 
 		DEBUGCOUT(2) << "Doesn't exist" << endl;
-		// check if the files in glob patterns is correct
 
-		if (!atLeastOneValidFile(directory))
+		vector<string> filteredFileNames = getTraceFiles(directory, suffix);
+		if (filteredFileNames.empty())
 		{
 			return FAIL_NO_DATA;
 		}
 
-		DataOutputFileStream dos(outputFile.c_str());
-
 		//-----------------------------------------------------
-		// 1. write the header:
-		//  int type (0: unknown, 1: mpi, 2: openmp, 3: hybrid, ...
-		//	int num_files
+		// 1. Record the process ID, thread ID of every file.
+		//   It will also detect if the application is mp, mt, or hybrid
+		//	 no accelator is supported
 		//-----------------------------------------------------
-
 		int type = 0;
-		dos.writeInt(type);
-
-		vector<string> allPaths = FileUtils::getAllFilesInDir(directory);
-		vector<string> filteredFileNames;
-		vector<string>::iterator it;
-		for (it = allPaths.begin(); it != allPaths.end(); it++)
-		{
-			string val = *it;
-			if (val.find(".hpctrace") < string::npos)//This is hardcoded, which isn't great but will have to do because GlobInputFile is regex-style ("*.hpctrace")
-				filteredFileNames.push_back(val);
-		}
-		// on linux, we have to sort the files
-		//To sort them, we need a random access iterator, which means we need to load all of them into a vector
-		sort(filteredFileNames.begin(), filteredFileNames.end());
-
-		dos.writeInt(filteredFileNames.size());
-		const Long num_metric_header = 2 * SIZEOF_INT; // type of app (4 bytes) + num procs (4 bytes)
-		 Long num_metric_index = filteredFileNames.size()
-				* (SIZEOF_LONG + 2 * SIZEOF_INT);
-		FileOffset currentOffset = num_metric_header + num_metric_index;
+		vector<string> traceFiles;
+		vector<int> procs, threads;
 
 		int name_format = 0; // FIXME hack:some hpcprof revisions have different format name !!
-		//-----------------------------------------------------
-		// 2. Record the process ID, thread ID and the currentOffset
-		//   It will also detect if the application is mp, mt, or hybrid
-		//	 no accelator is supported
-		//  for all files:
-		//		int proc-id, int thread-id, long currentOffset
-		//-----------------------------------------------------
 		vector<string>::iterator it2;
 		for (it2 = filteredFileNames.begin(); it2 < filteredFileNames.end(); it2++)
 		{
@@ -169,62 +257,105 @@ namespace TraceviewerServer
 				string Token_To_Parse = tokens[name_format + num_tokens - PROC_POS];
 				proc = atoi(Token_To_Parse.c_str());
 			}
-			dos.writeInt(proc);
 			if (proc != 0)
 				type |= MULTI_PROCESSES;
 			 int Thread = atoi(tokens[name_format + num_tokens - THREAD_POS].c_str());
-			dos.writeInt(Thread);
 			if (Thread != 0)
 				type |= MULTI_THREADING;
-			dos.writeLong(currentOffset);
-			currentOffset += FileUtils::getFileSize(Filename);
+
+			traceFiles.push_back(Filename);
+			procs.push_back(proc);
+			threads.push_back(Thread);
 		}
+
 		//-----------------------------------------------------
-		// 3. Copy all data from the multiple files into one file
+		// 2. Size every file and lay them out, then write the header:
+		//  int type (0: unknown, 1: mpi, 2: openmp, 3: hybrid, ...
+		//	int num_files
+		//  for all files:
+		//		int proc-id, int thread-id, long offset
 		//-----------------------------------------------------
-		ProgressBar prog("Merging database", filteredFileNames.size());
-		for (it2 = filteredFileNames.begin(); it2 < filteredFileNames.end(); it2++)
+		vector<FileOffset> sizes(traceFiles.size());
+		vector<FileOffset> offsets(traceFiles.size());
+
+		MergeWork work;
+		work.files = &traceFiles;
+		work.sizes = &sizes;
+		work.offsets = &offsets;
+		work.output = -1;
+		work.prog = NULL;
+		work.task = sizeTask;
+		runMergeWork(&work);
+
+		const Long num_metric_header = 2 * SIZEOF_INT; // type of app (4 bytes) + num procs (4 bytes)
+		 Long num_metric_index = traceFiles.size()
+				* (SIZEOF_LONG + 2 * SIZEOF_INT);
+		FileOffset currentOffset = num_metric_header + num_metric_index;
+
+		vector<char> header(currentOffset);
+		char* pos = &header[0];
+		ByteUtilities::writeInt(pos, type);
+		pos += SIZEOF_INT;
+		ByteUtilities::writeInt(pos, traceFiles.size());
+		pos += SIZEOF_INT;
+		for (size_t i = 0; i < traceFiles.size(); i++)
 		{
-			string i = *it2;
+			offsets[i] = currentOffset;
+			currentOffset += sizes[i];
+
+			ByteUtilities::writeInt(pos, procs[i]);
+			pos += SIZEOF_INT;
+			ByteUtilities::writeInt(pos, threads[i]);
+			pos += SIZEOF_INT;
+			ByteUtilities::writeLong(pos, offsets[i]);
+			pos += SIZEOF_LONG;
+		}
 
-			ifstream dis(i.c_str(), ios_base::binary | ios_base::in);
-			char data[PAGE_SIZE_GUESS];
-			dis.read(data, PAGE_SIZE_GUESS);
-			int bytesRead = dis.gcount();
-			while (bytesRead > 0)
-			{
-				dos.write(data, bytesRead);
-				dis.read(data, PAGE_SIZE_GUESS);
-				bytesRead = dis.gcount();
-			}
-			dis.close();
-			prog.incrementProgress();
+		FileDescriptor output = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if (output < 0)
+		{
+			cerr << "Could not create " << outputFile << ": " << strerror(errno) << endl;
+			return STATUS_UNKNOWN;
 		}
-		insertMarker(&dos);
-		dos.close();
+		bool ok = (ftruncate(output, currentOffset + SIZEOF_LONG) == 0);
+		ok = ok && writeFully(output, &header[0], header.size(), 0);
+
 		//-----------------------------------------------------
-		// 4. FIXME: write the type of the application
-		//  	the type of the application is computed in step 2
-		//		Ideally, this step has to be in the beginning !
+		// 3. Copy all data from the multiple files into their places
 		//-----------------------------------------------------
-		//While we don't actually want to do any input operations, adding the input flag prevents the file from being truncated to 0 bytes
-		DataOutputFileStream f(outputFile.c_str(), ios_base::in | ios_base::out | ios_base::binary);
-		f.writeInt(type);
-		f.close();
+		if (ok)
+		{
+			ProgressBar prog("Merging database", traceFiles.size());
+			work.output = output;
+			work.prog = &prog;
+			work.task = copyTask;
+			ok = runMergeWork(&work);
+		}
+
+		//-----------------------------------------------------
+		// 4. Write the end marker last, so that a merge that did not
+		//    finish is never taken for a complete one
+		//-----------------------------------------------------
+		char marker[SIZEOF_LONG];
+		ByteUtilities::writeLong(marker, MARKER_END_MERGED_FILE);
+		ok = ok && writeFully(output, marker, SIZEOF_LONG, currentOffset);
+		ok = (close(output) == 0) && ok;
+		if (!ok)
+		{
+			cerr << "Could not merge the trace files into " << outputFile << endl;
+			remove(outputFile.c_str());
+			return STATUS_UNKNOWN;
+		}
 
 		//-----------------------------------------------------
 		// 5. remove old files
 		//-----------------------------------------------------
-		removeFiles(filteredFileNames);
+		removeFiles(traceFiles);
 		return SUCCESS_MERGED;
 	}
 
 
 
-	void MergeDataFiles::insertMarker(DataOutputFileStream* dos)
-	{
-		dos->writeLong(MARKER_END_MERGED_FILE);
-	}
 	bool MergeDataFiles::isMergedFileCorrect(string* filename)
 	{
 		ifstream f(filename->c_str(), ios_base::binary | ios_base::in);
@@ -254,28 +385,178 @@ namespace TraceviewerServer
 		}
 		return success;
 	}
-	bool MergeDataFiles::atLeastOneValidFile(string dir)
+	//Lists the files in dir that end in 'suffix', sorted. Only the names are
+	//looked at, so this does not stat every file of a large database.
+	vector<string> MergeDataFiles::getTraceFiles(string dir, string suffix)
 	{
-		vector<string> FileList = FileUtils::getAllFilesInDir(dir);
-		vector<string>::iterator it;
-		for (it = FileList.begin(); it != FileList.end(); ++it)
-		{
-			string filename = *it;
+		vector<string> files;
+		DIR* dirp = opendir(dir.c_str());
+		if (dirp == NULL)
+			return files;
 
-			unsigned int l = filename.length();
-			//if it ends with ".hpctrace", we are good.
-			string ending = ".hpctrace";
-			if (l < ending.length())
+		dirent* entry;
+		while ((entry = readdir(dirp)))
+		{
+			string name = entry->d_name;
+			if (name.length() <= suffix.length()
+					|| name.compare(name.length() - suffix.length(), suffix.length(), suffix) != 0)
+				continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+			if (entry->d_type == DT_DIR)
 				continue;
-			string supposedext = filename.substr(l - ending.length());
+#endif
+			files.push_back(FileUtils::combinePaths(dir, name));
+		}
+		closedir(dirp);
 
-			if (ending == supposedext)
+		// on linux, we have to sort the files
+		sort(files.begin(), files.end());
+		return files;
+	}
+
+	// Returns the size of the trace once copied into the merged file: the
+	// file size for a fixed-record trace, the expanded size for a compact one.
+	Long MergeDataFiles::getTraceSize(string filename)
+	{
+		Long size = FileUtils::getFileSize(filename);
+
+		FILE* fs = hpcio_fopen_r(filename.c_str());
+		if (!fs)
+			return size;
+
+		hpctrace_fmt_hdr_t hdr;
+		if (hpctrace_fmt_hdr_fread(&hdr, fs) == HPCFMT_OK
+			&& HPCTRACE_HDR_FLAGS_GET_BIT(hdr.flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS))
+		{
+			hpctrace_fmt_index_t idx;
+			if (hpctrace_fmt_index_fread(&idx, fs, malloc) == HPCFMT_OK)
+			{
+				bool isDataCentric = HPCTRACE_HDR_FLAGS_GET_BIT(hdr.flags,
+						HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS);
+				Long recordSize = SIZEOF_LONG + SIZEOF_INT
+						+ (isDataCentric ? SIZEOF_INT : 0);
+				size = HPCTRACE_FMT_HeaderLen + idx.nrecords * recordSize;
+				hpctrace_fmt_index_free(&idx, free);
+			}
+		}
+		hpcio_fclose(fs);
+		return size;
+	}
+
+	// Copies the trace 'filename' into 'output' at 'offset', expanding it to
+	// fixed-size records if it is compact. 'size' is from getTraceSize().
+	bool MergeDataFiles::copyTrace(string filename, FileOffset size, FileDescriptor output,
+			FileOffset offset)
+	{
+		if (copyCompactTrace(filename, output, offset))
+			return true;
+
+		FileDescriptor input = open(filename.c_str(), O_RDONLY);
+		if (input < 0)
+			return false;
+
+		FileOffset copied = 0;
+#ifdef HAVE_COPY_FILE_RANGE
+		// Let the kernel copy the data, without it passing through here
+		while (copied < size)
+		{
+			loff_t inPos = copied;
+			loff_t outPos = offset + copied;
+			ssize_t ret = copy_file_range(input, &inPos, output, &outPos, size - copied, 0);
+			if (ret <= 0)
+				break;
+			copied += ret;
+		}
+#endif
+		vector<char> buffer(COPY_BUFFER_SIZE);
+		while (copied < size)
+		{
+			ssize_t ret = pread(input, &buffer[0], min((FileOffset) buffer.size(), size - copied),
+					copied);
+			if (ret <= 0 || !writeFully(output, &buffer[0], ret, offset + copied))
+				break;
+			copied += ret;
+		}
+		close(input);
+		return copied == size;
+	}
+
+	// If 'filename' is a compact trace, writes it to 'output' at 'offset'
+	// in the fixed-record format and returns true; otherwise writes nothing.
+	bool MergeDataFiles::copyCompactTrace(string filename, FileDescriptor output,
+			FileOffset offset)
+	{
+		FILE* fs = hpcio_fopen_r(filename.c_str());
+		if (!fs)
+			return false;
+
+		hpctrace_fmt_hdr_t hdr;
+		if (hpctrace_fmt_hdr_fread(&hdr, fs) != HPCFMT_OK
+			|| !HPCTRACE_HDR_FLAGS_GET_BIT(hdr.flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS))
+		{
+			hpcio_fclose(fs);
+			return false;
+		}
+
+		hpctrace_hdr_flags_t flags = hdr.flags;
+		HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_COMPACT_BIT_POS, false);
+		bool isDataCentric = HPCTRACE_HDR_FLAGS_GET_BIT(flags,
+				HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS);
+		int recordSize = SIZEOF_LONG + SIZEOF_INT + (isDataCentric ? SIZEOF_INT : 0);
+
+		vector<char> buffer(HPCTRACE_FMT_HeaderLen);
+		char* pos = &buffer[0];
+		memcpy(pos, HPCTRACE_FMT_Magic, HPCTRACE_FMT_MagicLen);
+		pos += HPCTRACE_FMT_MagicLen;
+		memcpy(pos, HPCTRACE_FMT_Version, HPCTRACE_FMT_VersionLen);
+		pos += HPCTRACE_FMT_VersionLen;
+		memcpy(pos, HPCTRACE_FMT_Endian, HPCTRACE_FMT_EndianLen);
+		pos += HPCTRACE_FMT_EndianLen;
+		ByteUtilities::writeLong(pos, flags);
+		bool ok = writeFully(output, &buffer[0], buffer.size(), offset);
+		offset += buffer.size();
+
+		// the record count must agree with getTraceSize()
+		hpctrace_fmt_index_t idx;
+		uint64_t nrecords = 0;
+		if (hpctrace_fmt_index_fread(&idx, fs, malloc) == HPCFMT_OK)
+		{
+			nrecords = idx.nrecords;
+			hpctrace_fmt_index_free(&idx, free);
+		}
+
+		hpctrace_fmt_reader_t* reader = new hpctrace_fmt_reader_t;
+		fseek(fs, HPCTRACE_FMT_HeaderLen, SEEK_SET);
+		hpctrace_fmt_reader_init(reader, &hdr, fs);
+
+		buffer.resize((COPY_BUFFER_SIZE / recordSize) * recordSize);
+		hpctrace_fmt_datum_t datum;
+		uint64_t n = 0;
+		while (ok && n < nrecords)
+		{
+			size_t len = 0;
+			for (; n < nrecords && len < buffer.size(); n++)
 			{
-				return true;
+				if (hpctrace_fmt_reader_next(reader, &datum) != HPCFMT_OK)
+				{
+					ok = false;
+					break;
+				}
+				pos = &buffer[len];
+				ByteUtilities::writeLong(pos, datum.comp);
+				ByteUtilities::writeInt(pos + SIZEOF_LONG, datum.cpId);
+				if (isDataCentric)
+					ByteUtilities::writeInt(pos + SIZEOF_LONG + SIZEOF_INT, datum.metricId);
+				len += recordSize;
 			}
+			ok = ok && writeFully(output, &buffer[0], len, offset);
+			offset += len;
 		}
-		return false;
+		delete reader;
+		hpcio_fclose(fs);
+		return ok;
 	}
+
 	//From http://stackoverflow.com/questions/236129/splitting-a-string-in-c
 	vector<string> MergeDataFiles::splitString(string toSplit, char delimiter)
 	{
@@ -59,7 +59,8 @@
 #ifndef MERGEDATAFILES_H_
 #define MERGEDATAFILES_H_
 
-#include "DataOutputFileStream.hpp"
+#include "ByteUtilities.hpp"
+#include "FileUtils.hpp" // for FileOffset, FileDescriptor
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -79,20 +80,19 @@ namespace TraceviewerServer
 		static MergeDataAttribute merge(string, string, string);
 
 		static vector<string> splitString(string, char);
+
+		// compact (block-encoded) traces are expanded to fixed-size records
+		static Long getTraceSize(string);
+		static bool copyTrace(string, FileOffset, FileDescriptor, FileOffset);
 	private:
 		static const uint64_t MARKER_END_MERGED_FILE = 0xFFFFFFFFDEADF00D;
-		static const int PAGE_SIZE_GUESS = 4096;
+		static const int COPY_BUFFER_SIZE = 1 << 20;
 		static const int PROC_POS = 5;
 		static const int THREAD_POS = 4;
-		static void insertMarker(DataOutputFileStream*);
 		static bool isMergedFileCorrect(string*);
 		static bool removeFiles(vector<string>);
-		//This was in Util.java in a modified form but is more useful here
-		static bool atLeastOneValidFile(string);
-
-
-
-
+		static vector<string> getTraceFiles(string, string);
+		static bool copyCompactTrace(string, FileDescriptor, FileOffset);
 	};
 
 } /* namespace TraceviewerServer */
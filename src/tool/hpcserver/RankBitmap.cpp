@@ -0,0 +1,139 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL: https://hpctoolkit.googlecode.com/svn/branches/hpctoolkit-hpcserver/src/tool/hpcserver/RankBitmap.cpp $
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Set of ranks that pass the current filter
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include <assert.h>
+#include <algorithm>
+
+#include "RankBitmap.hpp"
+
+namespace TraceviewerServer
+{
+	RankBitmap::RankBitmap(int _size)
+	{
+		size = _size;
+		words.resize((size + 63) / 64, 0);
+		total = 0;
+	}
+
+	RankBitmap::~RankBitmap()
+	{
+	}
+
+	void RankBitmap::clear()
+	{
+		fill(words.begin(), words.end(), 0);
+	}
+
+	void RankBitmap::setAll()
+	{
+		fill(words.begin(), words.end(), ~(uint64_t)0);
+		//Keep the bits past the last rank clear so they never count
+		if (size % 64 != 0)
+			words.back() = ((uint64_t)1 << (size % 64)) - 1;
+	}
+
+	void RankBitmap::set(int index)
+	{
+		words[index / 64] |= (uint64_t)1 << (index % 64);
+	}
+
+	bool RankBitmap::get(int index)
+	{
+		return (words[index / 64] >> (index % 64)) & 1;
+	}
+
+	void RankBitmap::intersect(RankBitmap& other)
+	{
+		for (size_t i = 0; i < words.size(); i++)
+			words[i] &= other.words[i];
+	}
+
+	void RankBitmap::subtract(RankBitmap& other)
+	{
+		for (size_t i = 0; i < words.size(); i++)
+			words[i] &= ~other.words[i];
+	}
+
+	void RankBitmap::buildIndex()
+	{
+		wordRanks.resize(words.size());
+		total = 0;
+		for (size_t i = 0; i < words.size(); i++)
+		{
+			wordRanks[i] = total;
+			total += __builtin_popcountll(words[i]);
+		}
+	}
+
+	int RankBitmap::count()
+	{
+		return total;
+	}
+
+	int RankBitmap::select(int n)
+	{
+		assert(n >= 0 && n < total);
+		//The last word with fewer than n+1 set bits before it holds the bit
+		int word = (upper_bound(wordRanks.begin(), wordRanks.end(), n) - wordRanks.begin()) - 1;
+		uint64_t bits = words[word];
+		for (int skip = n - wordRanks[word]; skip > 0; skip--)
+			bits &= bits - 1;
+		return word * 64 + __builtin_ctzll(bits);
+	}
+}
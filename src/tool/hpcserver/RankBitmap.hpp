@@ -0,0 +1,100 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL: https://hpctoolkit.googlecode.com/svn/branches/hpctoolkit-hpcserver/src/tool/hpcserver/RankBitmap.hpp $
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Set of ranks that pass the current filter
+//
+// Description:
+//   A RankBitmap holds one bit per rank. Filters are combined a word at a
+//   time, and a directory of the number of set bits before each word lets
+//   the n-th set bit (the rank behind pseudo-rank n) be found without
+//   keeping a list of the matching ranks.
+//
+//***************************************************************************
+
+#ifndef RANKBITMAP_HPP_
+#define RANKBITMAP_HPP_
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+namespace TraceviewerServer
+{
+	class RankBitmap
+	{
+	public:
+		RankBitmap(int _size);
+		virtual ~RankBitmap();
+
+		void clear();
+		void setAll();
+		void set(int index);
+		bool get(int index);
+		void intersect(RankBitmap& other);
+		void subtract(RankBitmap& other);
+
+		//Must be called after the bits change and before count or select
+		void buildIndex();
+		int count();
+		//The index of the set bit that has n set bits before it
+		int select(int n);
+	private:
+		int size;
+		vector<uint64_t> words;
+		//Number of set bits in the words before each word
+		vector<int> wordRanks;
+		int total;
+	};
+}
+
+#endif /* RANKBITMAP_HPP_ */
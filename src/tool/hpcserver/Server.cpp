@@ -89,6 +89,7 @@ namespace TraceviewerServer
 	bool useCompression = true;
 	int mainPortNumber = DEFAULT_PORT;
 	int xmlPortNumber = 0;
+	int numWorkerThreads = 0;
 
 	Server::Server()
 	{
@@ -226,7 +227,7 @@ namespace TraceviewerServer
 		Time minBegTime = socket->readLong();
 		Time maxEndTime = socket->readLong();
 		int headerSize = socket->readInt();
-		controller->setInfo(minBegTime, maxEndTime, headerSize);
+		controller->setInfo(minBegTime, maxEndTime, headerSize, true);
 
 		Communication::sendParseInfo(minBegTime, maxEndTime, headerSize);//Send to MPI if necessary
 	}
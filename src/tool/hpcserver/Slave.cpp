@@ -113,7 +113,7 @@ namespace TraceviewerServer
 					break;
 				case INFO:
 					controller->setInfo(Message.minfo.minBegTime, Message.minfo.maxEndTime,
-							Message.minfo.headerSize);
+							Message.minfo.headerSize, false);
 					break;
 				case DATA:
 				{
@@ -80,18 +80,20 @@ namespace TraceviewerServer
 		experimentXML = locations->fileXML;
 		fileTrace = locations->fileTrace;
 		tracesInitialized = false;
+		pthread_mutex_init(&traceLock, NULL);
 
 	}
 
 //called once the INFO packet has been received to add the information to the controller
 	void SpaceTimeDataController::setInfo(Time _minBegTime, Time _maxEndTime,
-			int _headerSize)
+			int _headerSize, bool buildSummary)
 	{
 		minBegTime = _minBegTime;
 		maxEndTime = _maxEndTime;
 		headerSize = _headerSize;
 		delete dataTrace;
 		dataTrace = new FilteredBaseData(fileTrace, headerSize);
+		dataTrace->loadSummary(fileTrace, buildSummary);
 	}
 
 	int SpaceTimeDataController::getNumRanks()
@@ -106,22 +108,26 @@ namespace TraceviewerServer
 
 	ProcessTimeline* SpaceTimeDataController::getNextTrace()
 	{
+		ProcessTimeline* toReturn = NULL;
+		pthread_mutex_lock(&traceLock);
 		if (attributes->lineNum
 				< min(attributes->numPixelsV, attributes->endProcess - attributes->begProcess))
 		{
-			ProcessTimeline* toReturn  = new ProcessTimeline(*attributes, attributes->lineNum, dataTrace,
+			toReturn  = new ProcessTimeline(*attributes, attributes->lineNum, dataTrace,
 					minBegTime + attributes->begTime, headerSize);
 			attributes->lineNum++;
-			return toReturn;
 		}
-		return NULL;
+		pthread_mutex_unlock(&traceLock);
+		return toReturn;
 	}
 
 	void SpaceTimeDataController::addNextTrace(ProcessTimeline* NextPtl)
 	{
 		if (NextPtl == NULL)
 			cerr << "Saving a null PTL?" << endl;
+		pthread_mutex_lock(&traceLock);
 		traces[NextPtl->line()] = NextPtl;
+		pthread_mutex_unlock(&traceLock);
 	}
 
 	//Don't call if in MPI mode
@@ -159,7 +165,7 @@ namespace TraceviewerServer
 
 		deleteTraces();
 
-		traces = new ProcessTimeline*[numTraces];
+		traces = new ProcessTimeline*[numTraces]();
 		tracesLength = numTraces;
 		tracesInitialized = true;
 
@@ -190,6 +196,7 @@ namespace TraceviewerServer
 		//It does call getNextTrace, but changedBounds is always true so
 		//tracesInitialized is always false for MPI
 		deleteTraces();
+		pthread_mutex_destroy(&traceLock);
 
 	}
 
@@ -66,6 +66,7 @@
 #include "TimeCPID.hpp"
 
 #include <string>
+#include <pthread.h>
 
 namespace TraceviewerServer
 {
@@ -76,10 +77,15 @@ namespace TraceviewerServer
 
 		SpaceTimeDataController(FileData*);
 		virtual ~SpaceTimeDataController();
-		void setInfo(Time, Time, int);
+		//Only the process that talks to the client builds the trace summary;
+		//the MPI ranks it forwards the INFO to load what it built
+		void setInfo(Time, Time, int, bool buildSummary);
 		ProcessTimeline* getNextTrace();
 		void addNextTrace(ProcessTimeline*);
 		void fillTraces();
+		//Clears traces so that it can be refilled with getNextTrace() and
+		//addNextTrace(), which may then be called from several threads
+		void resetTraces();
 		ProcessTimeline* fillTrace(bool);
 		void applyFilters(FilterSet filters);
 		//The number of processes in the database, independent of the current display size
@@ -93,7 +99,6 @@ namespace TraceviewerServer
 		ProcessTimeline** traces;
 		int tracesLength;
 	private:
-		void resetTraces();
 		void deleteTraces();
 
 		FilteredBaseData* dataTrace;
@@ -108,6 +113,9 @@ namespace TraceviewerServer
 
 		bool tracesInitialized;
 
+		//Guards attributes->lineNum and traces while they are being filled
+		pthread_mutex_t traceLock;
+
 		static const int DEFAULT_HEADER_SIZE = 24;
 
 	};
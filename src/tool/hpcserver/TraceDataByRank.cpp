@@ -84,12 +84,17 @@ namespace TraceviewerServer
 			double pixelLength)
 	{
 		// get the start location
-		FileOffset startLoc = findTimeInInterval(timeStart, minloc, maxloc);
+		FileOffset l_bound = minloc, r_bound = maxloc;
+		data->narrowInterval(rank, timeStart, l_bound, r_bound);
+		FileOffset startLoc = findTimeInInterval(timeStart, l_bound, r_bound);
 
 		// get the end location
 		 Time endTime = timeStart + timeRange;
+		l_bound = minloc;
+		r_bound = maxloc;
+		data->narrowInterval(rank, endTime, l_bound, r_bound);
 		 FileOffset endLoc = min(
-				findTimeInInterval(endTime, minloc, maxloc) + SIZE_OF_TRACE_RECORD, maxloc);
+				findTimeInInterval(endTime, l_bound, r_bound) + SIZE_OF_TRACE_RECORD, maxloc);
 
 		// get the number of records data to display
 		 Long numRec = 1 + getNumberOfRecords(startLoc, endLoc);
@@ -112,8 +117,13 @@ namespace TraceviewerServer
 		{
 			// the data is too big: try to fit the "big" data into the display
 
-			//fills in the rest of the data for this process timeline
-			sampleTimeLine(startLoc, endLoc, 0, numPixelsH, 0, pixelLength, timeStart);
+			//fills in the rest of the data for this process timeline, from
+			//the summary if its buckets are narrow enough
+			int level = data->getSummaryLevel(rank, pixelLength);
+			if (level >= 0)
+				sampleSummary(level, 0, numPixelsH, pixelLength, timeStart);
+			else
+				sampleTimeLine(startLoc, endLoc, 0, numPixelsH, pixelLength, timeStart);
 		}
 		// --------------------------------------------------------------------------------------------------
 		// get the last data if necessary: the rightmost time is still less then the upper limit
@@ -137,38 +147,96 @@ namespace TraceviewerServer
 		postProcess();
 	}
 	/*******************************************************************************************
-	 * Recursive method that fills in times and timeLine with the correct data from the file.
-	 * Takes in two pixel locations as endpoints and finds the timestamp that owns the pixel
-	 * in between these two. It then recursively calls itself twice - once with the beginning
-	 * location and the newfound location as endpoints and once with the newfound location
-	 * and the end location as endpoints. Effectively updates times and timeLine by calculating
-	 * the index in which to insert the next data. This way, it keeps times and timeLine sorted.
-	 * @author Reed Landrum and Michael Franco
+	 * Fills in listCPID with the sample that owns each pixel strictly between startPixel
+	 * and endPixel, from left to right. This used to bisect the pixels recursively and
+	 * insert each sample into the middle of listCPID, which is quadratic in the number of
+	 * pixels. Each sample is now found by searching forward from the previous one, so the
+	 * samples are appended in order and the file is read front to back.
 	 * @param minLoc The beginning location in the file to bound the search.
 	 * @param maxLoc The end location in the file to bound the search.
 	 * @param startPixel The beginning pixel in the image that corresponds to minLoc.
 	 * @param endPixel The end pixel in the image that corresponds to maxLoc.
-	 * @param minIndex An index used for calculating the index in which the data is to be inserted.
-	 * @return Returns the index that shows the size of the recursive subtree that has been read.
-	 * Used for calculating the index in which the data is to be inserted.
+	 * @return Returns the number of samples added.
 	 ******************************************************************************************/
 	int TraceDataByRank::sampleTimeLine(FileOffset minLoc, FileOffset maxLoc, int startPixel,
-			int endPixel, int minIndex, double pixelLength, Time startingTime)
+			int endPixel, double pixelLength, Time startingTime)
 	{
-		int midPixel = (startPixel + endPixel) / 2;
-		if (midPixel == startPixel)
-			return 0;
-
-		Long loc = findTimeInInterval((long)(midPixel * pixelLength + startingTime), minLoc,
-				maxLoc);
-		 TimeCPID nextData = getData(loc);
-		addSample(minIndex, nextData);
-		int addedLeft = sampleTimeLine(minLoc, loc, startPixel, midPixel, minIndex,
-				pixelLength, startingTime);
-		int addedRight = sampleTimeLine(loc, maxLoc, midPixel, endPixel,
-				minIndex + addedLeft + 1, pixelLength, startingTime);
-
-		return (addedLeft + addedRight + 1);
+		listCPID->reserve(listCPID->size() + max(endPixel - startPixel, 0) + 2);
+
+		FileOffset loc = minLoc;
+		int added = 0;
+		for (int pixel = startPixel + 1; pixel < endPixel; pixel++)
+		{
+			loc = findTimeForward((long)(pixel * pixelLength + startingTime), loc, maxLoc);
+			listCPID->push_back(getData(loc));
+			added++;
+		}
+		return added;
+	}
+
+	/*******************************************************************************************
+	 * Same as sampleTimeLine, but takes the call path of each pixel from the summary
+	 * buckets of the given level instead of from the trace records. Runs of pixels with
+	 * the same call path are sent as one sample.
+	 * @return Returns the number of samples added.
+	 ******************************************************************************************/
+	int TraceDataByRank::sampleSummary(int level, int startPixel, int endPixel,
+			double pixelLength, Time startingTime)
+	{
+		listCPID->reserve(listCPID->size() + max(endPixel - startPixel, 0) + 2);
+
+		int added = 0;
+		for (int pixel = startPixel + 1; pixel < endPixel; pixel++)
+		{
+			Time time = (long)(pixel * pixelLength + startingTime);
+			int cpid = data->getSummaryCPID(rank, level, time);
+			if (added > 0 && listCPID->back().cpid == cpid)
+				continue;
+			listCPID->push_back(TimeCPID(time, cpid));
+			added++;
+		}
+		return added;
+	}
+
+	/*********************************************************************************
+	 *	Returns the location of the record closest in time to 'time', searching
+	 *	forward from l_boundOffset with a galloping search. Gives the same record as
+	 *	findTimeInInterval() over the same interval, but only reads forward of
+	 *	l_boundOffset, and reads little when the record is close to it.
+	 ********************************************************************************/
+	FileOffset TraceDataByRank::findTimeForward(Time time, FileOffset l_boundOffset,
+			FileOffset r_boundOffset)
+	{
+		FileOffset l_index = getRelativeLocation(l_boundOffset);
+		FileOffset r_bound = getRelativeLocation(r_boundOffset);
+
+		// gallop until the record at l_index + step is past 'time'
+		FileOffset step = 1;
+		while (l_index + step <= r_bound
+				&& (Time) data->getLong(getAbsoluteLocation(l_index + step)) <= time)
+		{
+			l_index += step;
+			step *= 2;
+		}
+
+		// then bisect: the last record at or before 'time' is in [l_index, r_index)
+		FileOffset r_index = min(l_index + step, r_bound + 1);
+		while (r_index - l_index > 1)
+		{
+			FileOffset mid_index = l_index + (r_index - l_index) / 2;
+			if ((Time) data->getLong(getAbsoluteLocation(mid_index)) <= time)
+				l_index = mid_index;
+			else
+				r_index = mid_index;
+		}
+
+		if (l_index >= r_bound)
+			return getAbsoluteLocation(r_bound);
+
+		Long leftDiff = (Long)(time - data->getLong(getAbsoluteLocation(l_index)));
+		Long rightDiff = (Long)(data->getLong(getAbsoluteLocation(l_index + 1)) - time);
+		bool is_left_closer = labs(leftDiff) < labs(rightDiff);
+		return getAbsoluteLocation(is_left_closer ? l_index : l_index + 1);
 	}
 
 
@@ -291,19 +359,25 @@ namespace TraceviewerServer
 
 	void TraceDataByRank::postProcess()
 	{
-		int len = listCPID->size();
-		for (int i = 0; i < len - 2; i++)
+		// Compacts in a single pass rather than erasing each duplicate in
+		// turn; the last two samples are left alone, as they always were.
+		vector<TimeCPID>& samples = *listCPID;
+		size_t len = samples.size();
+		if (len < 3)
+			return;
+
+		size_t i = 0, next = 1;
+		while (next + 1 < len)
 		{
-
-			while (i < len - 1 && (*listCPID)[i].timestamp == (*listCPID)[i + 1].timestamp)
-			{
-				vector<TimeCPID>::iterator it = listCPID->begin();
-				it += (i + 1);
-				listCPID->erase(it);
-				len--;
-			}
-
+			while (next < len && samples[i].timestamp == samples[next].timestamp)
+				next++;
+			if (next == len)
+				break;
+			samples[++i] = samples[next++];
 		}
+		while (next < len)
+			samples[++i] = samples[next++];
+		samples.erase(samples.begin() + i + 1, samples.end());
 	}
 
 	TraceDataByRank::~TraceDataByRank()
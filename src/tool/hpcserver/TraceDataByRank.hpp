@@ -77,8 +77,10 @@ namespace TraceviewerServer
 		virtual ~TraceDataByRank();
 
 		void getData(Time timeStart, Time timeRange, double pixelLength);
-		int sampleTimeLine(FileOffset minLoc, FileOffset maxLoc, int startPixel, int endPixel, int minIndex, double pixelLength, Time startingTime);
+		int sampleTimeLine(FileOffset minLoc, FileOffset maxLoc, int startPixel, int endPixel, double pixelLength, Time startingTime);
+		int sampleSummary(int level, int startPixel, int endPixel, double pixelLength, Time startingTime);
 		FileOffset findTimeInInterval(Time time, FileOffset l_boundOffset, FileOffset r_boundOffset);
+		FileOffset findTimeForward(Time time, FileOffset l_boundOffset, FileOffset r_boundOffset);
 
 
 
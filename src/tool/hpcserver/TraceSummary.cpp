@@ -0,0 +1,554 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL: https://hpctoolkit.googlecode.com/svn/branches/hpctoolkit-hpcserver/src/tool/hpcserver/TraceSummary.cpp $
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Multi-resolution summary of the traces in a merged trace file
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "TraceSummary.hpp"
+#include "ByteUtilities.hpp"
+#include "Constants.hpp"
+#include "DebugUtils.hpp"
+#include "Server.hpp" // for numWorkerThreads
+
+using namespace std;
+
+namespace TraceviewerServer
+{
+	static const char SUMMARY_MAGIC[8] = {'H', 'P', 'C', 'T', 'S', 'U', 'M', '3'};
+	static const char* SUMMARY_SUFFIX = ".summary";
+	static const int RECORDS_PER_READ = 1 << 16;
+
+	//Accumulates, for one level, the time each call path covers in the
+	//bucket currently being filled
+	class BucketAccumulator
+	{
+	public:
+		void init(SummaryEntry* _entries, int _numBuckets, Time _firstTime, Time _width)
+		{
+			entries = _entries;
+			numBuckets = _numBuckets;
+			firstTime = _firstTime;
+			width = _width;
+			current = -1;
+			coverage.clear();
+		}
+		//Spans must be added in time order and without gaps
+		void addSpan(Time start, Time end, int cpid, FileOffset offset)
+		{
+			while (start < end)
+			{
+				int bucket = (int) min((Time) (numBuckets - 1), (start - firstTime) / width);
+				if (bucket != current)
+				{
+					closeBucket();
+					current = bucket;
+					entries[current].offset = offset;
+				}
+				Time bucketEnd = (bucket == numBuckets - 1) ? end : firstTime + (bucket + 1) * width;
+				Time spanEnd = min(end, bucketEnd);
+				coverage[cpid] += spanEnd - start;
+				start = spanEnd;
+			}
+		}
+		//Buckets past the last record are covered by it
+		void finish(FileOffset lastOffset, int lastCpid)
+		{
+			closeBucket();
+			for (int bucket = current + 1; bucket < numBuckets; bucket++)
+			{
+				entries[bucket].offset = lastOffset;
+				entries[bucket].cpid = lastCpid;
+			}
+		}
+	private:
+		void closeBucket()
+		{
+			if (current < 0)
+				return;
+			Time longest = 0;
+			map<int, Time>::iterator it;
+			for (it = coverage.begin(); it != coverage.end(); ++it)
+			{
+				if (it->second > longest)
+				{
+					longest = it->second;
+					entries[current].cpid = it->first;
+				}
+			}
+			coverage.clear();
+		}
+
+		SummaryEntry* entries;
+		int numBuckets;
+		Time firstTime;
+		Time width;
+		int current;
+		map<int, Time> coverage;
+	};
+
+	static bool readFully(FileDescriptor fd, char* buffer, size_t size, FileOffset position)
+	{
+		while (size > 0)
+		{
+			ssize_t ret = pread(fd, buffer, size, position);
+			if (ret <= 0)
+				return false;
+			buffer += ret;
+			size -= ret;
+			position += ret;
+		}
+		return true;
+	}
+
+	static bool writeFully(FileDescriptor fd, const char* buffer, size_t size, FileOffset position)
+	{
+		while (size > 0)
+		{
+			ssize_t ret = pwrite(fd, buffer, size, position);
+			if (ret <= 0)
+				return false;
+			buffer += ret;
+			size -= ret;
+			position += ret;
+		}
+		return true;
+	}
+
+	//Shared by the threads that scan the ranks; each takes the next
+	//unclaimed rank and writes its entries at their place in the file
+	struct SummaryWork
+	{
+		TraceSummary* summary;
+		FileDescriptor in;
+		FileDescriptor out;
+		TraceSummary::RankHeader* ranks;
+		int numRanks;
+
+		pthread_mutex_t lock;
+		int next;
+		bool failed;
+	};
+
+	TraceSummary::TraceSummary(string traceFile, BaseDataFile* data, int _headerSize,
+			bool mayBuild)
+	{
+		mapping = NULL;
+		mappingSize = 0;
+		numRanks = data->getNumberOfFiles();
+		headerSize = _headerSize;
+		offsets = data->getOffsets();
+		rankHeaders = NULL;
+		entries = NULL;
+
+		FileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, SUMMARY_MAGIC, sizeof(header.magic));
+		header.numRanks = numRanks;
+		header.headerSize = headerSize;
+		header.numLevels = NUM_LEVELS;
+		header.recordsPerBucket = RECORDS_PER_BUCKET;
+		struct stat st;
+		if (stat(traceFile.c_str(), &st) == 0)
+		{
+			header.traceSize = st.st_size;
+			header.traceMtime = st.st_mtim.tv_sec;
+			header.traceMtimeNsec = st.st_mtim.tv_nsec;
+		}
+
+		vector<RankHeader> ranks(numRanks);
+		size_t totalEntries = layOut(ranks);
+
+		string summaryFile = traceFile + SUMMARY_SUFFIX;
+		if (load(summaryFile, &header, totalEntries))
+			return;
+		if (!mayBuild)
+		{
+			DEBUGCOUT(1) << "No trace summary " << summaryFile << " to load" << endl;
+			return;
+		}
+
+		DEBUGCOUT(1) << "Building trace summary " << summaryFile << endl;
+		if (build(summaryFile, traceFile, &header, ranks)
+				&& load(summaryFile, &header, totalEntries))
+			return;
+
+		cerr << "Could not create the trace summary " << summaryFile
+				<< "; zoomed-out views will read the whole trace" << endl;
+	}
+
+	bool TraceSummary::isValid()
+	{
+		return mapping != NULL;
+	}
+
+	FileOffset TraceSummary::getNumRecords(int rank)
+	{
+		FileOffset minloc = offsets[rank].start + headerSize;
+		FileOffset maxloc = offsets[rank].end;
+		return (maxloc < minloc) ? 0 : (maxloc - minloc) / SIZE_OF_TRACE_RECORD + 1;
+	}
+
+	//Gives each rank the smallest power of LEVEL_FACTOR of finest buckets
+	//that holds about RECORDS_PER_BUCKET records each, up to
+	//MAX_FINEST_BUCKETS. Returns the number of entries of all the ranks.
+	size_t TraceSummary::layOut(vector<RankHeader>& ranks)
+	{
+		size_t totalEntries = 0;
+		for (int rank = 0; rank < numRanks; rank++)
+		{
+			FileOffset wanted = getNumRecords(rank) / RECORDS_PER_BUCKET;
+			int finest = 1;
+			while ((FileOffset) finest < wanted && finest < MAX_FINEST_BUCKETS)
+				finest *= LEVEL_FACTOR;
+
+			memset(&ranks[rank], 0, sizeof(RankHeader));
+			ranks[rank].firstEntry = totalEntries;
+			ranks[rank].finestBuckets = finest;
+			totalEntries += entriesPerRank(finest);
+		}
+		return totalEntries;
+	}
+
+	bool TraceSummary::load(string summaryFile, FileHeader* expected, size_t totalEntries)
+	{
+		size_t size = sizeof(FileHeader) + numRanks * sizeof(RankHeader)
+				+ totalEntries * sizeof(SummaryEntry);
+
+		FileDescriptor fd = open(summaryFile.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t) st.st_size != size)
+		{
+			close(fd);
+			return false;
+		}
+		void* map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+			return false;
+
+		if (memcmp(map, expected, sizeof(FileHeader)) != 0)
+		{
+			DEBUGCOUT(1) << "Trace summary " << summaryFile << " is out of date" << endl;
+			munmap(map, size);
+			return false;
+		}
+
+		mapping = (char*) map;
+		mappingSize = size;
+		rankHeaders = (RankHeader*) (mapping + sizeof(FileHeader));
+		entries = (SummaryEntry*) (mapping + sizeof(FileHeader) + numRanks * sizeof(RankHeader));
+		return true;
+	}
+
+	void* TraceSummary::scanWorker(void* arg)
+	{
+		SummaryWork* work = (SummaryWork*) arg;
+		vector<SummaryEntry> rankEntries;
+		vector<char> buffer(RECORDS_PER_READ * SIZE_OF_TRACE_RECORD);
+		while (true)
+		{
+			pthread_mutex_lock(&work->lock);
+			int rank = work->failed ? work->numRanks : work->next++;
+			pthread_mutex_unlock(&work->lock);
+			if (rank >= work->numRanks)
+				break;
+
+			if (!work->summary->scanRank(rank, work->in, work->out, &work->ranks[rank],
+					rankEntries, buffer))
+			{
+				pthread_mutex_lock(&work->lock);
+				work->failed = true;
+				pthread_mutex_unlock(&work->lock);
+			}
+		}
+		return NULL;
+	}
+
+	//Writes to a temporary file and renames it into place, so that a
+	//summary is never seen half written
+	bool TraceSummary::build(string summaryFile, string traceFile, FileHeader* header,
+			vector<RankHeader>& ranks)
+	{
+		FileDescriptor in = open(traceFile.c_str(), O_RDONLY);
+		if (in < 0)
+			return false;
+
+		stringstream tempFile;
+		tempFile << summaryFile << "." << getpid();
+		FileDescriptor out = open(tempFile.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (out < 0)
+		{
+			close(in);
+			return false;
+		}
+
+		SummaryWork work;
+		work.summary = this;
+		work.in = in;
+		work.out = out;
+		work.ranks = numRanks == 0 ? NULL : &ranks[0];
+		work.numRanks = numRanks;
+		pthread_mutex_init(&work.lock, NULL);
+		work.next = 0;
+		work.failed = false;
+
+		int numThreads = numWorkerThreads;
+		if (numThreads < 1)
+		{
+			long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+			numThreads = (cpus > 0) ? (int) cpus : 1;
+		}
+		numThreads = min(numThreads, max(1, numRanks));
+
+		vector<pthread_t> workers;
+		for (int i = 0; i < numThreads; i++)
+		{
+			pthread_t worker;
+			if (pthread_create(&worker, NULL, scanWorker, &work) != 0)
+				break;
+			workers.push_back(worker);
+		}
+		if (workers.empty())
+			scanWorker(&work);
+		for (unsigned int i = 0; i < workers.size(); i++)
+			pthread_join(workers[i], NULL);
+		pthread_mutex_destroy(&work.lock);
+
+		bool ok = !work.failed;
+		ok = ok && writeFully(out, (char*) header, sizeof(FileHeader), 0);
+		ok = ok && (numRanks == 0 || writeFully(out, (char*) &ranks[0],
+				numRanks * sizeof(RankHeader), sizeof(FileHeader)));
+
+		close(in);
+		ok = (close(out) == 0) && ok;
+		ok = ok && rename(tempFile.str().c_str(), summaryFile.c_str()) == 0;
+		if (!ok)
+			remove(tempFile.str().c_str());
+		return ok;
+	}
+
+	//Fills in the times of rankHeader and writes the entries of the rank
+	bool TraceSummary::scanRank(int rank, FileDescriptor in, FileDescriptor out,
+			RankHeader* rankHeader, vector<SummaryEntry>& rankEntries, vector<char>& buffer)
+	{
+		int finest = rankHeader->finestBuckets;
+		rankEntries.assign(entriesPerRank(finest), SummaryEntry());
+		FileOffset numRecords = getNumRecords(rank);
+		FileOffset minloc = offsets[rank].start + headerSize;
+		bool ok = true;
+
+		if (numRecords > 0)
+		{
+			char record[SIZE_OF_TRACE_RECORD];
+			ok = readFully(in, record, SIZE_OF_TRACE_RECORD, minloc);
+			Time first = ByteUtilities::readLong(record);
+			ok = ok && readFully(in, record, SIZE_OF_TRACE_RECORD,
+					minloc + (numRecords - 1) * SIZE_OF_TRACE_RECORD);
+			Time last = max(first, (Time) ByteUtilities::readLong(record));
+
+			rankHeader->firstTime = first;
+			rankHeader->bucketWidth = (last - first) / finest + 1;
+
+			BucketAccumulator levels[NUM_LEVELS];
+			Time width = rankHeader->bucketWidth;
+			int firstEntry = 0;
+			for (int level = 0; level < NUM_LEVELS; level++)
+			{
+				levels[level].init(&rankEntries[firstEntry], bucketsAt(finest, level), first, width);
+				firstEntry += bucketsAt(finest, level);
+				width *= LEVEL_FACTOR;
+			}
+
+			// Each record covers the time up to the next one; the last covers one tick
+			Time prevTime = 0;
+			int prevCpid = 0;
+			FileOffset prevOffset = minloc;
+			for (FileOffset done = 0; done < numRecords && ok;)
+			{
+				FileOffset count = min((FileOffset) RECORDS_PER_READ, numRecords - done);
+				FileOffset position = minloc + done * SIZE_OF_TRACE_RECORD;
+				ok = readFully(in, &buffer[0], count * SIZE_OF_TRACE_RECORD, position);
+
+				for (FileOffset i = 0; i < count && ok; i++)
+				{
+					char* p = &buffer[i * SIZE_OF_TRACE_RECORD];
+					Time time = ByteUtilities::readLong(p);
+					int cpid = ByteUtilities::readInt(p + SIZEOF_LONG);
+					if (done + i > 0)
+					{
+						time = max(time, prevTime);
+						for (int level = 0; level < NUM_LEVELS; level++)
+							levels[level].addSpan(prevTime, time, prevCpid, prevOffset);
+					}
+					prevTime = time;
+					prevCpid = cpid;
+					prevOffset = position + i * SIZE_OF_TRACE_RECORD;
+				}
+				done += count;
+			}
+			for (int level = 0; level < NUM_LEVELS; level++)
+			{
+				levels[level].addSpan(prevTime, prevTime + 1, prevCpid, prevOffset);
+				levels[level].finish(prevOffset, prevCpid);
+			}
+		}
+
+		FileOffset position = sizeof(FileHeader) + numRanks * sizeof(RankHeader)
+				+ rankHeader->firstEntry * sizeof(SummaryEntry);
+		return ok && writeFully(out, (char*) &rankEntries[0],
+				rankEntries.size() * sizeof(SummaryEntry), position);
+	}
+
+	//Levels coarser than a single bucket keep that one bucket
+	int TraceSummary::bucketsAt(int finestBuckets, int level)
+	{
+		int buckets = finestBuckets;
+		for (int i = 0; i < level && buckets > 1; i++)
+			buckets /= LEVEL_FACTOR;
+		return buckets;
+	}
+
+	int TraceSummary::entriesPerRank(int finestBuckets)
+	{
+		int total = 0;
+		for (int level = 0; level < NUM_LEVELS; level++)
+			total += bucketsAt(finestBuckets, level);
+		return total;
+	}
+
+	SummaryEntry* TraceSummary::entriesAt(int rank, int level)
+	{
+		RankHeader* header = &rankHeaders[rank];
+		size_t first = header->firstEntry;
+		for (int i = 0; i < level; i++)
+			first += bucketsAt(header->finestBuckets, i);
+		return &entries[first];
+	}
+
+	int TraceSummary::findBucket(int rank, int level, Time time)
+	{
+		RankHeader* header = &rankHeaders[rank];
+		Time width = header->bucketWidth;
+		for (int i = 0; i < level; i++)
+			width *= LEVEL_FACTOR;
+		if (time <= header->firstTime)
+			return 0;
+		return (int) min((Time) (bucketsAt(header->finestBuckets, level) - 1),
+				(time - header->firstTime) / width);
+	}
+
+	int TraceSummary::getLevel(int rank, double pixelLength)
+	{
+		if (!isValid() || rank >= numRanks)
+			return -1;
+		Time width = rankHeaders[rank].bucketWidth;
+		if (width == 0)
+			return -1;
+
+		int level = -1;
+		for (int i = 0; i < NUM_LEVELS && width <= pixelLength; i++)
+		{
+			level = i;
+			width *= LEVEL_FACTOR;
+		}
+		return level;
+	}
+
+	SummaryEntry* TraceSummary::getEntry(int rank, int level, Time time)
+	{
+		return entriesAt(rank, level) + findBucket(rank, level, time);
+	}
+
+	void TraceSummary::narrowInterval(int rank, Time time, FileOffset& l_bound,
+			FileOffset& r_bound)
+	{
+		if (!isValid() || rank >= numRanks || rankHeaders[rank].bucketWidth == 0)
+			return;
+
+		// The closest record is either the one in effect at 'time' or the one
+		// after it, which is at most the one in effect at the next bucket.
+		SummaryEntry* rankEntries = entriesAt(rank, 0);
+		int bucket = findBucket(rank, 0, time);
+		l_bound = max(l_bound, rankEntries[bucket].offset);
+		if (bucket + 1 < rankHeaders[rank].finestBuckets)
+			r_bound = min(r_bound, rankEntries[bucket + 1].offset + SIZE_OF_TRACE_RECORD);
+		r_bound = max(r_bound, l_bound);
+	}
+
+	TraceSummary::~TraceSummary()
+	{
+		if (mapping != NULL)
+			munmap(mapping, mappingSize);
+	}
+
+} /* namespace TraceviewerServer */
@@ -0,0 +1,160 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL: https://hpctoolkit.googlecode.com/svn/branches/hpctoolkit-hpcserver/src/tool/hpcserver/TraceSummary.hpp $
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Multi-resolution summary of the traces in a merged trace file
+//
+// Description:
+//   A TraceSummary divides the time span of each rank into buckets at
+//   several resolutions and records, per bucket, the call path that covers
+//   most of it and the trace record in effect at its start. Zoomed-out
+//   views are drawn from the summary instead of the trace records, and
+//   searches for a time only read the records of one bucket. Each rank
+//   gets about one finest bucket per RECORDS_PER_BUCKET records, so the
+//   summary stays a small fraction of the trace however many ranks there
+//   are. It is built once, by the process that opens the database for
+//   the client, saved next to the merged trace file and reused while it
+//   matches the trace's size and modification time.
+//
+//***************************************************************************
+
+#ifndef TRACESUMMARY_H_
+#define TRACESUMMARY_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "BaseDataFile.hpp"
+#include "FileUtils.hpp" //For FileOffset
+#include "TimeCPID.hpp"
+
+namespace TraceviewerServer
+{
+	struct SummaryEntry
+	{
+		FileOffset offset; //The record in effect at the start of the bucket
+		int cpid; //The call path that covers most of the bucket
+		int pad;
+	};
+
+	struct SummaryWork;
+
+	class TraceSummary
+	{
+	public:
+		//Maps the summary saved next to traceFile. If it is missing or out of
+		//date and mayBuild is set, builds it first. isValid() is false if
+		//neither worked.
+		TraceSummary(string traceFile, BaseDataFile* data, int headerSize, bool mayBuild);
+		virtual ~TraceSummary();
+		bool isValid();
+
+		//Returns the coarsest level whose buckets are no wider than
+		//pixelLength, or -1 if even the finest buckets are too wide
+		int getLevel(int rank, double pixelLength);
+		SummaryEntry* getEntry(int rank, int level, Time time);
+		//Narrows [l_bound, r_bound] to the records that can be the closest
+		//to 'time'
+		void narrowInterval(int rank, Time time, FileOffset& l_bound, FileOffset& r_bound);
+
+		static const int NUM_LEVELS = 4; //Each level has LEVEL_FACTOR times fewer buckets
+		static const int LEVEL_FACTOR = 4;
+		static const int MAX_FINEST_BUCKETS = 4096;
+		static const int RECORDS_PER_BUCKET = 16;
+
+	private:
+		friend struct SummaryWork;
+
+		struct FileHeader
+		{
+			char magic[8];
+			int32_t numRanks;
+			int32_t headerSize;
+			int32_t numLevels;
+			int32_t recordsPerBucket;
+			uint64_t traceSize;
+			int64_t traceMtime; //Modification time of the trace, so that a
+			int64_t traceMtimeNsec; //rewrite of the same size is noticed
+		};
+		struct RankHeader
+		{
+			Time firstTime;
+			Time bucketWidth; //At the finest level; 0 if the rank has no records
+			uint64_t firstEntry; //Index of the rank's first entry
+			int32_t finestBuckets;
+			int32_t pad;
+		};
+
+		size_t layOut(vector<RankHeader>& ranks);
+		bool load(string summaryFile, FileHeader* expected, size_t totalEntries);
+		bool build(string summaryFile, string traceFile, FileHeader* header,
+				vector<RankHeader>& ranks);
+		bool scanRank(int rank, FileDescriptor in, FileDescriptor out, RankHeader* rankHeader,
+				vector<SummaryEntry>& rankEntries, vector<char>& buffer);
+		static void* scanWorker(void* arg);
+		FileOffset getNumRecords(int rank);
+		static int bucketsAt(int finestBuckets, int level);
+		static int entriesPerRank(int finestBuckets);
+		int findBucket(int rank, int level, Time time);
+		SummaryEntry* entriesAt(int rank, int level);
+
+		char* mapping;
+		size_t mappingSize;
+		int numRanks;
+		int headerSize;
+		OffsetPair* offsets;
+		RankHeader* rankHeaders;
+		SummaryEntry* entries;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* TRACESUMMARY_H_ */
@@ -61,6 +61,7 @@ extern void filterTest();
 extern void progBarTest();
 extern void compressionTest();
 extern void lruTest();
+extern void rankBitmapTest();
 
 int main(int argc, char** argv)
 {
@@ -68,5 +69,6 @@ int main(int argc, char** argv)
 	compressionTest();
 	progBarTest();
 	filterTest();
+	rankBitmapTest();
 }
 
@@ -0,0 +1,196 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Checks FilteredBaseData's rank filtering against FilterSet::matches
+//
+// Description:
+//   Writes a merged trace whose ranks carry process and thread IDs in
+//   shuffled order, opens it with FilteredBaseData and applies filter sets
+//   through setFilters, which combines the ranks markMatches finds in the
+//   sorted ID list into a RankBitmap. Checks that the pseudoranks give
+//   exactly the ranks for which FilterSet::matches is true, in order.
+//   Covers include and exclude filter sets and rank counts that are not a
+//   multiple of 64.
+//
+//***************************************************************************
+
+#undef NDEBUG
+
+#include "../ByteUtilities.hpp"
+#include "../Constants.hpp"
+#include "../FilterSet.hpp"
+#include "../FilteredBaseData.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace TraceviewerServer;
+
+static const int HEADER_SIZE = SIZE_OF_TRACE_RECORD;
+
+//Where the data of 'rank' starts: after the file header and the ranks
+//before it, each a header and one record
+static FileOffset rankStart(int numRanks, int rank)
+{
+	FileOffset dataStart = 2 * SIZEOF_INT + numRanks * (2 * SIZEOF_INT + SIZEOF_LONG);
+	return dataStart + rank * (HEADER_SIZE + SIZE_OF_TRACE_RECORD);
+}
+
+//Writes a merged trace with one record per rank and returns its name
+static string writeTrace(vector<int>& processIDs, vector<int>& threadIDs)
+{
+	int numRanks = processIDs.size();
+	vector<char> file(rankStart(numRanks, numRanks) + SIZEOF_END_OF_FILE_MARKER);
+
+	char* p = &file[0];
+	ByteUtilities::writeInt(p, MULTI_PROCESSES | MULTI_THREADING);
+	ByteUtilities::writeInt(p + SIZEOF_INT, numRanks);
+	p += 2 * SIZEOF_INT;
+	for (int rank = 0; rank < numRanks; rank++) {
+		ByteUtilities::writeInt(p, processIDs[rank]);
+		ByteUtilities::writeInt(p + SIZEOF_INT, threadIDs[rank]);
+		ByteUtilities::writeLong(p + 2 * SIZEOF_INT, rankStart(numRanks, rank));
+		p += 2 * SIZEOF_INT + SIZEOF_LONG;
+	}
+
+	char name[] = "/tmp/RankBitmap_test.XXXXXX";
+	int fd = mkstemp(name);
+	assert(fd >= 0);
+	ssize_t written = write(fd, &file[0], file.size());
+	assert(written == (ssize_t) file.size());
+	close(fd);
+	return name;
+}
+
+static void checkFilters(FilteredBaseData& data, vector<int>& processIDs,
+		vector<int>& threadIDs, FilterSet filters)
+{
+	int numRanks = processIDs.size();
+	data.setFilters(filters);
+
+	vector<int> expected;
+	for (int rank = 0; rank < numRanks; rank++) {
+		if (filters.matches(processIDs[rank], threadIDs[rank]))
+			expected.push_back(rank);
+	}
+
+	//The pseudoranks are the matching ranks in rank order; getMinLoc tells
+	//which rank each one is
+	assert(data.getNumberOfRanks() == (int) expected.size());
+	for (unsigned int n = 0; n < expected.size(); n++)
+		assert(data.getMinLoc(n) == rankStart(numRanks, expected[n]) + HEADER_SIZE);
+}
+
+static void checkRanks(int numRanks, int threadsPerProc)
+{
+	//Rank r runs thread r % threadsPerProc of process r / threadsPerProc,
+	//but the ranks are shuffled so that the IDs are out of order in the file
+	vector<int> order(numRanks);
+	for (int i = 0; i < numRanks; i++)
+		order[i] = i;
+	srand(numRanks * 31 + threadsPerProc);
+	random_shuffle(order.begin(), order.end());
+
+	vector<int> processIDs(numRanks), threadIDs(numRanks);
+	for (int rank = 0; rank < numRanks; rank++) {
+		processIDs[rank] = order[rank] / threadsPerProc;
+		threadIDs[rank] = order[rank] % threadsPerProc;
+	}
+
+	string traceFile = writeTrace(processIDs, threadIDs);
+	FilteredBaseData data(traceFile, HEADER_SIZE);
+
+	for (int exclude = 0; exclude <= 1; exclude++) {
+		//No filters: everything for exclude, everything for include
+		checkFilters(data, processIDs, threadIDs, FilterSet(exclude));
+
+		FilterSet one(exclude);
+		one.add(Filter(Range(1, numRanks / 2, 3), Range(0, 2, 1)));
+		checkFilters(data, processIDs, threadIDs, one);
+
+		FilterSet two(exclude);
+		two.add(Filter(Range(0, numRanks, 2), Range(0, 4, 2)));
+		two.add(Filter(Range(numRanks / 3, numRanks, 1), Range(1, 1, 1)));
+		checkFilters(data, processIDs, threadIDs, two);
+
+		//Matches nothing, so excludes nothing or includes nothing
+		FilterSet none(exclude);
+		none.add(Filter(Range(numRanks + 1, numRanks + 5, 1), Range(0, 4, 1)));
+		checkFilters(data, processIDs, threadIDs, none);
+
+		FilterSet all(exclude);
+		all.add(Filter(Range(0, numRanks, 1), Range(0, 4, 1)));
+		checkFilters(data, processIDs, threadIDs, all);
+	}
+
+	remove(traceFile.c_str());
+}
+
+void rankBitmapTest()
+{
+	const int sizes[] = {1, 7, 63, 64, 65, 127, 129, 1000};
+	const int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+	for (int i = 0; i < numSizes; i++) {
+		for (int threads = 1; threads <= 5; threads += 2)
+			checkRanks(sizes[i], threads);
+	}
+
+	cout << "FilteredBaseData matches FilterSet" << endl;
+}
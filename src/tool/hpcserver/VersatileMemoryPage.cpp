@@ -73,6 +73,7 @@ namespace TraceviewerServer
 	static int MAX_PAGES_TO_ALLOCATE_AT_ONCE = 0;
 
 	VersatileMemoryPage::VersatileMemoryPage(FileOffset _startPoint, int _size, FileDescriptor _file, LRUList<VersatileMemoryPage>* pageManagementList)
+		: pins(0), mapped(NULL), referenced(false)
 	{
 		startPoint = _startPoint;
 		size = _size;
@@ -80,6 +81,7 @@ namespace TraceviewerServer
 		index = mostRecentlyUsed->addNewUnused(this);
 		file = _file;
 		isMapped = false;
+		page = NULL;
 		if (MAX_PAGES_TO_ALLOCATE_AT_ONCE <1)
 			cerr<<"Set max pages before creating any VersatileMemoryPages"<<endl;
 	}
@@ -94,9 +96,31 @@ namespace TraceviewerServer
 		if (isMapped)
 			unmapPage();
 	}
-	char* VersatileMemoryPage::get()
+
+	char* VersatileMemoryPage::tryPin()
 	{
+		int n = pins.load();
+		while (n != EVICTING && !pins.compare_exchange_weak(n, n + 1))
+			;
+		if (n == EVICTING)
+			return NULL;
+
+		char* p = mapped.load();
+		if (p == NULL)
+		{
+			unpin();
+			return NULL;
+		}
+		//Avoid writing the shared flag on every read
+		if (!referenced.load(memory_order_relaxed))
+			referenced.store(true, memory_order_relaxed);
+		return p;
+	}
 
+	char* VersatileMemoryPage::pin()
+	{
+		//Pages are only evicted under the lock, so the count is not EVICTING
+		pins++;
 		if (!isMapped)
 		{
 			mapPage();
@@ -106,6 +130,33 @@ namespace TraceviewerServer
 		return page;
 	}
 
+	void VersatileMemoryPage::unpin()
+	{
+		pins--;
+	}
+
+	void VersatileMemoryPage::prefetch()
+	{
+		//Mapping may evict the least recently used page, so leave at least
+		//the page being read alone
+		if (MAX_PAGES_TO_ALLOCATE_AT_ONCE < 2)
+			return;
+		if (!isMapped)
+		{
+			DEBUGCOUT(1) << "Prefetching page " << index << endl;
+			mapPage();
+		}
+		madvise(page, size, MADV_WILLNEED);
+	}
+
+	//Claims an unpinned page for unmapping; readers that try to pin it
+	//from now on fall back to the locked path
+	bool VersatileMemoryPage::tryEvict()
+	{
+		int unpinned = 0;
+		return pins.compare_exchange_strong(unpinned, EVICTING);
+	}
+
 	void VersatileMemoryPage::mapPage()
 	{
 
@@ -116,11 +167,22 @@ namespace TraceviewerServer
 			cerr << "Trying to double map!"<<endl;
 			return;
 		}
-		if (mostRecentlyUsed->getUsedPageCount() >= MAX_PAGES_TO_ALLOCATE_AT_ONCE)
+		//Evict the least recently used page that is neither being read nor
+		//recently read without the lock. If every page is in use, go over
+		//the budget rather than wait.
+		int candidates = 2 * mostRecentlyUsed->getUsedPageCount();
+		while (mostRecentlyUsed->getUsedPageCount() >= MAX_PAGES_TO_ALLOCATE_AT_ONCE
+				&& candidates-- > 0)
 		{
 
 			VersatileMemoryPage* toRemove = mostRecentlyUsed->getLast();
 
+			if (toRemove->referenced.exchange(false) || !toRemove->tryEvict())
+			{
+				mostRecentlyUsed->putOnTop(toRemove->index);
+				continue;
+			}
+
 			DEBUGCOUT(1)<<"Kicking " << toRemove->index << " out"<<endl;
 
 			if (toRemove->isMapped != true)
@@ -128,6 +190,7 @@ namespace TraceviewerServer
 
 			toRemove->unmapPage();
 			mostRecentlyUsed->removeLast();
+			toRemove->pins.store(0);
 		}
 		page = (char*)mmap(0, size, MAP_PROT, MAP_FLAGS, file, startPoint);
 		if (page == MAP_FAILED)
@@ -141,6 +204,7 @@ namespace TraceviewerServer
 
 
 		isMapped = true;
+		mapped.store(page);
 		mostRecentlyUsed->reAdd(index);
 	}
 	void VersatileMemoryPage::unmapPage()
@@ -150,6 +214,7 @@ namespace TraceviewerServer
 			cerr << "Trying to double unmap!"<<endl;
 			return;
 		}
+		mapped.store(NULL);
 		munmap(page, size);
 
 		isMapped = false;
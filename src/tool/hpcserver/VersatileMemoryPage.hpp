@@ -62,6 +62,7 @@
 
 
 #include <sys/mman.h>
+#include <atomic>
 #include "FileUtils.hpp" //FileOffset
 #include "LRUList.hpp"
 
@@ -69,17 +70,30 @@ using namespace std;
 namespace TraceviewerServer
 {
 
+	//Pages are mapped, unmapped and reordered in the LRU list only by
+	//callers that hold their LargeByteBuffer's lock. Reading from a page
+	//that is already mapped needs no lock: the reader pins the page, which
+	//keeps it from being unmapped until the reader unpins it.
 	class VersatileMemoryPage
 	{
 	public:
-		VersatileMemoryPage();
 		VersatileMemoryPage(FileOffset, int, FileDescriptor, LRUList<VersatileMemoryPage>* pageManagementList);
 		virtual ~VersatileMemoryPage();
 		static void setMaxPages(int);
-		char* get();
+		//Without the lock: pins the page and returns it if it is mapped,
+		//else returns NULL and the caller must use pin()
+		char* tryPin();
+		//With the lock: maps the page if needed and pins it
+		char* pin();
+		void unpin();
+		//Maps the page if needed and asks the kernel to start reading it in,
+		//without waiting for it
+		void prefetch();
 	private:
+		VersatileMemoryPage(const VersatileMemoryPage&);
 		void mapPage();
 		void unmapPage();
+		bool tryEvict();
 
 		FileOffset startPoint;
 		int size;
@@ -90,12 +104,20 @@ namespace TraceviewerServer
 		bool isMapped;
 		LRUList<VersatileMemoryPage>* mostRecentlyUsed;
 
-		// Use MAP_POPULATE if available
-#ifdef MAP_POPULATE
-		static const int MAP_FLAGS = MAP_SHARED | MAP_POPULATE;
-#else
-		static const int MAP_FLAGS = MAP_SHARED
-#endif
+		//Number of readers of the page, or EVICTING while it is unmapped
+		atomic<int> pins;
+		//The mapping, for lock-free readers; NULL when not mapped
+		atomic<char*> mapped;
+		//Set by lock-free reads, which do not move the page in the LRU
+		//list; eviction gives such a page a second chance
+		atomic<bool> referenced;
+
+		static const int EVICTING = -1;
+
+		// Pages are not populated when mapped: most accesses are searches
+		// that touch a few parts of a page, and pages that will be read
+		// through are prefetched instead
+		static const int MAP_FLAGS = MAP_SHARED;
 		static const int MAP_PROT = PROT_READ;
 	};
 
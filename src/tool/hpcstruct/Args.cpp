@@ -164,6 +164,22 @@ Options: Output files\n\
   -o <file>, --output <file>\n\
                        Write hpcstruct file to <file>.\n\
                        Use '--output=-' to write output to stdout.\n\
+  --convert            Treat <binary> as an existing hpcstruct XML file and\n\
+                       convert it to binary form, written to\n\
+                       'basename(<binary>).bin' or the -o file.  hpcprof\n\
+                       maps binary structure files directly instead of\n\
+                       parsing XML.  This is the only way to get a binary\n\
+                       structure file: analyzing <binary> always writes\n\
+                       XML, so run hpcstruct on <binary> first and then\n\
+                       hpcstruct --convert on its .hpcstruct file.\n\
+  --cache <dir>        Keep hpcstruct files in the cache directory <dir>,\n\
+                       keyed by a hash of the binary's contents, of its\n\
+                       separate debug file (path, size and mtime) and of\n\
+                       the options that affect the output.  An unchanged\n\
+                       binary is satisfied from the cache without being\n\
+                       analyzed.  Entries are never removed; delete <dir>\n\
+                       to reclaim space.  Not used when <binary> is a\n\
+                       measurements directory.\n\
 \n\
 Options for Developers:\n\
   --jobs-struct <num>  Use <num> threads for the MakeStructure() phase only.\n\
@@ -198,6 +214,10 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
   // Output options
   { 'o', "output",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "convert",         CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "cache",           CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
+     NULL },
 
   // General
   { 'v', "verbose",     CLP::ARG_OPT,  CLP::DUPOPT_CLOB, NULL,
@@ -246,6 +266,7 @@ Args::Ctor()
   searchPathStr = ".";
   show_gaps = false;
   compute_gpu_cfg = false;
+  convertToBinary = false;
 }
 
 
@@ -371,6 +392,7 @@ Args::parse(int argc, const char* const argv[])
     }
     if (parser.isOpt("replace-path")) {
       string arg = parser.getOptArg("replace-path");
+      replacePathStr = arg;
       
       std::vector<std::string> replacePaths;
       StrUtil::tokenize_str(arg, CLP_SEPARATOR, replacePaths);
@@ -396,6 +418,18 @@ Args::parse(int argc, const char* const argv[])
     if (parser.isOpt("output")) {
       out_filenm = parser.getOptArg("output");
     }
+    if (parser.isOpt("convert")) {
+      convertToBinary = true;
+    }
+    if (convertToBinary && out_filenm == "-") {
+      ARG_ERROR("Cannot write a binary structure file to stdout.");
+    }
+    if (parser.isOpt("cache")) {
+      cache_dir = parser.getOptArg("cache");
+      if (out_filenm == "-" || show_gaps) {
+	ARG_ERROR("--cache cannot be used with stdout output or --show-gaps.");
+      }
+    }
 
     // Check for required arguments
     if (parser.getNumArgs() != 1) {
@@ -405,7 +439,7 @@ Args::parse(int argc, const char* const argv[])
 
     if (out_filenm.empty()) {
       string base_filenm = FileUtil::basename(in_filenm);
-      out_filenm = base_filenm + ".hpcstruct";
+      out_filenm = base_filenm + (convertToBinary ? ".bin" : ".hpcstruct");
     }
   }
   catch (const CmdLineParser::ParseError& x) {
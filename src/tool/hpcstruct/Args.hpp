@@ -120,10 +120,13 @@ public:
   // Parsed Data: optional arguments
   std::string searchPathStr;          // default: "."
   std::string dbgProcGlob;
+  std::string replacePathStr;         // raw -R arguments, for cache keys
+  std::string cache_dir;              // default: "" (no cache)
 
   bool prettyPrintOutput;         // default: true
   bool useBinutils;		  // default: false
   bool show_gaps;                 // default: false
+  bool convertToBinary;           // default: false
 
   // Parsed Data: arguments
   std::string in_filenm;
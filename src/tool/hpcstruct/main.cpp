@@ -56,7 +56,11 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <dirent.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
 
 #include <iostream>
 using std::cerr;
@@ -65,6 +69,7 @@ using std::endl;
 #include <dlfcn.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fstream>
 #include <string>
 #include <streambuf>
@@ -79,7 +84,12 @@ using std::endl;
 #include "Args.hpp"
 
 #include <lib/banal/Struct.hpp>
+#include <lib/prof/Struct-Tree.hpp>
+#include <lib/prof/Struct-TreeBinary.hpp>
+#include <lib/prof-lean/crypto-hash.h>
 #include <lib/prof-lean/hpcio.h>
+#include <lib/profxml/PGMReader.hpp>
+#include <lib/profxml/DocHandlerArgs.hpp>
 #include <lib/support/diagnostics.h>
 #include <lib/support/realpath.h>
 #include <lib/support/FileUtil.hpp>
@@ -189,6 +199,279 @@ doMeasurementsDir(string measurements_dir, BAnal::Struct::Options & opts)
   }
 }
 
+//************************ Binary Structure Files ***************************
+
+//
+// Read the hpcstruct XML file 'xml_filenm' and write the same
+// structure in binary form to 'bin_filenm'.  File names are kept as
+// written: hpcprof applies its own search paths when it reads the
+// binary file.
+//
+static void
+writeBinaryStructure(const string& xml_filenm, const string& bin_filenm)
+{
+  Prof::Struct::Tree structure("");
+  std::vector<string> structureFiles(1, xml_filenm);
+  DocHandlerArgs docargs;
+
+  Prof::Struct::readStructure(structure, structureFiles,
+			      PGMDocHandler::Doc_STRUCT, docargs);
+
+  std::ostream* os = IOUtil::OpenOStream(bin_filenm.c_str());
+  try {
+    Prof::Struct::writeBinary(*os, structure);
+  }
+  catch (...) {
+    IOUtil::CloseStream(os);
+    unlink(bin_filenm.c_str());
+    throw;
+  }
+  IOUtil::CloseStream(os);
+}
+
+//***************************** Structure Cache *****************************
+
+//
+// The structure cache is a directory of hpcstruct files named by a
+// hash of the binary's contents and a hash of everything else that
+// reaches the output: the binary's path (written into the file), the
+// search and replacement paths, the options that change the analysis
+// and the hpctoolkit version and git revision.  A separate debug file
+// (found by build-id or .gnu_debuglink) is read along with the binary
+// and enters the second hash by its path, size and mtime.  Entries
+// are written under a temporary name and renamed into place, so
+// concurrent runs may share a cache.  Nothing is ever evicted.
+//
+
+static string
+hashToString(unsigned char* hash)
+{
+  char str[2 * HASH_LENGTH + 1];
+
+  crypto_hash_to_hexstring(hash, str, sizeof(str));
+  return string(str);
+}
+
+
+// Append to 'paths' the places where a separate debug file for the ELF
+// image 'image' (the contents of 'filenm') may be found, in the order
+// that gdb and Symtab search them: the build-id file, then the
+// .gnu_debuglink name in the binary's directory, its .debug
+// subdirectory and the same directory under /usr/lib/debug.
+template <class Ehdr, class Shdr, class Nhdr>
+static void
+debugFilePaths(const char* image, size_t size, const string& filenm,
+	       std::vector<string>& paths)
+{
+  static const string debugRoot = "/usr/lib/debug";
+
+  const Ehdr* ehdr = (const Ehdr*) image;
+  if (size < sizeof(Ehdr) || ehdr->e_shentsize != sizeof(Shdr)
+      || ehdr->e_shoff > size
+      || ehdr->e_shnum > (size - ehdr->e_shoff) / sizeof(Shdr)
+      || ehdr->e_shstrndx >= ehdr->e_shnum) {
+    return;
+  }
+
+  const Shdr* shdrs = (const Shdr*) (image + ehdr->e_shoff);
+  const Shdr& strtab = shdrs[ehdr->e_shstrndx];
+  if (strtab.sh_offset > size || strtab.sh_size > size - strtab.sh_offset) {
+    return;
+  }
+
+  string buildId;
+  string debugLink;
+
+  for (uint i = 0; i < ehdr->e_shnum; ++i) {
+    const Shdr& shdr = shdrs[i];
+    if (shdr.sh_type == SHT_NOBITS || shdr.sh_offset > size
+	|| shdr.sh_size > size - shdr.sh_offset
+	|| shdr.sh_name >= strtab.sh_size) {
+      continue;
+    }
+    const char* data = image + shdr.sh_offset;
+    string name(image + strtab.sh_offset + shdr.sh_name,
+		strnlen(image + strtab.sh_offset + shdr.sh_name,
+			strtab.sh_size - shdr.sh_name));
+
+    if (name == ".gnu_debuglink") {
+      debugLink = string(data, strnlen(data, shdr.sh_size));
+    }
+    else if (shdr.sh_type == SHT_NOTE) {
+      // notes are 4-byte aligned in their name and description
+      size_t pos = 0;
+      while (pos + sizeof(Nhdr) <= shdr.sh_size) {
+	const Nhdr* nhdr = (const Nhdr*) (data + pos);
+	size_t name_pos = pos + sizeof(Nhdr);
+	size_t desc_pos = name_pos + ((nhdr->n_namesz + 3) & ~3);
+	size_t next = desc_pos + ((nhdr->n_descsz + 3) & ~3);
+	if (next > shdr.sh_size) {
+	  break;
+	}
+	if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4
+	    && memcmp(data + name_pos, "GNU", 4) == 0
+	    && nhdr->n_descsz > 1) {
+	  static const char digits[] = "0123456789abcdef";
+	  buildId.clear();
+	  for (size_t k = 0; k < nhdr->n_descsz; ++k) {
+	    unsigned char c = data[desc_pos + k];
+	    buildId += digits[c >> 4];
+	    buildId += digits[c & 0xf];
+	  }
+	}
+	pos = next;
+      }
+    }
+  }
+
+  if (! buildId.empty()) {
+    paths.push_back(debugRoot + "/.build-id/" + buildId.substr(0, 2) + "/"
+		    + buildId.substr(2) + ".debug");
+  }
+  if (! debugLink.empty()) {
+    string dir = FileUtil::dirname(RealPath(filenm.c_str()));
+    paths.push_back(dir + "/" + debugLink);
+    paths.push_back(dir + "/.debug/" + debugLink);
+    paths.push_back(debugRoot + dir + "/" + debugLink);
+  }
+}
+
+
+// Returns the cache entry name for 'filenm', or the empty string if
+// 'filenm' can not be read.
+static string
+structCacheKey(const string& filenm, const Args& args)
+{
+  unsigned char hash[HASH_LENGTH];
+
+  int fd = open(filenm.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return "";
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || sb.st_size == 0) {
+    close(fd);
+    return "";
+  }
+
+  void* contents = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (contents == MAP_FAILED) {
+    return "";
+  }
+
+  crypto_hash_compute((const unsigned char*) contents, sb.st_size,
+		      hash, HASH_LENGTH);
+
+  std::vector<string> debug_paths;
+  const char* image = (const char*) contents;
+  if (sb.st_size > EI_CLASS && memcmp(image, ELFMAG, SELFMAG) == 0) {
+    if (image[EI_CLASS] == ELFCLASS64) {
+      debugFilePaths<Elf64_Ehdr, Elf64_Shdr, Elf64_Nhdr>
+	(image, sb.st_size, filenm, debug_paths);
+    }
+    else if (image[EI_CLASS] == ELFCLASS32) {
+      debugFilePaths<Elf32_Ehdr, Elf32_Shdr, Elf32_Nhdr>
+	(image, sb.st_size, filenm, debug_paths);
+    }
+  }
+  munmap(contents, sb.st_size);
+
+  string content_key = hashToString(hash);
+
+  string opts_str = string(HPCTOOLKIT_VERSION_STRING) + "\n"
+    + HPCTOOLKIT_GIT_VERSION + "\n"
+    + RealPath(filenm.c_str()) + "\n"
+    + args.searchPathStr + "\n"
+    + args.replacePathStr + "\n"
+    + (args.compute_gpu_cfg ? "gpucfg" : "") + "\n";
+
+  for (uint i = 0; i < debug_paths.size(); ++i) {
+    struct stat dsb;
+    if (stat(debug_paths[i].c_str(), &dsb) == 0) {
+      opts_str += debug_paths[i] + " " + std::to_string(dsb.st_size) + " "
+	+ std::to_string(dsb.st_mtim.tv_sec) + "."
+	+ std::to_string(dsb.st_mtim.tv_nsec) + "\n";
+    }
+  }
+
+  crypto_hash_compute((const unsigned char*) opts_str.data(), opts_str.size(),
+		      hash, HASH_LENGTH);
+
+  return content_key + "-" + hashToString(hash);
+}
+
+
+// Copy 'src' to 'dst', checking every read and write (unlike
+// FileUtil::copy, which ignores short writes).  'dst' is synced to
+// disk before it is closed.
+//
+// Returns: true on success; on failure, 'dst' is removed.
+static bool
+copyStructFile(const string& dst, const string& src)
+{
+  int srcFd = open(src.c_str(), O_RDONLY);
+  if (srcFd < 0) {
+    return false;
+  }
+  int dstFd = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (dstFd < 0) {
+    close(srcFd);
+    return false;
+  }
+
+  bool ok = true;
+  char buf[1 << 16];
+  for (;;) {
+    ssize_t len = read(srcFd, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      ok = (len == 0);
+      break;
+    }
+    for (ssize_t done = 0; ok && done < len; ) {
+      ssize_t ret = write(dstFd, buf + done, len - done);
+      if (ret > 0) {
+	done += ret;
+      }
+      else if (ret < 0 && errno != EINTR) {
+	ok = false;
+      }
+    }
+    if (! ok) {
+      break;
+    }
+  }
+
+  close(srcFd);
+  ok = (fsync(dstFd) == 0) && ok;
+  ok = (close(dstFd) == 0) && ok;
+  if (! ok) {
+    unlink(dst.c_str());
+  }
+  return ok;
+}
+
+
+// Copy 'out_filenm' into the cache as 'entry'.  A failure to update
+// the cache is not an error for hpcstruct.
+static void
+saveStructCache(const string& out_filenm, const string& entry)
+{
+  string tmp = entry + "." + std::to_string(getpid()) + ".tmp";
+
+  if (! copyStructFile(tmp, out_filenm)
+      || rename(tmp.c_str(), entry.c_str()) != 0) {
+    int err = errno;
+    unlink(tmp.c_str());
+    DIAG_WMsg(1, "unable to save structure file in cache: " << entry
+	      << " (" << strerror(err) << ")");
+  }
+}
+
 //****************************** Main Program *******************************
 
 int
@@ -269,6 +552,14 @@ realmain(int argc, char* argv[])
   opts.compute_gpu_cfg = args.compute_gpu_cfg;
   opts.gpu_size = args.gpu_size;
 
+  // ------------------------------------------------------------
+  // Convert an existing structure file to binary form
+  // ------------------------------------------------------------
+  if (args.convertToBinary) {
+    writeBinaryStructure(args.in_filenm, args.out_filenm);
+    return 0;
+  }
+
   // ------------------------------------------------------------
   // If in_filenm is a directory, then analyze separately
   // ------------------------------------------------------------
@@ -279,6 +570,41 @@ realmain(int argc, char* argv[])
     return 0;
   }
 
+  // ------------------------------------------------------------
+  // Reuse the cached structure file for an unchanged binary
+  // ------------------------------------------------------------
+  string cache_entry;
+
+  if (! args.cache_dir.empty()) {
+    string key = structCacheKey(args.in_filenm, args);
+
+    if (! key.empty()) {
+      // a cache problem only means the binary is analyzed; another run
+      // may have created the directory first
+      try {
+	FileUtil::mkdir(args.cache_dir);
+      }
+      catch (const Diagnostics::Exception& x) {
+	if (! FileUtil::isDir(args.cache_dir)) {
+	  DIAG_WMsg(1, "not using structure cache " << args.cache_dir
+		    << ": " << x.message());
+	}
+      }
+      if (FileUtil::isDir(args.cache_dir)) {
+	cache_entry = args.cache_dir + "/" + key + ".hpcstruct";
+      }
+    }
+
+    if (! cache_entry.empty() && FileUtil::isReadable(cache_entry)) {
+      if (copyStructFile(args.out_filenm, cache_entry)) {
+	DIAG_Msg(1, "Using cached structure file: " << cache_entry);
+	return 0;
+      }
+      DIAG_WMsg(1, "unable to copy cached structure file " << cache_entry
+		<< ", analyzing the binary instead");
+    }
+  }
+
   // ------------------------------------------------------------
   // Single application binary
   // ------------------------------------------------------------
@@ -327,6 +653,10 @@ realmain(int argc, char* argv[])
   IOUtil::CloseStream(outFile);
   delete[] outBuf;
 
+  if (! cache_entry.empty()) {
+    saveStructCache(args.out_filenm, cache_entry);
+  }
+
   if (gapsFile != NULL) {
     IOUtil::CloseStream(gapsFile);
     delete[] gapsBuf;
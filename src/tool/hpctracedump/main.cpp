@@ -103,11 +103,20 @@ main(int argc, char **argv)
     exit(-1);
   }
 
+  hpctrace_fmt_reader_t* reader = new hpctrace_fmt_reader_t;
+
+  ret = hpctrace_fmt_reader_init(reader, &hdr, infs);
+
+  if (ret != HPCFMT_OK) {
+    fprintf(stderr, "%s: unable to read trace file %s\n", argv[0], fileName);
+    exit(-1);
+  }
+
   // read and dump trace records until EOF 
-  while ( !feof(infs) ) {
+  while (true) {
     hpctrace_fmt_datum_t datum;
 
-    ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, infs);
+    ret = hpctrace_fmt_reader_next(reader, &datum);
 
     if (ret == HPCFMT_EOF) {
       break;
@@ -122,6 +131,7 @@ main(int argc, char **argv)
 
   hpcio_fclose(infs);
 
+  delete reader;
   delete[] infsBuf;
 
   return 0;